@@ -8,6 +8,7 @@ layout (location = 2) in vec3 fragColor;
 layout (location = 3) in vec3 cameraPosition;
 layout (location = 4) in vec3 worldPosition;
 layout (location = 5) in mat3 TBN;
+layout (location = 8) in float ambientOcclusion; // baked per vertex, 1 = unoccluded
 
 const int LightCount = 16;
 
@@ -185,7 +186,7 @@ void main()
     
     // // ambient lighting (note that the next IBL tutorial will replace 
     // // this ambient lighting with environment lighting).
-    vec3 ambient = vec3(0.03) * albedo * materialUBO.ao;
+    vec3 ambient = vec3(0.03) * albedo * materialUBO.ao * ambientOcclusion;
 
     vec3 finalColor = ambient + Lo * fragColor;
 
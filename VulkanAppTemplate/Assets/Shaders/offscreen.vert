@@ -2,9 +2,10 @@
 
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec3 inNormal;
-layout (location = 2) in vec3 inTangent;
+layout (location = 2) in vec4 inTangent; // w = handedness
 layout (location = 3) in vec2 inTexcoord;
 layout (location = 4) in vec3 inColor;
+layout (location = 5) in float inAmbientOcclusion; // baked, binding 1
 
 layout (binding = 0) uniform GlobalUniformBufferObject
 {
@@ -24,6 +25,7 @@ layout (location = 2) out vec3 fragColor;
 layout (location = 3) out vec3 cameraPosition;
 layout (location = 4) out vec3 worldPosition;
 layout (location = 5) out mat3 TBN;
+layout (location = 8) out float ambientOcclusion;
 
 
 void main()
@@ -34,10 +36,11 @@ void main()
     texcoord = inTexcoord;
     cameraPosition = globalUBO.cameraPosition.xyz;
     fragColor = inColor;
+    ambientOcclusion = inAmbientOcclusion;
 
-    vec3 T = normalize(vec3(objectUBO.model * vec4(inTangent, 0.0)));
+    vec3 T = normalize(vec3(objectUBO.model * vec4(inTangent.xyz, 0.0)));
     vec3 N = normalize(normal);
-    vec3 B = normalize(cross(N, T));
+    vec3 B = normalize(cross(N, T)) * inTangent.w;
 
     TBN = mat3(T, B, N);
 }
\ No newline at end of file
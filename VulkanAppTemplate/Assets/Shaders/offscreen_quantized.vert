@@ -0,0 +1,59 @@
+#version 460
+
+// Variant of offscreen.vert for QuantizedVertex input (see QuantizedVertex.h).
+// The vertex fetch already converts the UNORM/SNORM/SFLOAT formats to floats.
+layout (location = 0) in vec4 inPosition; // w = tangent handedness, 0 or 1
+layout (location = 1) in vec2 inNormal;
+layout (location = 2) in vec2 inTangent;
+layout (location = 3) in vec2 inTexcoord;
+layout (location = 5) in float inAmbientOcclusion; // baked, binding 1
+
+layout (binding = 0) uniform GlobalUniformBufferObject
+{
+    mat4 view;
+    mat4 projection;
+    vec4 cameraPosition;
+} globalUBO;
+
+layout (binding = 1) uniform ObjectUniformBufferObject
+{
+    mat4 model;
+    vec4 positionOffset;
+    vec4 positionScale;
+} objectUBO;
+
+layout (location = 0) out vec3 normal;
+layout (location = 1) out vec2 texcoord;
+layout (location = 2) out vec3 fragColor;
+layout (location = 3) out vec3 cameraPosition;
+layout (location = 4) out vec3 worldPosition;
+layout (location = 5) out mat3 TBN;
+layout (location = 8) out float ambientOcclusion;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 position = objectUBO.positionOffset.xyz + inPosition.xyz * objectUBO.positionScale.xyz;
+
+    worldPosition = (objectUBO.model * vec4(position, 1.0)).xyz;
+    gl_Position = globalUBO.projection * globalUBO.view * vec4(worldPosition, 1.0);
+    normal = (objectUBO.model * vec4(octDecode(inNormal), 0.0)).xyz;
+    texcoord = inTexcoord;
+    cameraPosition = globalUBO.cameraPosition.xyz;
+    fragColor = vec3(1.0);
+    ambientOcclusion = inAmbientOcclusion;
+
+    vec3 T = normalize(vec3(objectUBO.model * vec4(octDecode(inTangent), 0.0)));
+    vec3 N = normalize(normal);
+    vec3 B = normalize(cross(N, T)) * (inPosition.w * 2.0 - 1.0);
+
+    TBN = mat3(T, B, N);
+}
@@ -2,7 +2,7 @@
 
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec3 inNormal;
-layout (location = 2) in vec3 inTangent;
+layout (location = 2) in vec4 inTangent; // w = handedness
 layout (location = 3) in vec2 inTexcoord;
 layout (location = 4) in vec3 inColor;
 
@@ -36,9 +36,9 @@ void main()
     cameraPosition = globalUBO.cameraPosition.xyz;
     fragColor = inColor;
 
-    vec3 T = normalize(vec3(objectUBO.model * vec4(inTangent, 0.0)));
+    vec3 T = normalize(vec3(objectUBO.model * vec4(inTangent.xyz, 0.0)));
     vec3 N = normalize(normal);
-    vec3 B = normalize(cross(N, T));
+    vec3 B = normalize(cross(N, T)) * inTangent.w;
 
     TBN = mat3(T, B, N);
 }
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "BakedBvh.h"
+
+#include <limits>
+#include <utility>
+#include <algorithm>
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "labutils/error.hpp"
+
+namespace lut = labutils;
+
+namespace
+{
+	// Initial capacity of the traversal stacks; enough for trees over
+	// millions of primitives.
+	constexpr std::size_t kStackReserve = 64;
+
+	// Whether the box is outside of (-1), intersects (0) or is inside (+1) of
+	// the frustum
+	int classify_( BvhFrustum const& aFrustum, BakedBvhNode const& aNode )
+	{
+		int ret = 1;
+		for( auto const& plane : aFrustum.planes )
+		{
+			auto const normal = glm::vec3( plane );
+
+			// Corners furthest along and against the plane normal
+			auto const positive = glm::mix( aNode.aabbMin, aNode.aabbMax, glm::step( glm::vec3( 0.f ), normal ) );
+			auto const negative = glm::mix( aNode.aabbMax, aNode.aabbMin, glm::step( glm::vec3( 0.f ), normal ) );
+
+			if( glm::dot( normal, positive ) + plane.w < 0.f )
+				return -1;
+			if( glm::dot( normal, negative ) + plane.w < 0.f )
+				ret = 0;
+		}
+
+		return ret;
+	}
+
+	// Distance to the box along the ray, or infinity if it is missed
+	float intersect_box_( BakedBvhNode const& aNode, glm::vec3 const& aOrigin, glm::vec3 const& aInvDir, float aMaxDistance )
+	{
+		auto const t0 = (aNode.aabbMin - aOrigin) * aInvDir;
+		auto const t1 = (aNode.aabbMax - aOrigin) * aInvDir;
+
+		auto const tmin = glm::min( t0, t1 );
+		auto const tmax = glm::max( t0, t1 );
+
+		auto const enter = std::max( std::max( tmin.x, tmin.y ), std::max( tmin.z, 0.f ) );
+		auto const leave = std::min( std::min( tmax.x, tmax.y ), std::min( tmax.z, aMaxDistance ) );
+
+		return enter <= leave ? enter : std::numeric_limits<float>::infinity();
+	}
+
+	// Moeller-Trumbore
+	bool intersect_triangle_( glm::vec3 const& aOrigin, glm::vec3 const& aDir, glm::vec3 const& aV0, glm::vec3 const& aV1, glm::vec3 const& aV2, float& aDistance, glm::vec2& aBarycentrics )
+	{
+		auto const e1 = aV1 - aV0;
+		auto const e2 = aV2 - aV0;
+
+		auto const p = glm::cross( aDir, e2 );
+		auto const det = glm::dot( e1, p );
+		if( std::abs( det ) < std::numeric_limits<float>::min() )
+			return false;
+
+		auto const invDet = 1.f / det;
+		auto const s = aOrigin - aV0;
+
+		auto const u = glm::dot( s, p ) * invDet;
+		if( u < 0.f || u > 1.f )
+			return false;
+
+		auto const q = glm::cross( s, e1 );
+		auto const v = glm::dot( aDir, q ) * invDet;
+		if( v < 0.f || u + v > 1.f )
+			return false;
+
+		aDistance = glm::dot( e2, q ) * invDet;
+		aBarycentrics = glm::vec2( u, v );
+		return true;
+	}
+}
+
+BvhFrustum makeBvhFrustum(const glm::mat4& clipFromMesh)
+{
+	// Gribb & Hartmann. glm matrices are column major; row i is m[.][i].
+	auto const row_ = [&] (int aRow) {
+		return glm::vec4( clipFromMesh[0][aRow], clipFromMesh[1][aRow], clipFromMesh[2][aRow], clipFromMesh[3][aRow] );
+	};
+
+	auto const r0 = row_( 0 ), r1 = row_( 1 ), r2 = row_( 2 ), r3 = row_( 3 );
+
+	BvhFrustum ret;
+	ret.planes[0] = r3 + r0; // left
+	ret.planes[1] = r3 - r0; // right
+	ret.planes[2] = r3 + r1; // bottom
+	ret.planes[3] = r3 - r1; // top
+	ret.planes[4] = r2;      // near (z >= 0)
+	ret.planes[5] = r3 - r2; // far
+
+	// Normalizing makes w a distance; not needed for the tests themselves
+	for( auto& plane : ret.planes )
+	{
+		auto const length = glm::length( glm::vec3( plane ) );
+		if( length > 0.f )
+			plane /= length;
+	}
+
+	return ret;
+}
+
+void cullBakedMeshes(const BakedModelView& model, const BvhFrustum& frustum, std::vector<std::uint32_t>& visibleMeshes)
+{
+	auto const& nodes = model.meshBvh;
+	auto const& meshes = model.meshBvhMeshes;
+
+	if( nodes.empty() )
+	{
+		if( !model.meshes.empty() )
+			throw lut::Error( "cullBakedMeshes(): model has no BVH" );
+		return;
+	}
+
+	// Nodes that are completely inside are accepted with all of their
+	// descendants, without testing those any further.
+	std::vector<std::pair<std::uint32_t,bool>> stack; // node, inside
+	stack.reserve( kStackReserve );
+	stack.emplace_back( 0, false );
+
+	while( !stack.empty() )
+	{
+		auto const [index, inside] = stack.back();
+		stack.pop_back();
+
+		auto const& node = nodes[index];
+
+		auto const result = inside ? 1 : classify_( frustum, node );
+		if( result < 0 )
+			continue;
+
+		if( node.count )
+		{
+			visibleMeshes.insert( visibleMeshes.end(), meshes.begin() + node.offset, meshes.begin() + node.offset + node.count );
+			continue;
+		}
+
+		stack.emplace_back( node.offset, result > 0 );
+		stack.emplace_back( index + 1, result > 0 );
+	}
+}
+
+bool raycastBakedModel(const BakedModelView& model, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhRayHit& hit)
+{
+	auto const& nodes = model.triangleBvh;
+	auto const& triangles = model.triangleBvhTriangles;
+
+	if( nodes.empty() )
+	{
+		if( !model.meshes.empty() )
+			throw lut::Error( "raycastBakedModel(): model has no BVH" );
+		return false;
+	}
+
+	// Division by zero gives infinities, which the slab test handles
+	auto const invDir = 1.f / direction;
+
+	bool found = false;
+	float closest = maxDistance;
+
+	struct Entry_
+	{
+		std::uint32_t node;
+		float distance;
+	};
+
+	auto const rootDistance = intersect_box_( nodes[0], origin, invDir, closest );
+	if( !std::isfinite( rootDistance ) )
+		return false;
+
+	std::vector<Entry_> stack;
+	stack.reserve( kStackReserve );
+	stack.push_back( { 0, rootDistance } );
+
+	while( !stack.empty() )
+	{
+		auto const entry = stack.back();
+		stack.pop_back();
+
+		// The closest hit may have moved since the node was pushed
+		if( entry.distance > closest )
+			continue;
+
+		auto const& node = nodes[entry.node];
+		if( node.count )
+		{
+			for( std::uint32_t i = node.offset; i < node.offset + node.count; ++i )
+			{
+				auto const& tri = triangles[i];
+				auto const& mesh = model.meshes[tri.mesh];
+
+				auto const* idx = mesh.indices.data() + std::size_t(tri.triangle)*3;
+
+				float distance;
+				glm::vec2 bary;
+				if( !intersect_triangle_( origin, direction, mesh.positions[idx[0]], mesh.positions[idx[1]], mesh.positions[idx[2]], distance, bary ) )
+					continue;
+
+				if( distance < 0.f || distance > closest )
+					continue;
+
+				closest = distance;
+				found = true;
+
+				hit.mesh = tri.mesh;
+				hit.triangle = tri.triangle;
+				hit.distance = distance;
+				hit.barycentrics = bary;
+			}
+
+			continue;
+		}
+
+		// Visit the nearer child first
+		std::uint32_t const left = entry.node + 1, right = node.offset;
+		auto const leftDistance = intersect_box_( nodes[left], origin, invDir, closest );
+		auto const rightDistance = intersect_box_( nodes[right], origin, invDir, closest );
+
+		bool const leftFirst = leftDistance <= rightDistance;
+		auto const nearDistance = leftFirst ? leftDistance : rightDistance;
+		auto const farDistance = leftFirst ? rightDistance : leftDistance;
+
+		if( std::isfinite( farDistance ) )
+			stack.push_back( { leftFirst ? right : left, farDistance } );
+		if( std::isfinite( nearDistance ) )
+			stack.push_back( { leftFirst ? left : right, nearDistance } );
+	}
+
+	return found;
+}
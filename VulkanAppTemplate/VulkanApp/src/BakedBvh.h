@@ -0,0 +1,51 @@
+#ifndef BAKED_BVH_HPP_C84A1E53_2B7D_4F96_8E0A_5D13F7B92C64
+#define BAKED_BVH_HPP_C84A1E53_2B7D_4F96_8E0A_5D13F7B92C64
+
+#include <vector>
+
+#include <cstdint>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "BakedModel.h"
+
+/* Queries against the bounding volume hierarchies of a baked model ("BVH "
+ * section, see BakedModel.h). Both queries work in mesh space; transform the
+ * frustum or the ray into it first. The queries throw labutils::Error if the
+ * model has no BVH.
+ */
+
+// Six planes (xyz = normal pointing inwards, w = distance), such that a point
+// p is inside if dot(plane.xyz, p) + plane.w >= 0 for all planes.
+struct BvhFrustum
+{
+	glm::vec4 planes[6];
+};
+
+// Extracts the frustum from a projection * view (* model) matrix, with clip
+// space depth in [0,1] (GLM_FORCE_DEPTH_ZERO_TO_ONE, see glm.h).
+BvhFrustum makeBvhFrustum(const glm::mat4& clipFromMesh);
+
+// Appends the indices of all meshes whose bounding boxes intersect the
+// frustum to `visibleMeshes`. The order is that of the mesh tree.
+void cullBakedMeshes(const BakedModelView& model, const BvhFrustum& frustum, std::vector<std::uint32_t>& visibleMeshes);
+
+struct BvhRayHit
+{
+	std::uint32_t mesh;
+	std::uint32_t triangle;
+
+	float distance; // Along the ray, in units of the direction's length
+
+	// Of the triangle's second and third vertex
+	glm::vec2 barycentrics;
+};
+
+// Finds the closest triangle that the ray origin + t * direction hits for
+// t in [0, maxDistance]. Triangles are hit from either side.
+bool raycastBakedModel(const BakedModelView& model, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhRayHit& hit);
+
+#endif // BAKED_BVH_HPP_C84A1E53_2B7D_4F96_8E0A_5D13F7B92C64
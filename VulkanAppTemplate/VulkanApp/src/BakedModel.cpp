@@ -1,8 +1,17 @@
 #include "BakedModel.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include <cassert>
 #include <cstdio>
 #include <cstring>
 
+#include "BlockCodec.h"
+#include "MappedFile.h"
+#include "RandomAccessFile.h"
 #include "labutils/error.hpp"
 
 namespace lut = labutils;
@@ -12,18 +21,192 @@ namespace
 	// See cw2-bake/main.cpp for more info
 	constexpr char kFileMagic[16] = "\0\0COMP5822Mmesh";
 	constexpr char kFileVariant[16] = "default-cw3";
+	constexpr char kFileVariantAligned[16] = "aligned-cw3";
+	constexpr char kFileVariantPacked[16] = "packed-cw3";
 
 	constexpr std::uint32_t kMaxString = 32*1024;
+	constexpr std::uint32_t kMaxSections = 64;
+	constexpr std::uint64_t kAlignment = 16;
+
+	// Aligned variant
+	struct SectionEntry_
+	{
+		char tag[4];
+		std::uint32_t reserved;
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+	static_assert( sizeof(SectionEntry_) == 24 );
+
+	struct MeshRecord_
+	{
+		std::uint32_t materialId;
+		std::uint32_t vertexCount;
+		std::uint32_t indexCount;
+		std::uint32_t reserved;
+
+		std::uint64_t positionsOffset;
+		std::uint64_t normalsOffset;
+		std::uint64_t texcoordsOffset;
+		std::uint64_t indicesOffset;
+	};
+
+	static_assert( sizeof(MeshRecord_) == 48 );
+
+	struct MeshletHeader_
+	{
+		std::uint32_t meshCount;
+		std::uint32_t meshletCount;
+		std::uint32_t vertexCount;
+		std::uint32_t indexCount;
+
+		std::uint64_t meshletsOffset;
+		std::uint64_t verticesOffset;
+		std::uint64_t indicesOffset;
+		std::uint64_t reserved;
+	};
+
+	struct MeshletRange_
+	{
+		std::uint32_t meshletOffset, meshletCount;
+		std::uint32_t vertexOffset, vertexCount;
+		std::uint32_t indexOffset, indexCount;
+		std::uint32_t reserved[2];
+	};
+
+	struct LodHeader_
+	{
+		std::uint32_t meshCount;
+		std::uint32_t levelCount;
+		std::uint32_t indexCount;
+		std::uint32_t reserved;
+
+		std::uint64_t levelsOffset;
+		std::uint64_t indicesOffset;
+	};
+
+	struct LodRange_
+	{
+		std::uint32_t firstLevel;
+		std::uint32_t levelCount;
+	};
+
+	struct Index16Header_
+	{
+		std::uint32_t meshCount;
+		std::uint32_t indexCount;
+
+		std::uint64_t indicesOffset;
+	};
+
+	struct Index16Range_
+	{
+		std::uint32_t firstIndex;
+		std::uint32_t indexCount;
+	};
+
+	static_assert( sizeof(MeshletHeader_) == 48 );
+	static_assert( sizeof(MeshletRange_) == 32 );
+	static_assert( sizeof(LodHeader_) == 32 );
+	static_assert( sizeof(LodRange_) == 8 );
+	static_assert( sizeof(Index16Header_) == 16 );
+	static_assert( sizeof(Index16Range_) == 8 );
+
+	struct TocEntry_
+	{
+		std::uint32_t materialId;
+		std::uint32_t vertexCount;
+		std::uint32_t indexCount;
+		std::uint32_t reserved0;
+
+		glm::vec3 aabbMin;
+		float reserved1;
+		glm::vec3 aabbMax;
+		float reserved2;
+
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+	static_assert( sizeof(TocEntry_) == 64 );
+
+	struct BvhHeader_
+	{
+		std::uint32_t meshNodeCount;
+		std::uint32_t meshCount;
+		std::uint32_t triangleNodeCount;
+		std::uint32_t triangleCount;
+
+		std::uint64_t meshNodesOffset;
+		std::uint64_t meshesOffset;
+		std::uint64_t triangleNodesOffset;
+		std::uint64_t trianglesOffset;
+	};
+
+	static_assert( sizeof(BvhHeader_) == 48 );
+
+	constexpr std::uint32_t kNoIndices16 = 0xffffffff;
+	constexpr std::size_t kMaxVertices16 = 65536;
+
+	// Packed variant
+	struct PackedHeader_
+	{
+		std::uint64_t imageSize;
+		std::uint32_t blockCount;
+		std::uint32_t reserved;
+	};
+
+	struct PackedBlock_
+	{
+		std::uint64_t imageOffset;
+		std::uint64_t dataOffset;
+		std::uint32_t rawSize;
+		std::uint32_t dataSize;
+		std::uint32_t checksum;
+		std::uint8_t filter;
+		std::uint8_t codec;
+		std::uint16_t reserved;
+	};
+
+	static_assert( sizeof(PackedHeader_) == 16 );
+	static_assert( sizeof(PackedBlock_) == 32 );
+
+	// Decoded image of a packed file, aligned like the start of a mapping
+	struct alignas(16) ImageChunk_
+	{
+		std::byte bytes[16];
+	};
 
 	// functions
 	BakedModel loadBakedModel(FILE* inputFile, const std::string& modelPath);
+
+	BakedModelView map_aligned_( std::shared_ptr<const void> aStorage, BakedSpan<std::byte> aFile, const std::string& modelPath );
+	BakedModelView map_packed_( MappedFile const&, const std::string& modelPath );
+	void check_bvh_( BakedSpan<BakedBvhNode>, std::size_t aPrimitiveCount, char const* aWhat, const std::string& modelPath );
+	BakedModel copy_view_( BakedModelView const& );
+
+	std::string base_path_( const std::string& modelPath );
 }
 
 BakedModel loadBakedModel(const std::string& modelPath)
 {
 	FILE* fin = std::fopen(modelPath.c_str(), "rb" );
 	if(!fin)
-		throw lut::Error( "load_baked_model(): unable to open '%s' for reading", modelPath);
+		throw lut::Error( "load_baked_model(): unable to open '%s' for reading", modelPath.c_str());
+
+	// Aligned and packed files are mapped and copied out; see mapBakedModel().
+	char header[32]{};
+	bool const aligned = 32 == std::fread( header, 1, 32, fin )
+		&& (0 == std::memcmp( header+16, kFileVariantAligned, 16 ) || 0 == std::memcmp( header+16, kFileVariantPacked, 16 ));
+
+	if( aligned )
+	{
+		std::fclose(fin);
+		return copy_view_( mapBakedModel(modelPath) );
+	}
+
+	std::rewind(fin);
 
 	try
 	{
@@ -38,6 +221,78 @@ BakedModel loadBakedModel(const std::string& modelPath)
 	}
 }
 
+BakedModelView mapBakedModel(const std::string& modelPath)
+{
+	auto file = std::make_shared<MappedFile const>( modelPath );
+
+	if( file->size() < 32 )
+		throw lut::Error( "map_baked_model(): %s: file too small (%zu bytes)", modelPath.c_str(), file->size() );
+
+	if( 0 != std::memcmp( file->data(), kFileMagic, 16 ) )
+		throw lut::Error( "map_baked_model(): %s: invalid file signature!", modelPath.c_str() );
+
+	if( 0 == std::memcmp( file->data()+16, kFileVariantAligned, 16 ) )
+	{
+		BakedSpan<std::byte> const bytes{ file->data(), file->size() };
+		return map_aligned_( std::move(file), bytes, modelPath );
+	}
+
+	if( 0 == std::memcmp( file->data()+16, kFileVariantPacked, 16 ) )
+		return map_packed_( *file, modelPath );
+
+	// Older variants cannot be used in place. Fall back to the sequential
+	// loader and hand out views into its arrays.
+	file.reset();
+
+	return viewBakedModel( std::make_shared<BakedModel const>( loadBakedModel(modelPath) ) );
+}
+
+BakedModelView viewBakedModel(std::shared_ptr<const BakedModel> model)
+{
+	BakedModelView ret;
+	ret.textures = model->textures;
+	ret.materials = model->materials;
+
+	std::size_t firstVertex = 0, firstIndex = 0;
+
+	ret.meshes.reserve( model->meshes.size() );
+	for( auto const& mesh : model->meshes )
+	{
+		BakedMeshView view;
+		view.materialId = mesh.materialId;
+		view.firstVertex = firstVertex;
+		view.firstIndex = firstIndex;
+		view.positions = { mesh.positions.data(), mesh.positions.size() };
+		view.normals = { mesh.normals.data(), mesh.normals.size() };
+		view.texcoords = { mesh.texcoords.data(), mesh.texcoords.size() };
+		view.tangents = { mesh.tangents.data(), mesh.tangents.size() };
+		view.indices = { mesh.indices.data(), mesh.indices.size() };
+		view.indices16 = { mesh.indices16.data(), mesh.indices16.size() };
+		view.meshlets = { mesh.meshlets.data(), mesh.meshlets.size() };
+		view.meshletVertices = { mesh.meshletVertices.data(), mesh.meshletVertices.size() };
+		view.meshletIndices = { mesh.meshletIndices.data(), mesh.meshletIndices.size() };
+		view.lods = { mesh.lods.data(), mesh.lods.size() };
+		ret.meshes.emplace_back( view );
+
+		firstVertex += mesh.positions.size();
+		firstIndex += mesh.indices.size();
+	}
+
+	ret.vertices = { model->vertices.data(), model->vertices.size() };
+	ret.indices = { model->indices.data(), model->indices.size() };
+	ret.quantizationBounds = { model->quantizationBounds.data(), model->quantizationBounds.size() };
+	ret.quantizedVertices = { model->quantizedVertices.data(), model->quantizedVertices.size() };
+	ret.lodIndices = { model->lodIndices.data(), model->lodIndices.size() };
+	ret.ambientOcclusion = { model->ambientOcclusion.data(), model->ambientOcclusion.size() };
+	ret.meshBvh = { model->meshBvh.data(), model->meshBvh.size() };
+	ret.meshBvhMeshes = { model->meshBvhMeshes.data(), model->meshBvhMeshes.size() };
+	ret.triangleBvh = { model->triangleBvh.data(), model->triangleBvh.size() };
+	ret.triangleBvhTriangles = { model->triangleBvhTriangles.data(), model->triangleBvhTriangles.size() };
+
+	ret.storage = std::move(model);
+	return ret;
+}
+
 namespace
 {
 	void checked_read_( FILE* aFin, std::size_t aBytes, void* aBuffer )
@@ -68,31 +323,36 @@ namespace
 		return ret;
 	}
 
-	BakedModel loadBakedModel(FILE* inputFile, const std::string& modelPath)
+	std::string base_path_( const std::string& modelPath )
 	{
-		BakedModel ret;
-
-		// Figure out base path
 		char const* pathBeg = modelPath.c_str();
 		char const* pathEnd = std::strrchr( pathBeg, '/' );
 	
-		std::string const prefix = pathEnd
+		return pathEnd
 			? std::string( pathBeg, pathEnd+1 )
 			: ""
 		;
+	}
+
+	BakedModel loadBakedModel(FILE* inputFile, const std::string& modelPath)
+	{
+		BakedModel ret;
+
+		// Figure out base path
+		std::string const prefix = base_path_( modelPath );
 
 		// Read header and verify file magic and variant
 		char magic[16];
 		checked_read_(inputFile, 16, magic);
 
 		if( 0 != std::memcmp(magic, kFileMagic, 16))
-			throw lut::Error("load_baked_model_(): %s: invalid file signature!", modelPath);
+			throw lut::Error("load_baked_model_(): %s: invalid file signature!", modelPath.c_str());
 
 		char variant[16];
 		checked_read_(inputFile, 16, variant);
 
 		if( 0 != std::memcmp( variant, kFileVariant, 16 ) )
-			throw lut::Error( "load_baked_model_(): %s: file variant is '%s', expected '%s'", modelPath, variant, kFileVariant );
+			throw lut::Error( "load_baked_model_(): %s: file variant is '%s', expected '%s'", modelPath.c_str(), variant, kFileVariant );
 
 		// Read texture info
 		auto const textureCount = read_uint32_(inputFile);
@@ -168,3 +428,755 @@ namespace
 		return ret;
 	}
 }
+
+namespace
+{
+	// Bounds-checked cursor over a part of a mapped file
+	class ByteReader_
+	{
+		public:
+			ByteReader_( std::byte const* aBeg, std::byte const* aEnd )
+				: mCur( aBeg ), mEnd( aEnd )
+			{}
+
+			void read( void* aBuffer, std::size_t aBytes )
+			{
+				if( std::size_t(mEnd - mCur) < aBytes )
+					throw lut::Error( "ByteReader_::read(): expected %zu bytes, got %zu", aBytes, std::size_t(mEnd-mCur) );
+
+				std::memcpy( aBuffer, mCur, aBytes );
+				mCur += aBytes;
+			}
+
+			std::uint32_t read_uint32()
+			{
+				std::uint32_t ret;
+				read( &ret, sizeof(std::uint32_t) );
+				return ret;
+			}
+
+			std::string read_string()
+			{
+				auto const length = read_uint32();
+
+				if( length >= kMaxString )
+					throw lut::Error( "ByteReader_::read_string(): unexpectedly long string (%u bytes)", length );
+
+				std::string ret;
+				ret.resize( length );
+
+				read( ret.data(), length );
+				return ret;
+			}
+
+		private:
+			std::byte const* mCur;
+			std::byte const* mEnd;
+	};
+
+	// "TEXT" and "MATL" sections
+	std::vector<BakedTextureInfo> read_textures_( ByteReader_& aIn, std::string const& aPrefix )
+	{
+		auto const textureCount = aIn.read_uint32();
+
+		std::vector<BakedTextureInfo> ret;
+		ret.reserve( textureCount );
+		for( std::uint32_t i = 0; i < textureCount; ++i )
+		{
+			BakedTextureInfo info;
+			info.path = aPrefix + aIn.read_string();
+			aIn.read( &info.channels, sizeof(std::uint8_t) );
+
+			ret.emplace_back( std::move(info) );
+		}
+
+		return ret;
+	}
+
+	std::vector<BakedMaterialInfo> read_materials_( ByteReader_& aIn )
+	{
+		auto const materialCount = aIn.read_uint32();
+
+		std::vector<BakedMaterialInfo> ret;
+		ret.reserve( materialCount );
+		for( std::uint32_t i = 0; i < materialCount; ++i )
+		{
+			BakedMaterialInfo info;
+			info.baseColorTextureId = aIn.read_uint32();
+			info.roughnessTextureId = aIn.read_uint32();
+			info.metalnessTextureId = aIn.read_uint32();
+			info.alphaMaskTextureId = aIn.read_uint32();
+			info.normalMapTextureId = aIn.read_uint32();
+
+			aIn.read( &info.baseColor.x, sizeof(float)*3 );
+			aIn.read( &info.emissiveColor.x, sizeof(float)*3 );
+			aIn.read( &info.roughness, sizeof(float) );
+			aIn.read( &info.metalness, sizeof(float) );
+
+			ret.emplace_back( std::move(info) );
+		}
+
+		return ret;
+	}
+
+	// Returns a pointer to aCount elements of T at aOffset, after checking
+	// that they lie in [aRangeBeg, aRangeEnd) and are suitably aligned.
+	template< typename T >
+	BakedSpan<T> checked_span_( BakedSpan<std::byte> const& aFile, std::uint64_t aRangeBeg, std::uint64_t aRangeEnd, std::uint64_t aOffset, std::uint32_t aCount, char const* aWhat, std::string const& aPath )
+	{
+		std::uint64_t const bytes = std::uint64_t(aCount) * sizeof(T);
+
+		if( 0 != aOffset % kAlignment )
+			throw lut::Error( "map_baked_model(): %s: misaligned %s array at offset %llu", aPath.c_str(), aWhat, (unsigned long long)aOffset );
+
+		if( aOffset < aRangeBeg || aOffset > aRangeEnd || bytes > aRangeEnd - aOffset )
+			throw lut::Error( "map_baked_model(): %s: %s array (%llu bytes at offset %llu) exceeds its section", aPath.c_str(), aWhat, (unsigned long long)bytes, (unsigned long long)aOffset );
+
+		return { reinterpret_cast<T const*>(aFile.data() + aOffset), aCount };
+	}
+
+	BakedModelView map_aligned_( std::shared_ptr<const void> aStorage, BakedSpan<std::byte> aFile, const std::string& modelPath )
+	{
+		auto const& file = aFile;
+		std::uint64_t const fileSize = file.size();
+
+		// Validate section table
+		ByteReader_ header( file.data() + 32, file.data() + file.size() );
+
+		auto const sectionCount = header.read_uint32();
+		(void)header.read_uint32(); // reserved
+
+		if( sectionCount > kMaxSections )
+			throw lut::Error( "map_baked_model(): %s: unexpectedly many sections (%u)", modelPath.c_str(), sectionCount );
+
+		SectionEntry_ const* textures = nullptr;
+		SectionEntry_ const* materials = nullptr;
+		SectionEntry_ const* meshes = nullptr;
+		SectionEntry_ const* vertices = nullptr;
+		SectionEntry_ const* indices = nullptr;
+		SectionEntry_ const* quantized = nullptr;
+		SectionEntry_ const* tangents = nullptr;
+		SectionEntry_ const* meshlets = nullptr;
+		SectionEntry_ const* lods = nullptr;
+		SectionEntry_ const* indices16 = nullptr;
+		SectionEntry_ const* bvh = nullptr;
+		SectionEntry_ const* ambientOcclusion = nullptr;
+
+		std::vector<SectionEntry_> sections( sectionCount );
+		for( auto& section : sections )
+		{
+			header.read( &section, sizeof(SectionEntry_) );
+
+			if( 0 != section.offset % kAlignment || section.offset > fileSize || section.size > fileSize - section.offset )
+				throw lut::Error( "map_baked_model(): %s: section '%.4s' (%llu bytes at offset %llu) is misaligned or truncated", modelPath.c_str(), section.tag, (unsigned long long)section.size, (unsigned long long)section.offset );
+
+			if( 0 == std::memcmp( section.tag, "TEXT", 4 ) )
+				textures = &section;
+			else if( 0 == std::memcmp( section.tag, "MATL", 4 ) )
+				materials = &section;
+			else if( 0 == std::memcmp( section.tag, "MESH", 4 ) )
+				meshes = &section;
+			else if( 0 == std::memcmp( section.tag, "VERT", 4 ) )
+				vertices = &section;
+			else if( 0 == std::memcmp( section.tag, "INDX", 4 ) )
+				indices = &section;
+			else if( 0 == std::memcmp( section.tag, "QVTX", 4 ) )
+				quantized = &section;
+			else if( 0 == std::memcmp( section.tag, "TANG", 4 ) )
+				tangents = &section;
+			else if( 0 == std::memcmp( section.tag, "MSHL", 4 ) )
+				meshlets = &section;
+			else if( 0 == std::memcmp( section.tag, "LODS", 4 ) )
+				lods = &section;
+			else if( 0 == std::memcmp( section.tag, "IX16", 4 ) )
+				indices16 = &section;
+			else if( 0 == std::memcmp( section.tag, "BVH ", 4 ) )
+				bvh = &section;
+			else if( 0 == std::memcmp( section.tag, "AOCC", 4 ) )
+				ambientOcclusion = &section;
+		}
+
+		if( !textures || !materials || !meshes )
+			throw lut::Error( "map_baked_model(): %s: missing required section(s)", modelPath.c_str() );
+		if( !vertices != !indices )
+			throw lut::Error( "map_baked_model(): %s: 'VERT' and 'INDX' sections must be present together", modelPath.c_str() );
+		if( quantized && !vertices )
+			throw lut::Error( "map_baked_model(): %s: 'QVTX' section requires 'VERT'", modelPath.c_str() );
+		if( lods && !indices )
+			throw lut::Error( "map_baked_model(): %s: 'LODS' section requires 'INDX'", modelPath.c_str() );
+		if( ambientOcclusion && !vertices )
+			throw lut::Error( "map_baked_model(): %s: 'AOCC' section requires 'VERT'", modelPath.c_str() );
+
+		auto const reader_ = [&] (SectionEntry_ const* aSection) {
+			auto const* beg = file.data() + aSection->offset;
+			return ByteReader_( beg, beg + aSection->size );
+		};
+
+		BakedModelView ret;
+
+		// Read texture and material info
+		auto texin = reader_( textures );
+		ret.textures = read_textures_( texin, base_path_( modelPath ) );
+
+		auto matin = reader_( materials );
+		ret.materials = read_materials_( matin );
+
+		// Map mesh data. Only the records are read here; the arrays themselves
+		// are not touched until someone uses them.
+		auto meshin = reader_( meshes );
+		auto const meshCount = meshin.read_uint32();
+		std::uint32_t reserved[3];
+		meshin.read( reserved, sizeof(reserved) );
+
+		std::uint64_t const meshBeg = meshes->offset;
+		std::uint64_t const meshEnd = meshes->offset + meshes->size;
+
+		if( std::uint64_t(meshCount) * sizeof(MeshRecord_) > meshes->size )
+			throw lut::Error( "map_baked_model(): %s: mesh section too small for %u meshes", modelPath.c_str(), meshCount );
+
+		std::uint64_t firstVertex = 0, firstIndex = 0;
+
+		ret.meshes.reserve( meshCount );
+		for( std::uint32_t i = 0; i < meshCount; ++i )
+		{
+			MeshRecord_ record;
+			meshin.read( &record, sizeof(MeshRecord_) );
+
+			if( record.materialId >= ret.materials.size() )
+				throw lut::Error( "map_baked_model(): %s: mesh %u references material %u (of %zu)", modelPath.c_str(), i, record.materialId, ret.materials.size() );
+
+			auto const V = record.vertexCount;
+			auto const I = record.indexCount;
+
+			BakedMeshView view;
+			view.materialId = record.materialId;
+			view.firstVertex = std::size_t(firstVertex);
+			view.firstIndex = std::size_t(firstIndex);
+			view.positions = checked_span_<glm::vec3>( file, meshBeg, meshEnd, record.positionsOffset, V, "position", modelPath );
+			view.normals = checked_span_<glm::vec3>( file, meshBeg, meshEnd, record.normalsOffset, V, "normal", modelPath );
+			view.texcoords = checked_span_<glm::vec2>( file, meshBeg, meshEnd, record.texcoordsOffset, V, "texcoord", modelPath );
+			view.indices = checked_span_<std::uint32_t>( file, meshBeg, meshEnd, record.indicesOffset, I, "index", modelPath );
+
+			ret.meshes.emplace_back( view );
+
+			firstVertex += V;
+			firstIndex += I;
+		}
+
+		// Interleaved vertices and global indices. These must cover exactly
+		// the meshes listed above.
+		if( vertices )
+		{
+			if( vertices->size != firstVertex*sizeof(BakedVertex) || indices->size != firstIndex*sizeof(std::uint32_t) )
+				throw lut::Error( "map_baked_model(): %s: 'VERT'/'INDX' sections (%llu/%llu bytes) do not match the meshes (%llu vertices, %llu indices)", modelPath.c_str(), (unsigned long long)vertices->size, (unsigned long long)indices->size, (unsigned long long)firstVertex, (unsigned long long)firstIndex );
+
+			ret.vertices = { reinterpret_cast<BakedVertex const*>(file.data() + vertices->offset), std::size_t(firstVertex) };
+			ret.indices = { reinterpret_cast<std::uint32_t const*>(file.data() + indices->offset), std::size_t(firstIndex) };
+		}
+
+		// Tangents are stored for all meshes in one array; hand out per-mesh
+		// ranges of it.
+		if( tangents )
+		{
+			if( tangents->size != firstVertex*sizeof(glm::vec4) )
+				throw lut::Error( "map_baked_model(): %s: 'TANG' section (%llu bytes) does not match the meshes (%llu vertices)", modelPath.c_str(), (unsigned long long)tangents->size, (unsigned long long)firstVertex );
+
+			auto const* beg = reinterpret_cast<glm::vec4 const*>(file.data() + tangents->offset);
+			for( auto& view : ret.meshes )
+				view.tangents = { beg + view.firstVertex, view.positions.size() };
+		}
+
+		if( quantized )
+		{
+			std::uint64_t const boundsBytes = std::uint64_t(meshCount)*sizeof(QuantizationBounds);
+			if( quantized->size != boundsBytes + firstVertex*sizeof(QuantizedVertex) )
+				throw lut::Error( "map_baked_model(): %s: 'QVTX' section (%llu bytes) does not match the meshes (%u meshes, %llu vertices)", modelPath.c_str(), (unsigned long long)quantized->size, meshCount, (unsigned long long)firstVertex );
+
+			auto const* beg = file.data() + quantized->offset;
+			ret.quantizationBounds = { reinterpret_cast<QuantizationBounds const*>(beg), meshCount };
+			ret.quantizedVertices = { reinterpret_cast<QuantizedVertex const*>(beg + boundsBytes), std::size_t(firstVertex) };
+		}
+
+		if( ambientOcclusion )
+		{
+			if( ambientOcclusion->size != firstVertex )
+				throw lut::Error( "map_baked_model(): %s: 'AOCC' section (%llu bytes) does not match the meshes (%llu vertices)", modelPath.c_str(), (unsigned long long)ambientOcclusion->size, (unsigned long long)firstVertex );
+
+			auto const* beg = reinterpret_cast<std::uint8_t const*>(file.data() + ambientOcclusion->offset);
+			ret.ambientOcclusion = { beg, std::size_t(firstVertex) };
+		}
+
+		// Meshlets of all meshes; each mesh gets its range of the arrays
+		if( meshlets )
+		{
+			auto meshletin = reader_( meshlets );
+
+			MeshletHeader_ mheader;
+			meshletin.read( &mheader, sizeof(MeshletHeader_) );
+
+			if( mheader.meshCount != meshCount )
+				throw lut::Error( "map_baked_model(): %s: 'MSHL' section has %u meshes, expected %u", modelPath.c_str(), mheader.meshCount, meshCount );
+
+			std::uint64_t const sectionBeg = meshlets->offset;
+			std::uint64_t const sectionEnd = meshlets->offset + meshlets->size;
+
+			auto const allMeshlets = checked_span_<BakedMeshlet>( file, sectionBeg, sectionEnd, mheader.meshletsOffset, mheader.meshletCount, "meshlet", modelPath );
+			auto const allVertices = checked_span_<std::uint32_t>( file, sectionBeg, sectionEnd, mheader.verticesOffset, mheader.vertexCount, "meshlet vertex", modelPath );
+			auto const allIndices = checked_span_<std::uint8_t>( file, sectionBeg, sectionEnd, mheader.indicesOffset, mheader.indexCount, "meshlet index", modelPath );
+
+			auto const in_range_ = [] (std::uint32_t aOffset, std::uint32_t aCount, std::size_t aTotal) {
+				return aOffset <= aTotal && aCount <= aTotal - aOffset;
+			};
+
+			for( std::uint32_t i = 0; i < meshCount; ++i )
+			{
+				MeshletRange_ range;
+				meshletin.read( &range, sizeof(MeshletRange_) );
+
+				if( !in_range_( range.meshletOffset, range.meshletCount, allMeshlets.size() ) || !in_range_( range.vertexOffset, range.vertexCount, allVertices.size() ) || !in_range_( range.indexOffset, range.indexCount, allIndices.size() ) )
+					throw lut::Error( "map_baked_model(): %s: 'MSHL' ranges of mesh %u are out of bounds", modelPath.c_str(), i );
+
+				auto& view = ret.meshes[i];
+				view.meshlets = { allMeshlets.data() + range.meshletOffset, range.meshletCount };
+				view.meshletVertices = { allVertices.data() + range.vertexOffset, range.vertexCount };
+				view.meshletIndices = { allIndices.data() + range.indexOffset, range.indexCount };
+			}
+		}
+
+		// Levels of detail. Levels must stay within the "INDX" indices followed
+		// by the LOD indices.
+		if( lods )
+		{
+			auto lodin = reader_( lods );
+
+			LodHeader_ lheader;
+			lodin.read( &lheader, sizeof(LodHeader_) );
+
+			if( lheader.meshCount != meshCount )
+				throw lut::Error( "map_baked_model(): %s: 'LODS' section has %u meshes, expected %u", modelPath.c_str(), lheader.meshCount, meshCount );
+
+			std::uint64_t const sectionBeg = lods->offset;
+			std::uint64_t const sectionEnd = lods->offset + lods->size;
+
+			auto const allLevels = checked_span_<BakedMeshLod>( file, sectionBeg, sectionEnd, lheader.levelsOffset, lheader.levelCount, "LOD level", modelPath );
+			ret.lodIndices = checked_span_<std::uint32_t>( file, sectionBeg, sectionEnd, lheader.indicesOffset, lheader.indexCount, "LOD index", modelPath );
+
+			std::uint64_t const totalIndices = firstIndex + lheader.indexCount;
+			for( auto const& level : allLevels )
+			{
+				if( std::uint64_t(level.firstIndex) + level.indexCount > totalIndices )
+					throw lut::Error( "map_baked_model(): %s: LOD level (%u indices at %u) is out of bounds", modelPath.c_str(), level.indexCount, level.firstIndex );
+			}
+
+			for( std::uint32_t i = 0; i < meshCount; ++i )
+			{
+				LodRange_ range;
+				lodin.read( &range, sizeof(LodRange_) );
+
+				if( range.firstLevel > allLevels.size() || range.levelCount > allLevels.size() - range.firstLevel )
+					throw lut::Error( "map_baked_model(): %s: 'LODS' range of mesh %u is out of bounds", modelPath.c_str(), i );
+
+				ret.meshes[i].lods = { allLevels.data() + range.firstLevel, range.levelCount };
+			}
+		}
+
+		// 16-bit indices of the meshes that have few enough vertices
+		if( indices16 )
+		{
+			auto index16in = reader_( indices16 );
+
+			Index16Header_ iheader;
+			index16in.read( &iheader, sizeof(Index16Header_) );
+
+			if( iheader.meshCount != meshCount )
+				throw lut::Error( "map_baked_model(): %s: 'IX16' section has %u meshes, expected %u", modelPath.c_str(), iheader.meshCount, meshCount );
+
+			auto const allIndices = checked_span_<std::uint16_t>( file, indices16->offset, indices16->offset + indices16->size, iheader.indicesOffset, iheader.indexCount, "16-bit index", modelPath );
+
+			for( std::uint32_t i = 0; i < meshCount; ++i )
+			{
+				Index16Range_ range;
+				index16in.read( &range, sizeof(Index16Range_) );
+
+				if( kNoIndices16 == range.firstIndex )
+					continue;
+
+				auto& view = ret.meshes[i];
+				if( range.indexCount != view.indices.size() || view.positions.size() > kMaxVertices16 || range.firstIndex > allIndices.size() || range.indexCount > allIndices.size() - range.firstIndex )
+					throw lut::Error( "map_baked_model(): %s: 'IX16' range of mesh %u is invalid", modelPath.c_str(), i );
+
+				view.indices16 = { allIndices.data() + range.firstIndex, range.indexCount };
+			}
+		}
+
+		// Bounding volume hierarchies. Everything is checked here, such that
+		// queries can follow the nodes without further checks.
+		if( bvh )
+		{
+			auto bvhin = reader_( bvh );
+
+			BvhHeader_ bheader;
+			bvhin.read( &bheader, sizeof(BvhHeader_) );
+
+			std::uint64_t const sectionBeg = bvh->offset;
+			std::uint64_t const sectionEnd = bvh->offset + bvh->size;
+
+			ret.meshBvh = checked_span_<BakedBvhNode>( file, sectionBeg, sectionEnd, bheader.meshNodesOffset, bheader.meshNodeCount, "mesh BVH node", modelPath );
+			ret.meshBvhMeshes = checked_span_<std::uint32_t>( file, sectionBeg, sectionEnd, bheader.meshesOffset, bheader.meshCount, "mesh BVH mesh", modelPath );
+			ret.triangleBvh = checked_span_<BakedBvhNode>( file, sectionBeg, sectionEnd, bheader.triangleNodesOffset, bheader.triangleNodeCount, "triangle BVH node", modelPath );
+			ret.triangleBvhTriangles = checked_span_<BakedBvhTriangle>( file, sectionBeg, sectionEnd, bheader.trianglesOffset, bheader.triangleCount, "triangle BVH triangle", modelPath );
+
+			check_bvh_( ret.meshBvh, ret.meshBvhMeshes.size(), "mesh", modelPath );
+			check_bvh_( ret.triangleBvh, ret.triangleBvhTriangles.size(), "triangle", modelPath );
+
+			for( auto const mesh : ret.meshBvhMeshes )
+			{
+				if( mesh >= meshCount )
+					throw lut::Error( "map_baked_model(): %s: mesh BVH references mesh %u (of %u)", modelPath.c_str(), mesh, meshCount );
+			}
+
+			for( auto const& tri : ret.triangleBvhTriangles )
+			{
+				if( tri.mesh >= meshCount || std::uint64_t(tri.triangle)*3 + 3 > ret.meshes[tri.mesh].indices.size() )
+					throw lut::Error( "map_baked_model(): %s: triangle BVH references triangle %u of mesh %u", modelPath.c_str(), tri.triangle, tri.mesh );
+			}
+		}
+
+		ret.storage = std::move(aStorage);
+		return ret;
+	}
+
+	BakedModelView map_packed_( MappedFile const& aFile, const std::string& modelPath )
+	{
+		auto const startTime = std::chrono::steady_clock::now();
+
+		// Validate the block table. The blocks must cover the image in order.
+		ByteReader_ header( aFile.data() + 32, aFile.data() + aFile.size() );
+
+		PackedHeader_ pheader;
+		header.read( &pheader, sizeof(PackedHeader_) );
+
+		if( pheader.blockCount > aFile.size() / sizeof(PackedBlock_) || pheader.imageSize < 32 || pheader.imageSize > std::uint64_t(pheader.blockCount) * kMaxBlockSize )
+			throw lut::Error( "map_baked_model(): %s: invalid block table (%u blocks, %llu bytes)", modelPath.c_str(), pheader.blockCount, (unsigned long long)pheader.imageSize );
+
+		std::vector<PackedBlock_> blocks( pheader.blockCount );
+		header.read( blocks.data(), blocks.size() * sizeof(PackedBlock_) );
+
+		std::uint64_t imageOffset = 0;
+		for( auto const& block : blocks )
+		{
+			if( block.imageOffset != imageOffset || block.rawSize > kMaxBlockSize || block.dataOffset > aFile.size() || block.dataSize > aFile.size() - block.dataOffset )
+				throw lut::Error( "map_baked_model(): %s: block at image offset %llu is invalid", modelPath.c_str(), (unsigned long long)block.imageOffset );
+
+			imageOffset += block.rawSize;
+		}
+
+		if( imageOffset != pheader.imageSize )
+			throw lut::Error( "map_baked_model(): %s: blocks cover %llu bytes, expected %llu", modelPath.c_str(), (unsigned long long)imageOffset, (unsigned long long)pheader.imageSize );
+
+		// Decode the blocks straight into the image. Blocks are independent;
+		// threads grab the next one until all are done.
+		auto const imageSize = std::size_t(pheader.imageSize);
+		std::shared_ptr<ImageChunk_[]> image( new ImageChunk_[(imageSize + sizeof(ImageChunk_)-1) / sizeof(ImageChunk_)] );
+		auto* const imageBytes = reinterpret_cast<std::byte*>(image.get());
+
+		std::atomic<std::size_t> nextBlock{ 0 };
+		std::atomic<std::size_t> corruptBlock{ blocks.size() };
+
+		auto const decode_ = [&] {
+			std::vector<std::byte> scratch;
+			for( std::size_t i = nextBlock++; i < blocks.size(); i = nextBlock++ )
+			{
+				auto const& block = blocks[i];
+				auto* const dest = imageBytes + block.imageOffset;
+
+				bool const ok = decodeBlock( BlockFilter(block.filter), BlockCodec(block.codec), aFile.data() + block.dataOffset, block.dataSize, dest, block.rawSize, scratch )
+					&& blockChecksum( dest, block.rawSize ) == block.checksum;
+
+				if( !ok )
+					corruptBlock = i;
+			}
+		};
+
+		auto const hardwareThreads = std::max( 1u, std::thread::hardware_concurrency() );
+		auto const threadCount = std::max<std::size_t>( 1, std::min<std::size_t>( hardwareThreads, blocks.size() ) );
+
+		std::vector<std::thread> threads;
+		threads.reserve( threadCount-1 );
+		for( std::size_t i = 1; i < threadCount; ++i )
+			threads.emplace_back( decode_ );
+
+		decode_();
+
+		for( auto& thread : threads )
+			thread.join();
+
+		if( corruptBlock != blocks.size() )
+			throw lut::Error( "map_baked_model(): %s: block %zu (of %zu) is corrupt", modelPath.c_str(), std::size_t(corruptBlock), blocks.size() );
+
+		if( 0 != std::memcmp( imageBytes, kFileMagic, 16 ) || 0 != std::memcmp( imageBytes+16, kFileVariantAligned, 16 ) )
+			throw lut::Error( "map_baked_model(): %s: packed image is not an '%s' file", modelPath.c_str(), kFileVariantAligned );
+
+		BakedPackingInfo info;
+		info.packedBytes = aFile.size();
+		info.unpackedBytes = imageSize;
+		info.blockCount = blocks.size();
+		info.threadCount = threadCount;
+		info.decodeSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+
+		auto ret = map_aligned_( std::move(image), { imageBytes, imageSize }, modelPath );
+		ret.packing = info;
+		return ret;
+	}
+
+	void check_bvh_( BakedSpan<BakedBvhNode> aNodes, std::size_t aPrimitiveCount, char const* aWhat, const std::string& modelPath )
+	{
+		// Depth-first layout: children come after their parent, which also
+		// rules out cycles.
+		for( std::size_t i = 0; i < aNodes.size(); ++i )
+		{
+			auto const& node = aNodes[i];
+
+			bool const valid = node.count
+				? node.offset <= aPrimitiveCount && node.count <= aPrimitiveCount - node.offset
+				: i+1 < aNodes.size() && node.offset > i+1 && node.offset < aNodes.size();
+
+			if( !valid )
+				throw lut::Error( "map_baked_model(): %s: %s BVH node %zu is invalid", modelPath.c_str(), aWhat, i );
+		}
+	}
+
+	BakedModel copy_view_( BakedModelView const& aView )
+	{
+		BakedModel ret;
+		ret.textures = aView.textures;
+		ret.materials = aView.materials;
+
+		ret.meshes.reserve( aView.meshes.size() );
+		for( auto const& view : aView.meshes )
+		{
+			BakedMeshData data;
+			data.materialId = view.materialId;
+			data.positions.assign( view.positions.begin(), view.positions.end() );
+			data.normals.assign( view.normals.begin(), view.normals.end() );
+			data.texcoords.assign( view.texcoords.begin(), view.texcoords.end() );
+			data.tangents.assign( view.tangents.begin(), view.tangents.end() );
+			data.indices.assign( view.indices.begin(), view.indices.end() );
+			data.indices16.assign( view.indices16.begin(), view.indices16.end() );
+			data.meshlets.assign( view.meshlets.begin(), view.meshlets.end() );
+			data.meshletVertices.assign( view.meshletVertices.begin(), view.meshletVertices.end() );
+			data.meshletIndices.assign( view.meshletIndices.begin(), view.meshletIndices.end() );
+			data.lods.assign( view.lods.begin(), view.lods.end() );
+
+			ret.meshes.emplace_back( std::move(data) );
+		}
+
+		ret.vertices.assign( aView.vertices.begin(), aView.vertices.end() );
+		ret.indices.assign( aView.indices.begin(), aView.indices.end() );
+		ret.quantizationBounds.assign( aView.quantizationBounds.begin(), aView.quantizationBounds.end() );
+		ret.quantizedVertices.assign( aView.quantizedVertices.begin(), aView.quantizedVertices.end() );
+		ret.lodIndices.assign( aView.lodIndices.begin(), aView.lodIndices.end() );
+		ret.ambientOcclusion.assign( aView.ambientOcclusion.begin(), aView.ambientOcclusion.end() );
+		ret.meshBvh.assign( aView.meshBvh.begin(), aView.meshBvh.end() );
+		ret.meshBvhMeshes.assign( aView.meshBvhMeshes.begin(), aView.meshBvhMeshes.end() );
+		ret.triangleBvh.assign( aView.triangleBvh.begin(), aView.triangleBvh.end() );
+		ret.triangleBvhTriangles.assign( aView.triangleBvhTriangles.begin(), aView.triangleBvhTriangles.end() );
+
+		return ret;
+	}
+}
+
+namespace
+{
+	std::uint64_t align_up_( std::uint64_t aOffset )
+	{
+		return (aOffset + kAlignment-1) & ~(kAlignment-1);
+	}
+
+	// Whole section read into memory
+	struct SectionData_
+	{
+		std::vector<std::byte> bytes;
+
+		ByteReader_ reader() const
+		{
+			return ByteReader_( bytes.data(), bytes.data() + bytes.size() );
+		}
+	};
+
+	SectionData_ read_section_( RandomAccessFile const& aFile, SectionEntry_ const& aSection )
+	{
+		SectionData_ ret;
+		ret.bytes.resize( std::size_t(aSection.size) );
+		aFile.read( aSection.offset, ret.bytes.data(), ret.bytes.size() );
+		return ret;
+	}
+}
+
+BakedModelToc readBakedModelToc(const std::string& modelPath)
+{
+	auto file = std::make_shared<RandomAccessFile const>( modelPath );
+	std::uint64_t const fileSize = file->size();
+
+	if( fileSize < 40 )
+		throw lut::Error( "read_baked_model_toc(): %s: file too small (%llu bytes)", modelPath.c_str(), (unsigned long long)fileSize );
+
+	char header[40];
+	file->read( 0, header, sizeof(header) );
+
+	if( 0 != std::memcmp( header, kFileMagic, 16 ) )
+		throw lut::Error( "read_baked_model_toc(): %s: invalid file signature!", modelPath.c_str() );
+	if( 0 != std::memcmp( header+16, kFileVariantAligned, 16 ) )
+		throw lut::Error( "read_baked_model_toc(): %s: file variant is '%.16s', expected '%s'", modelPath.c_str(), header+16, kFileVariantAligned );
+
+	std::uint32_t sectionCount;
+	std::memcpy( &sectionCount, header+32, sizeof(std::uint32_t) );
+
+	if( sectionCount > kMaxSections )
+		throw lut::Error( "read_baked_model_toc(): %s: unexpectedly many sections (%u)", modelPath.c_str(), sectionCount );
+
+	std::vector<SectionEntry_> sections( sectionCount );
+	file->read( 40, sections.data(), sections.size()*sizeof(SectionEntry_) );
+
+	SectionEntry_ const* textures = nullptr;
+	SectionEntry_ const* materials = nullptr;
+	SectionEntry_ const* meshes = nullptr;
+	SectionEntry_ const* tangents = nullptr;
+	SectionEntry_ const* toc = nullptr;
+
+	for( auto const& section : sections )
+	{
+		if( 0 != section.offset % kAlignment || section.offset > fileSize || section.size > fileSize - section.offset )
+			throw lut::Error( "read_baked_model_toc(): %s: section '%.4s' (%llu bytes at offset %llu) is misaligned or truncated", modelPath.c_str(), section.tag, (unsigned long long)section.size, (unsigned long long)section.offset );
+
+		if( 0 == std::memcmp( section.tag, "TEXT", 4 ) )
+			textures = &section;
+		else if( 0 == std::memcmp( section.tag, "MATL", 4 ) )
+			materials = &section;
+		else if( 0 == std::memcmp( section.tag, "MESH", 4 ) )
+			meshes = &section;
+		else if( 0 == std::memcmp( section.tag, "TANG", 4 ) )
+			tangents = &section;
+		else if( 0 == std::memcmp( section.tag, "MTOC", 4 ) )
+			toc = &section;
+	}
+
+	if( !textures || !materials || !meshes )
+		throw lut::Error( "read_baked_model_toc(): %s: missing required section(s)", modelPath.c_str() );
+	if( !toc )
+		throw lut::Error( "read_baked_model_toc(): %s: no 'MTOC' section (rebake the model)", modelPath.c_str() );
+
+	BakedModelToc ret;
+
+	auto const texdata = read_section_( *file, *textures );
+	auto texin = texdata.reader();
+	ret.textures = read_textures_( texin, base_path_( modelPath ) );
+
+	auto const matdata = read_section_( *file, *materials );
+	auto matin = matdata.reader();
+	ret.materials = read_materials_( matin );
+
+	// Table of contents. Each entry must describe the arrays of a mesh in
+	// "MESH", laid out as by MeshBake.
+	auto const tocdata = read_section_( *file, *toc );
+	auto tocin = tocdata.reader();
+
+	std::uint32_t tocHeader[4];
+	tocin.read( tocHeader, sizeof(tocHeader) );
+
+	auto const meshCount = tocHeader[0];
+	if( std::uint64_t(meshCount) * sizeof(TocEntry_) > toc->size )
+		throw lut::Error( "read_baked_model_toc(): %s: 'MTOC' section too small for %u meshes", modelPath.c_str(), meshCount );
+
+	std::uint64_t const meshBeg = meshes->offset;
+	std::uint64_t const meshEnd = meshes->offset + meshes->size;
+
+	std::uint64_t firstVertex = 0, firstIndex = 0;
+
+	ret.meshes.reserve( meshCount );
+	for( std::uint32_t i = 0; i < meshCount; ++i )
+	{
+		TocEntry_ entry;
+		tocin.read( &entry, sizeof(TocEntry_) );
+
+		if( entry.materialId >= ret.materials.size() )
+			throw lut::Error( "read_baked_model_toc(): %s: mesh %u references material %u (of %zu)", modelPath.c_str(), i, entry.materialId, ret.materials.size() );
+
+		auto const V = std::uint64_t(entry.vertexCount);
+		auto const I = std::uint64_t(entry.indexCount);
+
+		auto const indicesOffset = align_up_( align_up_( align_up_( entry.offset + V*sizeof(glm::vec3) ) + V*sizeof(glm::vec3) ) + V*sizeof(glm::vec2) );
+		auto const expectedSize = indicesOffset + I*sizeof(std::uint32_t) - entry.offset;
+
+		if( 0 != entry.offset % kAlignment || entry.offset < meshBeg || entry.offset > meshEnd || entry.size != expectedSize || entry.size > meshEnd - entry.offset )
+			throw lut::Error( "read_baked_model_toc(): %s: 'MTOC' entry of mesh %u (%llu bytes at offset %llu) is invalid", modelPath.c_str(), i, (unsigned long long)entry.size, (unsigned long long)entry.offset );
+
+		BakedMeshTocEntry mesh;
+		mesh.materialId = entry.materialId;
+		mesh.vertexCount = entry.vertexCount;
+		mesh.indexCount = entry.indexCount;
+		mesh.firstVertex = std::size_t(firstVertex);
+		mesh.firstIndex = std::size_t(firstIndex);
+		mesh.aabbMin = entry.aabbMin;
+		mesh.aabbMax = entry.aabbMax;
+		mesh.offset = entry.offset;
+		mesh.size = entry.size;
+
+		ret.meshes.emplace_back( mesh );
+
+		firstVertex += V;
+		firstIndex += I;
+	}
+
+	if( tangents )
+	{
+		if( tangents->size != firstVertex*sizeof(glm::vec4) )
+			throw lut::Error( "read_baked_model_toc(): %s: 'TANG' section (%llu bytes) does not match the meshes (%llu vertices)", modelPath.c_str(), (unsigned long long)tangents->size, (unsigned long long)firstVertex );
+
+		ret.tangentsOffset = tangents->offset;
+	}
+
+	ret.storage = std::move(file);
+	return ret;
+}
+
+BakedMeshData loadBakedMesh(const BakedModelToc& toc, std::size_t meshIndex)
+{
+	if( meshIndex >= toc.meshes.size() )
+		throw lut::Error( "load_baked_mesh(): mesh %zu out of range (%zu meshes)", meshIndex, toc.meshes.size() );
+
+	auto const* file = static_cast<RandomAccessFile const*>(toc.storage.get());
+	if( !file )
+		throw lut::Error( "load_baked_mesh(): table of contents has no file" );
+
+	auto const& entry = toc.meshes[meshIndex];
+	auto const V = std::size_t(entry.vertexCount);
+	auto const I = std::size_t(entry.indexCount);
+
+	// Read straight into the arrays; the offsets were validated by
+	// readBakedModelToc().
+	BakedMeshData ret;
+	ret.materialId = entry.materialId;
+
+	ret.positions.resize( V );
+	ret.normals.resize( V );
+	ret.texcoords.resize( V );
+	ret.indices.resize( I );
+
+	auto offset = entry.offset;
+	file->read( offset, ret.positions.data(), V*sizeof(glm::vec3) );
+	offset = align_up_( offset + V*sizeof(glm::vec3) );
+	file->read( offset, ret.normals.data(), V*sizeof(glm::vec3) );
+	offset = align_up_( offset + V*sizeof(glm::vec3) );
+	file->read( offset, ret.texcoords.data(), V*sizeof(glm::vec2) );
+	offset = align_up_( offset + V*sizeof(glm::vec2) );
+	file->read( offset, ret.indices.data(), I*sizeof(std::uint32_t) );
+
+	if( toc.tangentsOffset )
+	{
+		ret.tangents.resize( V );
+		file->read( toc.tangentsOffset + entry.firstVertex*sizeof(glm::vec4), ret.tangents.data(), V*sizeof(glm::vec4) );
+	}
+
+	return ret;
+}
@@ -1,13 +1,18 @@
 #ifndef BAKED_MODEL_HPP_7D7BFF3A_1743_43DF_8D4F_D67D80FD8282
 #define BAKED_MODEL_HPP_7D7BFF3A_1743_43DF_8D4F_D67D80FD8282
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <cstddef>
 #include <cstdint>
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "QuantizedVertex.h"
 
 /* Baked file format:
  *
@@ -61,6 +66,175 @@
  *   - 1*uint32_t: N = length of string in chars, including terminating \0
  *   - repeat N times: char in string
  *
+ *
+ * Aligned variant ("aligned-cw3"):
+ *
+ * Same data, but laid out so that the arrays can be used in place from a
+ * memory mapped file (see mapBakedModel()). All offsets are absolute (from the
+ * start of the file) and all sections and arrays start at a multiple of 16
+ * bytes. Padding bytes are zero.
+ *
+ *  1. Header:
+ *    - 16*char: file magic = "\0\0COMP5822Mmesh"
+ *    - 16*char: variant = "aligned-cw3"
+ *
+ *  2. Section table
+ *    - 1*uint32_t: S = number of sections
+ *    - 1*uint32_t: reserved
+ *    - repeat S times:
+ *      - 4*char:   section tag ("TEXT", "MATL", "MESH", ...)
+ *      - uint32_t: reserved
+ *      - uint64_t: section offset
+ *      - uint64_t: section size in bytes
+ *
+ *  3. "TEXT" section: identical to 2. above
+ *  4. "MATL" section: identical to 3. above
+ *  5. "MESH" section:
+ *    - 1*uint32_t: M = number of meshes
+ *    - 3*uint32_t: reserved
+ *    - repeat M times (mesh records):
+ *      - uint32_t : material index
+ *      - uint32_t : V = number of vertices
+ *      - uint32_t : I = number of indices
+ *      - uint32_t : reserved
+ *      - uint64_t : offset of V*vec3 positions
+ *      - uint64_t : offset of V*vec3 normals
+ *      - uint64_t : offset of V*vec2 texture coordinates
+ *      - uint64_t : offset of I*uint32_t indices
+ *    - array data referenced by the mesh records
+ *  6. "VERT" section (optional):
+ *    - repeat sum(V) times: BakedVertex (see below), mesh after mesh in the
+ *      order of the mesh records
+ *  7. "INDX" section (optional, present iff "VERT" is):
+ *    - repeat sum(I) times: uint32_t index, mesh after mesh. Indices are
+ *      relative to the start of the "VERT" array, i.e., each mesh's indices
+ *      are offset by the number of vertices in the meshes preceding it.
+ *
+ *  8. "TANG" section (optional):
+ *    - repeat sum(V) times: vec4 tangent, mesh after mesh in the order of
+ *      the mesh records. xyz is the unit tangent, w = +-1 is the handedness
+ *      of the bitangent, i.e., bitangent = w * cross(normal, tangent).
+ *  9. "QVTX" section (optional, requires "VERT"):
+ *    - repeat M times: QuantizationBounds of the mesh (32 bytes)
+ *    - repeat sum(V) times: QuantizedVertex, in the same order as "VERT"
+ *    See QuantizedVertex.h.
+ * 10. "MSHL" section (optional):
+ *    - 1*uint32_t: M = number of meshes
+ *    - 1*uint32_t: L = total number of meshlets
+ *    - 1*uint32_t: V = total number of meshlet vertices
+ *    - 1*uint32_t: I = total number of meshlet indices
+ *    - uint64_t : offset of L*BakedMeshlet
+ *    - uint64_t : offset of V*uint32_t meshlet vertices
+ *    - uint64_t : offset of I*uint8_t meshlet indices
+ *    - uint64_t : reserved
+ *    - repeat M times (ranges of each mesh in the above arrays):
+ *      - 2*uint32_t: first meshlet, number of meshlets
+ *      - 2*uint32_t: first meshlet vertex, number of meshlet vertices
+ *      - 2*uint32_t: first meshlet index, number of meshlet indices
+ *      - 2*uint32_t: reserved
+ *    - array data
+ *    Meshlet vertices are indices into the mesh's vertices. Meshlet indices
+ *    are three uint8_t per triangle, indexing the meshlet's vertices. See
+ *    BakedMeshlet for the remaining details.
+ * 11. "LODS" section (optional, requires "INDX"):
+ *    - 1*uint32_t: M = number of meshes
+ *    - 1*uint32_t: L = total number of levels
+ *    - 1*uint32_t: I = number of LOD indices
+ *    - 1*uint32_t: reserved
+ *    - uint64_t : offset of L*BakedMeshLod
+ *    - uint64_t : offset of I*uint32_t LOD indices
+ *    - repeat M times: 2*uint32_t: first level, number of levels of the mesh
+ *    - array data
+ *    Level 0 of each mesh is the full mesh (its range in "INDX"). The LOD
+ *    indices of the other levels share the "VERT" vertices and are rebased
+ *    the same way as "INDX". BakedMeshLod::firstIndex counts from the start
+ *    of "INDX", i.e., an index buffer holding "INDX" followed by the LOD
+ *    indices can draw every level by changing only firstIndex/indexCount.
+ * 12. "IX16" section (optional):
+ *    - 1*uint32_t: M = number of meshes
+ *    - 1*uint32_t: I = number of 16-bit indices
+ *    - uint64_t : offset of I*uint16_t indices
+ *    - repeat M times: 2*uint32_t: first index, number of indices of the mesh
+ *    - array data
+ *    The indices of each mesh with at most 65536 vertices, relative to the
+ *    mesh's first vertex (i.e., not rebased like "INDX"). Draw them with
+ *    vertexOffset = the mesh's first vertex in "VERT". Meshes with more
+ *    vertices have first index 0xffffffff and must use 32-bit indices.
+ * 13. "MTOC" section (optional; when present, it is the first section in the
+ *     file, right after the section table):
+ *    - 1*uint32_t: M = number of meshes
+ *    - 3*uint32_t: reserved
+ *    - repeat M times (64 bytes each):
+ *      - uint32_t : material index
+ *      - uint32_t : V = number of vertices
+ *      - uint32_t : I = number of indices
+ *      - uint32_t : reserved
+ *      - 3*float  : minimum of the mesh's bounding box
+ *      - float    : reserved
+ *      - 3*float  : maximum of the mesh's bounding box
+ *      - float    : reserved
+ *      - uint64_t : offset of the mesh's arrays in "MESH"
+ *      - uint64_t : size of the mesh's arrays in bytes
+ *    Each mesh's arrays in "MESH" follow each other (positions, normals,
+ *    texture coordinates, indices; each aligned to 16 bytes), so a single
+ *    byte range covers them. Together with the header, section table, "TEXT"
+ *    and "MATL", this is enough to load meshes one by one; see
+ *    readBakedModelToc().
+ * 14. "BVH " section (optional):
+ *    - 1*uint32_t: N = number of mesh tree nodes
+ *    - 1*uint32_t: M = number of meshes in the mesh tree
+ *    - 1*uint32_t: T = number of triangle tree nodes
+ *    - 1*uint32_t: P = number of triangles in the triangle tree
+ *    - uint64_t : offset of N*BakedBvhNode (mesh tree)
+ *    - uint64_t : offset of M*uint32_t mesh indices
+ *    - uint64_t : offset of T*BakedBvhNode (triangle tree)
+ *    - uint64_t : offset of P*BakedBvhTriangle
+ *    - array data
+ *    Two bounding volume hierarchies in mesh space, built with the surface
+ *    area heuristic: one over the bounding boxes of the meshes (one mesh per
+ *    leaf), for culling, and one over all triangles, for ray queries. See
+ *    BakedBvhNode for the node layout and BakedBvh.h for queries.
+ * 15. "AOCC" section (optional, requires "VERT"):
+ *    - repeat sum(V) times: uint8_t ambient occlusion, in the same order as
+ *      "VERT". 255 is unoccluded, 0 fully occluded. Baked by casting rays
+ *      from each vertex against the whole model (see MeshBake/BakeAo.h).
+ *
+ * "VERT" and "INDX" duplicate the mesh data in the layout used by the runtime
+ * vertex and index buffers, so that they can be copied into a staging buffer
+ * as-is.
+ *
+ * Unknown sections are ignored by the loader.
+ *
+ *
+ * Packed variant ("packed-cw3"):
+ *
+ * A block-compressed "aligned-cw3" file (the image). The image is split into
+ * blocks of at most 4 MB that never straddle a section, so that each block
+ * holds one kind of data and can use the filter that suits it (e.g., delta
+ * coding for indices). See BlockCodec.h for the filters and the codec.
+ *
+ *  1. Header:
+ *    - 16*char: file magic = "\0\0COMP5822Mmesh"
+ *    - 16*char: variant = "packed-cw3"
+ *  2. Block table
+ *    - uint64_t : size of the image in bytes
+ *    - uint32_t : B = number of blocks
+ *    - uint32_t : reserved
+ *    - repeat B times, in image order (the blocks cover the whole image):
+ *      - uint64_t : offset in the image
+ *      - uint64_t : offset of the block data in the file
+ *      - uint32_t : size in the image (raw size)
+ *      - uint32_t : size of the block data
+ *      - uint32_t : checksum of the raw bytes (xxHash32)
+ *      - uint8_t  : BlockFilter
+ *      - uint8_t  : BlockCodec
+ *      - uint16_t : reserved
+ *  3. Block data
+ *
+ * mapBakedModel() decodes the blocks in parallel into one buffer holding the
+ * image, and then maps that like an "aligned-cw3" file. Packed files trade
+ * decoding time for less I/O; they cannot be used in place.
+ *
  * See cw2-bake/main.cpp (specifically write_model_data_()) for additional
  * information.
  *
@@ -102,6 +276,79 @@ struct BakedMaterialInfo
 	float roughness, metalness;
 };
 
+// Interleaved vertex as stored in the "VERT" section. The layout matches the
+// runtime Vertex (see Vertex.h).
+struct BakedVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec4 tangent; // w = handedness, see "TANG"
+	glm::vec2 texcoord;
+	glm::vec3 color;
+};
+
+static_assert( sizeof(BakedVertex) == 60 );
+
+// Meshlet ("MSHL" section): a cluster of at most 64 vertices and 124 triangles
+// (with the default MeshBake settings).
+struct BakedMeshlet
+{
+	// Bounding sphere in mesh space
+	glm::vec3 center;
+	float radius;
+
+	// Normal cone. The meshlet faces away from a viewer at `eye` (and can be
+	// culled) if
+	//   dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius
+	// Meshlets that cannot be culled this way have coneCutoff = 1.
+	glm::vec3 coneAxis;
+	float coneCutoff;
+
+	// Offsets into the mesh's meshletVertices and meshletIndices
+	std::uint32_t vertexOffset;
+	std::uint32_t indexOffset;
+	std::uint32_t vertexCount;
+	std::uint32_t triangleCount;
+};
+
+static_assert( sizeof(BakedMeshlet) == 48 );
+
+// Level of detail ("LODS" section)
+struct BakedMeshLod
+{
+	std::uint32_t firstIndex;
+	std::uint32_t indexCount;
+
+	// Approximate distance to the full resolution mesh, in mesh units
+	float error;
+	std::uint32_t reserved;
+};
+
+static_assert( sizeof(BakedMeshLod) == 16 );
+
+// Node of a bounding volume hierarchy ("BVH " section). Nodes are stored depth
+// first: node 0 is the root, and the first child of an inner node is the node
+// right after it.
+struct BakedBvhNode
+{
+	glm::vec3 aabbMin;
+	std::uint32_t offset; // Leaf: first primitive; inner node: second child
+	glm::vec3 aabbMax;
+	std::uint32_t count;  // Leaf: number of primitives (> 0); inner node: 0
+};
+
+static_assert( sizeof(BakedBvhNode) == 32 );
+
+// Primitive of the triangle tree: triangle `triangle` (i.e., indices
+// 3*triangle to 3*triangle+2) of mesh `mesh`.
+struct BakedBvhTriangle
+{
+	std::uint32_t mesh;
+	std::uint32_t triangle;
+};
+
+static_assert( sizeof(BakedBvhTriangle) == 8 );
+
 struct BakedMeshData
 {
 	std::uint32_t materialId;
@@ -109,8 +356,21 @@ struct BakedMeshData
 	std::vector<glm::vec3> positions;
 	std::vector<glm::vec2> texcoords;
 	std::vector<glm::vec3> normals;
+	std::vector<glm::vec4> tangents; // Empty if the file has no "TANG" section
 
 	std::vector<std::uint32_t> indices;
+
+	// Empty if the file has no "IX16" section or if the mesh has more than
+	// 65536 vertices.
+	std::vector<std::uint16_t> indices16;
+
+	// Empty if the file has no "MSHL" section
+	std::vector<BakedMeshlet> meshlets;
+	std::vector<std::uint32_t> meshletVertices;
+	std::vector<std::uint8_t> meshletIndices;
+
+	// Empty if the file has no "LODS" section
+	std::vector<BakedMeshLod> lods;
 };
 
 struct BakedModel
@@ -118,9 +378,181 @@ struct BakedModel
 	std::vector<BakedTextureInfo> textures;
 	std::vector<BakedMaterialInfo> materials;
 	std::vector<BakedMeshData> meshes;
+
+	// Interleaved vertices and global indices of all meshes. Empty unless the
+	// file contains the optional "VERT"/"INDX" sections.
+	std::vector<BakedVertex> vertices;
+	std::vector<std::uint32_t> indices;
+
+	// One entry per mesh and one per vertex, respectively. Empty unless the
+	// file contains the optional "QVTX" section.
+	std::vector<QuantizationBounds> quantizationBounds;
+	std::vector<QuantizedVertex> quantizedVertices;
+
+	// Indices of LOD levels 1+ (see BakedMeshLod). Empty unless the file
+	// contains the optional "LODS" section.
+	std::vector<std::uint32_t> lodIndices;
+
+	// Per-vertex ambient occlusion, parallel to `vertices`. Empty unless the
+	// file contains the optional "AOCC" section.
+	std::vector<std::uint8_t> ambientOcclusion;
+
+	// Bounding volume hierarchies. Empty unless the file contains the
+	// optional "BVH " section.
+	std::vector<BakedBvhNode> meshBvh;
+	std::vector<std::uint32_t> meshBvhMeshes;
+	std::vector<BakedBvhNode> triangleBvh;
+	std::vector<BakedBvhTriangle> triangleBvhTriangles;
 };
 
+// Loads either file variant into freshly allocated arrays.
 BakedModel loadBakedModel(const std::string& path);
 
+
+// Non-owning view of a contiguous array (a minimal std::span for C++17).
+template<typename T>
+struct BakedSpan
+{
+	const T* ptr = nullptr;
+	std::size_t count = 0;
+
+	const T* data() const noexcept { return ptr; }
+	std::size_t size() const noexcept { return count; }
+	bool empty() const noexcept { return 0 == count; }
+
+	const T* begin() const noexcept { return ptr; }
+	const T* end() const noexcept { return ptr + count; }
+
+	const T& operator[](std::size_t i) const noexcept { return ptr[i]; }
+};
+
+struct BakedMeshView
+{
+	std::uint32_t materialId;
+
+	// Position of the mesh in BakedModelView::vertices and ::indices
+	std::size_t firstVertex = 0;
+	std::size_t firstIndex = 0;
+
+	BakedSpan<glm::vec3> positions;
+	BakedSpan<glm::vec2> texcoords;
+	BakedSpan<glm::vec3> normals;
+	BakedSpan<glm::vec4> tangents; // Empty if the file has no "TANG" section
+
+	BakedSpan<std::uint32_t> indices;
+
+	// Relative to firstVertex. Empty if the file has no "IX16" section or if
+	// the mesh has more than 65536 vertices.
+	BakedSpan<std::uint16_t> indices16;
+
+	// Empty if the file has no "MSHL" section
+	BakedSpan<BakedMeshlet> meshlets;
+	BakedSpan<std::uint32_t> meshletVertices;
+	BakedSpan<std::uint8_t> meshletIndices;
+
+	// Empty if the file has no "LODS" section
+	BakedSpan<BakedMeshLod> lods;
+};
+
+// Statistics of decoding a "packed-cw3" file. All zero for other variants.
+struct BakedPackingInfo
+{
+	std::size_t packedBytes = 0;   // Size of the file
+	std::size_t unpackedBytes = 0; // Size of the decoded image
+	std::size_t blockCount = 0;
+	std::size_t threadCount = 0;
+	double decodeSeconds = 0.0;
+};
+
+// Baked model whose mesh arrays point directly into the storage kept alive by
+// `storage`. For "aligned-cw3" files, this is the memory mapped file itself,
+// so no mesh data is read or copied until it is touched. "packed-cw3" files
+// are decoded into a buffer first. Older variants are loaded with
+// loadBakedModel() and the views point into that copy instead.
+//
+// Textures and materials are small and are always decoded into owned arrays.
+struct BakedModelView
+{
+	std::shared_ptr<const void> storage;
+
+	std::vector<BakedTextureInfo> textures;
+	std::vector<BakedMaterialInfo> materials;
+	std::vector<BakedMeshView> meshes;
+
+	BakedSpan<BakedVertex> vertices;
+	BakedSpan<std::uint32_t> indices;
+
+	BakedSpan<QuantizationBounds> quantizationBounds;
+	BakedSpan<QuantizedVertex> quantizedVertices;
+
+	BakedSpan<std::uint32_t> lodIndices;
+
+	// Parallel to `vertices`; empty unless the file contains the "AOCC" section
+	BakedSpan<std::uint8_t> ambientOcclusion;
+
+	// Empty unless the file contains the "BVH " section; see BakedBvh.h
+	BakedSpan<BakedBvhNode> meshBvh;
+	BakedSpan<std::uint32_t> meshBvhMeshes;
+	BakedSpan<BakedBvhNode> triangleBvh;
+	BakedSpan<BakedBvhTriangle> triangleBvhTriangles;
+
+	BakedPackingInfo packing;
+};
+
+BakedModelView mapBakedModel(const std::string& path);
+
+// Views into the arrays of a model returned by loadBakedModel(). The view keeps
+// `model` alive.
+BakedModelView viewBakedModel(std::shared_ptr<const BakedModel> model);
+
+
+// Mesh in the table of contents ("MTOC" section)
+struct BakedMeshTocEntry
+{
+	std::uint32_t materialId;
+	std::uint32_t vertexCount;
+	std::uint32_t indexCount;
+
+	// Position of the mesh in the "VERT"/"INDX" arrays (see BakedMeshView)
+	std::size_t firstVertex = 0;
+	std::size_t firstIndex = 0;
+
+	glm::vec3 aabbMin;
+	glm::vec3 aabbMax;
+
+	// Byte range of the mesh's arrays in the file
+	std::uint64_t offset;
+	std::uint64_t size;
+};
+
+// Table of contents of an "aligned-cw3" file with an "MTOC" section. Reading
+// it touches only the first few kB of the file (header, section table, table
+// of contents, textures and materials); meshes are then loaded individually
+// with loadBakedMesh(), e.g., in the order in which they become visible.
+//
+// `storage` keeps the file open. Meshes may be loaded from any number of
+// threads concurrently.
+struct BakedModelToc
+{
+	std::shared_ptr<const void> storage;
+
+	std::vector<BakedTextureInfo> textures;
+	std::vector<BakedMaterialInfo> materials;
+	std::vector<BakedMeshTocEntry> meshes;
+
+	// Offset of the "TANG" section; 0 if the file has none
+	std::uint64_t tangentsOffset = 0;
+};
+
+// Throws labutils::Error if the file is not an "aligned-cw3" file or has no
+// table of contents. (Rebake older files. "packed-cw3" files must be decoded
+// as a whole; use mapBakedModel() for those.)
+BakedModelToc readBakedModelToc(const std::string& path);
+
+// Reads one mesh's positions, normals, texture coordinates, indices and (if
+// present) tangents. The other per-mesh data (16-bit indices, meshlets, LODs)
+// is only available through mapBakedModel() and loadBakedModel().
+BakedMeshData loadBakedMesh(const BakedModelToc& toc, std::size_t meshIndex);
+
 #endif // BAKED_MODEL_HPP_7D7BFF3A_1743_43DF_8D4F_D67D80FD8282
 
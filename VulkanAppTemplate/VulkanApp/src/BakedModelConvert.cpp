@@ -0,0 +1,303 @@
+#include "BakedModelConvert.h"
+
+#include <iterator>
+#include <algorithm>
+#include <unordered_map>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <tgen.h>
+
+// bakedModel2SimpleModel() copies BakedVertex arrays straight into Vertex arrays
+static_assert(sizeof(Vertex) == sizeof(BakedVertex), "Vertex and BakedVertex layouts differ");
+static_assert(offsetof(Vertex, position) == offsetof(BakedVertex, position) &&
+	offsetof(Vertex, normal) == offsetof(BakedVertex, normal) &&
+	offsetof(Vertex, tangent) == offsetof(BakedVertex, tangent) &&
+	offsetof(Vertex, texcoord) == offsetof(BakedVertex, texcoord) &&
+	offsetof(Vertex, color) == offsetof(BakedVertex, color), "Vertex and BakedVertex layouts differ");
+
+SimpleMaterialInfo bakedMaterial2SimpleMaterial(const BakedMaterialInfo& bakedMaterial, const std::vector<BakedTextureInfo>& bakedTextures)
+{
+	SimpleMaterialInfo material;
+
+	auto textured = bakedMaterial.baseColorTextureId != 0xffffffff;
+
+	if (textured)
+	{
+		const auto& baseColorTexture = bakedTextures[bakedMaterial.baseColorTextureId];
+
+		material.diffuseTextureIndex = bakedMaterial.baseColorTextureId;
+		material.diffuseTexturePath = baseColorTexture.path;
+	}
+
+	auto alphaTextured = bakedMaterial.alphaMaskTextureId != 0xffffffff;
+
+	if (alphaTextured)
+	{
+		const auto& alphaTexture = bakedTextures[bakedMaterial.alphaMaskTextureId];
+
+		material.alphaTextureIndex = bakedMaterial.alphaMaskTextureId;
+		material.alphaTexturePath = alphaTexture.path;
+	}
+
+	auto normalTextured = bakedMaterial.normalMapTextureId != 0xffffffff;
+
+	if (normalTextured)
+	{
+		const auto& normalTexture = bakedTextures[bakedMaterial.normalMapTextureId];
+
+		material.normalTextureIndex = bakedMaterial.normalMapTextureId;
+		material.normalTexturePath = normalTexture.path;
+	}
+
+	auto roughnessTextured = bakedMaterial.roughnessTextureId != 0xffffffff;
+
+	if (roughnessTextured)
+	{
+		const auto& roughnessTexture = bakedTextures[bakedMaterial.roughnessTextureId];
+
+		material.roughnessTextureIndex = bakedMaterial.roughnessTextureId;
+		material.roughnessTexturePath = roughnessTexture.path;
+	}
+
+	auto metallicTextured = bakedMaterial.metalnessTextureId != 0xffffffff;
+
+	if (metallicTextured)
+	{
+		const auto& metallicTexture = bakedTextures[bakedMaterial.metalnessTextureId];
+
+		material.metallicTextureIndex = bakedMaterial.metalnessTextureId;
+		material.metallicTexturePath = metallicTexture.path;
+	}
+
+	material.diffuseColor = bakedMaterial.baseColor;
+	material.emissionColor = bakedMaterial.emissiveColor;
+	material.metallic = bakedMaterial.metalness;
+	material.roughness = bakedMaterial.roughness;
+
+	return material;
+}
+
+SimpleModel bakedModel2SimpleModel(const BakedModelView& bakedModel, bool keepQuantizedVertices, bool keepIndices16)
+{
+	SimpleModel model;
+
+	const auto& bakedMaterials = bakedModel.materials;
+	const auto& bakedMeshes = bakedModel.meshes;
+	const auto& bakedextures = bakedModel.textures;
+
+	// Files baked with the "VERT"/"INDX" sections store all meshes in the final
+	// vertex layout with indices into one global vertex buffer
+	const bool interleaved = !bakedModel.vertices.empty();
+
+	if (interleaved)
+	{
+		model.vertices.resize(bakedModel.vertices.size());
+		model.indices.resize(bakedModel.indices.size());
+
+		std::memcpy(static_cast<void*>(model.vertices.data()), bakedModel.vertices.data(), bakedModel.vertices.size() * sizeof(Vertex));
+		std::memcpy(model.indices.data(), bakedModel.indices.data(), bakedModel.indices.size() * sizeof(uint32_t));
+
+		model.ambientOcclusion.assign(bakedModel.ambientOcclusion.begin(), bakedModel.ambientOcclusion.end());
+
+		// Picked up by quantizeModel() instead of quantizing again
+		if (keepQuantizedVertices && bakedModel.quantizedVertices.size() == bakedModel.vertices.size())
+		{
+			model.quantizedVertices.assign(bakedModel.quantizedVertices.begin(), bakedModel.quantizedVertices.end());
+		}
+	}
+	else
+	{
+		std::size_t vertexCount = 0, indexCount = 0;
+
+		for (const auto& bakedMesh : bakedMeshes)
+		{
+			vertexCount += bakedMesh.positions.size();
+			indexCount += bakedMesh.indices.size();
+		}
+
+		model.vertices.reserve(vertexCount);
+		model.indices.reserve(indexCount);
+	}
+
+	if (keepIndices16)
+	{
+		std::size_t indices16Count = 0;
+		for (const auto& bakedMesh : bakedMeshes)
+		{
+			indices16Count += bakedMesh.indices16.size();
+		}
+
+		model.indices16.reserve(indices16Count);
+	}
+
+	// The meshes' vertices and indices follow each other in the file, so the
+	// meshes only need to refer to their ranges
+	std::size_t vertexStartIndex = 0;
+	std::size_t indexStartIndex = 0;
+
+	for (size_t i = 0; i < bakedMeshes.size(); i++)
+	{
+		const auto& bakedMesh = bakedMeshes[i];
+
+		const auto& bakedMatrial = bakedMaterials[bakedMesh.materialId];
+
+		SimpleMeshInfo mesh;
+
+		if (interleaved)
+		{
+			// Already in the vertex buffer layout and rebased
+			assert(bakedMesh.firstVertex == vertexStartIndex && bakedMesh.firstIndex == indexStartIndex);
+
+			if (!model.quantizedVertices.empty())
+			{
+				mesh.quantizationBounds = bakedModel.quantizationBounds[i];
+				mesh.bakedQuantizedVertices = true;
+			}
+		}
+		else
+		{
+			for (size_t j = 0; j < bakedMesh.positions.size(); j++)
+			{
+				auto position = bakedMesh.positions[j];
+				auto normal = bakedMesh.normals[j];
+				auto texcoord = bakedMesh.texcoords[j];
+
+				Vertex vertex{ position, normal, texcoord, glm::vec3(1.0f) };
+
+				if (!bakedMesh.tangents.empty())
+				{
+					vertex.tangent = bakedMesh.tangents[j];
+				}
+
+				model.vertices.emplace_back(vertex);
+			}
+
+			const auto indexOffset = static_cast<uint32_t>(vertexStartIndex);
+
+			std::transform(bakedMesh.indices.begin(), bakedMesh.indices.end(), std::back_inserter(model.indices), [=](uint32_t index) { return index + indexOffset; });
+		}
+
+		// 16-bit indices are relative to the mesh's first vertex (vertexStartIndex);
+		// splitIndexBuffers() turns that into the vertexOffset to draw them with
+		if (keepIndices16 && bakedMesh.indices16.size() == bakedMesh.indices.size() && !bakedMesh.indices16.empty())
+		{
+			mesh.bakedIndices16 = true;
+			mesh.indices16StartIndex = model.indices16.size();
+			model.indices16.insert(model.indices16.end(), bakedMesh.indices16.begin(), bakedMesh.indices16.end());
+		}
+
+		// The interleaved layout always carries tangents
+		mesh.bakedTangents = interleaved || !bakedMesh.tangents.empty();
+
+		auto material =	bakedMaterial2SimpleMaterial(bakedMatrial, bakedextures);
+
+		mesh.materialIndex = i;
+		mesh.textured = !material.diffuseTexturePath.empty();
+		mesh.alphaTextured = !material.alphaTexturePath.empty();
+		mesh.normalTextured = !material.normalTexturePath.empty();
+		mesh.roughnessTextured = !material.roughnessTexturePath.empty();
+		mesh.metallicTextured = !material.metallicTexturePath.empty();
+
+		mesh.vertexStartIndex = vertexStartIndex;
+		mesh.vertexCount = bakedMesh.positions.size();
+		mesh.indexStartIndex = indexStartIndex;
+		mesh.indexCount = bakedMesh.indices.size();
+
+		vertexStartIndex += mesh.vertexCount;
+		indexStartIndex += mesh.indexCount;
+
+		model.indexCount += mesh.indexCount;
+
+		model.meshes.emplace_back(std::move(mesh));
+		model.materials.emplace_back(std::move(material));
+	}
+
+	return model;
+}
+
+void generateTangents(SimpleModel& model)
+{
+	// Only meshes without baked tangents go through tgen. Their vertices are
+	// compacted so that the work is proportional to what actually needs it.
+	std::vector<tgen::VIndexT> vertexIndices;
+	std::vector<uint32_t> vertexIds;
+	std::unordered_map<uint32_t, tgen::VIndexT> compactIndices;
+
+	for (const auto& mesh : model.meshes)
+	{
+		if (mesh.bakedTangents)
+		{
+			continue;
+		}
+
+		for (size_t i = mesh.indexStartIndex; i < mesh.indexStartIndex + mesh.indexCount; i++)
+		{
+			auto index = model.indices[i];
+			auto result = compactIndices.emplace(index, vertexIds.size());
+
+			if (result.second)
+			{
+				vertexIds.push_back(index);
+			}
+
+			vertexIndices.push_back(result.first->second);
+		}
+	}
+
+	if (vertexIds.empty())
+	{
+		return;
+	}
+
+	std::vector<tgen::VIndexT> uvIndices = vertexIndices;
+
+	std::vector<tgen::RealT> vertices(vertexIds.size() * 3);
+	std::vector<tgen::RealT> normals(vertexIds.size() * 3);
+	std::vector<tgen::RealT> uvs(vertexIds.size() * 2);
+
+	for (size_t v = 0; v < vertexIds.size(); v++)
+	{
+		const auto& vertex = model.vertices[vertexIds[v]];
+
+		for (int i = 0; i < 3; i++)
+		{
+			vertices[v * 3 + i] = vertex.position[i];
+			normals[v * 3 + i] = vertex.normal[i];
+		}
+
+		for (int k = 0; k < 2; k++)
+		{
+			uvs[v * 2 + k] = vertex.texcoord[k];
+		}
+	}
+
+	std::vector<tgen::RealT> cornerTangents;
+	std::vector<tgen::RealT> cornerBitangents;
+
+	tgen::computeCornerTSpace(vertexIndices, uvIndices, vertices, uvs, cornerTangents, cornerBitangents);
+
+	std::vector<tgen::RealT> vertexTangents;
+	std::vector<tgen::RealT> vertexBitangents;
+
+	tgen::computeVertexTSpace(uvIndices, cornerTangents, cornerBitangents, vertexIds.size(), vertexTangents, vertexBitangents);
+
+	tgen::orthogonalizeTSpace(normals, vertexTangents, vertexBitangents);
+
+	std::vector<tgen::RealT> tangents;
+
+	tgen::computeTangent4D(normals, vertexTangents, vertexBitangents, tangents);
+	
+	for (size_t i = 0; i < vertexIds.size(); i++)
+	{
+		auto& vertex = model.vertices[vertexIds[i]];
+
+		vertex.tangent.x = static_cast<float>(tangents[i * 4]);
+		vertex.tangent.y = static_cast<float>(tangents[i * 4 + 1]);
+		vertex.tangent.z = static_cast<float>(tangents[i * 4 + 2]);
+		vertex.tangent.w = tangents[i * 4 + 3] < 0.0 ? -1.0f : 1.0f;
+	}
+}
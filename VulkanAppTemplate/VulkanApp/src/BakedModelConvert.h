@@ -0,0 +1,23 @@
+#ifndef BAKED_MODEL_CONVERT_HPP_E1C47A3B_58D2_4F09_9B6E_2A7D0C8F4B15
+#define BAKED_MODEL_CONVERT_HPP_E1C47A3B_58D2_4F09_9B6E_2A7D0C8F4B15
+
+#include <vector>
+
+#include "BakedModel.h"
+#include "SimpleModel.h"
+
+// Conversion of baked models into the SimpleModel layout used by the renderer.
+// None of these need a Vulkan device, so tools such as LoadBench can use them
+// as well.
+
+SimpleMaterialInfo bakedMaterial2SimpleMaterial(const BakedMaterialInfo& bakedMaterial, const std::vector<BakedTextureInfo>& bakedTextures);
+
+// With `keepQuantizedVertices` and `keepIndices16`, the file's quantized
+// vertices and 16-bit indices (if any) are copied into the model's arenas,
+// where quantizeModel() and splitIndexBuffers() pick them up.
+SimpleModel bakedModel2SimpleModel(const BakedModelView& bakedModel, bool keepQuantizedVertices, bool keepIndices16);
+
+// Generates tangents with tgen for all meshes without baked tangents.
+void generateTangents(SimpleModel& model);
+
+#endif // BAKED_MODEL_CONVERT_HPP_E1C47A3B_58D2_4F09_9B6E_2A7D0C8F4B15
@@ -0,0 +1,128 @@
+#include "BakedTexture.h"
+
+#include <algorithm>
+
+#include <cstring>
+
+#include "MappedFile.h"
+#include "labutils/error.hpp"
+
+namespace lut = labutils;
+
+namespace
+{
+	// See MeshBake/BakeTexture.cpp
+	constexpr char kTextureMagic[16] = "\0\0COMP5822Mtex";
+	constexpr char kTextureVariant[16] = "mips-cw3";
+	constexpr char kTextureExtension[] = ".comp5822tex";
+
+	constexpr std::uint64_t kAlignment = 16;
+	constexpr std::uint32_t kMaxLevels = 32;
+
+	struct TextureHeader_
+	{
+		char magic[16];
+		char variant[16];
+		std::uint32_t format;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t levelCount;
+	};
+
+	struct LevelEntry_
+	{
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+	static_assert( sizeof(TextureHeader_) == 48 );
+	static_assert( sizeof(LevelEntry_) == 16 );
+}
+
+std::uint32_t bakedTextureTexelSize(BakedTextureFormat format)
+{
+	switch( format )
+	{
+		case BakedTextureFormat::r8Unorm: return 1;
+		case BakedTextureFormat::rgba8Srgb: return 4;
+	}
+
+	return 0;
+}
+
+bool isBakedTexturePath(const std::string& path)
+{
+	auto const length = sizeof(kTextureExtension)-1;
+	return path.size() >= length && 0 == path.compare( path.size()-length, length, kTextureExtension );
+}
+
+BakedTextureView mapBakedTexture(const std::string& path)
+{
+	auto file = std::make_shared<MappedFile const>( path );
+	auto const* bytes = file->data();
+
+	if( file->size() < sizeof(TextureHeader_) )
+		throw lut::Error( "mapBakedTexture(): %s: file too small (%zu bytes)", path.c_str(), file->size() );
+
+	TextureHeader_ header;
+	std::memcpy( &header, bytes, sizeof(TextureHeader_) );
+
+	if( 0 != std::memcmp( header.magic, kTextureMagic, 16 ) )
+		throw lut::Error( "mapBakedTexture(): %s: invalid file signature!", path.c_str() );
+	if( 0 != std::memcmp( header.variant, kTextureVariant, 16 ) )
+		throw lut::Error( "mapBakedTexture(): %s: unsupported variant '%.16s'", path.c_str(), header.variant );
+
+	auto const format = BakedTextureFormat(header.format);
+	auto const texelSize = bakedTextureTexelSize( format );
+	if( 0 == texelSize )
+		throw lut::Error( "mapBakedTexture(): %s: unknown format %u", path.c_str(), header.format );
+
+	if( 0 == header.width || 0 == header.height || 0 == header.levelCount || header.levelCount > kMaxLevels )
+		throw lut::Error( "mapBakedTexture(): %s: invalid size %ux%u with %u levels", path.c_str(), header.width, header.height, header.levelCount );
+
+	if( file->size() < sizeof(TextureHeader_) + header.levelCount*sizeof(LevelEntry_) )
+		throw lut::Error( "mapBakedTexture(): %s: truncated level table", path.c_str() );
+
+	std::vector<LevelEntry_> entries( header.levelCount );
+	std::memcpy( entries.data(), bytes + sizeof(TextureHeader_), entries.size()*sizeof(LevelEntry_) );
+
+	// Levels must be in order, aligned and of the expected size, such that
+	// the data can be copied to the GPU as it is.
+	auto const dataBegin = entries.front().offset;
+
+	BakedTextureView ret;
+	ret.format = format;
+	ret.width = header.width;
+	ret.height = header.height;
+
+	std::uint64_t end = sizeof(TextureHeader_) + entries.size()*sizeof(LevelEntry_);
+	for( std::uint32_t i = 0; i < header.levelCount; ++i )
+	{
+		auto const& entry = entries[i];
+
+		BakedTextureLevel level;
+		level.width = std::max( header.width >> i, 1u );
+		level.height = std::max( header.height >> i, 1u );
+
+		if( entry.offset % kAlignment || entry.offset < end || entry.offset > file->size() )
+			throw lut::Error( "mapBakedTexture(): %s: level %u at invalid offset %llu", path.c_str(), i, (unsigned long long)entry.offset );
+		if( entry.size != std::uint64_t(level.width) * level.height * texelSize || entry.size > file->size() - entry.offset )
+			throw lut::Error( "mapBakedTexture(): %s: level %u has invalid size %llu", path.c_str(), i, (unsigned long long)entry.size );
+
+		level.offset = std::size_t(entry.offset - dataBegin);
+		level.size = std::size_t(entry.size);
+		ret.levels.emplace_back( level );
+
+		end = entry.offset + entry.size;
+	}
+
+	// The last level must be 1x1
+	if( ret.levels.back().width != 1 || ret.levels.back().height != 1 )
+		throw lut::Error( "mapBakedTexture(): %s: incomplete mip chain (%u levels)", path.c_str(), header.levelCount );
+
+	ret.data = bytes + dataBegin;
+	ret.dataSize = std::size_t(end - dataBegin);
+	ret.storage = std::move(file);
+
+	return ret;
+}
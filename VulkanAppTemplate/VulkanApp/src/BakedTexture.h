@@ -0,0 +1,83 @@
+#ifndef BAKED_TEXTURE_HPP_5B2E8C41_7A90_4F3D_A6E1_C93D0F7B2A58
+#define BAKED_TEXTURE_HPP_5B2E8C41_7A90_4F3D_A6E1_C93D0F7B2A58
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/* Baked texture format (".comp5822tex"), written by MeshBake:
+ *
+ * A texture with its complete mip chain, laid out such that all levels can
+ * be uploaded to a VkImage with a single vkCmdCopyBufferToImage() straight
+ * from the file contents. No decoding and no mipmap generation is necessary.
+ * All offsets are absolute (from the start of the file) and all levels start
+ * at a multiple of 16 bytes. Padding bytes are zero.
+ *
+ *  1. Header:
+ *    - 16*char: file magic = "\0\0COMP5822Mtex"
+ *    - 16*char: variant = "mips-cw3"
+ *    - 1*uint32_t: format (BakedTextureFormat)
+ *    - 1*uint32_t: width of level 0
+ *    - 1*uint32_t: height of level 0
+ *    - 1*uint32_t: L = number of levels
+ *
+ *  2. Level table, L entries of 16 bytes:
+ *    - 1*uint64_t: offset of the level's texels
+ *    - 1*uint64_t: size of the level in bytes
+ *
+ *  3. Level data. Level i is max(1, width >> i) by max(1, height >> i)
+ *     texels, with tightly packed rows. Levels are stored in order and the
+ *     first row is the bottom row of the source image (matching
+ *     stbi_set_flip_vertically_on_load(true)).
+ *
+ * There are levels down to 1x1, i.e., floor(log2(max(width,height))) + 1.
+ * Levels of sRGB formats are filtered in linear space.
+ */
+
+enum class BakedTextureFormat : std::uint32_t
+{
+	r8Unorm = 1,   // VK_FORMAT_R8_UNORM; one-channel textures
+	rgba8Srgb = 2  // VK_FORMAT_R8G8B8A8_SRGB
+};
+
+// Bytes per texel
+std::uint32_t bakedTextureTexelSize(BakedTextureFormat format);
+
+struct BakedTextureLevel
+{
+	std::uint32_t width;
+	std::uint32_t height;
+
+	// Relative to BakedTextureView::data
+	std::size_t offset;
+	std::size_t size;
+};
+
+// Baked texture whose level data points directly into the memory mapped file,
+// which is kept alive by `storage`.
+struct BakedTextureView
+{
+	std::shared_ptr<const void> storage;
+
+	BakedTextureFormat format;
+	std::uint32_t width;
+	std::uint32_t height;
+
+	std::vector<BakedTextureLevel> levels;
+
+	// All levels, including any padding between them. This can be copied into
+	// a staging buffer as a whole.
+	const std::byte* data = nullptr;
+	std::size_t dataSize = 0;
+};
+
+// Whether the path refers to a baked texture (by its extension)
+bool isBakedTexturePath(const std::string& path);
+
+// Throws labutils::Error if the file is not a valid baked texture.
+BakedTextureView mapBakedTexture(const std::string& path);
+
+#endif // BAKED_TEXTURE_HPP_5B2E8C41_7A90_4F3D_A6E1_C93D0F7B2A58
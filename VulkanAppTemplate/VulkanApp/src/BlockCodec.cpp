@@ -0,0 +1,453 @@
+#include "BlockCodec.h"
+
+#include <vector>
+#include <algorithm>
+
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+	// xxHash32 primes
+	constexpr std::uint32_t kPrime1 = 2654435761u;
+	constexpr std::uint32_t kPrime2 = 2246822519u;
+	constexpr std::uint32_t kPrime3 = 3266489917u;
+	constexpr std::uint32_t kPrime4 = 668265263u;
+	constexpr std::uint32_t kPrime5 = 374761393u;
+
+	// LZ parameters. Matches are at least kMinMatch bytes and never extend
+	// into the last kLastLiterals bytes of a block.
+	constexpr unsigned kHashBits = 16;
+	constexpr std::size_t kMinMatch = 4;
+	constexpr std::size_t kMaxOffset = 65535;
+	constexpr std::size_t kLastLiterals = 8;
+
+	inline std::uint32_t rotl_( std::uint32_t aX, unsigned aBits )
+	{
+		return (aX << aBits) | (aX >> (32-aBits));
+	}
+
+	inline std::uint32_t load32_( std::byte const* aPtr )
+	{
+		std::uint32_t ret;
+		std::memcpy( &ret, aPtr, sizeof(ret) );
+		return ret;
+	}
+	inline std::uint64_t load64_( std::byte const* aPtr )
+	{
+		std::uint64_t ret;
+		std::memcpy( &ret, aPtr, sizeof(ret) );
+		return ret;
+	}
+
+	inline std::uint32_t hash_( std::uint32_t aSequence )
+	{
+		return (aSequence * kPrime1) >> (32-kHashBits);
+	}
+
+	std::byte* write_length_( std::byte* aOut, std::size_t aLength )
+	{
+		for( ; aLength >= 255; aLength -= 255 )
+			*aOut++ = std::byte(255);
+
+		*aOut++ = std::byte(aLength);
+		return aOut;
+	}
+
+	std::byte* write_sequence_( std::byte* aOut, std::byte const* aLiterals, std::size_t aLiteralCount, std::size_t aOffset, std::size_t aMatchLength )
+	{
+		assert( 0 == aMatchLength || aMatchLength >= kMinMatch );
+
+		std::size_t const extra = aMatchLength ? aMatchLength-kMinMatch : 0;
+
+		*aOut++ = std::byte( (std::min<std::size_t>( aLiteralCount, 15 ) << 4) | std::min<std::size_t>( extra, 15 ) );
+		if( aLiteralCount >= 15 )
+			aOut = write_length_( aOut, aLiteralCount-15 );
+
+		std::memcpy( aOut, aLiterals, aLiteralCount );
+		aOut += aLiteralCount;
+
+		if( aMatchLength )
+		{
+			*aOut++ = std::byte( aOffset & 0xff );
+			*aOut++ = std::byte( aOffset >> 8 );
+
+			if( extra >= 15 )
+				aOut = write_length_( aOut, extra-15 );
+		}
+
+		return aOut;
+	}
+
+	inline bool read_length_( std::byte const*& aIn, std::byte const* aInEnd, std::size_t& aLength )
+	{
+		std::uint8_t add;
+		do
+		{
+			if( aIn == aInEnd )
+				return false;
+
+			add = std::uint8_t(*aIn++);
+			aLength += add;
+		} while( 255 == add );
+
+		return true;
+	}
+
+	template< typename tWord >
+	void apply_filter_( std::byte const* aIn, std::byte* aOut, std::size_t aBytes, bool aDelta )
+	{
+		constexpr std::size_t kSize = sizeof(tWord);
+		constexpr unsigned kSignShift = kSize*8 - 1;
+
+		std::size_t const words = aBytes / kSize;
+
+		tWord prev = 0;
+		for( std::size_t i = 0; i < words; ++i )
+		{
+			tWord word;
+			std::memcpy( &word, aIn + i*kSize, kSize );
+
+			if( aDelta )
+			{
+				tWord const diff = tWord(word - prev);
+				prev = word;
+
+				// zigzag: 0, -1, 1, -2, ... => 0, 1, 2, 3, ...
+				word = tWord( tWord(diff << 1) ^ tWord(0 - (diff >> kSignShift)) );
+			}
+
+			for( std::size_t b = 0; b < kSize; ++b )
+				aOut[b*words + i] = std::byte( word >> (8*b) );
+		}
+
+		std::memcpy( aOut + words*kSize, aIn + words*kSize, aBytes - words*kSize );
+	}
+
+	template< typename tWord >
+	void undo_filter_( std::byte const* aIn, std::byte* aOut, std::size_t aBytes, bool aDelta )
+	{
+		constexpr std::size_t kSize = sizeof(tWord);
+
+		std::size_t const words = aBytes / kSize;
+
+		// Interleave the byte planes. One pointer per plane keeps the loop
+		// simple enough for the compiler to vectorize (without delta coding).
+		auto const* p0 = reinterpret_cast<std::uint8_t const*>(aIn);
+		auto const* p1 = p0 + words;
+		auto const* p2 = 4 == kSize ? p1 + words : p1;
+		auto const* p3 = 4 == kSize ? p2 + words : p1;
+
+		auto const gather_ = [&] (std::size_t aI) {
+			if constexpr( 2 == kSize )
+				return tWord( p0[aI] | (p1[aI] << 8) );
+			else
+				return tWord( tWord(p0[aI]) | (tWord(p1[aI]) << 8) | (tWord(p2[aI]) << 16) | (tWord(p3[aI]) << 24) );
+		};
+
+		if( aDelta )
+		{
+			tWord prev = 0;
+			for( std::size_t i = 0; i < words; ++i )
+			{
+				tWord const word = gather_( i );
+				prev = tWord( prev + tWord( (word >> 1) ^ tWord(0 - (word & 1)) ) );
+				std::memcpy( aOut + i*kSize, &prev, kSize );
+			}
+		}
+		else
+		{
+			for( std::size_t i = 0; i < words; ++i )
+			{
+				tWord const word = gather_( i );
+				std::memcpy( aOut + i*kSize, &word, kSize );
+			}
+		}
+
+		std::memcpy( aOut + words*kSize, aIn + words*kSize, aBytes - words*kSize );
+	}
+}
+
+std::uint32_t blockChecksum( const void* aData, std::size_t aBytes )
+{
+	auto const* ptr = static_cast<std::byte const*>(aData);
+	auto const* const end = ptr + aBytes;
+
+	std::uint32_t hash;
+	if( aBytes >= 16 )
+	{
+		std::uint32_t v1 = kPrime1 + kPrime2;
+		std::uint32_t v2 = kPrime2;
+		std::uint32_t v3 = 0;
+		std::uint32_t v4 = 0 - kPrime1;
+
+		for( auto const* limit = end - 16; ptr <= limit; ptr += 16 )
+		{
+			v1 = rotl_( v1 + load32_( ptr+0 ) * kPrime2, 13 ) * kPrime1;
+			v2 = rotl_( v2 + load32_( ptr+4 ) * kPrime2, 13 ) * kPrime1;
+			v3 = rotl_( v3 + load32_( ptr+8 ) * kPrime2, 13 ) * kPrime1;
+			v4 = rotl_( v4 + load32_( ptr+12 ) * kPrime2, 13 ) * kPrime1;
+		}
+
+		hash = rotl_( v1, 1 ) + rotl_( v2, 7 ) + rotl_( v3, 12 ) + rotl_( v4, 18 );
+	}
+	else
+	{
+		hash = kPrime5;
+	}
+
+	hash += std::uint32_t(aBytes);
+
+	for( ; end - ptr >= 4; ptr += 4 )
+		hash = rotl_( hash + load32_( ptr ) * kPrime3, 17 ) * kPrime4;
+	for( ; ptr != end; ++ptr )
+		hash = rotl_( hash + std::uint8_t(*ptr) * kPrime5, 11 ) * kPrime1;
+
+	hash ^= hash >> 15;
+	hash *= kPrime2;
+	hash ^= hash >> 13;
+	hash *= kPrime3;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+void applyBlockFilter( BlockFilter aFilter, const std::byte* aIn, std::byte* aOut, std::size_t aBytes )
+{
+	switch( aFilter )
+	{
+		case BlockFilter::none: std::memcpy( aOut, aIn, aBytes ); break;
+		case BlockFilter::bytes2: apply_filter_<std::uint16_t>( aIn, aOut, aBytes, false ); break;
+		case BlockFilter::bytes4: apply_filter_<std::uint32_t>( aIn, aOut, aBytes, false ); break;
+		case BlockFilter::delta16: apply_filter_<std::uint16_t>( aIn, aOut, aBytes, true ); break;
+		case BlockFilter::delta32: apply_filter_<std::uint32_t>( aIn, aOut, aBytes, true ); break;
+	}
+}
+
+void undoBlockFilter( BlockFilter aFilter, const std::byte* aIn, std::byte* aOut, std::size_t aBytes )
+{
+	switch( aFilter )
+	{
+		case BlockFilter::none: std::memcpy( aOut, aIn, aBytes ); break;
+		case BlockFilter::bytes2: undo_filter_<std::uint16_t>( aIn, aOut, aBytes, false ); break;
+		case BlockFilter::bytes4: undo_filter_<std::uint32_t>( aIn, aOut, aBytes, false ); break;
+		case BlockFilter::delta16: undo_filter_<std::uint16_t>( aIn, aOut, aBytes, true ); break;
+		case BlockFilter::delta32: undo_filter_<std::uint32_t>( aIn, aOut, aBytes, true ); break;
+	}
+}
+
+EncodedBlock encodeBlock( BlockFilter aFilter, const std::byte* aIn, std::size_t aBytes )
+{
+	assert( aBytes <= kMaxBlockSize );
+
+	std::vector<std::byte> filtered;
+	if( BlockFilter::none != aFilter )
+	{
+		filtered.resize( aBytes );
+		applyBlockFilter( aFilter, aIn, filtered.data(), aBytes );
+	}
+
+	EncodedBlock ret;
+	ret.data.resize( lzCompressBound( aBytes ) );
+
+	auto const* source = filtered.empty() ? aIn : filtered.data();
+	auto const packed = lzCompressBlock( source, aBytes, ret.data.data() );
+
+	if( packed < aBytes )
+	{
+		ret.filter = aFilter;
+		ret.codec = BlockCodec::lz;
+		ret.data.resize( packed );
+	}
+	else
+	{
+		ret.filter = BlockFilter::none;
+		ret.codec = BlockCodec::stored;
+		ret.data.assign( aIn, aIn + aBytes );
+	}
+
+	return ret;
+}
+
+bool decodeBlock( BlockFilter aFilter, BlockCodec aCodec, const std::byte* aIn, std::size_t aInBytes, std::byte* aOut, std::size_t aOutBytes, std::vector<std::byte>& aScratch )
+{
+	if( aFilter > BlockFilter::delta32 || aOutBytes > kMaxBlockSize )
+		return false;
+
+	if( BlockCodec::stored == aCodec )
+	{
+		if( aInBytes != aOutBytes )
+			return false;
+
+		undoBlockFilter( aFilter, aIn, aOut, aOutBytes );
+		return true;
+	}
+
+	if( BlockCodec::lz != aCodec )
+		return false;
+
+	// Unfiltered blocks decompress straight into the destination
+	if( BlockFilter::none == aFilter )
+		return lzDecompressBlock( aIn, aInBytes, aOut, aOutBytes );
+
+	if( aScratch.size() < aOutBytes )
+		aScratch.resize( aOutBytes );
+
+	if( !lzDecompressBlock( aIn, aInBytes, aScratch.data(), aOutBytes ) )
+		return false;
+
+	undoBlockFilter( aFilter, aScratch.data(), aOut, aOutBytes );
+	return true;
+}
+
+std::size_t lzCompressBound( std::size_t aBytes ) noexcept
+{
+	return aBytes + aBytes/255 + 16;
+}
+
+std::size_t lzCompressBlock( const std::byte* aIn, std::size_t aBytes, std::byte* aOut )
+{
+	std::byte* out = aOut;
+	std::size_t anchor = 0;
+
+	if( aBytes > kLastLiterals + kMinMatch )
+	{
+		// Greedy parse. The table holds the last position of each hashed
+		// 4-byte sequence; candidates are verified, so collisions and the
+		// zero-initialized entries are harmless.
+		std::vector<std::uint32_t> table( std::size_t(1) << kHashBits, 0 );
+
+		std::size_t const matchLimit = aBytes - kLastLiterals;
+		std::size_t const searchLimit = matchLimit - kMinMatch;
+
+		std::size_t pos = 1, misses = 0;
+
+		while( pos <= searchLimit )
+		{
+			auto const sequence = load32_( aIn + pos );
+			auto& slot = table[hash_( sequence )];
+			std::size_t cand = slot;
+			slot = std::uint32_t(pos);
+
+			if( pos - cand > kMaxOffset || load32_( aIn + cand ) != sequence )
+			{
+				// Skip ahead faster in data that does not compress
+				pos += 1 + (misses++ >> 6);
+				continue;
+			}
+
+			// Extend the match backwards over pending literals, then forwards
+			while( pos > anchor && cand > 0 && aIn[pos-1] == aIn[cand-1] )
+			{
+				--pos;
+				--cand;
+			}
+
+			std::size_t length = kMinMatch;
+			while( pos + length + 8 <= matchLimit && load64_( aIn + cand + length ) == load64_( aIn + pos + length ) )
+				length += 8;
+			while( pos + length < matchLimit && aIn[cand+length] == aIn[pos+length] )
+				++length;
+
+			out = write_sequence_( out, aIn + anchor, pos - anchor, pos - cand, length );
+
+			pos += length;
+			anchor = pos;
+			misses = 0;
+
+			if( pos - 2 <= searchLimit )
+				table[hash_( load32_( aIn + pos - 2 ) )] = std::uint32_t(pos - 2);
+		}
+	}
+
+	out = write_sequence_( out, aIn + anchor, aBytes - anchor, 0, 0 );
+
+	assert( std::size_t(out - aOut) <= lzCompressBound( aBytes ) );
+	return std::size_t(out - aOut);
+}
+
+bool lzDecompressBlock( const std::byte* aIn, std::size_t aInBytes, std::byte* aOut, std::size_t aOutBytes ) noexcept
+{
+	std::byte const* in = aIn;
+	std::byte const* const inEnd = aIn + aInBytes;
+
+	std::byte* out = aOut;
+	std::byte* const outEnd = aOut + aOutBytes;
+
+	for( ;; )
+	{
+		if( in == inEnd )
+			return false;
+
+		auto const token = std::uint8_t(*in++);
+
+		// Literals
+		std::size_t literals = token >> 4;
+		if( 15 == literals && !read_length_( in, inEnd, literals ) )
+			return false;
+
+		if( literals > std::size_t(inEnd - in) || literals > std::size_t(outEnd - out) )
+			return false;
+
+		if( literals <= 16 && inEnd - in >= 16 && outEnd - out >= 16 )
+			std::memcpy( out, in, 16 );
+		else
+			std::memcpy( out, in, literals );
+
+		in += literals;
+		out += literals;
+
+		// The last sequence has no match
+		if( in == inEnd )
+			return out == outEnd;
+
+		// Match
+		if( inEnd - in < 2 )
+			return false;
+
+		std::size_t const offset = std::uint8_t(in[0]) | (std::size_t(std::uint8_t(in[1])) << 8);
+		in += 2;
+
+		if( 0 == offset || offset > std::size_t(out - aOut) )
+			return false;
+
+		std::size_t length = token & 15;
+		if( 15 == length && !read_length_( in, inEnd, length ) )
+			return false;
+
+		length += kMinMatch;
+		if( length > std::size_t(outEnd - out) )
+			return false;
+
+		std::byte const* match = out - offset;
+		if( length <= 16 && offset >= 16 && outEnd - out >= 16 )
+		{
+			// Common case: a short match that is far enough back
+			std::memcpy( out, match, 16 );
+		}
+		else if( std::size_t(outEnd - out) >= length + 8 )
+		{
+			// Copy in 8-byte chunks, which may write up to 7 bytes past the
+			// match (they are overwritten later). Chunks must not overlap the
+			// bytes they are copied to, so for short offsets (runs), first
+			// repeat the pattern until it spans at least 8 bytes, and then
+			// copy from a multiple of the offset back.
+			std::size_t i = 0, step = offset;
+			if( offset < 8 )
+			{
+				step = (8 + offset-1) / offset * offset;
+				for( ; i < step - offset && i < length; ++i )
+					out[i] = match[i];
+			}
+
+			for( ; i < length; i += 8 )
+				std::memcpy( out + i, out + i - step, 8 );
+		}
+		else
+		{
+			for( std::size_t i = 0; i < length; ++i )
+				out[i] = match[i];
+		}
+
+		out += length;
+	}
+}
@@ -0,0 +1,92 @@
+#ifndef BLOCK_CODEC_HPP_5B0E9C43_7A21_4F8D_A6E3_1D94C2B7F058
+#define BLOCK_CODEC_HPP_5B0E9C43_7A21_4F8D_A6E3_1D94C2B7F058
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/* Block compression for baked files, shared by MeshBake (encoder) and the
+ * runtime (decoder). See the "packed-cw3" variant in BakedModel.h.
+ *
+ * A block is compressed in two steps:
+ *  - a filter rearranges the raw bytes into something that compresses better
+ *    (see BlockFilter), and
+ *  - the filtered bytes are compressed with a small LZ77 codec, a variant of
+ *    the LZ4 block format (see lzCompressBlock()).
+ *
+ * Both steps are lossless. A block is at most kMaxBlockSize bytes, and the
+ * checksum (blockChecksum()) is always taken over the raw bytes.
+ */
+
+constexpr std::size_t kMaxBlockSize = 4*1024*1024;
+
+enum class BlockFilter : std::uint8_t
+{
+	none = 0,
+
+	// Byte planes of 16-/32-bit words: all first bytes, then all second
+	// bytes, ... Helps with float arrays, where the high bytes repeat.
+	bytes2 = 1,
+	bytes4 = 2,
+
+	// Difference to the previous 16-/32-bit word, zigzag encoded (small
+	// negative differences become small positive numbers), followed by
+	// bytes2/bytes4. Meant for index arrays.
+	delta16 = 3,
+	delta32 = 4,
+};
+
+enum class BlockCodec : std::uint8_t
+{
+	stored = 0, // Filtered bytes, not compressed
+	lz = 1,
+};
+
+struct EncodedBlock
+{
+	BlockFilter filter;
+	BlockCodec codec;
+	std::vector<std::byte> data;
+};
+
+// Filter and compress aBytes (at most kMaxBlockSize) from aIn. Blocks that do
+// not get smaller are stored as-is, with BlockFilter::none.
+EncodedBlock encodeBlock( BlockFilter, const std::byte* aIn, std::size_t aBytes );
+
+// Decode a block produced by encodeBlock() into exactly aOutBytes at aOut.
+// aScratch is resized as needed; reuse it across calls. Returns false if the
+// block is malformed. Does not verify the checksum.
+bool decodeBlock( BlockFilter, BlockCodec, const std::byte* aIn, std::size_t aInBytes, std::byte* aOut, std::size_t aOutBytes, std::vector<std::byte>& aScratch );
+
+// xxHash32 (seed 0) of aBytes bytes
+std::uint32_t blockChecksum( const void* aData, std::size_t aBytes );
+
+// Filter aBytes bytes from aIn into aOut, which must not overlap. Trailing
+// bytes that do not make up a whole word are copied as-is.
+void applyBlockFilter( BlockFilter, const std::byte* aIn, std::byte* aOut, std::size_t aBytes );
+
+// Undo applyBlockFilter(). aIn and aOut must not overlap.
+void undoBlockFilter( BlockFilter, const std::byte* aIn, std::byte* aOut, std::size_t aBytes );
+
+// Worst-case size of lzCompressBlock() output for aBytes of input
+std::size_t lzCompressBound( std::size_t aBytes ) noexcept;
+
+/* Compress aBytes from aIn into aOut (which has room for lzCompressBound()
+ * bytes). Returns the compressed size.
+ *
+ * The stream is a sequence of
+ *  - token: high nibble = number of literals L, low nibble = match length-4;
+ *    15 means that more length bytes follow (each adds 0..255; a byte < 255
+ *    ends the length), first for L, then (after the literals) for the match
+ *  - L literal bytes
+ *  - 16-bit little endian match offset (1..65535) and the match length
+ *    bytes, unless the literals end the block.
+ */
+std::size_t lzCompressBlock( const std::byte* aIn, std::size_t aBytes, std::byte* aOut );
+
+// Decompress exactly aOutBytes. Returns false if the input is malformed or
+// does not decode to exactly aOutBytes; never reads or writes out of bounds.
+bool lzDecompressBlock( const std::byte* aIn, std::size_t aInBytes, std::byte* aOut, std::size_t aOutBytes ) noexcept;
+
+#endif // BLOCK_CODEC_HPP_5B0E9C43_7A21_4F8D_A6E3_1D94C2B7F058
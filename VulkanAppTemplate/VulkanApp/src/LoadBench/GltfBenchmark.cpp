@@ -0,0 +1,68 @@
+#include "GltfBenchmark.h"
+
+#include <limits>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include "../LoadModelGltf.h"
+#include "../SimpleModel.h"
+
+namespace
+{
+	using Clock_ = std::chrono::steady_clock;
+
+	template< typename tFunc >
+	double best_ms_( std::size_t aRepeats, tFunc&& );
+}
+
+void benchmark_gltf_loading( char const* aInputGltf, std::size_t aRepeats )
+{
+	// Untimed load; brings the file into the page cache
+	auto const model = loadGltf( aInputGltf );
+
+	double const loadMs = best_ms_( aRepeats, [&] {
+		auto const loaded = loadGltf( aInputGltf );
+		(void)loaded;
+	} );
+
+	// Baseline: copy the loaded geometry once
+	std::size_t const bytes = model.vertices.size() * sizeof(Vertex) + model.indices.size() * sizeof(std::uint32_t);
+
+	std::vector<char> const src( bytes, 1 );
+	std::vector<char> dst( bytes );
+
+	double const copyMs = best_ms_( aRepeats, [&] {
+		std::memcpy( dst.data(), src.data(), bytes );
+	} );
+
+	auto const mbs_ = [&] ( double aMs ) {
+		return aMs > 0.0 ? double(bytes) / (1024.0*1024.0) / (aMs / 1000.0) : 0.0;
+	};
+
+	std::printf( "%s: %zu meshes, %zu materials, %zu vertices, %zu indices (best of %zu)\n", aInputGltf, model.meshes.size(), model.materials.size(), model.vertices.size(), model.indices.size(), aRepeats );
+	std::printf( " - loadGltf():              %8.3f ms (%.1f MB/s)\n", loadMs, mbs_( loadMs ) );
+	std::printf( " - memcpy() of the result:  %8.3f ms (%.1f MB/s)\n", copyMs, mbs_( copyMs ) );
+	std::printf( "\n" );
+}
+
+namespace
+{
+	template< typename tFunc >
+	double best_ms_( std::size_t aRepeats, tFunc&& aFunc )
+	{
+		double best = std::numeric_limits<double>::max();
+		for( std::size_t i = 0; i < std::max( aRepeats, std::size_t(1) ); ++i )
+		{
+			auto const start = Clock_::now();
+			aFunc();
+			best = std::min( best, std::chrono::duration<double,std::milli>( Clock_::now() - start ).count() );
+		}
+
+		return best;
+	}
+}
@@ -0,0 +1,18 @@
+#ifndef GLTF_BENCHMARK_HPP_9C41E7A2_0B6D_4F38_8E25_D17A3B95C6F0
+#define GLTF_BENCHMARK_HPP_9C41E7A2_0B6D_4F38_8E25_D17A3B95C6F0
+
+#include <cstddef>
+
+/* Time loadGltf() on a .gltf or .glb file.
+ *
+ * The loader runs `aRepeats` times and the best time is reported, next to
+ * the best time of a plain memcpy() of as many bytes as the loaded vertices
+ * and indices take up. The closer the two are, the less the loader does
+ * beyond copying accessor data out of the mapped buffers.
+ */
+void benchmark_gltf_loading(
+	char const* aInputGltf,
+	std::size_t aRepeats = 3
+);
+
+#endif // GLTF_BENCHMARK_HPP_9C41E7A2_0B6D_4F38_8E25_D17A3B95C6F0
@@ -0,0 +1,385 @@
+#include "ObjBenchmark.h"
+
+#include <limits>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+
+#include <rapidobj/rapidobj.hpp>
+
+#include "../LoadModelObj.h"
+#include "../ObjModelCache.h"
+#include "../SimpleModel.h"
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	using Clock_ = std::chrono::steady_clock;
+
+	bool same_soup_( SimpleModel const&, SimpleModel const&, std::string& aWhy );
+
+	template< typename tFunc >
+	double best_ms_( std::size_t aRepeats, tFunc&& );
+}
+
+// Previous implementation, unchanged except for the name and for keeping its
+// triangle soups and per-mesh vertex copies to itself (SimpleModel no longer
+// stores them). It deduplicates vertices by value, hashing each one through
+// two std::unordered_map<Vertex>.
+namespace
+{
+	SimpleModel load_simple_wavefront_obj_unordered_map_(char const* aPath)
+	{
+		assert(aPath);
+
+		// Ask rapidobj to load the requested file
+		auto result = rapidobj::ParseFile(aPath);
+		if (result.error)
+			throw lut::Error("Unable to load OBJ file '%s': %s", aPath, result.error.code.message().c_str());
+
+		// OBJ files can define faces that are not triangles. However, Vulkan will
+		// only render triangles (or lines and points), so we must triangulate any
+		// faces that are not already triangles. Fortunately, rapidobj can do this
+		// for us.
+		rapidobj::Triangulate(result);
+
+		// Find the path to the OBJ file
+		char const* pathBeg = aPath;
+		char const* pathEnd = std::strrchr(pathBeg, '/');
+
+		std::string const prefix = pathEnd
+			? std::string(pathBeg, pathEnd + 1)
+			: ""
+			;
+
+		// Convert the OBJ data into a SimpleModel structure.
+		// First, extract material data.
+		SimpleModel ret;
+
+		ret.modelSourcePath = aPath;
+
+		for (auto const& mat : result.materials)
+		{
+			SimpleMaterialInfo mi;
+
+			mi.materialName = mat.name;
+			mi.diffuseColor = glm::vec3(mat.diffuse[0], mat.diffuse[1], mat.diffuse[2]);
+			mi.roughness = mat.specular[0];
+
+			if (!mat.diffuse_texname.empty())
+				mi.diffuseTexturePath = prefix + mat.diffuse_texname;
+
+			if (!mat.normal_texname.empty())
+				mi.normalTexturePath = prefix + mat.normal_texname;
+
+			if (!mat.bump_texname.empty())
+				mi.normalTexturePath = prefix + mat.bump_texname;
+
+			if (!mat.roughness_texname.empty())
+				mi.roughnessTexturePath = prefix + mat.roughness_texname;
+
+			if (!mat.metallic_texname.empty())
+				mi.metallicTexturePath = prefix + mat.metallic_texname;
+
+			if (!mat.alpha_texname.empty())
+				mi.alphaTexturePath = prefix + mat.alpha_texname;
+
+			ret.materials.emplace_back(std::move(mi));
+		}
+
+		// Next, extract the actual mesh data. There are some complications:
+		// - OBJ use separate indices to positions, normals and texture coords. To
+		//   deal with this, the mesh is turned into an unindexed triangle soup.
+		// - OBJ uses three methods of grouping faces:
+		//   - 'o' = object
+		//   - 'g' = group
+		//   - 'usemtl' = switch materials
+		//  The first two create logical objects/groups. The latter switches
+		//  materials. We want to primarily group faces by material (and possibly
+		//  secondarily by other logical groupings). 
+		//
+		// Unfortunately, RapidOBJ exposes a per-face material index.
+
+		SimpleModel::Data_ dataTextured;
+		SimpleModel::Data2_ dataUntextured;
+
+		std::unordered_set<std::size_t> activeMaterials;
+		std::unordered_map<Vertex, uint32_t> globalUniqueVertices;
+
+		for (auto const& shape : result.shapes)
+		{
+			auto const& shapeName = shape.name;
+
+			// Scan shape for materials
+			activeMaterials.clear();
+
+			for (std::size_t i = 0; i < shape.mesh.indices.size(); ++i)
+			{
+				auto const faceId = i / 3; // Always triangles; see Triangulate() above
+
+				assert(faceId < shape.mesh.material_ids.size());
+				auto const matId = shape.mesh.material_ids[faceId];
+
+				assert(matId < int(ret.materials.size()));
+				activeMaterials.emplace(matId);
+			}
+
+			// Process vertices for active material
+			// This does multiple passes over the vertex data, which is less than
+			// optimal...
+			//
+			// Note: we still keep different "shapes" separate. For static meshes,
+			// one could merge all vertices with the same material for a bit more
+			// efficient rendering.
+			for (auto const matId : activeMaterials)
+			{
+				auto* opos = &dataTextured.positions;
+				auto* otex = &dataTextured.texcoords;
+				auto* onormals = &dataTextured.normals;
+
+				bool const textured = !ret.materials[matId].diffuseTexturePath.empty();
+				bool const alphaTextured = !ret.materials[matId].alphaTexturePath.empty();
+				bool const normalTextured = !ret.materials[matId].normalTexturePath.empty();
+				bool const roughnessTextured = !ret.materials[matId].roughnessTexturePath.empty();
+				bool const metallicTextured = !ret.materials[matId].metallicTexturePath.empty();
+
+				if (!textured)
+				{
+					opos = &dataUntextured.positions;
+					onormals = &dataUntextured.normals;
+					otex = nullptr;
+				}
+
+				// Keep track of mesh names; this can be useful for debugging.
+				std::string meshName;
+				if (1 == activeMaterials.size())
+					meshName = shapeName;
+				else
+					meshName = shapeName + "::" + ret.materials[matId].materialName;
+
+				// Extract this material's vertices.
+				size_t firstIndex = ret.indices.size();
+				assert(!textured || opos->size() == otex->size());
+
+				std::vector<Vertex> vertices;
+				std::vector<uint32_t> indices;
+				std::unordered_map<Vertex, uint32_t> uniqueVertices;
+
+				for (std::size_t i = 0; i < shape.mesh.indices.size(); ++i)
+				{
+					auto const faceId = i / 3; // Always triangles; see Triangulate() above
+					auto const faceMat = std::size_t(shape.mesh.material_ids[faceId]);
+
+					if (faceMat != matId)
+						continue;
+
+					auto const& idx = shape.mesh.indices[i];
+
+					Vertex vertex;
+
+					auto x = result.attributes.positions[idx.position_index * 3 + 0];
+					auto y = result.attributes.positions[idx.position_index * 3 + 1];
+					auto z = result.attributes.positions[idx.position_index * 3 + 2];
+
+					opos->emplace_back(glm::vec3{ x, y, z });
+
+					vertex.position = { x, y, z };
+
+					auto nx = result.attributes.normals[idx.normal_index * 3 + 0];
+					auto ny = result.attributes.normals[idx.normal_index * 3 + 1];
+					auto nz = result.attributes.normals[idx.normal_index * 3 + 2];
+
+					onormals->emplace_back(glm::vec3{ nx, ny, nz });
+
+					vertex.normal = { nx, ny, nz };
+
+					if (textured)
+					{
+						auto tx = result.attributes.texcoords[idx.texcoord_index * 2 + 0];
+						auto ty = result.attributes.texcoords[idx.texcoord_index * 2 + 1];
+
+						otex->emplace_back(glm::vec2{ tx, ty });
+
+						vertex.texcoord = { tx, ty };
+					}
+
+					if (uniqueVertices.count(vertex) == 0)
+					{
+						uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+						vertices.emplace_back(vertex);
+					}
+
+					if (globalUniqueVertices.count(vertex) == 0)
+					{
+						globalUniqueVertices[vertex] = static_cast<uint32_t>(ret.vertices.size());
+						ret.vertices.emplace_back(vertex);
+					}
+
+					ret.indices.emplace_back(globalUniqueVertices[vertex]);
+					indices.emplace_back(globalUniqueVertices[vertex]);
+				}
+
+				SimpleMeshInfo meshInfo;
+
+				meshInfo.meshName = std::move(meshName);
+				meshInfo.materialIndex = matId;
+				meshInfo.textured = textured;
+				meshInfo.alphaTextured = alphaTextured;
+				meshInfo.normalTextured = normalTextured;
+				meshInfo.roughnessTextured = roughnessTextured;
+				meshInfo.metallicTextured = metallicTextured;
+
+				auto const vertexCount = vertices.size();
+
+				auto const indexCount = ret.indices.size() - firstIndex;
+
+				meshInfo.vertexCount = vertexCount;
+				meshInfo.indexStartIndex = firstIndex;
+				meshInfo.indexCount = indexCount;
+
+				ret.indexCount += indexCount;
+
+				ret.meshes.emplace_back(meshInfo);
+			}
+		}
+
+		return ret;
+	}
+}
+
+void benchmark_obj_loading( char const* aInputOBJ, std::size_t aRepeats )
+{
+	SimpleModel oldModel, newModel;
+
+	// Stamped before any parsing, as loadSimpleWavefrontObj() does
+	auto const sources = stampObjModelSources( aInputOBJ );
+
+	double const parseMs = best_ms_( aRepeats, [&] {
+		auto result = rapidobj::ParseFile( aInputOBJ );
+		if( result.error )
+			throw lut::Error( "Unable to load OBJ file '%s': %s", aInputOBJ, result.error.code.message().c_str() );
+
+		rapidobj::Triangulate( result );
+	} );
+
+	double const oldMs = best_ms_( aRepeats, [&] { oldModel = load_simple_wavefront_obj_unordered_map_( aInputOBJ ); } );
+	double const newMs = best_ms_( aRepeats, [&] { newModel = loadSimpleWavefrontObj( aInputOBJ, false ); } );
+
+	std::string why;
+	if( !same_soup_( oldModel, newModel, why ) )
+		throw lut::Error( "%s: loaders produce different triangles: %s", aInputOBJ, why.c_str() );
+
+	// Cached loads; the cache is (re)written from the freshly parsed model.
+	double cachedMs = -1.0;
+	if( writeSimpleModelCache( aInputOBJ, sources, newModel ) )
+	{
+		SimpleModel cachedModel;
+		cachedMs = best_ms_( aRepeats, [&] { cachedModel = loadSimpleWavefrontObj( aInputOBJ ); } );
+
+		if( !same_soup_( newModel, cachedModel, why ) )
+			throw lut::Error( "%s: cached model differs: %s", aInputOBJ, why.c_str() );
+
+		if( cachedModel.vertices.size() != newModel.vertices.size() || cachedModel.indices != newModel.indices )
+			throw lut::Error( "%s: cached model differs: vertex buffers differ", aInputOBJ );
+	}
+
+	auto const convert_ = [&] (double aMs) {
+		return std::max( aMs - parseMs, 0.0 );
+	};
+
+	std::printf( "%s: %zu meshes, %zu indices, %zu => %zu vertices (best of %zu)\n", aInputOBJ, newModel.meshes.size(), newModel.indices.size(), oldModel.vertices.size(), newModel.vertices.size(), aRepeats );
+	std::printf( " - rapidobj parse:          %8.2f ms\n", parseMs );
+	std::printf( " - unordered_map<Vertex>:   %8.2f ms (%.2f ms after parsing)\n", oldMs, convert_( oldMs ) );
+	std::printf( " - index triplet table:     %8.2f ms (%.2f ms after parsing)\n", newMs, convert_( newMs ) );
+	std::printf( " - speedup: %.2fx overall, %.2fx after parsing, triangles identical\n",
+		newMs > 0.0 ? oldMs / newMs : 0.0,
+		convert_( newMs ) > 0.0 ? convert_( oldMs ) / convert_( newMs ) : 0.0
+	);
+
+	if( cachedMs >= 0.0 )
+		std::printf( " - cached (%s): %8.2f ms, %.2fx faster than parsing, model identical\n", simpleModelCachePath( aInputOBJ ).c_str(), cachedMs, cachedMs > 0.0 ? newMs / cachedMs : 0.0 );
+	else
+		std::printf( " - cached: unable to write '%s', skipped\n", simpleModelCachePath( aInputOBJ ).c_str() );
+}
+
+namespace
+{
+	bool same_soup_( SimpleModel const& aA, SimpleModel const& aB, std::string& aWhy )
+	{
+		if( aA.meshes.size() != aB.meshes.size() )
+		{
+			aWhy = "mesh counts differ";
+			return false;
+		}
+
+		if( aA.indices.size() != aB.indices.size() )
+		{
+			aWhy = "index counts differ";
+			return false;
+		}
+
+		for( std::size_t i = 0; i < aA.meshes.size(); ++i )
+		{
+			auto const& ma = aA.meshes[i];
+			auto const& mb = aB.meshes[i];
+
+			if( ma.meshName != mb.meshName || ma.materialIndex != mb.materialIndex || ma.indexStartIndex != mb.indexStartIndex || ma.indexCount != mb.indexCount )
+			{
+				aWhy = "mesh '" + ma.meshName + "' differs";
+				return false;
+			}
+		}
+
+		// Vertex indices may legitimately differ (the previous loader also
+		// merges distinct OBJ index triplets with identical values); the
+		// vertices they refer to may not.
+		for( std::size_t i = 0; i < aA.indices.size(); ++i )
+		{
+			auto const& va = aA.vertices[aA.indices[i]];
+			auto const& vb = aB.vertices[aB.indices[i]];
+
+			if( !(va == vb) )
+			{
+				aWhy = "vertex of index " + std::to_string( i ) + " differs";
+				return false;
+			}
+		}
+
+		auto const same_ = [] (auto const& aX, auto const& aY) {
+			return aX.size() == aY.size() && (aX.empty() || 0 == std::memcmp( aX.data(), aY.data(), aX.size() * sizeof(aX[0]) ));
+		};
+
+		auto const texturedA = aA.texturedSoup(), texturedB = aB.texturedSoup();
+		auto const untexturedA = aA.untexturedSoup(), untexturedB = aB.untexturedSoup();
+
+		if( !same_( texturedA.positions, texturedB.positions ) || !same_( texturedA.texcoords, texturedB.texcoords ) || !same_( texturedA.normals, texturedB.normals )
+			|| !same_( untexturedA.positions, untexturedB.positions ) || !same_( untexturedA.normals, untexturedB.normals ) )
+		{
+			aWhy = "triangle soups differ";
+			return false;
+		}
+
+		return true;
+	}
+
+	template< typename tFunc >
+	double best_ms_( std::size_t aRepeats, tFunc&& aFunc )
+	{
+		double best = std::numeric_limits<double>::max();
+		for( std::size_t i = 0; i < std::max( aRepeats, std::size_t(1) ); ++i )
+		{
+			auto const start = Clock_::now();
+			aFunc();
+			best = std::min( best, std::chrono::duration<double,std::milli>( Clock_::now() - start ).count() );
+		}
+
+		return best;
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef OBJ_BENCHMARK_HPP_3D0B8E57_61A4_4C92_B7F3_95E2A8C41D06
+#define OBJ_BENCHMARK_HPP_3D0B8E57_61A4_4C92_B7F3_95E2A8C41D06
+
+#include <cstddef>
+
+/* Compare loadSimpleWavefrontObj() against the previous loader (which
+ * deduplicated vertices by value through std::unordered_map<Vertex>, kept in
+ * ObjBenchmark.cpp for reference) on an OBJ file.
+ *
+ * Each loader runs `aRepeats` times; the best time is reported, along with
+ * the time rapidobj alone takes to parse the file. Throws lut::Error if the
+ * two produce different triangles.
+ *
+ * Afterwards, the binary cache next to the OBJ is rewritten and the cached
+ * load is timed as well (and checked against the parsed model).
+ */
+void benchmark_obj_loading(
+	char const* aInputOBJ,
+	std::size_t aRepeats = 3
+);
+
+#endif // OBJ_BENCHMARK_HPP_3D0B8E57_61A4_4C92_B7F3_95E2A8C41D06
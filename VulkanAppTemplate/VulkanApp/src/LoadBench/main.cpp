@@ -0,0 +1,429 @@
+#include <new>
+#include <limits>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <typeinfo>
+#include <exception>
+#include <filesystem>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__linux__)
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+#include "../BakedModel.h"
+#include "../BakedModelConvert.h"
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+#include "ObjBenchmark.h"
+#include "GltfBenchmark.h"
+
+/* Load-throughput benchmark for baked models.
+ *
+ * Loads each baked model a number of times, exactly as loadResources() does
+ * but without a window or a Vulkan device, and reports the time spent in each
+ * step of the load:
+ *
+ *  - read:     reading the file's bytes (from disk with a cold cache, from the
+ *              page cache otherwise)
+ *  - parse:    loadBakedModel() (or mapBakedModel() with --map)
+ *  - convert:  bakedModel2SimpleModel()
+ *  - tangents: generateTangents()
+ *
+ * The read step also pulls the file into the page cache, so the later steps
+ * measure the loader itself rather than the disk. With --map, pages of
+ * "aligned-cw3" files are only touched by the conversion.
+ *
+ * Allocations are counted by replacing the global operator new below.
+ *
+ * Wavefront OBJ files are instead handed to benchmark_obj_loading(), which
+ * compares loadSimpleWavefrontObj() against its previous implementation, and
+ * glTF files (.gltf, .glb) to benchmark_gltf_loading().
+ */
+
+// Allocation counters
+namespace
+{
+	std::atomic<std::size_t> gAllocations_{ 0 };
+	std::atomic<std::size_t> gAllocatedBytes_{ 0 };
+}
+
+void* operator new( std::size_t aSize )
+{
+	gAllocations_.fetch_add( 1, std::memory_order_relaxed );
+	gAllocatedBytes_.fetch_add( aSize, std::memory_order_relaxed );
+
+	if( void* ptr = std::malloc( aSize ? aSize : 1 ) )
+		return ptr;
+
+	throw std::bad_alloc();
+}
+void operator delete( void* aPtr ) noexcept
+{
+	std::free( aPtr );
+}
+void operator delete( void* aPtr, std::size_t ) noexcept
+{
+	std::free( aPtr );
+}
+
+namespace
+{
+	using Clock_ = std::chrono::steady_clock;
+
+	enum class Phase_ : std::size_t
+	{
+		read,
+		parse,
+		convert,
+		tangents,
+		count
+	};
+
+	constexpr char const* kPhaseNames_[] = { "read", "parse", "convert", "tangents" };
+	static_assert( sizeof(kPhaseNames_)/sizeof(kPhaseNames_[0]) == std::size_t(Phase_::count) );
+
+	struct PhaseStats_
+	{
+		double totalSeconds = 0.0;
+		double minSeconds = std::numeric_limits<double>::infinity();
+
+		std::size_t allocations = 0;
+		std::size_t allocatedBytes = 0;
+	};
+
+	struct RunStats_
+	{
+		PhaseStats_ phases[std::size_t(Phase_::count)];
+		PhaseStats_ total;
+
+		std::size_t iterations = 0;
+	};
+
+	struct CommandLine_
+	{
+		std::vector<std::string> models;
+
+		std::size_t iterations = 10;
+
+		bool warm = true;
+		bool cold = true;
+
+		bool map = false;       // mapBakedModel() instead of loadBakedModel()
+		bool quantized = false; // as with quantizeVertices in the renderer
+
+		bool help = false;
+	};
+
+	CommandLine_ parse_command_line_( int aArgc, char* aArgv[] );
+	void print_usage_( char const* aProgram );
+
+	RunStats_ run_( std::string const& aPath, CommandLine_ const&, bool aCold );
+	void print_stats_( std::string const& aPath, std::uint64_t aFileBytes, CommandLine_ const&, bool aCold, RunStats_ const& );
+
+	std::vector<char> read_file_( std::string const& aPath );
+
+	// Evicts the file's pages from the page cache. Returns false where this is
+	// not permitted or not supported.
+	bool drop_file_cache_( std::string const& aPath );
+
+	std::size_t parse_count_( char const* aOption, char const* aValue );
+}
+
+int main( int aArgc, char* aArgv[] ) try
+{
+	auto cmd = parse_command_line_( aArgc, aArgv );
+	if( cmd.help )
+	{
+		print_usage_( aArgv[0] );
+		return 0;
+	}
+
+	// Without any models on the command line (e.g., when started from the
+	// IDE), measure the models that loadResources() loads.
+	if( cmd.models.empty() )
+	{
+		cmd.models.emplace_back( "../Assets/Models/sponza-pbr/sponza-pbr.comp5822mesh" );
+		cmd.models.emplace_back( "../Assets/Models/NewShip/ship.comp5822mesh" );
+	}
+
+	for( auto const& model : cmd.models )
+	{
+		auto const extension = std::filesystem::path( model ).extension();
+		if( extension == ".obj" )
+		{
+			benchmark_obj_loading( model.c_str(), cmd.iterations );
+			continue;
+		}
+		if( extension == ".gltf" || extension == ".glb" )
+		{
+			benchmark_gltf_loading( model.c_str(), cmd.iterations );
+			continue;
+		}
+
+		auto const fileBytes = std::uint64_t(std::filesystem::file_size( model ));
+
+		if( cmd.warm )
+			print_stats_( model, fileBytes, cmd, false, run_( model, cmd, false ) );
+
+		if( cmd.cold )
+			print_stats_( model, fileBytes, cmd, true, run_( model, cmd, true ) );
+	}
+
+	return 0;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "Top-level exception [%s]:\n%s\nBye.\n", typeid(eErr).name(), eErr.what() );
+	return 1;
+}
+
+namespace
+{
+	RunStats_ run_( std::string const& aPath, CommandLine_ const& aCmd, bool aCold )
+	{
+		RunStats_ ret;
+
+		// One untimed load brings the file into the page cache (and warms up
+		// the allocator) for the warm runs.
+		if( !aCold )
+		{
+			auto model = bakedModel2SimpleModel( mapBakedModel( aPath ), aCmd.quantized, true );
+			generateTangents( model );
+		}
+
+		bool warned = false;
+
+		for( std::size_t i = 0; i < aCmd.iterations; ++i )
+		{
+			if( aCold && !drop_file_cache_( aPath ) && !warned )
+			{
+				std::fprintf( stderr, "%s: unable to drop the file from the page cache; cold runs are warm\n", aPath.c_str() );
+				warned = true;
+			}
+
+			double iterationSeconds = 0.0;
+			std::size_t iterationAllocations = 0, iterationBytes = 0;
+
+			auto const measure_ = [&] ( Phase_ aPhase, auto&& aFunc ) {
+				auto const allocations = gAllocations_.load( std::memory_order_relaxed );
+				auto const bytes = gAllocatedBytes_.load( std::memory_order_relaxed );
+				auto const t0 = Clock_::now();
+
+				auto result = aFunc();
+
+				auto const t1 = Clock_::now();
+				double const seconds = std::chrono::duration<double>( t1-t0 ).count();
+
+				auto& stats = ret.phases[std::size_t(aPhase)];
+				stats.totalSeconds += seconds;
+				stats.minSeconds = std::min( stats.minSeconds, seconds );
+				stats.allocations += gAllocations_.load( std::memory_order_relaxed ) - allocations;
+				stats.allocatedBytes += gAllocatedBytes_.load( std::memory_order_relaxed ) - bytes;
+
+				iterationSeconds += seconds;
+				iterationAllocations += gAllocations_.load( std::memory_order_relaxed ) - allocations;
+				iterationBytes += gAllocatedBytes_.load( std::memory_order_relaxed ) - bytes;
+
+				return result;
+			};
+
+			measure_( Phase_::read, [&] { return read_file_( aPath ); } );
+
+			auto view = measure_( Phase_::parse, [&] {
+				if( aCmd.map )
+					return mapBakedModel( aPath );
+
+				return viewBakedModel( std::make_shared<BakedModel const>( loadBakedModel( aPath ) ) );
+			} );
+
+			auto model = measure_( Phase_::convert, [&] {
+				return bakedModel2SimpleModel( view, aCmd.quantized, true );
+			} );
+
+			measure_( Phase_::tangents, [&] {
+				generateTangents( model );
+				return 0;
+			} );
+
+			ret.total.totalSeconds += iterationSeconds;
+			ret.total.minSeconds = std::min( ret.total.minSeconds, iterationSeconds );
+			ret.total.allocations += iterationAllocations;
+			ret.total.allocatedBytes += iterationBytes;
+
+			++ret.iterations;
+		}
+
+		return ret;
+	}
+
+	void print_stats_( std::string const& aPath, std::uint64_t aFileBytes, CommandLine_ const& aCmd, bool aCold, RunStats_ const& aStats )
+	{
+		double const fileMB = double(aFileBytes) / (1024.0*1024.0);
+
+		std::printf( "%s: %.1f MB, %zu iterations, %s cache, %s\n",
+			aPath.c_str(),
+			fileMB,
+			aStats.iterations,
+			aCold ? "cold" : "warm",
+			aCmd.map ? "mapBakedModel()" : "loadBakedModel()"
+		);
+
+		if( 0 == aStats.iterations )
+			return;
+
+		std::printf( "  %-10s %10s %10s %10s %12s %12s\n", "step", "mean ms", "min ms", "MB/s", "allocs/it", "alloc MB/it" );
+
+		auto const row_ = [&] ( char const* aName, PhaseStats_ const& aPhase ) {
+			double const n = double(aStats.iterations);
+			double const mean = aPhase.totalSeconds / n;
+
+			// Throughput is meaningless for steps that (nearly) do nothing,
+			// e.g., generateTangents() when all meshes have baked tangents
+			char throughput[32] = "-";
+			if( mean >= 1e-6 )
+				std::snprintf( throughput, sizeof(throughput), "%.1f", fileMB / mean );
+
+			std::printf( "  %-10s %10.2f %10.2f %10s %12.0f %12.2f\n",
+				aName,
+				mean * 1000.0,
+				aPhase.minSeconds * 1000.0,
+				throughput,
+				double(aPhase.allocations) / n,
+				double(aPhase.allocatedBytes) / n / (1024.0*1024.0)
+			);
+		};
+
+		for( std::size_t i = 0; i < std::size_t(Phase_::count); ++i )
+			row_( kPhaseNames_[i], aStats.phases[i] );
+
+		row_( "total", aStats.total );
+		std::printf( "\n" );
+	}
+
+	std::vector<char> read_file_( std::string const& aPath )
+	{
+		FILE* fin = std::fopen( aPath.c_str(), "rb" );
+		if( !fin )
+			throw lut::Error( "Unable to open '%s' for reading", aPath.c_str() );
+
+		std::vector<char> ret( std::size_t(std::filesystem::file_size( aPath )) );
+		auto const read = std::fread( ret.data(), 1, ret.size(), fin );
+		std::fclose( fin );
+
+		if( read != ret.size() )
+			throw lut::Error( "%s: expected %zu bytes, got %zu", aPath.c_str(), ret.size(), read );
+
+		return ret;
+	}
+
+	bool drop_file_cache_( std::string const& aPath )
+	{
+#		if defined(__linux__)
+		// Unlike writing to /proc/sys/vm/drop_caches, this does not require
+		// root and leaves the rest of the page cache alone. Only clean pages
+		// are dropped, which is all a read-only file has.
+		int const fd = ::open( aPath.c_str(), O_RDONLY );
+		if( -1 == fd )
+			return false;
+
+		bool const ret = 0 == ::posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+		::close( fd );
+		return ret;
+#		else
+		// Windows has no per-file equivalent; purging the standby list needs
+		// administrator rights and an undocumented API.
+		(void)aPath;
+		return false;
+#		endif
+	}
+
+	CommandLine_ parse_command_line_( int aArgc, char* aArgv[] )
+	{
+		CommandLine_ ret;
+
+		for( int i = 1; i < aArgc; ++i )
+		{
+			std::string const arg = aArgv[i];
+
+			auto const value_ = [&] () -> char const* {
+				if( i+1 >= aArgc )
+					throw lut::Error( "%s: missing argument (see --help)", arg.c_str() );
+				return aArgv[++i];
+			};
+
+			if( "-h" == arg || "--help" == arg )
+				ret.help = true;
+			else if( "-n" == arg || "--iterations" == arg )
+				ret.iterations = parse_count_( arg.c_str(), value_() );
+			else if( "--warm" == arg )
+			{
+				ret.warm = true;
+				ret.cold = false;
+			}
+			else if( "--cold" == arg )
+			{
+				ret.warm = false;
+				ret.cold = true;
+			}
+			else if( "--map" == arg )
+				ret.map = true;
+			else if( "--quantized" == arg )
+				ret.quantized = true;
+			else if( !arg.empty() && '-' == arg[0] )
+				throw lut::Error( "Unknown option '%s' (see --help)", arg.c_str() );
+			else
+				ret.models.emplace_back( arg );
+		}
+
+		return ret;
+	}
+
+	void print_usage_( char const* aProgram )
+	{
+		std::printf( "Usage: %s [options] [model.comp5822mesh|model.obj|model.gltf ...]\n", aProgram );
+		std::printf( "\n" );
+		std::printf( "Measures how fast baked models load, split into reading the file, parsing\n" );
+		std::printf( "it, converting it into a SimpleModel and generating tangents. Without any\n" );
+		std::printf( "inputs, the models loaded by the renderer are measured.\n" );
+		std::printf( "\n" );
+		std::printf( "OBJ files are loaded with loadSimpleWavefrontObj() and its previous\n" );
+		std::printf( "implementation instead; the best of N loads of each is reported.\n" );
+		std::printf( "glTF files (.gltf, .glb) are loaded with loadGltf() and compared to a\n" );
+		std::printf( "memcpy() of the loaded geometry.\n" );
+		std::printf( "\n" );
+		std::printf( "Options:\n" );
+		std::printf( "  -n, --iterations N     load each model N times (default: %zu)\n", CommandLine_{}.iterations );
+		std::printf( "      --warm             only measure with the file in the page cache\n" );
+		std::printf( "      --cold             only measure with the file dropped from the page\n" );
+		std::printf( "                         cache before each load (Linux only)\n" );
+		std::printf( "      --map              parse with mapBakedModel() instead of\n" );
+		std::printf( "                         loadBakedModel(), as the renderer does\n" );
+		std::printf( "      --quantized        keep quantized vertices, as with quantizeVertices\n" );
+		std::printf( "  -h, --help             show this message\n" );
+		std::printf( "\n" );
+		std::printf( "By default, both warm and cold runs are measured.\n" );
+	}
+
+	std::size_t parse_count_( char const* aOption, char const* aValue )
+	{
+		char* end = nullptr;
+		auto const ret = std::strtoull( aValue, &end, 10 );
+
+		if( end == aValue || *end != '\0' )
+			throw lut::Error( "%s: expected a non-negative integer, got '%s'", aOption, aValue );
+
+		return std::size_t(ret);
+	}
+}
@@ -0,0 +1,680 @@
+#include "LoadModelGltf.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#define CGLTF_IMPLEMENTATION
+#include <cgltf.h>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include "labutils/error.hpp"
+#include "MappedFile.h"
+#include "SimpleModel.h"
+
+namespace lut = labutils;
+
+namespace
+{
+	// External buffers are memory mapped by read_file_() and stay mapped for
+	// as long as this lives; release_file_() does nothing.
+	struct GltfFiles_
+	{
+		std::vector<MappedFile> mappings;
+	};
+
+	cgltf_result read_file_(const cgltf_memory_options*, const cgltf_file_options* options, const char* path, cgltf_size* size, void** data);
+	void release_file_(const cgltf_memory_options*, const cgltf_file_options*, void*);
+
+	struct GltfDataDeleter_
+	{
+		void operator()(cgltf_data* data) const { cgltf_free(data); }
+	};
+
+	char const* result_string_(cgltf_result result);
+
+	SimpleMaterialInfo convert_material_(cgltf_data const& data, cgltf_material const& material, std::string const& prefix);
+
+	// Copies `accessor` into the `member` of consecutive vertices, or as many
+	// of its components as `member` has. Returns false if the accessor's data
+	// is unavailable or malformed.
+	template<typename T>
+	bool read_attribute_(cgltf_accessor const& accessor, Vertex* vertices, T Vertex::* member);
+
+	// Reads one unsigned integer of the given type
+	bool read_index_(std::uint8_t const* src, cgltf_component_type type, std::uint32_t& out);
+
+	// Reads `accessor.count` indices into `out`
+	bool read_indices_(cgltf_accessor const& accessor, std::uint32_t* out);
+
+	// Turns the indices of a triangle strip or fan into a triangle list
+	std::vector<std::uint32_t> triangulate_(cgltf_primitive_type type, std::vector<std::uint32_t> const& indices);
+
+	// Depth-first list of the nodes of the default scene (or of the first
+	// scene, or of all root nodes for files without scenes)
+	std::vector<cgltf_node const*> scene_nodes_(cgltf_data const& data);
+
+	bool is_triangles_(cgltf_primitive_type type)
+	{
+		return cgltf_primitive_type_triangles == type || cgltf_primitive_type_triangle_strip == type || cgltf_primitive_type_triangle_fan == type;
+	}
+
+	cgltf_accessor const* find_attribute_(cgltf_primitive const& primitive, cgltf_attribute_type type)
+	{
+		for (std::size_t i = 0; i < primitive.attributes_count; ++i)
+		{
+			auto const& attribute = primitive.attributes[i];
+			if (type == attribute.type && 0 == attribute.index)
+				return attribute.data;
+		}
+
+		return nullptr;
+	}
+}
+
+SimpleModel loadGltf(char const* aPath)
+{
+	assert(aPath);
+
+	// Declared first, so that the mappings outlive the cgltf data that points
+	// into them
+	GltfFiles_ files;
+	MappedFile const file(aPath);
+
+	cgltf_options options{};
+	options.file.read = &read_file_;
+	options.file.release = &release_file_;
+	options.file.user_data = &files;
+
+	cgltf_data* parsed = nullptr;
+	auto result = cgltf_parse(&options, file.data(), file.size(), &parsed);
+	if (cgltf_result_success != result)
+		throw lut::Error("Unable to load glTF file '%s': %s", aPath, result_string_(result));
+
+	std::unique_ptr<cgltf_data, GltfDataDeleter_> data(parsed);
+
+	// For .glb files, the first buffer is the (mapped) BIN chunk. Validation
+	// checks that all accessors and buffer views lie within their buffers.
+	result = cgltf_load_buffers(&options, data.get(), aPath);
+	if (cgltf_result_success == result)
+		result = cgltf_validate(data.get());
+
+	if (cgltf_result_success != result)
+		throw lut::Error("Unable to load glTF file '%s': %s", aPath, result_string_(result));
+
+	// Find the path to the glTF file
+	char const* pathBeg = aPath;
+	char const* pathEnd = std::strrchr(pathBeg, '/');
+
+	std::string const prefix = pathEnd
+		? std::string(pathBeg, pathEnd + 1)
+		: ""
+		;
+
+	SimpleModel ret;
+
+	ret.modelSourcePath = aPath;
+
+	for (std::size_t i = 0; i < data->materials_count; ++i)
+		ret.materials.emplace_back(convert_material_(*data, data->materials[i], prefix));
+
+	// Primitives without a material use a default one, added on demand
+	std::size_t defaultMaterial = ~std::size_t(0);
+
+	auto const nodes = scene_nodes_(*data);
+
+	// Size the arenas up front
+	std::size_t vertexCount = 0, indexCount = 0;
+	for (auto const* node : nodes)
+	{
+		if (!node->mesh)
+			continue;
+
+		for (std::size_t p = 0; p < node->mesh->primitives_count; ++p)
+		{
+			auto const& primitive = node->mesh->primitives[p];
+			if (auto const* position = find_attribute_(primitive, cgltf_attribute_type_position))
+			{
+				vertexCount += position->count;
+				indexCount += primitive.indices ? primitive.indices->count : position->count;
+			}
+		}
+	}
+
+	ret.vertices.reserve(vertexCount);
+	ret.indices.reserve(indexCount);
+
+	for (auto const* node : nodes)
+	{
+		if (!node->mesh)
+			continue;
+
+		auto const& mesh = *node->mesh;
+
+		// Node transforms are baked into the vertices. cgltf matrices are
+		// column-major, like glm's.
+		cgltf_float world[16];
+		cgltf_node_transform_world(node, world);
+
+		glm::mat4 transform;
+		std::memcpy(&transform, world, sizeof(world));
+
+		bool const identity = glm::mat4(1.0f) == transform;
+		glm::mat3 const normalTransform = glm::inverseTranspose(glm::mat3(transform));
+		bool const mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+
+		for (std::size_t p = 0; p < mesh.primitives_count; ++p)
+		{
+			auto const& primitive = mesh.primitives[p];
+
+			auto const* position = find_attribute_(primitive, cgltf_attribute_type_position);
+			if (!is_triangles_(primitive.type) || !position)
+				continue;
+
+			auto const* normal = find_attribute_(primitive, cgltf_attribute_type_normal);
+			auto const* tangent = find_attribute_(primitive, cgltf_attribute_type_tangent);
+			auto const* texcoord = find_attribute_(primitive, cgltf_attribute_type_texcoord);
+			auto const* color = find_attribute_(primitive, cgltf_attribute_type_color);
+
+			for (auto const* attribute : { normal, tangent, texcoord, color })
+			{
+				if (attribute && attribute->count != position->count)
+					throw lut::Error("glTF file '%s': attributes of mesh '%s' have different counts", aPath, mesh.name ? mesh.name : "");
+			}
+
+			// Vertex attributes, straight into the model's vertex arena
+			auto const vertexStart = ret.vertices.size();
+			auto const primitiveVertices = position->count;
+
+			ret.vertices.resize(vertexStart + primitiveVertices);
+			Vertex* vertices = ret.vertices.data() + vertexStart;
+
+			bool ok = read_attribute_(*position, vertices, &Vertex::position);
+
+			if (normal)
+				ok = ok && read_attribute_(*normal, vertices, &Vertex::normal);
+
+			if (tangent)
+				ok = ok && read_attribute_(*tangent, vertices, &Vertex::tangent);
+
+			if (texcoord)
+				ok = ok && read_attribute_(*texcoord, vertices, &Vertex::texcoord);
+
+			if (color)
+				ok = ok && read_attribute_(*color, vertices, &Vertex::color);
+
+			// Indices, straight into the model's index arena. They stay relative
+			// to the primitive's first vertex until the end. Non-indexed
+			// primitives draw their vertices in order.
+			auto const indexStart = ret.indices.size();
+			ret.indices.resize(indexStart + (primitive.indices ? primitive.indices->count : primitiveVertices));
+
+			if (primitive.indices)
+				ok = ok && read_indices_(*primitive.indices, ret.indices.data() + indexStart);
+			else
+				std::iota(ret.indices.begin() + indexStart, ret.indices.end(), 0u);
+
+			if (!ok)
+				throw lut::Error("glTF file '%s': unable to read the data of mesh '%s'", aPath, mesh.name ? mesh.name : "");
+
+			if (cgltf_primitive_type_triangles != primitive.type)
+			{
+				auto const list = triangulate_(primitive.type, std::vector<std::uint32_t>(ret.indices.begin() + indexStart, ret.indices.end()));
+
+				ret.indices.resize(indexStart);
+				ret.indices.insert(ret.indices.end(), list.begin(), list.end());
+			}
+
+			ret.indices.resize(ret.indices.size() - (ret.indices.size() - indexStart) % 3);
+
+			std::uint32_t* indices = ret.indices.data() + indexStart;
+			auto const indexCount = ret.indices.size() - indexStart;
+
+			if (indexCount && *std::max_element(indices, indices + indexCount) >= primitiveVertices)
+				throw lut::Error("glTF file '%s': indices of mesh '%s' are out of range", aPath, mesh.name ? mesh.name : "");
+
+			// Mirroring transforms flip the triangles' orientation
+			if (mirrored)
+			{
+				for (std::size_t i = 0; i < indexCount; i += 3)
+					std::swap(indices[i + 1], indices[i + 2]);
+			}
+
+			// Without normals, the triangles are flat shaded. Each corner then
+			// needs its own vertex.
+			if (!normal)
+			{
+				std::vector<Vertex> const shared(vertices, vertices + primitiveVertices);
+
+				ret.vertices.resize(vertexStart + indexCount);
+				vertices = ret.vertices.data() + vertexStart;
+
+				for (std::size_t i = 0; i < indexCount; i += 3)
+				{
+					auto const& v0 = shared[indices[i + 0]];
+					auto const& v1 = shared[indices[i + 1]];
+					auto const& v2 = shared[indices[i + 2]];
+
+					auto faceNormal = glm::cross(v1.position - v0.position, v2.position - v0.position);
+					float const length = glm::length(faceNormal);
+					faceNormal = length > 0.0f ? faceNormal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+
+					vertices[i + 0] = v0;
+					vertices[i + 1] = v1;
+					vertices[i + 2] = v2;
+
+					for (std::size_t k = 0; k < 3; ++k)
+						vertices[i + k].normal = mirrored ? -faceNormal : faceNormal;
+				}
+
+				std::iota(indices, indices + indexCount, 0u);
+			}
+
+			auto const meshVertices = ret.vertices.size() - vertexStart;
+
+			// glTF puts the texture origin at the top left; the renderer
+			// flips images on load, like OBJ texture coordinates expect
+			if (texcoord)
+			{
+				for (std::size_t i = 0; i < meshVertices; ++i)
+					vertices[i].texcoord.y = 1.0f - vertices[i].texcoord.y;
+			}
+
+			if (!identity)
+			{
+				for (std::size_t i = 0; i < meshVertices; ++i)
+				{
+					auto& vertex = vertices[i];
+
+					vertex.position = glm::vec3(transform * glm::vec4(vertex.position, 1.0f));
+					vertex.normal = glm::normalize(normalTransform * vertex.normal);
+
+					if (tangent)
+					{
+						auto const t = glm::normalize(glm::mat3(transform) * glm::vec3(vertex.tangent));
+						vertex.tangent = glm::vec4(t, mirrored ? -vertex.tangent.w : vertex.tangent.w);
+					}
+				}
+			}
+
+			auto const firstVertex = static_cast<std::uint32_t>(vertexStart);
+			for (std::size_t i = 0; i < indexCount; ++i)
+				indices[i] += firstVertex;
+
+			// Material
+			std::size_t materialIndex;
+			if (primitive.material)
+			{
+				materialIndex = std::size_t(primitive.material - data->materials);
+			}
+			else
+			{
+				if (~std::size_t(0) == defaultMaterial)
+				{
+					SimpleMaterialInfo mi;
+					mi.materialName = "default";
+					mi.diffuseColor = glm::vec3(1.0f);
+					mi.emissionColor = glm::vec3(0.0f);
+
+					defaultMaterial = ret.materials.size();
+					ret.materials.emplace_back(std::move(mi));
+				}
+
+				materialIndex = defaultMaterial;
+			}
+
+			auto const& material = ret.materials[materialIndex];
+
+			// Keep track of mesh names; this can be useful for debugging.
+			std::string meshName = mesh.name ? mesh.name : (node->name ? node->name : "");
+			if (mesh.primitives_count > 1)
+				meshName += "::" + std::to_string(p);
+
+			SimpleMeshInfo meshInfo;
+
+			meshInfo.meshName = std::move(meshName);
+			meshInfo.materialIndex = materialIndex;
+			meshInfo.textured = !material.diffuseTexturePath.empty();
+			meshInfo.alphaTextured = !material.alphaTexturePath.empty();
+			meshInfo.normalTextured = !material.normalTexturePath.empty();
+			meshInfo.roughnessTextured = !material.roughnessTexturePath.empty();
+			meshInfo.metallicTextured = !material.metallicTexturePath.empty();
+
+			meshInfo.vertexStartIndex = vertexStart;
+			meshInfo.vertexCount = meshVertices;
+			meshInfo.indexStartIndex = indexStart;
+			meshInfo.indexCount = indexCount;
+
+			// generateTangents() fills in the rest
+			meshInfo.bakedTangents = nullptr != tangent;
+
+			ret.indexCount += indexCount;
+
+			ret.meshes.emplace_back(std::move(meshInfo));
+		}
+	}
+
+	return ret;
+}
+
+namespace
+{
+	cgltf_result read_file_(const cgltf_memory_options*, const cgltf_file_options* options, const char* path, cgltf_size* size, void** data)
+	{
+		auto* files = static_cast<GltfFiles_*>(options->user_data);
+
+		try
+		{
+			files->mappings.emplace_back(path);
+		}
+		catch (const lut::Error&)
+		{
+			return cgltf_result_file_not_found;
+		}
+
+		auto const& mapping = files->mappings.back();
+
+		// `size` is the buffer's declared byteLength (or 0 if unknown)
+		if (size && *size > mapping.size())
+			return cgltf_result_data_too_short;
+
+		if (size)
+			*size = mapping.size();
+
+		// cgltf never writes to buffers it did not allocate itself
+		*data = const_cast<std::byte*>(mapping.data());
+		return cgltf_result_success;
+	}
+
+	void release_file_(const cgltf_memory_options*, const cgltf_file_options*, void*)
+	{}
+
+	char const* result_string_(cgltf_result result)
+	{
+		switch (result)
+		{
+			case cgltf_result_success: return "success";
+			case cgltf_result_data_too_short: return "data too short";
+			case cgltf_result_unknown_format: return "unknown format";
+			case cgltf_result_invalid_json: return "invalid JSON";
+			case cgltf_result_invalid_gltf: return "invalid glTF";
+			case cgltf_result_invalid_options: return "invalid options";
+			case cgltf_result_file_not_found: return "file not found";
+			case cgltf_result_io_error: return "I/O error";
+			case cgltf_result_out_of_memory: return "out of memory";
+			case cgltf_result_legacy_gltf: return "legacy glTF (1.0)";
+			default: return "unknown error";
+		}
+	}
+
+	// Path of the image file behind a texture. Empty if there is no texture,
+	// or if the image is embedded (see loadGltf()).
+	std::string texture_path_(cgltf_texture_view const& view, std::string const& prefix)
+	{
+		if (!view.texture || !view.texture->image || !view.texture->image->uri)
+			return {};
+
+		std::string uri = view.texture->image->uri;
+		if (0 == uri.compare(0, 5, "data:"))
+			return {};
+
+		uri.resize(cgltf_decode_uri(uri.data()));
+		return prefix + uri;
+	}
+
+	SimpleMaterialInfo convert_material_(cgltf_data const& data, cgltf_material const& material, std::string const& prefix)
+	{
+		SimpleMaterialInfo mi;
+
+		// cgltf fills in the glTF defaults for missing factors
+		auto const& pbr = material.pbr_metallic_roughness;
+
+		mi.materialName = material.name ? material.name : "";
+		mi.diffuseColor = glm::vec3(pbr.base_color_factor[0], pbr.base_color_factor[1], pbr.base_color_factor[2]);
+		mi.emissionColor = glm::vec3(material.emissive_factor[0], material.emissive_factor[1], material.emissive_factor[2]);
+		mi.metallic = pbr.metallic_factor;
+		mi.roughness = pbr.roughness_factor;
+
+		if (auto path = texture_path_(pbr.base_color_texture, prefix); !path.empty())
+		{
+			mi.diffuseTexturePath = path;
+			mi.diffuseTextureIndex = static_cast<uint32_t>(pbr.base_color_texture.texture - data.textures);
+
+			// The renderer takes alpha from the alpha texture's alpha channel
+			if (cgltf_alpha_mode_opaque != material.alpha_mode)
+			{
+				mi.alphaTexturePath = std::move(path);
+				mi.alphaTextureIndex = mi.diffuseTextureIndex;
+			}
+		}
+
+		if (auto path = texture_path_(material.normal_texture, prefix); !path.empty())
+		{
+			mi.normalTexturePath = std::move(path);
+			mi.normalTextureIndex = static_cast<uint32_t>(material.normal_texture.texture - data.textures);
+		}
+
+		return mi;
+	}
+
+	template<typename T>
+	bool read_attribute_(cgltf_accessor const& accessor, Vertex* vertices, T Vertex::* member)
+	{
+		constexpr std::size_t kMemberComponents = sizeof(T) / sizeof(float);
+
+		auto const components = cgltf_num_components(accessor.type);
+		auto const bytes = std::min<std::size_t>(components, kMemberComponents) * sizeof(float);
+
+		// Plain floats (tightly packed or interleaved) are copied straight out
+		// of the buffer, with sparse substitutions applied on top
+		if (accessor.buffer_view && cgltf_component_type_r_32f == accessor.component_type)
+		{
+			auto const* src = cgltf_buffer_view_data(accessor.buffer_view);
+			if (!src)
+				return false;
+
+			src += accessor.offset;
+
+			// Fixed-size copies in the common case, where the accessor has
+			// (at least) as many components as the member
+			if (sizeof(T) == bytes)
+			{
+				for (std::size_t i = 0; i < accessor.count; ++i)
+					std::memcpy(&(vertices[i].*member), src + i * accessor.stride, sizeof(T));
+			}
+			else
+			{
+				for (std::size_t i = 0; i < accessor.count; ++i)
+					std::memcpy(&(vertices[i].*member), src + i * accessor.stride, bytes);
+			}
+
+			if (!accessor.is_sparse)
+				return true;
+
+			auto const& sparse = accessor.sparse;
+
+			auto const* sparseIndices = cgltf_buffer_view_data(sparse.indices_buffer_view);
+			auto const* sparseValues = cgltf_buffer_view_data(sparse.values_buffer_view);
+			if (!sparseIndices || !sparseValues)
+				return false;
+
+			sparseIndices += sparse.indices_byte_offset;
+			sparseValues += sparse.values_byte_offset;
+
+			auto const indexSize = cgltf_component_size(sparse.indices_component_type);
+
+			for (std::size_t i = 0; i < sparse.count; ++i)
+			{
+				std::uint32_t target;
+				if (!read_index_(sparseIndices + i * indexSize, sparse.indices_component_type, target) || target >= accessor.count)
+					return false;
+
+				std::memcpy(&(vertices[target].*member), sparseValues + i * components * sizeof(float), bytes);
+			}
+
+			return true;
+		}
+
+		// Everything else (normalized integers, accessors without a buffer
+		// view) is converted by cgltf
+		std::vector<cgltf_float> values(accessor.count * components);
+		if (values.size() != cgltf_accessor_unpack_floats(&accessor, values.data(), values.size()))
+			return false;
+
+		for (std::size_t i = 0; i < accessor.count; ++i)
+			std::memcpy(&(vertices[i].*member), values.data() + i * components, bytes);
+
+		return true;
+	}
+
+	bool read_index_(std::uint8_t const* src, cgltf_component_type type, std::uint32_t& out)
+	{
+		switch (type)
+		{
+			case cgltf_component_type_r_8u:
+				out = *src;
+				return true;
+			case cgltf_component_type_r_16u:
+			{
+				std::uint16_t value;
+				std::memcpy(&value, src, sizeof(value));
+				out = value;
+				return true;
+			}
+			case cgltf_component_type_r_32u:
+				std::memcpy(&out, src, sizeof(out));
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	bool read_indices_(cgltf_accessor const& accessor, std::uint32_t* out)
+	{
+		// Dense part; accessors without a buffer view are all zeros
+		if (!accessor.buffer_view)
+		{
+			std::fill(out, out + accessor.count, 0u);
+		}
+		else
+		{
+			auto const* src = cgltf_buffer_view_data(accessor.buffer_view);
+			if (!src)
+				return false;
+
+			src += accessor.offset;
+
+			if (cgltf_component_type_r_32u == accessor.component_type && sizeof(std::uint32_t) == accessor.stride)
+			{
+				std::memcpy(out, src, accessor.count * sizeof(std::uint32_t));
+			}
+			else
+			{
+				for (std::size_t i = 0; i < accessor.count; ++i)
+				{
+					if (!read_index_(src + i * accessor.stride, accessor.component_type, out[i]))
+						return false;
+				}
+			}
+		}
+
+		if (!accessor.is_sparse)
+			return true;
+
+		// Sparse substitutions
+		auto const& sparse = accessor.sparse;
+
+		auto const* sparseIndices = cgltf_buffer_view_data(sparse.indices_buffer_view);
+		auto const* sparseValues = cgltf_buffer_view_data(sparse.values_buffer_view);
+		if (!sparseIndices || !sparseValues)
+			return false;
+
+		sparseIndices += sparse.indices_byte_offset;
+		sparseValues += sparse.values_byte_offset;
+
+		auto const indexSize = cgltf_component_size(sparse.indices_component_type);
+		auto const valueSize = cgltf_component_size(accessor.component_type);
+
+		for (std::size_t i = 0; i < sparse.count; ++i)
+		{
+			std::uint32_t target, value;
+			if (!read_index_(sparseIndices + i * indexSize, sparse.indices_component_type, target) || target >= accessor.count)
+				return false;
+
+			if (!read_index_(sparseValues + i * valueSize, accessor.component_type, value))
+				return false;
+
+			out[target] = value;
+		}
+
+		return true;
+	}
+
+	std::vector<std::uint32_t> triangulate_(cgltf_primitive_type type, std::vector<std::uint32_t> const& indices)
+	{
+		std::vector<std::uint32_t> ret;
+		if (indices.size() < 3)
+			return ret;
+
+		ret.reserve(3 * (indices.size() - 2));
+
+		for (std::size_t i = 2; i < indices.size(); ++i)
+		{
+			if (cgltf_primitive_type_triangle_fan == type)
+			{
+				ret.insert(ret.end(), { indices[0], indices[i - 1], indices[i] });
+			}
+			else if (0 == i % 2)
+			{
+				ret.insert(ret.end(), { indices[i - 2], indices[i - 1], indices[i] });
+			}
+			else
+			{
+				ret.insert(ret.end(), { indices[i - 1], indices[i - 2], indices[i] });
+			}
+		}
+
+		return ret;
+	}
+
+	std::vector<cgltf_node const*> scene_nodes_(cgltf_data const& data)
+	{
+		std::vector<cgltf_node const*> stack;
+
+		cgltf_scene const* scene = data.scene ? data.scene : (data.scenes_count ? data.scenes : nullptr);
+		if (scene)
+		{
+			for (std::size_t i = scene->nodes_count; i > 0; --i)
+				stack.push_back(scene->nodes[i - 1]);
+		}
+		else
+		{
+			for (std::size_t i = data.nodes_count; i > 0; --i)
+			{
+				if (!data.nodes[i - 1].parent)
+					stack.push_back(&data.nodes[i - 1]);
+			}
+		}
+
+		std::vector<cgltf_node const*> ret;
+		while (!stack.empty())
+		{
+			auto const* node = stack.back();
+			stack.pop_back();
+
+			ret.push_back(node);
+
+			for (std::size_t i = node->children_count; i > 0; --i)
+				stack.push_back(node->children[i - 1]);
+		}
+
+		return ret;
+	}
+}
@@ -0,0 +1,21 @@
+#ifndef LOAD_MODEL_GLTF_HPP_5E8B3C21_A7D4_4F16_92C0_7B1E6D48F3A9
+#define LOAD_MODEL_GLTF_HPP_5E8B3C21_A7D4_4F16_92C0_7B1E6D48F3A9
+
+#include "SimpleModel.h"
+
+// Load a glTF 2.0 model (.gltf with external or embedded buffers, or .glb)
+//
+// The file and its external buffers are memory mapped, and vertex attributes
+// and indices are copied straight out of the mapped buffers. Interleaved and
+// sparse accessors are supported. Node transforms of the default scene are
+// baked into the vertices; only triangle primitives (lists, strips, fans) are
+// imported.
+//
+// Materials keep their glTF texture indices. Only textures stored in separate
+// image files get a texture path; the renderer loads textures by path, so
+// images embedded in buffers or data URIs are skipped. The packed glTF
+// metallic-roughness texture is not used either (the renderer expects
+// separate single-channel textures), only its factors are.
+SimpleModel loadGltf( char const* aPath );
+
+#endif // LOAD_MODEL_GLTF_HPP_5E8B3C21_A7D4_4F16_92C0_7B1E6D48F3A9
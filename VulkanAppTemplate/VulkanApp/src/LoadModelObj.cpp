@@ -1,21 +1,107 @@
 #include "LoadModelObj.h"
 
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <algorithm>
 #include <unordered_set>
 
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 
 #include <rapidobj/rapidobj.hpp>
 
 #include "labutils/error.hpp"
 #include "SimpleModel.h"
+#include "ObjModelCache.h"
 
 namespace lut = labutils;
 
-SimpleModel loadSimpleWavefrontObj(char const* aPath)
+namespace
+{
+	// Mesh vertices are identified by their OBJ position, normal and
+	// texture coordinate indices. Untextured materials ignore the texture
+	// coordinates, so their `texcoord` is -1.
+	struct IndexTriplet_
+	{
+		int position;
+		int normal;
+		int texcoord;
+	};
+
+	// Flat open-addressing (linear probing) map from index triplets to vertex
+	// indices. The capacity is fixed up front and the table never rehashes;
+	// `maxEntries` must be an upper bound on the number of distinct keys.
+	class TripletTable_
+	{
+	public:
+		explicit TripletTable_(std::size_t maxEntries);
+
+		// Returns the vertex index of `key`. If the key is new, it is mapped
+		// to `newIndex` and `inserted` is set.
+		std::uint32_t findOrInsert(IndexTriplet_ const& key, std::uint32_t newIndex, bool& inserted);
+
+	private:
+		static constexpr std::uint32_t kEmpty = ~std::uint32_t(0);
+
+		struct Slot_
+		{
+			IndexTriplet_ key;
+			std::uint32_t value;
+		};
+
+		std::vector<Slot_> mSlots;
+		std::size_t mMask;
+	};
+
+	// One mesh, i.e., the faces of one shape that use one material
+	struct MeshJob_
+	{
+		std::size_t shape;
+		std::size_t material;
+		std::size_t shapeMaterials; // Number of meshes of the shape
+
+		std::vector<std::uint32_t> faces;
+
+		// Filled by build_mesh_(): the mesh's unique vertices in the order of
+		// their first use, and indices into those.
+		std::vector<Vertex> vertices;
+		std::vector<std::uint32_t> indices;
+
+		// Filled when stitching the meshes together; the vectors above are
+		// released once they have been copied into the model.
+		std::size_t firstVertex, vertexCount;
+		std::size_t firstIndex, indexCount;
+	};
+
+	void build_mesh_(MeshJob_& job, rapidobj::Result const& result, bool textured);
+
+	// Calls func(0) ... func(count-1) on up to one thread per hardware thread
+	template<typename Func>
+	void parallel_for_(std::size_t count, Func&& func);
+}
+
+SimpleModel loadSimpleWavefrontObj(char const* aPath, bool aUseCache)
 {
 	assert(aPath);
 
+	if (aUseCache)
+	{
+		if (auto cached = readSimpleModelCache(aPath))
+			return std::move(*cached);
+
+		// Stamp the sources before parsing them; if they change meanwhile,
+		// the cache is stale right away rather than never.
+		auto const sources = stampObjModelSources(aPath);
+		auto model = loadSimpleWavefrontObj(aPath, false);
+
+		// Failing to write the cache only costs us the parse next time.
+		writeSimpleModelCache(aPath, sources, model);
+		return model;
+	}
+
 	// Ask rapidobj to load the requested file
 	auto result = rapidobj::ParseFile(aPath);
 	if (result.error)
@@ -73,7 +159,8 @@ SimpleModel loadSimpleWavefrontObj(char const* aPath)
 
 	// Next, extract the actual mesh data. There are some complications:
 	// - OBJ use separate indices to positions, normals and texture coords. To
-	//   deal with this, the mesh is turned into an unindexed triangle soup.
+	//   deal with this, each distinct combination of the three becomes one
+	//   vertex.
 	// - OBJ uses three methods of grouping faces:
 	//   - 'o' = object
 	//   - 'g' = group
@@ -83,150 +170,259 @@ SimpleModel loadSimpleWavefrontObj(char const* aPath)
 	//  secondarily by other logical groupings). 
 	//
 	// Unfortunately, RapidOBJ exposes a per-face material index.
+	//
+	// Each (shape, material) pair becomes one mesh. The meshes are built
+	// independently on worker threads and then stitched together in order,
+	// so the result does not depend on the number of threads.
+
+	// Bucket each shape's faces by material, in one pass over the faces. The
+	// meshes of a shape are ordered by the iteration order of
+	// activeMaterials, as they always have been.
+	std::vector<MeshJob_> jobs;
 
 	std::unordered_set<std::size_t> activeMaterials;
-	std::unordered_map<Vertex, uint32_t> globalUniqueVertices;
+	std::vector<std::size_t> materialBucket(ret.materials.size());
+	std::vector<MeshJob_> buckets;
 
-	for (auto const& shape : result.shapes)
+	for (std::size_t s = 0; s < result.shapes.size(); ++s)
 	{
-		auto const& shapeName = shape.name;
+		auto const& shape = result.shapes[s];
 
-		// Scan shape for materials
 		activeMaterials.clear();
+		buckets.clear();
+
+		assert(shape.mesh.indices.size() == 3 * shape.mesh.material_ids.size()); // Always triangles; see Triangulate() above
 
-		for (std::size_t i = 0; i < shape.mesh.indices.size(); ++i)
+		for (std::size_t faceId = 0; faceId < shape.mesh.material_ids.size(); ++faceId)
 		{
-			auto const faceId = i / 3; // Always triangles; see Triangulate() above
+			auto const matId = std::size_t(shape.mesh.material_ids[faceId]);
+			assert(matId < ret.materials.size());
 
-			assert(faceId < shape.mesh.material_ids.size());
-			auto const matId = shape.mesh.material_ids[faceId];
+			if (activeMaterials.emplace(matId).second)
+			{
+				materialBucket[matId] = buckets.size();
+
+				auto& bucket = buckets.emplace_back();
+				bucket.shape = s;
+				bucket.material = matId;
+			}
 
-			assert(matId < int(ret.materials.size()));
-			activeMaterials.emplace(matId);
+			buckets[materialBucket[matId]].faces.emplace_back(std::uint32_t(faceId));
 		}
 
-		// Process vertices for active material
-		// This does multiple passes over the vertex data, which is less than
-		// optimal...
-		//
-		// Note: we still keep different "shapes" separate. For static meshes,
-		// one could merge all vertices with the same material for a bit more
-		// efficient rendering.
 		for (auto const matId : activeMaterials)
 		{
-			auto* opos = &ret.dataTextured.positions;
-			auto* otex = &ret.dataTextured.texcoords;
-			auto* onormals = &ret.dataTextured.normals;
+			auto& job = jobs.emplace_back(std::move(buckets[materialBucket[matId]]));
+			job.shapeMaterials = activeMaterials.size();
+		}
+	}
 
-			bool const textured = !ret.materials[matId].diffuseTexturePath.empty();
-			bool const alphaTextured = !ret.materials[matId].alphaTexturePath.empty();
-			bool const normalTextured = !ret.materials[matId].normalTexturePath.empty();
-			bool const roughnessTextured = !ret.materials[matId].roughnessTexturePath.empty();
-			bool const metallicTextured = !ret.materials[matId].metallicTexturePath.empty();
+	// Build the meshes. Note: we still keep different "shapes" separate. For
+	// static meshes, one could merge all vertices with the same material for
+	// a bit more efficient rendering.
+	parallel_for_(jobs.size(), [&](std::size_t i) {
+		auto& job = jobs[i];
+		build_mesh_(job, result, !ret.materials[job.material].diffuseTexturePath.empty());
+	});
 
-			if (!textured)
-			{
-				opos = &ret.dataUntextured.positions;
-				onormals = &ret.dataUntextured.normals;
-				otex = nullptr;
-			}
+	// Stitch the meshes together. Each mesh gets its own contiguous range of
+	// the model's vertex and index arenas, in mesh order, so the result does
+	// not depend on the number of threads.
+	std::size_t totalVertices = 0, totalIndices = 0;
 
-			// Keep track of mesh names; this can be useful for debugging.
-			std::string meshName;
-			if (1 == activeMaterials.size())
-				meshName = shapeName;
-			else
-				meshName = shapeName + "::" + ret.materials[matId].materialName;
+	for (auto& job : jobs)
+	{
+		job.firstVertex = totalVertices;
+		job.vertexCount = job.vertices.size();
+		job.firstIndex = totalIndices;
+		job.indexCount = job.indices.size();
 
-			// Extract this material's vertices.
-			auto const firstVertex = opos->size();
-			size_t firstIndex = ret.indices.size();
-			assert(!textured || firstVertex == otex->size());
+		totalVertices += job.vertexCount;
+		totalIndices += job.indexCount;
+	}
+
+	ret.vertices.resize(totalVertices);
+	ret.indices.resize(totalIndices);
+
+	parallel_for_(jobs.size(), [&](std::size_t i) {
+		auto& job = jobs[i];
+
+		std::copy(job.vertices.begin(), job.vertices.end(), ret.vertices.begin() + job.firstVertex);
+
+		auto const firstVertex = static_cast<std::uint32_t>(job.firstVertex);
+		std::transform(job.indices.begin(), job.indices.end(), ret.indices.begin() + job.firstIndex, [=](std::uint32_t index) { return index + firstVertex; });
 
-			std::vector<Vertex> vertices;
-			std::vector<uint32_t> indices;
-			std::unordered_map<Vertex, uint32_t> uniqueVertices;
+		// Only the arenas are kept
+		job.vertices = {};
+		job.indices = {};
+	});
 
-			for (std::size_t i = 0; i < shape.mesh.indices.size(); ++i)
+	for (auto& job : jobs)
+	{
+		auto const matId = job.material;
+		auto const& shapeName = result.shapes[job.shape].name;
+
+		// Keep track of mesh names; this can be useful for debugging.
+		std::string meshName;
+		if (1 == job.shapeMaterials)
+			meshName = shapeName;
+		else
+			meshName = shapeName + "::" + ret.materials[matId].materialName;
+
+		SimpleMeshInfo meshInfo;
+
+		meshInfo.meshName = std::move(meshName);
+		meshInfo.materialIndex = matId;
+		meshInfo.textured = !ret.materials[matId].diffuseTexturePath.empty();
+		meshInfo.alphaTextured = !ret.materials[matId].alphaTexturePath.empty();
+		meshInfo.normalTextured = !ret.materials[matId].normalTexturePath.empty();
+		meshInfo.roughnessTextured = !ret.materials[matId].roughnessTexturePath.empty();
+		meshInfo.metallicTextured = !ret.materials[matId].metallicTexturePath.empty();
+
+		meshInfo.vertexStartIndex = job.firstVertex;
+		meshInfo.vertexCount = job.vertexCount;
+		meshInfo.indexStartIndex = job.firstIndex;
+		meshInfo.indexCount = job.indexCount;
+
+		ret.indexCount += job.indexCount;
+
+		ret.meshes.emplace_back(std::move(meshInfo));
+	}
+
+	return ret;
+}
+
+namespace
+{
+	TripletTable_::TripletTable_(std::size_t maxEntries)
+	{
+		// At most two thirds full (and usually far less, as most vertices are
+		// shared by several indices), so that probe sequences stay short
+		std::size_t capacity = 16;
+		while (capacity < maxEntries + maxEntries / 2)
+			capacity *= 2;
+
+		mSlots.resize(capacity, Slot_{ { 0, 0, 0 }, kEmpty });
+		mMask = capacity - 1;
+	}
+
+	std::uint32_t TripletTable_::findOrInsert(IndexTriplet_ const& key, std::uint32_t newIndex, bool& inserted)
+	{
+		std::uint64_t hash = std::uint64_t(std::uint32_t(key.position)) * 0x9E3779B97F4A7C15ull;
+		hash ^= std::uint64_t(std::uint32_t(key.normal)) * 0xC2B2AE3D27D4EB4Full;
+		hash ^= std::uint64_t(std::uint32_t(key.texcoord)) * 0x165667B19E3779F9ull;
+		hash ^= hash >> 29;
+
+		for (std::size_t slot = std::size_t(hash) & mMask;; slot = (slot + 1) & mMask)
+		{
+			auto& entry = mSlots[slot];
+
+			if (kEmpty == entry.value)
 			{
-				auto const faceId = i / 3; // Always triangles; see Triangulate() above
-				auto const faceMat = std::size_t(shape.mesh.material_ids[faceId]);
+				entry.key = key;
+				entry.value = newIndex;
+				inserted = true;
+				return newIndex;
+			}
 
-				if (faceMat != matId)
-					continue;
+			if (entry.key.position == key.position && entry.key.normal == key.normal && entry.key.texcoord == key.texcoord)
+			{
+				inserted = false;
+				return entry.value;
+			}
+		}
+	}
 
-				auto const& idx = shape.mesh.indices[i];
+	void build_mesh_(MeshJob_& job, rapidobj::Result const& result, bool textured)
+	{
+		auto const& shape = result.shapes[job.shape];
+		auto const indexCount = 3 * job.faces.size();
 
-				Vertex vertex;
+		job.indices.reserve(indexCount);
+
+		TripletTable_ uniqueVertices(indexCount);
+
+		for (auto const faceId : job.faces)
+		{
+			for (std::size_t i = 3 * std::size_t(faceId); i < 3 * std::size_t(faceId) + 3; ++i)
+			{
+				auto const& idx = shape.mesh.indices[i];
 
 				auto x = result.attributes.positions[idx.position_index * 3 + 0];
 				auto y = result.attributes.positions[idx.position_index * 3 + 1];
 				auto z = result.attributes.positions[idx.position_index * 3 + 2];
 
-				opos->emplace_back(glm::vec3{ x, y, z });
-
-				vertex.position = { x, y, z };
-
 				auto nx = result.attributes.normals[idx.normal_index * 3 + 0];
 				auto ny = result.attributes.normals[idx.normal_index * 3 + 1];
 				auto nz = result.attributes.normals[idx.normal_index * 3 + 2];
 
-				onormals->emplace_back(glm::vec3{ nx, ny, nz });
-
-				vertex.normal = { nx, ny, nz };
+				glm::vec2 texcoord{ 0.0f, 0.0f };
 
 				if (textured)
 				{
 					auto tx = result.attributes.texcoords[idx.texcoord_index * 2 + 0];
 					auto ty = result.attributes.texcoords[idx.texcoord_index * 2 + 1];
 
-					otex->emplace_back(glm::vec2{ tx, ty });
-
-					vertex.texcoord = { tx, ty };
+					texcoord = { tx, ty };
 				}
 
-				if (uniqueVertices.count(vertex) == 0)
-				{
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.emplace_back(vertex);
-				}
+				IndexTriplet_ const key{ idx.position_index, idx.normal_index, textured ? idx.texcoord_index : -1 };
 
-				if (globalUniqueVertices.count(vertex) == 0)
+				bool inserted = false;
+				auto const index = uniqueVertices.findOrInsert(key, static_cast<uint32_t>(job.vertices.size()), inserted);
+
+				if (inserted)
 				{
-					globalUniqueVertices[vertex] = static_cast<uint32_t>(ret.vertices.size());
-					ret.vertices.emplace_back(vertex);
+					Vertex vertex;
+					vertex.position = { x, y, z };
+					vertex.normal = { nx, ny, nz };
+					vertex.texcoord = texcoord;
+
+					job.vertices.emplace_back(vertex);
 				}
 
-				ret.indices.emplace_back(globalUniqueVertices[vertex]);
-				indices.emplace_back(globalUniqueVertices[vertex]);
+				job.indices.emplace_back(index);
 			}
+		}
+	}
 
-			SimpleMeshInfo meshInfo;
+	template<typename Func>
+	void parallel_for_(std::size_t count, Func&& func)
+	{
+		std::atomic<std::size_t> next{ 0 };
 
-			meshInfo.meshName = std::move(meshName);
-			meshInfo.materialIndex = matId;
-			meshInfo.textured = textured;
-			meshInfo.alphaTextured = alphaTextured;
-			meshInfo.normalTextured = normalTextured;
-			meshInfo.roughnessTextured = roughnessTextured;
-			meshInfo.metallicTextured = metallicTextured;
+		std::exception_ptr error;
+		std::atomic_flag errorSet = ATOMIC_FLAG_INIT;
 
-			auto const vertexCount = vertices.size();
+		auto const work = [&] {
+			try
+			{
+				for (std::size_t i = next++; i < count; i = next++)
+					func(i);
+			}
+			catch (...)
+			{
+				next = count;
 
-			auto const indexCount = ret.indices.size() - firstIndex;
+				if (!errorSet.test_and_set())
+					error = std::current_exception();
+			}
+		};
 
-			meshInfo.vertexCount = vertexCount;
-			meshInfo.indexStartIndex = firstIndex;
-			meshInfo.indexCount = indexCount;
-			meshInfo.vertices = vertices;
-			meshInfo.indices = indices;
+		auto const hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+		auto const threadCount = std::max<std::size_t>(1, std::min<std::size_t>(hardwareThreads, count));
 
-			ret.indexCount += indexCount;
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+		for (std::size_t i = 1; i < threadCount; ++i)
+			threads.emplace_back(work);
 
-			ret.meshes.emplace_back(meshInfo);
-		}
-	}
+		work();
 
-	return ret;
-}
+		for (auto& thread : threads)
+			thread.join();
 
+		if (error)
+			std::rethrow_exception(error);
+	}
+}
@@ -4,7 +4,12 @@
 #include "SimpleModel.h"
 
 // Load a Wavefront OBJ model
-SimpleModel loadSimpleWavefrontObj( char const* aPath );
+//
+// With `aUseCache`, the processed model is cached in a binary file next to the
+// OBJ on the first load, and later loads map that file instead of parsing the
+// OBJ again (see ObjModelCache.h). The cache is rebuilt automatically when the
+// OBJ or its material library change.
+SimpleModel loadSimpleWavefrontObj( char const* aPath, bool aUseCache = true );
 
 #endif // LOAD_MODEL_OBJ_HPP_1B67CFB6_BF91_421E_983A_CA92A246F902
 
@@ -0,0 +1,137 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
+#include "labutils/error.hpp"
+
+namespace lut = labutils;
+
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (INVALID_HANDLE_VALUE == file)
+		throw lut::Error("MappedFile: unable to open '%s' for reading (error %lu)", path.c_str(), GetLastError());
+
+	mFile = file;
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size))
+	{
+		release();
+		throw lut::Error("MappedFile: unable to query size of '%s' (error %lu)", path.c_str(), GetLastError());
+	}
+
+	mSize = static_cast<std::size_t>(size.QuadPart);
+	if (0 == mSize)
+		return;
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		release();
+		throw lut::Error("MappedFile: unable to create mapping for '%s' (error %lu)", path.c_str(), GetLastError());
+	}
+
+	mMapping = mapping;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		release();
+		throw lut::Error("MappedFile: unable to map '%s' (error %lu)", path.c_str(), GetLastError());
+	}
+
+	mData = static_cast<const std::byte*>(view);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw lut::Error("MappedFile: unable to open '%s' for reading", path.c_str());
+
+	struct stat st {};
+	if (0 != ::fstat(fd, &st))
+	{
+		::close(fd);
+		throw lut::Error("MappedFile: unable to query size of '%s'", path.c_str());
+	}
+
+	mSize = static_cast<std::size_t>(st.st_size);
+	if (0 != mSize)
+	{
+		void* view = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (MAP_FAILED == view)
+		{
+			::close(fd);
+			throw lut::Error("MappedFile: unable to map '%s'", path.c_str());
+		}
+
+		mData = static_cast<const std::byte*>(view);
+	}
+
+	// The mapping keeps its own reference to the file.
+	::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: mData(std::exchange(other.mData, nullptr))
+	, mSize(std::exchange(other.mSize, 0))
+#ifdef _WIN32
+	, mFile(std::exchange(other.mFile, nullptr))
+	, mMapping(std::exchange(other.mMapping, nullptr))
+#endif
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		release();
+
+		mData = std::exchange(other.mData, nullptr);
+		mSize = std::exchange(other.mSize, 0);
+#ifdef _WIN32
+		mFile = std::exchange(other.mFile, nullptr);
+		mMapping = std::exchange(other.mMapping, nullptr);
+#endif
+	}
+
+	return *this;
+}
+
+void MappedFile::release() noexcept
+{
+#ifdef _WIN32
+	if (mData)
+		UnmapViewOfFile(mData);
+	if (mMapping)
+		CloseHandle(mMapping);
+	if (mFile)
+		CloseHandle(mFile);
+
+	mFile = nullptr;
+	mMapping = nullptr;
+#else
+	if (mData)
+		::munmap(const_cast<std::byte*>(mData), mSize);
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+}
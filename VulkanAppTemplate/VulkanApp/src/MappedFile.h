@@ -0,0 +1,47 @@
+#ifndef MAPPED_FILE_HPP_4C1E2A7B_9D3F_4E61_B8A2_6F0D5C3E9A14
+#define MAPPED_FILE_HPP_4C1E2A7B_9D3F_4E61_B8A2_6F0D5C3E9A14
+
+#include <string>
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file.
+//
+// The mapping is move-only (like labutils::UniqueHandle<>) and is released
+// when the object goes out of scope. Pointers returned by data() are only
+// valid for as long as the MappedFile that produced them is alive.
+//
+// Empty files are valid; data() returns nullptr and size() returns 0 for them.
+class MappedFile final
+{
+public:
+	MappedFile() noexcept = default;
+	~MappedFile();
+
+	explicit MappedFile(const std::string& path);
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&&) noexcept;
+	MappedFile& operator=(MappedFile&&) noexcept;
+
+public:
+	const std::byte* data() const noexcept { return mData; }
+	std::size_t size() const noexcept { return mSize; }
+
+	bool empty() const noexcept { return 0 == mSize; }
+
+private:
+	void release() noexcept;
+
+	const std::byte* mData = nullptr;
+	std::size_t mSize = 0;
+
+#ifdef _WIN32
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#endif
+};
+
+#endif // MAPPED_FILE_HPP_4C1E2A7B_9D3F_4E61_B8A2_6F0D5C3E9A14
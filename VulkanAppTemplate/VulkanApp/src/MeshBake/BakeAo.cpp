@@ -0,0 +1,367 @@
+#include "BakeAo.h"
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include <glm/glm.hpp>
+
+#include "WorkPool.h"
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr std::size_t kLanes_ = 4;
+
+	// Vertices per task
+	constexpr std::size_t kChunkSize_ = 256;
+
+	/* Up to four triangles of a leaf, stored as structure of arrays with the
+	 * vertex and edges precomputed for Möller-Trumbore. The four lanes are
+	 * tested in one go without branches, which the compiler vectorizes. Unused
+	 * lanes are zero (degenerate) and never hit.
+	 */
+	struct TrianglePack_
+	{
+		float v0[3][kLanes_];
+		float e1[3][kLanes_];
+		float e2[3][kLanes_];
+	};
+
+	// BvhNode with the leaves' `offset` and `count` referring to packs
+	struct Node_
+	{
+		glm::vec3 aabbMin;
+		std::uint32_t offset;
+		glm::vec3 aabbMax;
+		std::uint32_t count;
+	};
+
+	struct Ray_
+	{
+		glm::vec3 origin;
+		glm::vec3 direction;
+		glm::vec3 invDirection;
+		float maxT;
+	};
+
+	struct Scene_
+	{
+		std::vector<Node_> nodes;
+		std::vector<TrianglePack_> packs;
+	};
+
+	struct Chunk_
+	{
+		std::uint32_t mesh;
+		std::uint32_t firstVertex;
+		std::uint32_t vertexCount;
+	};
+
+	Scene_ make_scene_( std::vector<IndexedMesh> const&, BvhData const&, std::vector<BvhTriangle> const& );
+
+	bool hits_box_( Ray_ const&, glm::vec3 const& aMin, glm::vec3 const& aMax );
+	bool hits_pack_( Ray_ const&, TrianglePack_ const& );
+
+	bool occluded_( Scene_ const&, Ray_ const&, std::vector<std::uint32_t>& aStack );
+
+	// Integer hash (for the per-vertex rotation of the ray pattern)
+	std::uint32_t hash_u32_( std::uint32_t );
+}
+
+//--    bake_ambient_occlusion()        ///{{{2///////////////////////////////
+std::vector<std::vector<std::uint8_t>> bake_ambient_occlusion( std::vector<IndexedMesh> const& aMeshes, BvhData const& aTriangleBvh, std::vector<BvhTriangle> const& aTriangles, float aMaxDistance, std::size_t aRayCount, std::size_t aThreadCount, AoStats* aStats )
+{
+	if( 0 == aRayCount )
+		throw lut::Error( "bake_ambient_occlusion(): need at least one ray per vertex" );
+
+	auto const start = std::chrono::steady_clock::now();
+
+	std::vector<std::vector<std::uint8_t>> ret( aMeshes.size() );
+	for( std::size_t m = 0; m < aMeshes.size(); ++m )
+		ret[m].assign( aMeshes[m].vert.size(), 255 );
+
+	if( aTriangleBvh.nodes.empty() || !(aMaxDistance > 0.f) )
+		return ret;
+
+	auto const scene = make_scene_( aMeshes, aTriangleBvh, aTriangles );
+
+	/* Ray pattern in tangent space: cosine-weighted directions with stratified
+	 * elevations and golden-angle azimuths, which cover the hemisphere evenly.
+	 * Each vertex rotates the pattern about its normal by a pseudo-random
+	 * angle, which turns banding into noise.
+	 */
+	std::vector<glm::vec3> pattern( aRayCount );
+	for( std::size_t i = 0; i < aRayCount; ++i )
+	{
+		float const u = (i + 0.5f) / aRayCount;
+		float const phi = 2.f * 3.14159265f * std::fmod( i * 0.618033989f, 1.f );
+		float const r = std::sqrt( u );
+		pattern[i] = glm::vec3( r * std::cos( phi ), r * std::sin( phi ), std::sqrt( 1.f - u ) );
+	}
+
+	// Offset ray origins off the surface, such that rays do not hit the
+	// vertex's own triangles.
+	float const bias = 1e-3f * aMaxDistance;
+
+	std::vector<Chunk_> chunks;
+	for( std::size_t m = 0; m < aMeshes.size(); ++m )
+	{
+		auto const count = aMeshes[m].vert.size();
+		for( std::size_t first = 0; first < count; first += kChunkSize_ )
+			chunks.push_back( { std::uint32_t(m), std::uint32_t(first), std::uint32_t(std::min( kChunkSize_, count-first )) } );
+	}
+
+	std::atomic<std::uint64_t> totalRays{ 0 }, totalHits{ 0 };
+
+	run_tasks( chunks.size(), [&] (std::size_t aIndex) {
+		auto const& chunk = chunks[aIndex];
+		auto const& mesh = aMeshes[chunk.mesh];
+		auto& out = ret[chunk.mesh];
+
+		std::vector<std::uint32_t> stack;
+		stack.reserve( 64 );
+
+		std::uint64_t rays = 0, hits = 0;
+		for( std::uint32_t i = chunk.firstVertex; i < chunk.firstVertex+chunk.vertexCount; ++i )
+		{
+			auto const length = glm::length( mesh.norm[i] );
+			if( !(length > 0.f) )
+				continue;
+
+			auto const n = mesh.norm[i] / length;
+
+			// Orthonormal basis around n (Duff et al., "Building an
+			// Orthonormal Basis, Revisited", JCGT 2017)
+			float const sign = std::copysign( 1.f, n.z );
+			float const a = -1.f / (sign + n.z);
+			float const b = n.x * n.y * a;
+			glm::vec3 const t( 1.f + sign * n.x * n.x * a, sign * b, -sign * n.x );
+			glm::vec3 const s( b, sign + n.y * n.y * a, -n.y );
+
+			float const angle = hash_u32_( chunk.mesh * 0x9e3779b9u ^ i ) * (2.f * 3.14159265f / 4294967296.f);
+			float const cr = std::cos( angle ), sr = std::sin( angle );
+
+			Ray_ ray;
+			ray.origin = mesh.vert[i] + n * bias;
+			ray.maxT = aMaxDistance;
+
+			std::size_t blocked = 0;
+			for( auto const& p : pattern )
+			{
+				float const x = p.x * cr - p.y * sr;
+				float const y = p.x * sr + p.y * cr;
+				ray.direction = x * t + y * s + p.z * n;
+
+				// Avoid infinities for axis-aligned directions (0 * inf = NaN in
+				// the slab test)
+				for( int k = 0; k < 3; ++k )
+				{
+					auto const d = std::abs( ray.direction[k] ) > 1e-20f ? ray.direction[k] : 1e-20f;
+					ray.invDirection[k] = 1.f / d;
+				}
+
+				if( occluded_( scene, ray, stack ) )
+					++blocked;
+			}
+
+			rays += pattern.size();
+			hits += blocked;
+
+			auto const open = float(pattern.size() - blocked) / pattern.size();
+			out[i] = std::uint8_t(std::lround( open * 255.f ));
+		}
+
+		totalRays += rays;
+		totalHits += hits;
+	}, aThreadCount );
+
+	if( aStats )
+	{
+		aStats->rays = totalRays;
+		aStats->hits = totalHits;
+		aStats->seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+		aStats->threads = resolve_thread_count( aThreadCount );
+	}
+
+	return ret;
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	Scene_ make_scene_( std::vector<IndexedMesh> const& aMeshes, BvhData const& aBvh, std::vector<BvhTriangle> const& aTriangles )
+	{
+		Scene_ ret;
+		ret.nodes.resize( aBvh.nodes.size() );
+
+		for( std::size_t i = 0; i < aBvh.nodes.size(); ++i )
+		{
+			auto const& node = aBvh.nodes[i];
+			auto& out = ret.nodes[i];
+
+			out.aabbMin = node.aabbMin;
+			out.aabbMax = node.aabbMax;
+
+			if( 0 == node.count )
+			{
+				out.offset = node.offset;
+				out.count = 0;
+				continue;
+			}
+
+			if( std::size_t(node.offset) + node.count > aTriangles.size() )
+				throw lut::Error( "bake_ambient_occlusion(): BVH node %zu references triangles out of range", i );
+
+			// Leaves are copied in tree order, so packs of neighbouring leaves
+			// are adjacent in memory, too.
+			out.offset = std::uint32_t(ret.packs.size());
+			out.count = std::uint32_t((node.count + kLanes_-1) / kLanes_);
+
+			for( std::uint32_t j = 0; j < node.count; ++j )
+			{
+				if( 0 == j % kLanes_ )
+					ret.packs.emplace_back( TrianglePack_{} );
+
+				auto& pack = ret.packs.back();
+				auto const lane = j % kLanes_;
+
+				auto const& ref = aTriangles[node.offset + j];
+				auto const& mesh = aMeshes[ref.mesh];
+
+				auto const& v0 = mesh.vert[mesh.indices[ref.triangle*3+0]];
+				auto const& v1 = mesh.vert[mesh.indices[ref.triangle*3+1]];
+				auto const& v2 = mesh.vert[mesh.indices[ref.triangle*3+2]];
+
+				for( int k = 0; k < 3; ++k )
+				{
+					pack.v0[k][lane] = v0[k];
+					pack.e1[k][lane] = v1[k] - v0[k];
+					pack.e2[k][lane] = v2[k] - v0[k];
+				}
+			}
+		}
+
+		return ret;
+	}
+
+	bool hits_box_( Ray_ const& aRay, glm::vec3 const& aMin, glm::vec3 const& aMax )
+	{
+		auto const t0 = (aMin - aRay.origin) * aRay.invDirection;
+		auto const t1 = (aMax - aRay.origin) * aRay.invDirection;
+
+		auto const tmin = glm::min( t0, t1 );
+		auto const tmax = glm::max( t0, t1 );
+
+		float const enter = std::max( std::max( tmin.x, tmin.y ), std::max( tmin.z, 0.f ) );
+		float const leave = std::min( std::min( tmax.x, tmax.y ), std::min( tmax.z, aRay.maxT ) );
+		return enter <= leave;
+	}
+
+	bool hits_pack_( Ray_ const& aRay, TrianglePack_ const& aPack )
+	{
+		auto const& d = aRay.direction;
+		auto const& o = aRay.origin;
+
+		int hit = 0;
+		for( std::size_t k = 0; k < kLanes_; ++k )
+		{
+			float const e1x = aPack.e1[0][k], e1y = aPack.e1[1][k], e1z = aPack.e1[2][k];
+			float const e2x = aPack.e2[0][k], e2y = aPack.e2[1][k], e2z = aPack.e2[2][k];
+
+			// p = d x e2
+			float const px = d.y*e2z - d.z*e2y;
+			float const py = d.z*e2x - d.x*e2z;
+			float const pz = d.x*e2y - d.y*e2x;
+
+			float const det = e1x*px + e1y*py + e1z*pz;
+			float const inv = 1.f / (det != 0.f ? det : 1.f);
+
+			float const sx = o.x - aPack.v0[0][k];
+			float const sy = o.y - aPack.v0[1][k];
+			float const sz = o.z - aPack.v0[2][k];
+
+			float const u = (sx*px + sy*py + sz*pz) * inv;
+
+			// q = s x e1
+			float const qx = sy*e1z - sz*e1y;
+			float const qy = sz*e1x - sx*e1z;
+			float const qz = sx*e1y - sy*e1x;
+
+			float const v = (d.x*qx + d.y*qy + d.z*qz) * inv;
+			float const t = (e2x*qx + e2y*qy + e2z*qz) * inv;
+
+			hit |= int(det != 0.f) & int(u >= 0.f) & int(v >= 0.f) & int(u + v <= 1.f) & int(t > 0.f) & int(t < aRay.maxT);
+		}
+
+		return 0 != hit;
+	}
+
+	bool occluded_( Scene_ const& aScene, Ray_ const& aRay, std::vector<std::uint32_t>& aStack )
+	{
+		auto const& nodes = aScene.nodes;
+		if( !hits_box_( aRay, nodes[0].aabbMin, nodes[0].aabbMax ) )
+			return false;
+
+		aStack.clear();
+
+		std::uint32_t index = 0;
+		while( true )
+		{
+			auto const& node = nodes[index];
+			if( node.count )
+			{
+				// Any hit will do; there is no need to find the closest one
+				for( std::uint32_t i = 0; i < node.count; ++i )
+				{
+					if( hits_pack_( aRay, aScene.packs[node.offset + i] ) )
+						return true;
+				}
+			}
+			else
+			{
+				auto const left = index + 1, right = node.offset;
+				bool const hitLeft = hits_box_( aRay, nodes[left].aabbMin, nodes[left].aabbMax );
+				bool const hitRight = hits_box_( aRay, nodes[right].aabbMin, nodes[right].aabbMax );
+
+				if( hitLeft && hitRight )
+				{
+					aStack.push_back( right );
+					index = left;
+					continue;
+				}
+				if( hitLeft || hitRight )
+				{
+					index = hitLeft ? left : right;
+					continue;
+				}
+			}
+
+			if( aStack.empty() )
+				return false;
+
+			index = aStack.back();
+			aStack.pop_back();
+		}
+	}
+
+	std::uint32_t hash_u32_( std::uint32_t aValue )
+	{
+		// lowbias32 (https://nullprogram.com/blog/2018/07/31/)
+		aValue ^= aValue >> 16;
+		aValue *= 0x7feb352du;
+		aValue ^= aValue >> 15;
+		aValue *= 0x846ca68bu;
+		aValue ^= aValue >> 16;
+		return aValue;
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
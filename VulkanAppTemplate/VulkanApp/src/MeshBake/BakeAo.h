@@ -0,0 +1,53 @@
+#ifndef BAKE_AO_HPP_3F81C6D2_95A4_4E0B_B7D3_C2684E1A0F59
+#define BAKE_AO_HPP_3F81C6D2_95A4_4E0B_B7D3_C2684E1A0F59
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "BuildBvh.h"
+#include "IndexMesh.h"
+
+//--    constants                               ///{{{1///////////////////////
+
+constexpr std::size_t kAoDefaultRays = 64;
+
+//--    types                                   ///{{{1///////////////////////
+struct AoStats
+{
+	std::uint64_t rays = 0;
+	std::uint64_t hits = 0;
+	double seconds = 0.0; // wall clock time of the bake
+
+	std::size_t threads = 0;
+};
+
+//--    functions                               ///{{{1///////////////////////
+
+/* Bake per-vertex ambient occlusion for all meshes of a model.
+ *
+ * Each vertex casts `aRayCount` cosine-weighted rays over the hemisphere
+ * around its normal against all triangles of the model (via the triangle BVH
+ * from build_triangle_bvh()). A ray that hits anything within `aMaxDistance`
+ * is occluded. The result is the unoccluded fraction of the rays, quantized
+ * to 8 bits (255 = fully open), one value per vertex of each mesh.
+ *
+ * Rays are cast with any-hit traversal (the first hit ends the ray), on
+ * `aThreadCount` threads (see run_tasks()). Directions are derived from the
+ * vertex index only, so the result does not depend on the thread count.
+ */
+std::vector<std::vector<std::uint8_t>> bake_ambient_occlusion(
+	std::vector<IndexedMesh> const&,
+	BvhData const& aTriangleBvh,
+	std::vector<BvhTriangle> const& aTriangles,
+	float aMaxDistance,
+	std::size_t aRayCount = kAoDefaultRays,
+	std::size_t aThreadCount = 0,
+	AoStats* aStats = nullptr
+);
+
+#endif // BAKE_AO_HPP_3F81C6D2_95A4_4E0B_B7D3_C2684E1A0F59
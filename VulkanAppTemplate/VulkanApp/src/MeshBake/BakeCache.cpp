@@ -0,0 +1,480 @@
+#include "BakeCache.h"
+
+#include <algorithm>
+#include <type_traits>
+
+#include <cstdio>
+#include <cstring>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr char kCacheMagic_[16] = "\0\0COMP5822Mbake";
+
+	// xxHash64 primes
+	constexpr std::uint64_t kPrime1_ = 11400714785074694791ull;
+	constexpr std::uint64_t kPrime2_ = 14029467366897019727ull;
+	constexpr std::uint64_t kPrime3_ = 1609587929392839161ull;
+	constexpr std::uint64_t kPrime4_ = 9650029242287828579ull;
+	constexpr std::uint64_t kPrime5_ = 2870177450012600261ull;
+
+	struct CacheHeader_
+	{
+		char magic[16];
+		std::uint32_t version;
+		std::uint32_t reserved;
+		std::uint64_t manifestBytes;
+	};
+
+	static_assert( sizeof(CacheHeader_) == 32 );
+
+	// Appends to a byte buffer
+	class BlobWriter_
+	{
+		public:
+			template< typename tType >
+			void put( tType const& aValue )
+			{
+				static_assert( std::is_trivially_copyable_v<tType> );
+				put_bytes( &aValue, sizeof(tType) );
+			}
+
+			template< typename tType >
+			void put_array( std::vector<tType> const& aArray )
+			{
+				static_assert( std::is_trivially_copyable_v<tType> );
+				put( std::uint64_t(aArray.size()) );
+				put_bytes( aArray.data(), aArray.size()*sizeof(tType) );
+			}
+
+			void put_string( std::string const& aString )
+			{
+				put( std::uint64_t(aString.size()) );
+				put_bytes( aString.data(), aString.size() );
+			}
+
+			void put_bytes( void const* aData, std::size_t aBytes )
+			{
+				auto const* bytes = static_cast<std::byte const*>(aData);
+				mData.insert( mData.end(), bytes, bytes + aBytes );
+			}
+
+			std::vector<std::byte>& data() noexcept { return mData; }
+
+		private:
+			std::vector<std::byte> mData;
+	};
+
+	// Bounds-checked reads from a byte buffer; throws on overrun
+	class BlobReader_
+	{
+		public:
+			BlobReader_( std::byte const* aBeg, std::byte const* aEnd )
+				: mCur( aBeg ), mEnd( aEnd )
+			{}
+
+			template< typename tType >
+			tType get()
+			{
+				static_assert( std::is_trivially_copyable_v<tType> );
+				tType ret;
+				get_bytes( &ret, sizeof(tType) );
+				return ret;
+			}
+
+			template< typename tType >
+			void get_array( std::vector<tType>& aArray )
+			{
+				auto const count = get<std::uint64_t>();
+				if( count > std::size_t(mEnd - mCur) / sizeof(tType) )
+					throw lut::Error( "BlobReader_: array of %llu elements exceeds the data", (unsigned long long)count );
+
+				aArray.resize( std::size_t(count) );
+				get_bytes( aArray.data(), aArray.size()*sizeof(tType) );
+			}
+
+			std::string get_string()
+			{
+				std::vector<char> chars;
+				get_array( chars );
+				return std::string( chars.begin(), chars.end() );
+			}
+
+			void get_bytes( void* aBuffer, std::size_t aBytes )
+			{
+				if( std::size_t(mEnd - mCur) < aBytes )
+					throw lut::Error( "BlobReader_: expected %zu bytes, got %zu", aBytes, std::size_t(mEnd - mCur) );
+
+				if( aBytes )
+					std::memcpy( aBuffer, mCur, aBytes );
+				mCur += aBytes;
+			}
+
+			bool done() const noexcept { return mCur == mEnd; }
+
+		private:
+			std::byte const* mCur;
+			std::byte const* mEnd;
+	};
+
+	inline std::uint64_t rotl_( std::uint64_t aX, unsigned aBits )
+	{
+		return (aX << aBits) | (aX >> (64-aBits));
+	}
+
+	inline std::uint64_t round_( std::uint64_t aAcc, std::uint64_t aInput )
+	{
+		return rotl_( aAcc + aInput * kPrime2_, 31 ) * kPrime1_;
+	}
+
+	template< typename tType >
+	inline tType load_( std::byte const* aPtr )
+	{
+		tType ret;
+		std::memcpy( &ret, aPtr, sizeof(tType) );
+		return ret;
+	}
+
+	bool read_file_( std::filesystem::path const&, std::vector<std::byte>& );
+
+	void put_stamp_( BlobWriter_&, FileStamp const& );
+	FileStamp get_stamp_( BlobReader_& );
+}
+
+//--    hash_bytes()                    ///{{{2///////////////////////////////
+std::uint64_t hash_bytes( void const* aData, std::size_t aBytes, std::uint64_t aSeed )
+{
+	auto const* ptr = static_cast<std::byte const*>(aData);
+	auto const* const end = ptr + aBytes;
+
+	std::uint64_t hash;
+	if( aBytes >= 32 )
+	{
+		std::uint64_t v1 = aSeed + kPrime1_ + kPrime2_;
+		std::uint64_t v2 = aSeed + kPrime2_;
+		std::uint64_t v3 = aSeed;
+		std::uint64_t v4 = aSeed - kPrime1_;
+
+		for( auto const* limit = end - 32; ptr <= limit; ptr += 32 )
+		{
+			v1 = round_( v1, load_<std::uint64_t>( ptr+0 ) );
+			v2 = round_( v2, load_<std::uint64_t>( ptr+8 ) );
+			v3 = round_( v3, load_<std::uint64_t>( ptr+16 ) );
+			v4 = round_( v4, load_<std::uint64_t>( ptr+24 ) );
+		}
+
+		hash = rotl_( v1, 1 ) + rotl_( v2, 7 ) + rotl_( v3, 12 ) + rotl_( v4, 18 );
+		for( auto const v : { v1, v2, v3, v4 } )
+			hash = (hash ^ round_( 0, v )) * kPrime1_ + kPrime4_;
+	}
+	else
+	{
+		hash = aSeed + kPrime5_;
+	}
+
+	hash += aBytes;
+
+	for( ; end - ptr >= 8; ptr += 8 )
+		hash = rotl_( hash ^ round_( 0, load_<std::uint64_t>( ptr ) ), 27 ) * kPrime1_ + kPrime4_;
+	if( end - ptr >= 4 )
+	{
+		hash = rotl_( hash ^ (load_<std::uint32_t>( ptr ) * kPrime1_), 23 ) * kPrime2_ + kPrime3_;
+		ptr += 4;
+	}
+	for( ; ptr != end; ++ptr )
+		hash = rotl_( hash ^ (std::uint8_t(*ptr) * kPrime5_), 11 ) * kPrime1_;
+
+	hash ^= hash >> 33;
+	hash *= kPrime2_;
+	hash ^= hash >> 29;
+	hash *= kPrime3_;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+//--    stamp_file()                    ///{{{2///////////////////////////////
+bool stamp_file( std::filesystem::path const& aPath, FileStamp& aStamp, FileStamp const* aKnown )
+{
+	std::error_code ec;
+	auto const size = std::filesystem::file_size( aPath, ec );
+	if( ec )
+		return false;
+
+	auto const mtime = std::filesystem::last_write_time( aPath, ec );
+	if( ec )
+		return false;
+
+	FileStamp stamp;
+	stamp.size = size;
+	stamp.mtime = std::int64_t(mtime.time_since_epoch().count());
+
+	if( aKnown && aKnown->size == stamp.size && aKnown->mtime == stamp.mtime )
+	{
+		stamp.hash = aKnown->hash;
+	}
+	else
+	{
+		std::vector<std::byte> contents;
+		if( !read_file_( aPath, contents ) )
+			return false;
+
+		stamp.hash = hash_bytes( contents.data(), contents.size() );
+	}
+
+	aStamp = stamp;
+	return true;
+}
+
+//--    file_matches()                  ///{{{2///////////////////////////////
+bool file_matches( std::filesystem::path const& aPath, FileStamp const& aStamp )
+{
+	FileStamp current;
+	if( !stamp_file( aPath, current, &aStamp ) )
+		return false;
+
+	return current.size == aStamp.size && current.hash == aStamp.hash;
+}
+
+//--    load_bake_cache()               ///{{{2///////////////////////////////
+BakeCache load_bake_cache( std::filesystem::path const& aPath, bool aWithMeshes )
+{
+	FILE* fin = std::fopen( aPath.string().c_str(), "rb" );
+	if( !fin )
+		return {};
+
+	BakeCache ret;
+
+	try
+	{
+		CacheHeader_ header{};
+		if( 1 != std::fread( &header, sizeof(CacheHeader_), 1, fin ) || 0 != std::memcmp( header.magic, kCacheMagic_, 16 ) || kBakeCacheVersion != header.version )
+		{
+			std::fclose( fin );
+			return {};
+		}
+
+		std::vector<std::byte> manifest( std::size_t(std::min<std::uint64_t>( header.manifestBytes, std::filesystem::file_size( aPath ) )) );
+		if( manifest.size() != header.manifestBytes || manifest.size() != std::fread( manifest.data(), 1, manifest.size(), fin ) )
+			throw lut::Error( "truncated manifest" );
+
+		BlobReader_ min( manifest.data(), manifest.data() + manifest.size() );
+		ret.optionsHash = min.get<std::uint64_t>();
+
+		ret.inputs.resize( std::size_t(min.get<std::uint32_t>()) );
+		for( auto& input : ret.inputs )
+		{
+			input.path = min.get_string();
+			input.stamp = get_stamp_( min );
+		}
+
+		ret.output = get_stamp_( min );
+
+		ret.textures.resize( std::size_t(min.get<std::uint32_t>()) );
+		for( auto& texture : ret.textures )
+		{
+			texture.source = min.get_string();
+			texture.dest = min.get_string();
+			texture.sourceStamp = get_stamp_( min );
+			texture.destStamp = get_stamp_( min );
+			texture.channels = min.get<std::uint32_t>();
+		}
+
+		if( !min.done() )
+			throw lut::Error( "trailing manifest bytes" );
+
+		// Meshes follow the manifest, up to the end of the file
+		if( aWithMeshes )
+		{
+			std::vector<std::byte> rest;
+			std::byte buffer[64*1024];
+			for( std::size_t got; 0 != (got = std::fread( buffer, 1, sizeof(buffer), fin )); )
+				rest.insert( rest.end(), buffer, buffer + got );
+
+			BlobReader_ rin( rest.data(), rest.data() + rest.size() );
+			auto const count = rin.get<std::uint64_t>();
+			for( std::uint64_t i = 0; i < count; ++i )
+			{
+				auto const key = rin.get<std::uint64_t>();
+				rin.get_array( ret.meshes[key] );
+			}
+		}
+	}
+	catch( std::exception const& eErr )
+	{
+		std::fprintf( stderr, "Note: ignoring bake cache '%s': %s\n", aPath.string().c_str(), eErr.what() );
+		ret = {};
+	}
+
+	std::fclose( fin );
+	return ret;
+}
+
+//--    save_bake_cache()               ///{{{2///////////////////////////////
+void save_bake_cache( std::filesystem::path const& aPath, BakeCache const& aCache )
+{
+	BlobWriter_ manifest;
+	manifest.put( aCache.optionsHash );
+
+	manifest.put( std::uint32_t(aCache.inputs.size()) );
+	for( auto const& input : aCache.inputs )
+	{
+		manifest.put_string( input.path );
+		put_stamp_( manifest, input.stamp );
+	}
+
+	put_stamp_( manifest, aCache.output );
+
+	manifest.put( std::uint32_t(aCache.textures.size()) );
+	for( auto const& texture : aCache.textures )
+	{
+		manifest.put_string( texture.source );
+		manifest.put_string( texture.dest );
+		put_stamp_( manifest, texture.sourceStamp );
+		put_stamp_( manifest, texture.destStamp );
+		manifest.put( texture.channels );
+	}
+
+	CacheHeader_ header{};
+	std::memcpy( header.magic, kCacheMagic_, 16 );
+	header.version = kBakeCacheVersion;
+	header.manifestBytes = manifest.data().size();
+
+	BlobWriter_ out;
+	out.put( header );
+	out.put_bytes( manifest.data().data(), manifest.data().size() );
+
+	out.put( std::uint64_t(aCache.meshes.size()) );
+	for( auto const& entry : aCache.meshes )
+	{
+		out.put( entry.first );
+		out.put_array( entry.second );
+	}
+
+	auto const path = aPath.string();
+	FILE* fof = std::fopen( path.c_str(), "wb" );
+	if( !fof )
+		throw lut::Error( "Unable to open '%s' for writing", path.c_str() );
+
+	auto const& bytes = out.data();
+	auto const written = std::fwrite( bytes.data(), 1, bytes.size(), fof );
+	std::fclose( fof );
+
+	if( written != bytes.size() )
+		throw lut::Error( "fwrite() failed: %zu instead of %zu", written, bytes.size() );
+}
+
+//--    serialize_mesh()                ///{{{2///////////////////////////////
+std::vector<std::byte> serialize_mesh( CachedMesh const& aMesh )
+{
+	BlobWriter_ out;
+	out.put_array( aMesh.mesh.vert );
+	out.put_array( aMesh.mesh.norm );
+	out.put_array( aMesh.mesh.text );
+	out.put_array( aMesh.mesh.tangent );
+	out.put_array( aMesh.mesh.indices );
+	out.put( aMesh.mesh.aabbMin );
+	out.put( aMesh.mesh.aabbMax );
+
+	out.put_array( aMesh.meshlets.meshlets );
+	out.put_array( aMesh.meshlets.vertices );
+	out.put_array( aMesh.meshlets.indices );
+
+	out.put( std::uint64_t(aMesh.lods.size()) );
+	for( auto const& lod : aMesh.lods )
+	{
+		out.put_array( lod.indices );
+		out.put( lod.error );
+	}
+
+	out.put( aMesh.cacheBefore );
+	out.put( aMesh.cacheAfter );
+
+	return std::move(out.data());
+}
+
+//--    deserialize_mesh()              ///{{{2///////////////////////////////
+bool deserialize_mesh( std::vector<std::byte> const& aData, CachedMesh& aMesh )
+{
+	try
+	{
+		BlobReader_ in( aData.data(), aData.data() + aData.size() );
+
+		CachedMesh ret;
+		in.get_array( ret.mesh.vert );
+		in.get_array( ret.mesh.norm );
+		in.get_array( ret.mesh.text );
+		in.get_array( ret.mesh.tangent );
+		in.get_array( ret.mesh.indices );
+		ret.mesh.aabbMin = in.get<glm::vec3>();
+		ret.mesh.aabbMax = in.get<glm::vec3>();
+
+		in.get_array( ret.meshlets.meshlets );
+		in.get_array( ret.meshlets.vertices );
+		in.get_array( ret.meshlets.indices );
+
+		auto const lods = in.get<std::uint64_t>();
+		if( lods > aData.size() )
+			return false;
+
+		ret.lods.resize( std::size_t(lods) );
+		for( auto& lod : ret.lods )
+		{
+			in.get_array( lod.indices );
+			lod.error = in.get<float>();
+		}
+
+		ret.cacheBefore = in.get<VertexCacheStats>();
+		ret.cacheAfter = in.get<VertexCacheStats>();
+
+		if( !in.done() )
+			return false;
+
+		aMesh = std::move(ret);
+		return true;
+	}
+	catch( lut::Error const& )
+	{
+		return false;
+	}
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	bool read_file_( std::filesystem::path const& aPath, std::vector<std::byte>& aContents )
+	{
+		FILE* fin = std::fopen( aPath.string().c_str(), "rb" );
+		if( !fin )
+			return false;
+
+		std::error_code ec;
+		auto const size = std::filesystem::file_size( aPath, ec );
+
+		aContents.resize( ec ? 0 : std::size_t(size) );
+		auto const got = std::fread( aContents.data(), 1, aContents.size(), fin );
+		std::fclose( fin );
+
+		return !ec && got == aContents.size();
+	}
+
+	void put_stamp_( BlobWriter_& aOut, FileStamp const& aStamp )
+	{
+		aOut.put( aStamp.size );
+		aOut.put( aStamp.mtime );
+		aOut.put( aStamp.hash );
+	}
+
+	FileStamp get_stamp_( BlobReader_& aIn )
+	{
+		FileStamp ret;
+		ret.size = aIn.get<std::uint64_t>();
+		ret.mtime = aIn.get<std::int64_t>();
+		ret.hash = aIn.get<std::uint64_t>();
+		return ret;
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,118 @@
+#ifndef BAKE_CACHE_HPP_3F8A1D62_C54E_4B07_9D1A_E26B7C08F4D5
+#define BAKE_CACHE_HPP_3F8A1D62_C54E_4B07_9D1A_E26B7C08F4D5
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "IndexMesh.h"
+#include "OptimizeMesh.h"
+#include "SimplifyMesh.h"
+#include "BuildMeshlets.h"
+
+//--    constants                               ///{{{1///////////////////////
+
+/* Version of the cached data. Bump this whenever MeshBake produces different
+ * output for the same inputs and options (e.g., after changing one of the
+ * mesh processing stages); this invalidates all existing caches.
+ */
+constexpr std::uint32_t kBakeCacheVersion = 3;
+
+//--    types                                   ///{{{1///////////////////////
+
+// Identifies the contents of a file. Size and modification time are only
+// used to avoid re-hashing files that were not touched.
+struct FileStamp
+{
+	std::uint64_t size = 0;
+	std::int64_t mtime = 0; // std::filesystem::file_time_type ticks
+	std::uint64_t hash = 0; // hash_bytes() of the contents
+};
+
+// Result of the per-mesh stages that can be reused between bakes
+struct CachedMesh
+{
+	IndexedMesh mesh;
+	MeshletData meshlets;
+	std::vector<MeshLod> lods;
+
+	VertexCacheStats cacheBefore{}, cacheAfter{};
+};
+
+/* State of the previous bake of one model, see load_bake_cache().
+ *
+ * The baked file is up to date if the options, the inputs (the OBJ and its
+ * MTL) and the baked file itself are unchanged. Each texture is up to date
+ * if its source and the baked (or copied) texture are unchanged. Meshes are
+ * keyed by a hash of their input vertices and the options that affect
+ * processing, so that unchanged meshes are reused if only a part of the
+ * model changes.
+ */
+struct BakeCache
+{
+	struct Input
+	{
+		std::string path;
+		FileStamp stamp;
+	};
+
+	struct Texture
+	{
+		std::string source, dest;
+		FileStamp sourceStamp, destStamp;
+
+		// Channels of the baked texture (see bake_texture()); 0 if the
+		// source is copied as it is
+		std::uint32_t channels = 0;
+	};
+
+	std::uint64_t optionsHash = 0;
+
+	std::vector<Input> inputs;
+	FileStamp output;
+
+	std::vector<Texture> textures;
+
+	// Serialized CachedMesh (see serialize_mesh()), by key
+	std::unordered_map<std::uint64_t,std::vector<std::byte>> meshes;
+};
+
+//--    functions                               ///{{{1///////////////////////
+
+// 64-bit hash (xxHash64) of aBytes bytes. Pass a previous result as `aSeed`
+// to hash several arrays in sequence.
+std::uint64_t hash_bytes( void const* aData, std::size_t aBytes, std::uint64_t aSeed = 0 );
+
+/* Stamp the file at aPath. If `aKnown` is given and the file's size and
+ * modification time match it, the file is assumed to be unchanged and its
+ * hash is reused; otherwise the file is read and hashed. Returns false if the
+ * file does not exist (or cannot be read).
+ */
+bool stamp_file( std::filesystem::path const& aPath, FileStamp& aStamp, FileStamp const* aKnown = nullptr );
+
+// Whether the file at aPath (still) has the contents described by aStamp.
+// Cheap if the file was not touched, see stamp_file().
+bool file_matches( std::filesystem::path const& aPath, FileStamp const& aStamp );
+
+/* Load the cache of a previous bake from aPath. Returns an empty cache if
+ * there is none or if it is unusable (e.g., from a different version). The
+ * meshes are only loaded if `aWithMeshes` is set; they are not needed to
+ * decide whether anything must be rebaked.
+ */
+BakeCache load_bake_cache( std::filesystem::path const& aPath, bool aWithMeshes );
+
+void save_bake_cache( std::filesystem::path const& aPath, BakeCache const& );
+
+std::vector<std::byte> serialize_mesh( CachedMesh const& );
+
+// Returns false if aData is malformed
+bool deserialize_mesh( std::vector<std::byte> const& aData, CachedMesh& );
+
+#endif // BAKE_CACHE_HPP_3F8A1D62_C54E_4B07_9D1A_E26B7C08F4D5
@@ -0,0 +1,310 @@
+#include "BakeTexture.h"
+
+#include <vector>
+#include <algorithm>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	// See BakedTexture.h
+	constexpr char kTextureMagic_[16] = "\0\0COMP5822Mtex";
+	constexpr char kTextureVariant_[16] = "mips-cw3";
+
+	constexpr std::uint64_t kAlignment_ = 16;
+
+	enum class Format_ : std::uint32_t
+	{
+		r8Unorm = 1,
+		rgba8Srgb = 2
+	};
+
+	struct TextureHeader_
+	{
+		char magic[16];
+		char variant[16];
+		std::uint32_t format;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t levelCount;
+	};
+
+	struct LevelEntry_
+	{
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+	static_assert( sizeof(TextureHeader_) == 48 );
+	static_assert( sizeof(LevelEntry_) == 16 );
+
+	/* sRGB <-> linear conversion of 8-bit values. Encoding picks the code
+	 * whose linear value is nearest, by searching the midpoints between
+	 * consecutive codes. This is exact (decoding and encoding again returns
+	 * the original code) and much cheaper than a pow() per texel.
+	 */
+	struct SrgbTables_
+	{
+		float toLinear[256];
+		float midpoints[255];
+	};
+
+	SrgbTables_ const& srgb_tables_();
+
+	inline std::uint8_t encode_srgb_( float aLinear, SrgbTables_ const& aTables )
+	{
+		auto const* mid = aTables.midpoints;
+		return std::uint8_t(std::upper_bound( mid, mid+255, aLinear ) - mid);
+	}
+
+	inline std::uint8_t encode_unorm_( float aValue )
+	{
+		return std::uint8_t(std::lround( std::clamp( aValue, 0.f, 1.f ) * 255.f ));
+	}
+
+	// Source texels and weights of one output texel along one axis
+	struct DownsampleTaps_
+	{
+		std::uint32_t index[3];
+		float weight[3];
+	};
+
+	// Taps for halving an axis of `aSize` texels. Even sizes use a 2-tap box
+	// filter; odd sizes a 3-tap polyphase filter, such that every source
+	// texel (including the last one) contributes with equal total weight.
+	std::vector<DownsampleTaps_> downsample_taps_( std::uint32_t aSize );
+
+	// Halve a level (with at least one dimension > 1), see downsample_taps_()
+	std::vector<float> downsample_( std::vector<float> const&, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels );
+
+	void checked_write_( FILE*, std::size_t aBytes, void const* aData );
+}
+
+//--    bake_texture()                  ///{{{2///////////////////////////////
+BakedTextureStats bake_texture( std::string const& aSource, std::filesystem::path const& aDest, std::uint8_t aChannels )
+{
+	if( 1 != aChannels && 4 != aChannels )
+		throw lut::Error( "bake_texture(): %s: unsupported channel count %u", aSource.c_str(), unsigned(aChannels) );
+
+	// Load. The runtime flips textures on load; bake them flipped. Always load
+	// RGBA: shaders read one channel textures from the red channel, so that
+	// is what one channel textures keep (rather than stb's luminance).
+	stbi_set_flip_vertically_on_load_thread( 1 );
+
+	int width = 0, height = 0, sourceChannels = 0;
+	stbi_uc* pixels = stbi_load( aSource.c_str(), &width, &height, &sourceChannels, 4 );
+	if( !pixels )
+		throw lut::Error( "bake_texture(): unable to load '%s': %s", aSource.c_str(), stbi_failure_reason() );
+
+	std::size_t const texels = std::size_t(width) * std::size_t(height);
+
+	std::vector<std::uint8_t> base( texels * aChannels );
+	if( 4 == aChannels )
+		std::memcpy( base.data(), pixels, base.size() );
+	else
+	{
+		for( std::size_t i = 0; i < texels; ++i )
+			base[i] = pixels[i*4];
+	}
+
+	stbi_image_free( pixels );
+
+	// Build levels. Filtering works on linear floats and each level is
+	// derived from the unquantized previous one, so rounding errors do not
+	// accumulate down the chain.
+	auto const& srgb = srgb_tables_();
+	bool const isSrgb = 4 == aChannels;
+
+	std::vector<float> level( base.size() );
+	for( std::size_t i = 0; i < base.size(); ++i )
+	{
+		bool const color = isSrgb && 3 != i % 4;
+		level[i] = color ? srgb.toLinear[base[i]] : base[i] / 255.f;
+	}
+
+	std::vector<std::vector<std::uint8_t>> levels;
+	levels.emplace_back( std::move(base) );
+
+	auto levelWidth = std::uint32_t(width), levelHeight = std::uint32_t(height);
+	while( levelWidth > 1 || levelHeight > 1 )
+	{
+		level = downsample_( level, levelWidth, levelHeight, aChannels );
+		levelWidth = std::max( levelWidth / 2, 1u );
+		levelHeight = std::max( levelHeight / 2, 1u );
+
+		std::vector<std::uint8_t> encoded( level.size() );
+		for( std::size_t i = 0; i < level.size(); ++i )
+		{
+			bool const color = isSrgb && 3 != i % 4;
+			encoded[i] = color ? encode_srgb_( level[i], srgb ) : encode_unorm_( level[i] );
+		}
+
+		levels.emplace_back( std::move(encoded) );
+	}
+
+	// Lay out and write
+	TextureHeader_ header{};
+	std::memcpy( header.magic, kTextureMagic_, 16 );
+	std::memcpy( header.variant, kTextureVariant_, 16 );
+	header.format = std::uint32_t(isSrgb ? Format_::rgba8Srgb : Format_::r8Unorm);
+	header.width = std::uint32_t(width);
+	header.height = std::uint32_t(height);
+	header.levelCount = std::uint32_t(levels.size());
+
+	auto const align_up_ = [] (std::uint64_t aOffset) {
+		return (aOffset + kAlignment_-1) & ~(kAlignment_-1);
+	};
+
+	std::vector<LevelEntry_> entries( levels.size() );
+
+	std::uint64_t offset = sizeof(TextureHeader_) + entries.size()*sizeof(LevelEntry_);
+	for( std::size_t i = 0; i < levels.size(); ++i )
+	{
+		entries[i].offset = align_up_( offset );
+		entries[i].size = levels[i].size();
+		offset = entries[i].offset + entries[i].size;
+	}
+
+	FILE* fof = std::fopen( aDest.string().c_str(), "wb" );
+	if( !fof )
+		throw lut::Error( "bake_texture(): unable to open '%s' for writing", aDest.string().c_str() );
+
+	try
+	{
+		checked_write_( fof, sizeof(TextureHeader_), &header );
+		checked_write_( fof, entries.size()*sizeof(LevelEntry_), entries.data() );
+
+		static constexpr std::uint8_t zeros[kAlignment_] = {};
+		offset = sizeof(TextureHeader_) + entries.size()*sizeof(LevelEntry_);
+		for( std::size_t i = 0; i < levels.size(); ++i )
+		{
+			checked_write_( fof, std::size_t(entries[i].offset - offset), zeros );
+			checked_write_( fof, levels[i].size(), levels[i].data() );
+			offset = entries[i].offset + entries[i].size;
+		}
+	}
+	catch( ... )
+	{
+		std::fclose( fof );
+		throw;
+	}
+
+	std::fclose( fof );
+
+	BakedTextureStats ret;
+	ret.width = header.width;
+	ret.height = header.height;
+	ret.levels = header.levelCount;
+	ret.sourceBytes = levels.front().size();
+	ret.bakedBytes = std::size_t(offset - entries.front().offset);
+	return ret;
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	SrgbTables_ const& srgb_tables_()
+	{
+		static SrgbTables_ const tables = [] {
+			SrgbTables_ ret;
+			for( int i = 0; i < 256; ++i )
+			{
+				double const c = i / 255.0;
+				ret.toLinear[i] = float(c <= 0.04045 ? c / 12.92 : std::pow( (c + 0.055) / 1.055, 2.4 ));
+			}
+
+			for( int i = 0; i < 255; ++i )
+				ret.midpoints[i] = 0.5f * (ret.toLinear[i] + ret.toLinear[i+1]);
+
+			return ret;
+		}();
+
+		return tables;
+	}
+
+	std::vector<DownsampleTaps_> downsample_taps_( std::uint32_t aSize )
+	{
+		auto const size = std::max( aSize / 2, 1u );
+
+		std::vector<DownsampleTaps_> ret( size );
+		for( std::uint32_t i = 0; i < size; ++i )
+		{
+			auto& taps = ret[i];
+
+			if( 1 == aSize )
+				taps = DownsampleTaps_{ { 0, 0, 0 }, { 1.f, 0.f, 0.f } };
+			else if( 0 == aSize % 2 )
+				taps = DownsampleTaps_{ { 2*i, 2*i+1, 2*i+1 }, { 0.5f, 0.5f, 0.f } };
+			else
+			{
+				// Output texel i covers source texels [i*n/m, (i+1)*n/m)
+				float const n = float(aSize);
+				taps = DownsampleTaps_{
+					{ 2*i, 2*i+1, 2*i+2 },
+					{ float(size-i) / n, float(size) / n, float(i+1) / n }
+				};
+			}
+		}
+
+		return ret;
+	}
+
+	std::vector<float> downsample_( std::vector<float> const& aLevel, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels )
+	{
+		auto const xTaps = downsample_taps_( aWidth );
+		auto const yTaps = downsample_taps_( aHeight );
+
+		auto const width = std::uint32_t(xTaps.size());
+		auto const height = std::uint32_t(yTaps.size());
+
+		std::vector<float> ret( std::size_t(width) * height * aChannels, 0.f );
+		for( std::uint32_t y = 0; y < height; ++y )
+		{
+			auto* out = ret.data() + std::size_t(y) * width * aChannels;
+			for( std::uint32_t x = 0; x < width; ++x, out += aChannels )
+			{
+				for( int ty = 0; ty < 3; ++ty )
+				{
+					auto const wy = yTaps[y].weight[ty];
+					if( 0.f == wy )
+						continue;
+
+					auto const* row = aLevel.data() + std::size_t(yTaps[y].index[ty]) * aWidth * aChannels;
+					for( int tx = 0; tx < 3; ++tx )
+					{
+						auto const w = wy * xTaps[x].weight[tx];
+						if( 0.f == w )
+							continue;
+
+						auto const* texel = row + std::size_t(xTaps[x].index[tx]) * aChannels;
+						for( std::uint32_t c = 0; c < aChannels; ++c )
+							out[c] += w * texel[c];
+					}
+				}
+			}
+		}
+
+		return ret;
+	}
+
+	void checked_write_( FILE* aOut, std::size_t aBytes, void const* aData )
+	{
+		if( 0 == aBytes )
+			return;
+
+		auto const ret = std::fwrite( aData, 1, aBytes, aOut );
+		if( ret != aBytes )
+			throw lut::Error( "fwrite() failed: %zu instead of %zu", ret, aBytes );
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,44 @@
+#ifndef BAKE_TEXTURE_HPP_E07A4D19_3C6B_4F85_9B2E_71D8A5C0F364
+#define BAKE_TEXTURE_HPP_E07A4D19_3C6B_4F85_9B2E_71D8A5C0F364
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <string>
+#include <filesystem>
+
+#include <cstddef>
+#include <cstdint>
+
+//--    constants                               ///{{{1///////////////////////
+
+// Extension of baked textures (see BakedTexture.h)
+constexpr char kBakedTextureExtension[] = ".comp5822tex";
+
+//--    types                                   ///{{{1///////////////////////
+struct BakedTextureStats
+{
+	std::uint32_t width = 0;
+	std::uint32_t height = 0;
+	std::uint32_t levels = 0;
+
+	std::size_t sourceBytes = 0; // decoded level 0
+	std::size_t bakedBytes = 0;  // all levels
+};
+
+//--    functions                               ///{{{1///////////////////////
+
+/* Load the image `aSource` (any format that stb_image reads) and write it
+ * with all its mip levels to `aDest` as a baked texture (see BakedTexture.h).
+ *
+ * `aChannels` selects the format: four channel textures become sRGB RGBA,
+ * whose levels are filtered in linear space (alpha as is); one channel
+ * textures (e.g., roughness) become linear R8. Throws lut::Error on failure.
+ */
+BakedTextureStats bake_texture(
+	std::string const& aSource,
+	std::filesystem::path const& aDest,
+	std::uint8_t aChannels
+);
+
+#endif // BAKE_TEXTURE_HPP_E07A4D19_3C6B_4F85_9B2E_71D8A5C0F364
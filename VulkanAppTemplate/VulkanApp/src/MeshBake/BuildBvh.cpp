@@ -0,0 +1,278 @@
+#include "BuildBvh.h"
+
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include <glm/glm.hpp>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr std::size_t kBins_ = 16;
+
+	// Cost of visiting a node relative to testing one primitive
+	constexpr float kTraversalCost_ = 2.f;
+
+	struct Bounds_
+	{
+		glm::vec3 lo = glm::vec3( std::numeric_limits<float>::max() );
+		glm::vec3 hi = glm::vec3( std::numeric_limits<float>::lowest() );
+
+		void grow( glm::vec3 const& aLo, glm::vec3 const& aHi )
+		{
+			lo = glm::min( lo, aLo );
+			hi = glm::max( hi, aHi );
+		}
+
+		// Half the surface area, which is all that the heuristic needs
+		float area() const
+		{
+			auto const d = glm::max( hi - lo, glm::vec3( 0.f ) );
+			return d.x*d.y + d.y*d.z + d.z*d.x;
+		}
+	};
+
+	struct Split_
+	{
+		int axis = -1;
+		std::size_t bin = 0; // primitives in bins [0,bin] go left
+		float cost = std::numeric_limits<float>::max();
+	};
+
+	Split_ find_split_(
+		std::uint32_t const* aBegin,
+		std::uint32_t const* aEnd,
+		Bounds_ const& aCentroids,
+		std::vector<glm::vec3> const& aMin,
+		std::vector<glm::vec3> const& aMax,
+		std::vector<glm::vec3> const& aCenter
+	);
+
+	std::size_t bin_of_( float aValue, float aLo, float aScale )
+	{
+		return std::min( kBins_-1, std::size_t(std::max( 0.f, (aValue - aLo) * aScale )) );
+	}
+}
+
+//--    build_bvh()                     ///{{{2///////////////////////////////
+BvhData build_bvh( std::vector<glm::vec3> const& aMin, std::vector<glm::vec3> const& aMax, std::size_t aMaxLeafSize )
+{
+	if( aMin.size() != aMax.size() || aMaxLeafSize < 1 )
+		throw lut::Error( "build_bvh(): invalid arguments (%zu/%zu boxes, leaf size %zu)", aMin.size(), aMax.size(), aMaxLeafSize );
+	if( aMin.size() > std::numeric_limits<std::uint32_t>::max() )
+		throw lut::Error( "build_bvh(): too many primitives (%zu)", aMin.size() );
+
+	BvhData ret;
+	if( aMin.empty() )
+		return ret;
+
+	std::vector<glm::vec3> center( aMin.size() );
+	for( std::size_t i = 0; i < center.size(); ++i )
+		center[i] = 0.5f * (aMin[i] + aMax[i]);
+
+	ret.primitives.resize( aMin.size() );
+	std::iota( ret.primitives.begin(), ret.primitives.end(), 0u );
+
+	// Build depth first with an explicit stack. The left child is always
+	// built right after its parent; the right child's index is patched into
+	// the parent once the left subtree is done.
+	struct Task_
+	{
+		std::uint32_t begin, end;
+		std::uint32_t parent; // to patch, or kNoParent
+	};
+
+	constexpr std::uint32_t kNoParent = ~std::uint32_t(0);
+
+	std::vector<Task_> stack{ { 0, std::uint32_t(aMin.size()), kNoParent } };
+	ret.nodes.reserve( 2*aMin.size() / std::max<std::size_t>( aMaxLeafSize, 1 ) + 1 );
+
+	while( !stack.empty() )
+	{
+		auto const task = stack.back();
+		stack.pop_back();
+
+		auto const index = std::uint32_t(ret.nodes.size());
+		if( kNoParent != task.parent )
+			ret.nodes[task.parent].offset = index;
+
+		auto* const first = ret.primitives.data() + task.begin;
+		auto* const last = ret.primitives.data() + task.end;
+		std::size_t const count = task.end - task.begin;
+
+		Bounds_ bounds, centroids;
+		for( auto const* it = first; it != last; ++it )
+		{
+			bounds.grow( aMin[*it], aMax[*it] );
+			centroids.grow( center[*it], center[*it] );
+		}
+
+		BvhNode node{};
+		node.aabbMin = bounds.lo;
+		node.aabbMax = bounds.hi;
+		node.offset = task.begin;
+		node.count = std::uint32_t(count);
+
+		std::uint32_t* mid = nullptr;
+		if( count > 1 )
+		{
+			auto const split = find_split_( first, last, centroids, aMin, aMax, center );
+
+			// Compare with the cost of a leaf (which tests every primitive)
+			bool const worthIt = split.axis >= 0
+				&& kTraversalCost_ + split.cost / std::max( bounds.area(), std::numeric_limits<float>::min() ) < float(count);
+
+			if( worthIt || count > aMaxLeafSize )
+			{
+				if( split.axis >= 0 )
+				{
+					auto const axis = split.axis;
+					auto const lo = centroids.lo[axis];
+					auto const scale = float(kBins_) / (centroids.hi[axis] - lo);
+
+					mid = std::partition( first, last, [&] (std::uint32_t aPrim) {
+						return bin_of_( center[aPrim][axis], lo, scale ) <= split.bin;
+					} );
+				}
+
+				// Centroids that cannot be separated (e.g., all equal): halve
+				// the range to keep leaves small.
+				if( !mid || mid == first || mid == last )
+					mid = first + count/2;
+			}
+		}
+
+		if( mid )
+		{
+			node.offset = 0; // patched when the right child is built
+			node.count = 0;
+
+			auto const midIndex = std::uint32_t(mid - ret.primitives.data());
+			stack.push_back( { midIndex, task.end, index } );
+			stack.push_back( { task.begin, midIndex, kNoParent } );
+		}
+
+		ret.nodes.emplace_back( node );
+	}
+
+	return ret;
+}
+
+//--    build_mesh_bvh()                ///{{{2///////////////////////////////
+BvhData build_mesh_bvh( std::vector<IndexedMesh> const& aMeshes )
+{
+	std::vector<glm::vec3> lo, hi;
+	lo.reserve( aMeshes.size() );
+	hi.reserve( aMeshes.size() );
+
+	for( auto const& mesh : aMeshes )
+	{
+		// Empty meshes have an inverted box; they never intersect anything
+		lo.emplace_back( mesh.aabbMin );
+		hi.emplace_back( mesh.aabbMax );
+	}
+
+	return build_bvh( lo, hi, 1 );
+}
+
+//--    build_triangle_bvh()            ///{{{2///////////////////////////////
+BvhData build_triangle_bvh( std::vector<IndexedMesh> const& aMeshes, std::vector<BvhTriangle>& aTriangles )
+{
+	std::vector<BvhTriangle> triangles;
+	std::vector<glm::vec3> lo, hi;
+
+	for( std::size_t m = 0; m < aMeshes.size(); ++m )
+	{
+		auto const& mesh = aMeshes[m];
+		for( std::size_t t = 0; t+2 < mesh.indices.size(); t += 3 )
+		{
+			auto const& a = mesh.vert[mesh.indices[t+0]];
+			auto const& b = mesh.vert[mesh.indices[t+1]];
+			auto const& c = mesh.vert[mesh.indices[t+2]];
+
+			lo.emplace_back( glm::min( a, glm::min( b, c ) ) );
+			hi.emplace_back( glm::max( a, glm::max( b, c ) ) );
+			triangles.push_back( { std::uint32_t(m), std::uint32_t(t/3) } );
+		}
+	}
+
+	auto ret = build_bvh( lo, hi, 4 );
+
+	aTriangles.resize( ret.primitives.size() );
+	for( std::size_t i = 0; i < ret.primitives.size(); ++i )
+		aTriangles[i] = triangles[ret.primitives[i]];
+
+	return ret;
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	Split_ find_split_( std::uint32_t const* aBegin, std::uint32_t const* aEnd, Bounds_ const& aCentroids, std::vector<glm::vec3> const& aMin, std::vector<glm::vec3> const& aMax, std::vector<glm::vec3> const& aCenter )
+	{
+		Split_ best;
+
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			auto const lo = aCentroids.lo[axis];
+			auto const scale = float(kBins_) / (aCentroids.hi[axis] - lo);
+			if( !(scale > 0.f) || !std::isfinite( scale ) )
+				continue;
+
+			Bounds_ bins[kBins_];
+			std::size_t counts[kBins_] = {};
+
+			for( auto const* it = aBegin; it != aEnd; ++it )
+			{
+				auto const bin = bin_of_( aCenter[*it][axis], lo, scale );
+				bins[bin].grow( aMin[*it], aMax[*it] );
+				++counts[bin];
+			}
+
+			// Sweep from the right to get the area and count right of each
+			// split, then from the left to evaluate the splits.
+			float rightArea[kBins_];
+			std::size_t rightCount[kBins_];
+
+			Bounds_ right;
+			std::size_t count = 0;
+			for( std::size_t i = kBins_-1; i > 0; --i )
+			{
+				right.grow( bins[i].lo, bins[i].hi );
+				count += counts[i];
+				rightArea[i] = right.area();
+				rightCount[i] = count;
+			}
+
+			Bounds_ left;
+			count = 0;
+			for( std::size_t i = 0; i+1 < kBins_; ++i )
+			{
+				left.grow( bins[i].lo, bins[i].hi );
+				count += counts[i];
+
+				if( 0 == count || 0 == rightCount[i+1] )
+					continue;
+
+				auto const cost = left.area()*float(count) + rightArea[i+1]*float(rightCount[i+1]);
+				if( cost < best.cost )
+				{
+					best.axis = axis;
+					best.bin = i;
+					best.cost = cost;
+				}
+			}
+		}
+
+		return best;
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
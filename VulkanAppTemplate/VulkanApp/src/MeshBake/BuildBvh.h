@@ -0,0 +1,73 @@
+#ifndef BUILD_BVH_HPP_6E2D9A47_B813_4C05_A7F2_39C1E5D08B6A
+#define BUILD_BVH_HPP_6E2D9A47_B813_4C05_A7F2_39C1E5D08B6A
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+
+#include "IndexMesh.h"
+
+//--    types                                   ///{{{1///////////////////////
+
+// Matches BakedBvhNode (BakedModel.h)
+struct BvhNode
+{
+	glm::vec3 aabbMin;
+	std::uint32_t offset; // leaf: first primitive; inner node: second child
+	glm::vec3 aabbMax;
+	std::uint32_t count;  // leaf: number of primitives (> 0); inner node: 0
+};
+
+static_assert( sizeof(BvhNode) == 32 );
+
+/* Nodes are stored depth first: the root is node 0 and the first child of an
+ * inner node is the node right after it. Leaves reference ranges of
+ * `primitives`, which holds the caller's primitive indices in tree order.
+ */
+struct BvhData
+{
+	std::vector<BvhNode> nodes;
+	std::vector<std::uint32_t> primitives;
+};
+
+// Triangle of one of the model's meshes (see build_triangle_bvh())
+struct BvhTriangle
+{
+	std::uint32_t mesh;
+	std::uint32_t triangle;
+};
+
+//--    functions                               ///{{{1///////////////////////
+
+/* Build a BVH over primitives with the given bounding boxes. Splits are
+ * chosen with the surface area heuristic (evaluated over 16 bins per axis).
+ * Leaves hold at most `aMaxLeafSize` primitives, fewer where the heuristic
+ * says splitting further does not pay off.
+ */
+BvhData build_bvh(
+	std::vector<glm::vec3> const& aPrimitiveMin,
+	std::vector<glm::vec3> const& aPrimitiveMax,
+	std::size_t aMaxLeafSize = 4
+);
+
+// BVH over the bounding boxes of whole meshes, one mesh per leaf. Used to cull
+// meshes.
+BvhData build_mesh_bvh(
+	std::vector<IndexedMesh> const&
+);
+
+// BVH over all triangles of all meshes. `aTriangles` receives the triangle
+// that each primitive index refers to, in tree order (i.e., it replaces
+// BvhData::primitives).
+BvhData build_triangle_bvh(
+	std::vector<IndexedMesh> const&,
+	std::vector<BvhTriangle>& aTriangles
+);
+
+#endif // BUILD_BVH_HPP_6E2D9A47_B813_4C05_A7F2_39C1E5D08B6A
@@ -0,0 +1,172 @@
+#include "BuildMeshlets.h"
+
+#include <limits>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include <glm/glm.hpp>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr std::uint32_t kNotInMeshlet_ = ~std::uint32_t(0);
+
+	// Bounding sphere and normal cone
+	void compute_bounds_(
+		Meshlet&,
+		MeshletData const&,
+		IndexedMesh const&
+	);
+}
+
+//--    build_meshlets()                ///{{{2///////////////////////////////
+MeshletData build_meshlets( IndexedMesh const& aMesh, std::size_t aMaxVertices, std::size_t aMaxTriangles )
+{
+	if( aMaxVertices < 3 || aMaxVertices > 256 || aMaxTriangles < 1 )
+		throw lut::Error( "build_meshlets(): invalid meshlet limits (%zu vertices, %zu triangles)", aMaxVertices, aMaxTriangles );
+
+	MeshletData ret;
+
+	std::size_t const tris = aMesh.indices.size() / 3;
+	if( 0 == tris )
+		return ret;
+
+	ret.vertices.reserve( aMesh.vert.size() );
+	ret.indices.reserve( aMesh.indices.size() );
+
+	// Local index of each mesh vertex in the current meshlet
+	std::vector<std::uint32_t> local( aMesh.vert.size(), kNotInMeshlet_ );
+
+	Meshlet current{};
+
+	auto const finish_ = [&] {
+		if( 0 == current.triangleCount )
+			return;
+
+		compute_bounds_( current, ret, aMesh );
+		ret.meshlets.emplace_back( current );
+
+		for( std::uint32_t i = 0; i < current.vertexCount; ++i )
+			local[ret.vertices[current.vertexOffset+i]] = kNotInMeshlet_;
+
+		current = Meshlet{};
+		current.vertexOffset = std::uint32_t(ret.vertices.size());
+		current.indexOffset = std::uint32_t(ret.indices.size());
+	};
+
+	for( std::size_t t = 0; t < tris; ++t )
+	{
+		std::uint32_t const a = aMesh.indices[t*3+0];
+		std::uint32_t const b = aMesh.indices[t*3+1];
+		std::uint32_t const c = aMesh.indices[t*3+2];
+
+		std::size_t const newVerts = (kNotInMeshlet_ == local[a])
+			+ (kNotInMeshlet_ == local[b] && b != a)
+			+ (kNotInMeshlet_ == local[c] && c != a && c != b)
+		;
+
+		if( current.vertexCount + newVerts > aMaxVertices || current.triangleCount + 1 > aMaxTriangles )
+			finish_();
+
+		for( auto const v : { a, b, c } )
+		{
+			if( kNotInMeshlet_ == local[v] )
+			{
+				local[v] = current.vertexCount++;
+				ret.vertices.push_back( v );
+			}
+
+			assert( local[v] < aMaxVertices );
+			ret.indices.push_back( std::uint8_t(local[v]) );
+		}
+
+		++current.triangleCount;
+	}
+
+	finish_();
+
+	return ret;
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	void compute_bounds_( Meshlet& aMeshlet, MeshletData const& aData, IndexedMesh const& aMesh )
+	{
+		auto const position_ = [&] (std::uint32_t aLocal) {
+			return aMesh.vert[aData.vertices[aMeshlet.vertexOffset + aLocal]];
+		};
+
+		// Bounding sphere: center of the AABB, radius to the farthest vertex.
+		// Not minimal, but close enough for culling.
+		glm::vec3 bmin( std::numeric_limits<float>::max() );
+		glm::vec3 bmax( std::numeric_limits<float>::lowest() );
+		for( std::uint32_t i = 0; i < aMeshlet.vertexCount; ++i )
+		{
+			bmin = glm::min( bmin, position_( i ) );
+			bmax = glm::max( bmax, position_( i ) );
+		}
+
+		aMeshlet.center = 0.5f * (bmin + bmax);
+
+		float radius2 = 0.f;
+		for( std::uint32_t i = 0; i < aMeshlet.vertexCount; ++i )
+		{
+			glm::vec3 const d = position_( i ) - aMeshlet.center;
+			radius2 = std::max( radius2, glm::dot( d, d ) );
+		}
+
+		aMeshlet.radius = std::sqrt( radius2 );
+
+		// Normal cone: the axis is the average face normal; the cutoff is the
+		// sine of the angle between the axis and the farthest normal.
+		std::vector<glm::vec3> normals;
+		normals.reserve( aMeshlet.triangleCount );
+
+		glm::vec3 axis( 0.f );
+		for( std::uint32_t t = 0; t < aMeshlet.triangleCount; ++t )
+		{
+			auto const* tri = aData.indices.data() + aMeshlet.indexOffset + t*3;
+
+			glm::vec3 const p0 = position_( tri[0] );
+			glm::vec3 const n = glm::cross( position_( tri[1] ) - p0, position_( tri[2] ) - p0 );
+
+			// Degenerate triangles are never visible; they do not constrain
+			// the cone.
+			float const len = glm::length( n );
+			if( !(len > 0.f) )
+				continue;
+
+			normals.emplace_back( n / len );
+			axis += normals.back();
+		}
+
+		aMeshlet.coneAxis = glm::vec3( 0.f );
+		aMeshlet.coneCutoff = 1.f;
+
+		float const axisLength = glm::length( axis );
+		if( normals.empty() || !(axisLength > 0.f) )
+			return;
+
+		axis /= axisLength;
+
+		float minDot = 1.f;
+		for( auto const& n : normals )
+			minDot = std::min( minDot, glm::dot( n, axis ) );
+
+		// Normals spread over more than a hemisphere: the meshlet is visible
+		// from everywhere
+		if( minDot <= 0.f )
+			return;
+
+		aMeshlet.coneAxis = axis;
+		aMeshlet.coneCutoff = std::sqrt( 1.f - minDot*minDot );
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
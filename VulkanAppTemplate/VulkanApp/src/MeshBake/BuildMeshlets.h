@@ -0,0 +1,71 @@
+#ifndef BUILD_MESHLETS_HPP_A3F61D02_7C4B_4E9A_9B15_C0E84D27F5B3
+#define BUILD_MESHLETS_HPP_A3F61D02_7C4B_4E9A_9B15_C0E84D27F5B3
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+
+#include "IndexMesh.h"
+
+//--    types                                   ///{{{1///////////////////////
+
+// Matches BakedMeshlet (BakedModel.h)
+struct Meshlet
+{
+	// Bounding sphere of the meshlet's vertices
+	glm::vec3 center;
+	float radius;
+
+	// Normal cone. The meshlet faces away from a viewer at `eye` if
+	//   dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius
+	// coneCutoff is 1 (with a zero axis) if the cone is too wide to be useful.
+	glm::vec3 coneAxis;
+	float coneCutoff;
+
+	// Ranges in MeshletData::vertices and ::indices
+	std::uint32_t vertexOffset;
+	std::uint32_t indexOffset;
+	std::uint32_t vertexCount;
+	std::uint32_t triangleCount;
+};
+
+static_assert( sizeof(Meshlet) == 48 );
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+
+	// Mesh vertex index of each meshlet vertex
+	std::vector<std::uint32_t> vertices;
+
+	// Three meshlet-local vertex indices per triangle
+	std::vector<std::uint8_t> indices;
+};
+
+//--    constants                               ///{{{1///////////////////////
+
+// Limits suggested for mesh shaders on current NVIDIA hardware. 124 (not 128)
+// triangles leaves space for the primitive count in a 128*3 + 4 byte block.
+constexpr std::size_t kMeshletMaxVertices = 64;
+constexpr std::size_t kMeshletMaxTriangles = 124;
+
+//--    functions                               ///{{{1///////////////////////
+
+/* Split the mesh into meshlets of at most `aMaxVertices` vertices (<= 256)
+ * and `aMaxTriangles` triangles. Triangles are consumed in index buffer order,
+ * so this should run on a mesh that is optimized for vertex locality (see
+ * optimize_vertex_cache()).
+ */
+MeshletData build_meshlets(
+	IndexedMesh const&,
+	std::size_t aMaxVertices = kMeshletMaxVertices,
+	std::size_t aMaxTriangles = kMeshletMaxTriangles
+);
+
+#endif // BUILD_MESHLETS_HPP_A3F61D02_7C4B_4E9A_9B15_C0E84D27F5B3
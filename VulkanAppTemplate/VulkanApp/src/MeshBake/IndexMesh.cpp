@@ -1,17 +1,35 @@
 #include "IndexMesh.h"
 
+#include <limits>
 #include <numeric>
-#include <unordered_map>
+#include <algorithm>
 
+#include <cmath>
+#include <cassert>
 #include <cstddef>
 
+#include <tgen.h>
 #include <glm/glm.hpp>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define MESHBAKE_WELD_SSE_ 1
+#	include <emmintrin.h>
+#else
+#	define MESHBAKE_WELD_SSE_ 0
+#endif
+
 namespace
 {
 	// Tweakables
 	constexpr float kAABBMarginFactor = 10.f;
 	constexpr std::size_t kSparseGridMaxSize = 1024*1024;
+	constexpr float kSearchReachSlack = 1e-3f;
+
+	// Width of the grid cells, in multiples of the error tolerance (at least
+	// two). This does not affect the result. Cells that are only 2x as wide
+	// as the search range mean that almost every search covers two cells
+	// along each axis.
+	constexpr float kCellSizeFactor = 8.f;
 
 	// Discretize mesh positions
 	struct DiscretizedPosition_
@@ -28,23 +46,42 @@ namespace
 		float scale;
 	};
 
-	// hash discretized mesh positions
-	using VicinityKey_ = std::size_t;
-	inline VicinityKey_ hash_discretized_position_( DiscretizedPosition_ const& aPos );
+	/* Vertices sorted by grid cell. Cells are identified by a 64-bit key
+	 * ordered by x, then y, then z, so that the cells (x,y,z0) to (x,y,z1)
+	 * form one contiguous range of the sorted array. Finding the neighbours
+	 * of a vertex thus takes a binary search and a linear scan over flat
+	 * arrays per (x,y) column.
+	 */
+	using CellKey_ = std::uint64_t;
+
+	struct VicinityGrid_
+	{
+		std::vector<CellKey_> keys; // sorted
+		std::vector<std::uint32_t> vertices; // vertex for each entry of `keys`
+
+		unsigned shiftX, shiftY;
 
-	// generate vicinity map 
-	using VicinityMap_ = std::unordered_multimap<VicinityKey_,std::size_t>;
-	void build_vicinity_map_( 
-		VicinityMap_&, 
+		inline CellKey_ key( std::int32_t aX, std::int32_t aY, std::int32_t aZ ) const;
+	};
+
+	void build_vicinity_grid_( 
+		VicinityGrid_&, 
 		Discretizer_ const&,
 		std::vector<glm::vec3> const&
 	);
 
+	// Vertex attributes packed for comparison in mergable_()
+	struct alignas(16) PackedVertex_
+	{
+		float v[8]; // position, normal (or zero), texture coordinate
+	};
+
+	std::vector<PackedVertex_> pack_vertices_( TriangleSoup const& );
+
 	// is a vertex mergable?
-	bool mergable_( 
-		TriangleSoup const&, 
-		std::size_t aVertexAIndex, std::size_t aVertexBIndex,
-		glm::vec3 const& aVertexAPos, glm::vec3 const& aVertexBPos,
+	inline bool mergable_( 
+		PackedVertex_ const&,
+		PackedVertex_ const&,
 		float
 	);
 
@@ -55,8 +92,8 @@ namespace
 	std::size_t collapse_vertices_( 
 		IndexBuffer_&, 
 		VertexMapping_&, 
-		VicinityMap_ const&, 
-		Discretizer_ const&, 
+		VicinityGrid_ const&, 
+		Discretizer_ const&,
 		TriangleSoup const&, 
 		float
 	);
@@ -66,7 +103,7 @@ namespace
 //--    IndexedMesh                     ///{{{2///////////////////////////////
 IndexedMesh::IndexedMesh()
 	: aabbMin( std::numeric_limits<float>::max() )
-	, aabbMax( std::numeric_limits<float>::min() )
+	, aabbMax( std::numeric_limits<float>::lowest() )
 {}
 
 //--    make_indexed_mesh()             ///{{{2///////////////////////////////
@@ -74,7 +111,7 @@ IndexedMesh make_indexed_mesh( TriangleSoup const& aSoup, float aErrorTolerance
 {
 	// compute bounding volume
 	glm::vec3 bmin( std::numeric_limits<float>::max() );
-	glm::vec3 bmax( std::numeric_limits<float>::min() );
+	glm::vec3 bmax( std::numeric_limits<float>::lowest() );
 
 	for( std::size_t vert = 0; vert < aSoup.vert.size(); ++vert )
 	{
@@ -89,21 +126,21 @@ IndexedMesh make_indexed_mesh( TriangleSoup const& aSoup, float aErrorTolerance
 	auto const side = fmax - fmin;
 	float const maxSide = std::max( side.x, std::max( side.y, side.z ) );
 
-	float const numCells = maxSide / (2.f*aErrorTolerance);
+	float const numCells = maxSide / (kCellSizeFactor*aErrorTolerance);
 	std::size_t subdiv = std::min( kSparseGridMaxSize, std::size_t(numCells+.5f) );
 
 	// parameters for discretization
 	Discretizer_ dis( std::uint32_t(subdiv), fmin, maxSide );
 
-	// build the vincinity map
-	VicinityMap_ vincinityMap;
-	build_vicinity_map_( vincinityMap, dis, aSoup.vert );
+	// sort vertices into the grid
+	VicinityGrid_ grid;
+	build_vicinity_grid_( grid, dis, aSoup.vert );
 
 	// collapse vertices
 	IndexBuffer_ indices;
 	VertexMapping_ vertexMapping;
 
-	size_t verts = collapse_vertices_( indices, vertexMapping, vincinityMap, dis, aSoup, aErrorTolerance );
+	size_t verts = collapse_vertices_( indices, vertexMapping, grid, dis, aSoup, aErrorTolerance );
 
 	assert( indices.size() == aSoup.vert.size() );
 	assert( verts == vertexMapping.size() );
@@ -181,6 +218,64 @@ void ensure_normals( IndexedMesh& aMesh )
 }
 #endif
 
+//--    compute_tangents()              ///{{{2///////////////////////////////
+void compute_tangents( IndexedMesh& aMesh )
+{
+	std::size_t const verts = aMesh.vert.size();
+
+	aMesh.tangent.assign( verts, glm::vec4( 1.f, 0.f, 0.f, 1.f ) );
+	if( aMesh.indices.empty() || aMesh.norm.size() != verts )
+		return;
+
+	// tgen works on flat double arrays. Positions and texture coordinates
+	// share one index buffer, since the mesh is already welded.
+	std::vector<tgen::VIndexT> indices( aMesh.indices.begin(), aMesh.indices.end() );
+
+	std::vector<tgen::RealT> positions( verts*3 ), normals( verts*3 ), uvs( verts*2 );
+	for( std::size_t i = 0; i < verts; ++i )
+	{
+		for( int j = 0; j < 3; ++j )
+		{
+			positions[i*3+j] = aMesh.vert[i][j];
+			normals[i*3+j] = aMesh.norm[i][j];
+		}
+
+		uvs[i*2+0] = aMesh.text[i].x;
+		uvs[i*2+1] = aMesh.text[i].y;
+	}
+
+	std::vector<tgen::RealT> cornerTangents, cornerBitangents;
+	tgen::computeCornerTSpace( indices, indices, positions, uvs, cornerTangents, cornerBitangents );
+
+	std::vector<tgen::RealT> vertexTangents, vertexBitangents;
+	tgen::computeVertexTSpace( indices, cornerTangents, cornerBitangents, verts, vertexTangents, vertexBitangents );
+
+	tgen::orthogonalizeTSpace( normals, vertexTangents, vertexBitangents );
+
+	std::vector<tgen::RealT> tangents;
+	tgen::computeTangent4D( normals, vertexTangents, vertexBitangents, tangents );
+
+	assert( tangents.size() == verts*4 );
+	for( std::size_t i = 0; i < verts; ++i )
+	{
+		glm::vec3 t( float(tangents[i*4+0]), float(tangents[i*4+1]), float(tangents[i*4+2]) );
+
+		// Degenerate texture coordinates (e.g., collapsed at a pole) leave
+		// tgen with a zero/NaN tangent. Pick any direction orthogonal to the
+		// normal instead, so that the frame stays valid.
+		float const len = glm::length( t );
+		if( !(len > 1e-6f) || !std::isfinite( len ) )
+		{
+			glm::vec3 const& n = aMesh.norm[i];
+			glm::vec3 const axis = std::abs( n.x ) < 0.9f ? glm::vec3( 1.f, 0.f, 0.f ) : glm::vec3( 0.f, 1.f, 0.f );
+			t = glm::cross( n, axis );
+			t = glm::length( t ) > 0.f ? glm::normalize( t ) : axis;
+		}
+
+		aMesh.tangent[i] = glm::vec4( t, tangents[i*4+3] < 0.0 ? -1.f : 1.f );
+	}
+}
+
 
 //--    $ local functions               ///{{{2///////////////////////////////
 namespace
@@ -204,101 +299,171 @@ namespace
 
 namespace
 {
-	std::hash<VicinityKey_> gHash_;
+	// Bits needed to represent `aValue`
+	unsigned bit_width_( std::uint32_t aValue )
+	{
+		unsigned bits = 0;
+		for( ; aValue; aValue >>= 1 )
+			++bits;
 
-	inline VicinityKey_ hash_discretized_position_( DiscretizedPosition_ const& aDP )
+		return bits;
+	}
+
+	inline
+	CellKey_ VicinityGrid_::key( std::int32_t aX, std::int32_t aY, std::int32_t aZ ) const
 	{
-		// Based on boost::hash_combine.
-		std::size_t hash = gHash_(aDP.x);
-		hash ^= gHash_(aDP.y) + 0x9e3779b9 + (hash<<6) + (hash>>2);
-		hash ^= gHash_(aDP.z) + 0x9e3779b9 + (hash<<6) + (hash>>2);
-		return hash;
+		return (CellKey_(std::uint32_t(aX)) << shiftX) | (CellKey_(std::uint32_t(aY)) << shiftY) | CellKey_(std::uint32_t(aZ));
 	}
-}
 
-namespace
-{
-	void build_vicinity_map_( VicinityMap_& aMap, Discretizer_ const& aD, std::vector<glm::vec3> const& aPositions )
+	void build_vicinity_grid_( VicinityGrid_& aGrid, Discretizer_ const& aD, std::vector<glm::vec3> const& aPositions )
 	{
-		for( std::size_t index = 0; index < aPositions.size(); ++index )
+		std::size_t const count = aPositions.size();
+		assert( count <= std::numeric_limits<std::uint32_t>::max() );
+
+		aGrid.keys.clear();
+		aGrid.vertices.clear();
+		aGrid.shiftX = aGrid.shiftY = 0;
+
+		if( 0 == count )
+			return;
+
+		std::vector<DiscretizedPosition_> cells( count );
+		for( std::size_t index = 0; index < count; ++index )
+			cells[index] = aD.discretize( aPositions[index] );
+
+		// Pack the coordinates as tightly as possible, to minimize the number
+		// of radix sort passes. Queries may go one cell past the largest
+		// coordinate (see collapse_vertices_()), which must not overflow into
+		// the next field.
+		std::uint32_t maxX = 0, maxY = 0, maxZ = 0;
+		for( auto const& dp : cells )
 		{
-			DiscretizedPosition_ dp = aD.discretize( aPositions[index] );
-			VicinityKey_ vk = hash_discretized_position_( dp );
+			maxX = std::max( maxX, std::uint32_t(dp.x) );
+			maxY = std::max( maxY, std::uint32_t(dp.y) );
+			maxZ = std::max( maxZ, std::uint32_t(dp.z) );
+		}
+
+		unsigned const bitsX = bit_width_( maxX+1 );
+		unsigned const bitsY = bit_width_( maxY+1 );
+		unsigned const bitsZ = bit_width_( maxZ+1 );
+		assert( bitsX + bitsY + bitsZ <= 64 );
+
+		aGrid.shiftY = bitsZ;
+		aGrid.shiftX = bitsZ + bitsY;
 
-			aMap.insert( std::make_pair(vk, index) );
+		std::vector<CellKey_> keys( count );
+		std::vector<std::uint32_t> vertices( count );
+		for( std::size_t index = 0; index < count; ++index )
+		{
+			keys[index] = aGrid.key( cells[index].x, cells[index].y, cells[index].z );
+			vertices[index] = std::uint32_t(index);
 		}
-	}
-}
 
-namespace
-{
-	bool mergable_( TriangleSoup const& aSoup, size_t aI, size_t aJ, glm::vec3 const& aIPos, glm::vec3 const& aJPos, float aErrorTolerance )
-	{
-		// Compare all elements component-wise. 
-		// start with positions, since we've already got those
-		for(int i = 0; i < 3; ++i )
+		// LSD radix sort with 11-bit digits. All histograms are computed in a
+		// single pass up front.
+		constexpr unsigned kDigitBits = 11;
+		constexpr std::size_t kDigitCount = std::size_t(1) << kDigitBits;
+		constexpr CellKey_ kDigitMask = kDigitCount - 1;
+
+		unsigned const passes = (bitsX + bitsY + bitsZ + kDigitBits - 1) / kDigitBits;
+
+		std::vector<std::size_t> offsets( passes * kDigitCount, 0 );
+		for( auto const key : keys )
 		{
-			if( std::abs(aIPos[i] - aJPos[i]) > aErrorTolerance )
-				return false;
+			for( unsigned pass = 0; pass < passes; ++pass )
+				++offsets[pass*kDigitCount + ((key >> (pass*kDigitBits)) & kDigitMask)];
 		}
 
-		// Compare normals
-		if( !aSoup.norm.empty() )
+		std::vector<CellKey_> tmpKeys( count );
+		std::vector<std::uint32_t> tmpVertices( count );
+
+		for( unsigned pass = 0; pass < passes; ++pass )
 		{
-			auto const nI = aSoup.norm[aI];
-			auto const nJ = aSoup.norm[aJ];
-			for(int i = 0; i < 3; ++i )
+			auto* const offs = offsets.data() + pass*kDigitCount;
+			unsigned const shift = pass*kDigitBits;
+
+			// All keys have the same digit? Nothing to do.
+			if( offs[(keys.front() >> shift) & kDigitMask] == count )
+				continue;
+
+			std::size_t sum = 0;
+			for( std::size_t i = 0; i < kDigitCount; ++i )
 			{
-				if( std::abs(nI[i] - nJ[i]) > aErrorTolerance )
-					return false;
+				auto const n = offs[i];
+				offs[i] = sum;
+				sum += n;
 			}
-		}
 
-		// Compare tex coord
-		auto const tI = aSoup.text[aI];
-		auto const tJ = aSoup.text[aJ];
-		for(int i = 0; i < 2; ++i )
-		{
-			if( std::abs(tI[i] - tJ[i]) > aErrorTolerance )
-				return false;
+			for( std::size_t i = 0; i < count; ++i )
+			{
+				auto const to = offs[(keys[i] >> shift) & kDigitMask]++;
+				tmpKeys[to] = keys[i];
+				tmpVertices[to] = vertices[i];
+			}
+
+			keys.swap( tmpKeys );
+			vertices.swap( tmpVertices );
 		}
-	
-		return true;
+
+		aGrid.keys = std::move(keys);
+		aGrid.vertices = std::move(vertices);
 	}
 }
 
 namespace
 {
-	// neighbours
-	const size_t kNeighbourCount_ = 27;
-
-	DiscretizedPosition_ neighbour_( DiscretizedPosition_ const& aDP, std::size_t aJ )
+	std::vector<PackedVertex_> pack_vertices_( TriangleSoup const& aSoup )
 	{
-		static constexpr std::int32_t offset[kNeighbourCount_][3] = {
-			{ 0, 0, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
-			{ 0, 1, 0 }, { 0, 1, 1 }, { 0, 1, -1 },
-			{ 0, -1, 0 }, { 0, -1, 1 }, { 0, -1, -1 },
+		std::vector<PackedVertex_> ret( aSoup.vert.size() );
+		for( std::size_t i = 0; i < ret.size(); ++i )
+		{
+			auto& v = ret[i].v;
 
-			{ 1, 0, 0 }, { 1, 0, 1 }, { 1, 0, -1 },
-			{ 1, 1, 0 }, { 1, 1, 1 }, { 1, 1, -1 },
-			{ 1, -1, 0 }, { 1, -1, 1 }, { 1, -1, -1 },
+			v[0] = aSoup.vert[i].x;
+			v[1] = aSoup.vert[i].y;
+			v[2] = aSoup.vert[i].z;
 
-			{ -1, 0, 0 }, { -1, 0, 1 }, { -1, 0, -1 },
-			{ -1, 1, 0 }, { -1, 1, 1 }, { -1, 1, -1 },
-			{ -1, -1, 0 }, { -1, -1, 1 }, { -1, -1, -1 },
-		};
+			// Missing normals compare equal
+			auto const n = aSoup.norm.empty() ? glm::vec3( 0.f ) : aSoup.norm[i];
+			v[3] = n.x;
+			v[4] = n.y;
+			v[5] = n.z;
+
+			v[6] = aSoup.text[i].x;
+			v[7] = aSoup.text[i].y;
+		}
 
-		assert( aJ < kNeighbourCount_ );
-		
-		DiscretizedPosition_ ret = aDP;
-		ret.x += offset[aJ][0];
-		ret.y += offset[aJ][1];
-		ret.z += offset[aJ][2];
 		return ret;
 	}
 
+	inline
+	bool mergable_( PackedVertex_ const& aI, PackedVertex_ const& aJ, float aErrorTolerance )
+	{
+		// Compare all elements component-wise. Note: comparisons involving
+		// NaNs are false, i.e., NaNs do not prevent merging (as before).
+#		if MESHBAKE_WELD_SSE_
+		__m128 const tol = _mm_set1_ps( aErrorTolerance );
+		__m128 const sign = _mm_set1_ps( -0.f );
+
+		__m128 const d0 = _mm_andnot_ps( sign, _mm_sub_ps( _mm_load_ps( aI.v+0 ), _mm_load_ps( aJ.v+0 ) ) );
+		__m128 const d1 = _mm_andnot_ps( sign, _mm_sub_ps( _mm_load_ps( aI.v+4 ), _mm_load_ps( aJ.v+4 ) ) );
+
+		__m128 const gt = _mm_or_ps( _mm_cmpgt_ps( d0, tol ), _mm_cmpgt_ps( d1, tol ) );
+		return 0 == _mm_movemask_ps( gt );
+#		else // !SSE
+		bool ok = true;
+		for( int i = 0; i < 8; ++i )
+			ok &= !(std::abs(aI.v[i] - aJ.v[i]) > aErrorTolerance);
+
+		return ok;
+#		endif // ~ SSE
+	}
+}
+
+namespace
+{
 	// Merge vertices
-	size_t collapse_vertices_( IndexBuffer_& aIndices, VertexMapping_& aVertices, VicinityMap_ const& aVM, Discretizer_ const& aD, TriangleSoup const& aSoup, float aMaxError )
+	size_t collapse_vertices_( IndexBuffer_& aIndices, VertexMapping_& aVertices, VicinityGrid_ const& aGrid, Discretizer_ const& aD, TriangleSoup const& aSoup, float aMaxError )
 	{
 		aVertices.clear();
 		aVertices.reserve( aSoup.vert.size() );
@@ -306,6 +471,8 @@ namespace
 		aIndices.clear();
 		aIndices.reserve( aSoup.vert.size() );
 
+		auto const packed = pack_vertices_( aSoup );
+
 		// initialize collapse map
 		VertexMapping_ collapseMap( aSoup.vert.size() );
 		std::fill( collapseMap.begin(), collapseMap.end(), ~std::size_t(0) );
@@ -322,60 +489,48 @@ namespace
 				continue;
 			}
 
-			// get position and look for possible neighbours
-			auto const self = aSoup.vert[i];
-			DiscretizedPosition_ const dp = aD.discretize( self );
-
-			bool merged = false;
-			std::size_t target = ~std::size_t(0);
-
-			for( std::size_t j = 0; j < kNeighbourCount_; ++j )
+			// This vertex starts a new one. 
+			std::size_t const toWhere = nextVertex++;
+
+			collapseMap[i] = toWhere;
+			aVertices.push_back( i );
+			aIndices.push_back( std::uint32_t(toWhere) );
+
+			/* Find vertices that can be merged with it. These are within
+			 * aMaxError along each axis. Cells are at least 2*aMaxError wide,
+			 * so this covers at most two cells per axis (and usually one; see
+			 * kCellSizeFactor).
+			 *
+			 * The search reach is slightly larger than aMaxError to account
+			 * for rounding in mergable_(). A float q >= p-reach is never below
+			 * the rounded value of p-reach, and discretize() is monotonic, so
+			 * no candidate's cell is outside of the range.
+			 */
+			auto const& self = packed[i];
+			auto const pos = aSoup.vert[i];
+
+			glm::vec3 const reach( aMaxError * (1.f + kSearchReachSlack) );
+			DiscretizedPosition_ const lo = aD.discretize( pos - reach );
+			DiscretizedPosition_ const hi = aD.discretize( pos + reach );
+
+			for( std::int32_t x = lo.x; x <= hi.x; ++x )
 			{
-				DiscretizedPosition_ const dq = neighbour_( dp, j );
-				VicinityKey_ const vk = hash_discretized_position_( dq );
-
-				// get vertices in this bucket
-				for( auto [it, jt] = aVM.equal_range( vk ); it != jt; ++it )
+				for( std::int32_t y = lo.y; y <= hi.y; ++y )
 				{
-					std::size_t const idx =  it->second;
-
-					if( idx == i ) continue; // don't try to merge with self
-					if( ~std::size_t(0) != collapseMap[idx] ) continue; // don't remerge
+					CellKey_ const first = aGrid.key( x, y, lo.z );
+					CellKey_ const last = aGrid.key( x, y, hi.z );
 
-					auto const other = aSoup.vert[idx];
-					if( mergable_( aSoup, i, idx, self, other, aMaxError ) )
+					auto const beg = std::lower_bound( aGrid.keys.begin(), aGrid.keys.end(), first );
+					for( auto it = beg; it != aGrid.keys.end() && *it <= last; ++it )
 					{
-						std::size_t toWhere;
-						
-						if( merged )
-						{
-							toWhere = target;
-						}
-						else
-						{
-							toWhere = nextVertex++;
-							aVertices.push_back( i );
-
-							collapseMap[i] = toWhere;
-							aIndices.push_back( std::uint32_t(toWhere) );
-						}
-
-						collapseMap[idx] = toWhere;
-						
-						target = toWhere;
-						merged = true;
+						std::size_t const idx = aGrid.vertices[it - aGrid.keys.begin()];
+						if( ~std::size_t(0) != collapseMap[idx] ) continue; // don't remerge (or merge with self)
+
+						if( mergable_( self, packed[idx], aMaxError ) )
+							collapseMap[idx] = toWhere;
 					}
 				}
 			}
-
-			if( !merged )
-			{
-				std::size_t toWhere = nextVertex++;
-
-				collapseMap[i] = toWhere;
-				aVertices.push_back( i );
-				aIndices.push_back( std::uint32_t(toWhere) );
-			}
 		}
 
 		return nextVertex;
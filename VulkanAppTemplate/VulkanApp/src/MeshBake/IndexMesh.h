@@ -10,7 +10,7 @@
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
-//#include <glm/vec4.hpp>
+#include <glm/vec4.hpp>
 
 //--    types                                   ///{{{1///////////////////////
 struct TriangleSoup
@@ -25,7 +25,7 @@ struct IndexedMesh
 	std::vector<glm::vec3> norm;
 	std::vector<glm::vec2> text;
 
-	//std::vector<glm::vec4> tangent; // Task 1.4
+	std::vector<glm::vec4> tangent; // xyz = tangent, w = handedness (+-1); see compute_tangents()
 
 	std::vector<std::uint32_t> indices;
 
@@ -43,4 +43,7 @@ IndexedMesh make_indexed_mesh(
 
 void ensure_normals( IndexedMesh& );
 
+// Fill IndexedMesh::tangent from positions, normals and texture coordinates.
+void compute_tangents( IndexedMesh& );
+
 #endif // INDEX_MESH_HPP_8617BC10_313B_4397_9E27_33AA16A4C308
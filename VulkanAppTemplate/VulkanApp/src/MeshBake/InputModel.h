@@ -46,6 +46,10 @@ struct InputModel
 {
 	std::string modelSourcePath;
 
+	// Other files that the model was loaded from (e.g., the OBJ's material
+	// library). Used to decide whether a baked model is out of date.
+	std::vector<std::string> dependencyPaths;
+
 	std::vector<InputMaterialInfo> materials;
 	std::vector<InputMeshInfo> meshes;
 
@@ -1,7 +1,19 @@
 #include "LoadModelObj.h"
 
+#include <array>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <charconv>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+#include <type_traits>
 #include <unordered_set>
 
+#include <cmath>
+#include <cfloat>
 #include <cassert>
 #include <cstring>
 
@@ -11,6 +23,36 @@
 #include "InputModel.h"
 namespace lut = labutils;
 
+namespace
+{
+	// Like rapidobj, faces have at most 255 vertices
+	constexpr std::size_t kMaxFaceVertices = 255;
+
+	// Block size for reading OBJ files in the streaming import
+	constexpr std::size_t kReadBlockSize = std::size_t(4) << 20;
+
+	// One corner of a face; indices are resolved, -1 = not given
+	struct FaceVertex_
+	{
+		std::int64_t position, texcoord, normal;
+	};
+
+	std::string path_prefix_( char const* );
+	void convert_materials_( rapidobj::Materials const&, std::string const& aPrefix, InputModel& );
+
+	rapidobj::Materials load_material_library_( std::string const& aPath );
+
+	template< typename tLineFn >
+	void for_each_line_( char const* aPath, std::uint64_t aBegin, std::uint64_t aEnd, tLineFn&& );
+
+	std::string_view trim_( std::string_view );
+	bool starts_with_token_( std::string_view aLine, char const* aToken );
+
+	std::size_t parse_floats_( std::string_view, std::size_t aMaxCount, float* aOut );
+	std::size_t count_face_vertices_( std::string_view );
+	std::size_t parse_face_( std::string_view, ObjMeshRange const& aCounts, FaceVertex_* aOut );
+}
+
 InputModel load_wavefront_obj( char const* aPath )
 {
 	assert( aPath );
@@ -27,13 +69,7 @@ InputModel load_wavefront_obj( char const* aPath )
 	rapidobj::Triangulate( result );
 
 	// Find the path to the OBJ file
-	char const* pathBeg = aPath;
-	char const* pathEnd = std::strrchr( pathBeg, '/' );
-	
-	std::string const prefix = pathEnd
-		? std::string( pathBeg, pathEnd+1 )
-		: ""
-	;
+	std::string const prefix = path_prefix_( aPath );
 
 	// Convert the OBJ data into a InputModel structure.
 	// First, extract material data.
@@ -41,35 +77,25 @@ InputModel load_wavefront_obj( char const* aPath )
 
 	ret.modelSourcePath = aPath;
 
-	for( auto const& mat : result.materials )
+	// Record the material library. rapidobj does not report which file it
+	// loaded the materials from, so look for the "mtllib" statement. Like
+	// rapidobj, resolve it relative to the OBJ file.
 	{
-		InputMaterialInfo mi;
-
-		mi.materialName  = mat.name;
-
-		mi.baseColor = glm::vec3( mat.diffuse[0], mat.diffuse[1], mat.diffuse[2] );
-		mi.emissiveColor = glm::vec3( mat.emission[0], mat.emission[1], mat.emission[2] );
-
-		mi.baseRoughness  = mat.roughness;
-		mi.baseMetalness  = mat.metallic;
-
-		if( !mat.diffuse_texname.empty() )
-			mi.baseColorTexturePath  = prefix + mat.diffuse_texname;
-
-		if( !mat.roughness_texname.empty() )
-			mi.roughnessTexturePath  = prefix + mat.roughness_texname;
-		if( !mat.metallic_texname.empty() )
-			mi.metalnessTexturePath  = prefix + mat.metallic_texname;
-
-		if( !mat.alpha_texname.empty() )
-			mi.alphaMaskTexturePath  = prefix + mat.alpha_texname;
-
-		if( !mat.normal_texname.empty() )
-			mi.normalMapTexturePath  = prefix + mat.normal_texname;
+		std::ifstream fin( aPath );
+		for( std::string line; std::getline( fin, line ); )
+		{
+			if( 0 != line.compare( 0, 7, "mtllib " ) )
+				continue;
 
-		ret.materials.emplace_back( std::move(mi) );
+			auto const beg = line.find_first_not_of( " \t", 7 );
+			auto const end = line.find_last_not_of( " \t\r" );
+			if( std::string::npos != beg && end >= beg )
+				ret.dependencyPaths.emplace_back( prefix + line.substr( beg, end-beg+1 ) );
+		}
 	}
 
+	convert_materials_( result.materials, prefix, ret );
+
 	// Next, extract the actual mesh data. There are some complications:
 	// - OBJ use separate indices to positions, normals and texture coords. To
 	//   deal with this, the mesh is turned into an unindexed triangle soup.
@@ -163,3 +189,549 @@ InputModel load_wavefront_obj( char const* aPath )
 	return ret;
 }
 
+ObjStreamModel scan_wavefront_obj( char const* aPath )
+{
+	assert( aPath );
+
+	std::error_code ec;
+	auto const fileSize = std::filesystem::file_size( aPath, ec );
+	if( ec )
+		throw lut::Error( "Unable to load OBJ file '%s': %s", aPath, ec.message().c_str() );
+
+	ObjStreamModel ret;
+	ret.model.modelSourcePath = aPath;
+
+	std::string const prefix = path_prefix_( aPath );
+
+	// Shapes start at each "g" or "o" statement (plus an unnamed one at the
+	// start of the file). For each shape, keep the materials that its faces
+	// use, in the order of first use, and the number of triangle soup
+	// vertices per material. Materials are named rather than indexed until
+	// the material library is loaded.
+	struct Shape_
+	{
+		std::string name;
+		ObjMeshRange range;
+
+		std::vector<std::int64_t> materials;
+		std::vector<std::size_t> vertexCounts;
+	};
+
+	std::vector<std::string> materialNames;
+	std::unordered_map<std::string,std::int64_t> materialNameIds;
+
+	std::vector<Shape_> shapes;
+	shapes.push_back( { std::string(), ObjMeshRange{ 0, 0, 0, 0, 0, -1 }, {}, {} } );
+
+	std::int64_t currentMaterial = -1;
+	std::string materialLibrary;
+
+	for_each_line_( aPath, 0, fileSize, [&] (std::string_view aLine, std::uint64_t aOffset) {
+		auto const line = trim_( aLine );
+		if( line.empty() )
+			return;
+
+		float values[3];
+		if( starts_with_token_( line, "v" ) )
+		{
+			if( parse_floats_( line.substr( 2 ), 3, values ) < 3 )
+				throw lut::Error( "Unable to load OBJ file '%s': malformed position at byte %llu", aPath, (unsigned long long)aOffset );
+
+			ret.positions.emplace_back( values[0], values[1], values[2] );
+		}
+		else if( starts_with_token_( line, "vn" ) )
+		{
+			if( parse_floats_( line.substr( 3 ), 3, values ) < 3 )
+				throw lut::Error( "Unable to load OBJ file '%s': malformed normal at byte %llu", aPath, (unsigned long long)aOffset );
+
+			ret.normals.emplace_back( values[0], values[1], values[2] );
+		}
+		else if( starts_with_token_( line, "vt" ) )
+		{
+			if( parse_floats_( line.substr( 3 ), 2, values ) < 2 )
+				throw lut::Error( "Unable to load OBJ file '%s': malformed texture coordinate at byte %llu", aPath, (unsigned long long)aOffset );
+
+			ret.texcoords.emplace_back( values[0], values[1] );
+		}
+		else if( starts_with_token_( line, "f" ) )
+		{
+			auto const corners = count_face_vertices_( line.substr( 2 ) );
+			if( corners < 3 || corners > kMaxFaceVertices )
+				throw lut::Error( "Unable to load OBJ file '%s': face with %zu vertices at byte %llu", aPath, corners, (unsigned long long)aOffset );
+
+			auto& shape = shapes.back();
+			auto const it = std::find( shape.materials.begin(), shape.materials.end(), currentMaterial );
+			auto const slot = std::size_t(it - shape.materials.begin());
+			if( shape.materials.end() == it )
+			{
+				shape.materials.emplace_back( currentMaterial );
+				shape.vertexCounts.emplace_back( 0 );
+			}
+
+			shape.vertexCounts[slot] += 3*(corners-2); // see read_wavefront_obj_mesh()
+		}
+		else if( starts_with_token_( line, "g" ) || starts_with_token_( line, "o" ) )
+		{
+			shapes.back().range.end = aOffset;
+
+			ObjMeshRange range{ aOffset, 0, ret.positions.size(), ret.normals.size(), ret.texcoords.size(), currentMaterial };
+			shapes.push_back( { std::string( trim_( line.substr( 2 ) ) ), range, {}, {} } );
+		}
+		else if( starts_with_token_( line, "usemtl" ) )
+		{
+			std::string name( trim_( line.substr( 7 ) ) );
+			auto const [it, added] = materialNameIds.emplace( name, std::int64_t(materialNames.size()) );
+			if( added )
+				materialNames.emplace_back( std::move(name) );
+
+			currentMaterial = it->second;
+		}
+		else if( starts_with_token_( line, "mtllib" ) )
+		{
+			auto const name = prefix + std::string( trim_( line.substr( 7 ) ) );
+			ret.model.dependencyPaths.emplace_back( name );
+
+			if( materialLibrary.empty() )
+				materialLibrary = name;
+		}
+	} );
+
+	shapes.back().range.end = fileSize;
+
+	// Materials. Resolve the names used by the faces to material indices.
+	if( !materialLibrary.empty() )
+		convert_materials_( load_material_library_( materialLibrary ), prefix, ret.model );
+
+	for( std::size_t i = 0; i < ret.model.materials.size(); ++i )
+		ret.materialIndices.emplace( ret.model.materials[i].materialName, i );
+
+	std::vector<std::int64_t> nameToMaterial( materialNames.size() );
+	for( std::size_t i = 0; i < materialNames.size(); ++i )
+	{
+		auto const it = ret.materialIndices.find( materialNames[i] );
+		if( ret.materialIndices.end() == it )
+			throw lut::Error( "Unable to load OBJ file '%s': unknown material '%s'", aPath, materialNames[i].c_str() );
+
+		nameToMaterial[i] = std::int64_t(it->second);
+	}
+
+	auto const resolve_ = [&] (std::int64_t aName) -> std::int64_t {
+		return aName < 0 ? -1 : nameToMaterial[std::size_t(aName)];
+	};
+
+	// Meshes: one per shape and material, like load_wavefront_obj(). This
+	// includes iterating the materials in the same order, i.e., that of an
+	// unordered_set into which the material of each face was inserted.
+	std::unordered_set<std::size_t> activeMaterials;
+	for( auto& shape : shapes )
+	{
+		shape.range.material = resolve_( shape.range.material );
+
+		activeMaterials.clear();
+		for( auto const name : shape.materials )
+		{
+			auto const matId = resolve_( name );
+			if( matId < 0 )
+				throw lut::Error( "Unable to load OBJ file '%s': faces without material in '%s'", aPath, shape.name.c_str() );
+
+			activeMaterials.emplace( std::size_t(matId) );
+		}
+
+		for( auto const matId : activeMaterials )
+		{
+			std::string meshName;
+			if( 1 == activeMaterials.size() )
+				meshName = shape.name;
+			else
+				meshName = shape.name + "::" + ret.model.materials[matId].materialName;
+
+			// Faces that use the same material name share the count
+			std::size_t vertexCount = 0;
+			for( std::size_t i = 0; i < shape.materials.size(); ++i )
+			{
+				if( std::size_t(resolve_( shape.materials[i] )) == matId )
+					vertexCount += shape.vertexCounts[i];
+			}
+
+			ret.model.meshes.emplace_back( InputMeshInfo{
+				std::move(meshName),
+				matId,
+				0,
+				vertexCount
+			} );
+			ret.ranges.emplace_back( shape.range );
+		}
+	}
+
+	return ret;
+}
+
+InputModel read_wavefront_obj_mesh( ObjStreamModel const& aObj, std::size_t aMeshIndex )
+{
+	assert( aMeshIndex < aObj.model.meshes.size() );
+
+	auto const& info = aObj.model.meshes[aMeshIndex];
+	auto const& source = aObj.model.modelSourcePath;
+
+	InputModel ret;
+	ret.modelSourcePath = source;
+
+	ret.positions.reserve( info.vertexCount );
+	ret.normals.reserve( info.vertexCount );
+	ret.texcoords.reserve( info.vertexCount );
+
+	// Replay the shape's lines: attributes and materials are tracked, such
+	// that relative indices and "usemtl" mean the same as during the scan.
+	ObjMeshRange counts = aObj.ranges[aMeshIndex];
+	std::int64_t const matId = std::int64_t(info.materialIndex);
+
+	FaceVertex_ face[kMaxFaceVertices];
+	std::array<std::vector<std::array<float,2>>,1> polygon;
+
+	// Like rapidobj, indices must be in range; missing texture coordinates
+	// and normals (-1) are zero.
+	auto const fetch_ = [&] (auto const& aArray, std::int64_t aIndex, bool aRequired) {
+		using Value_ = typename std::decay_t<decltype(aArray)>::value_type;
+		if( aIndex < 0 && !aRequired )
+			return Value_( 0.f );
+
+		if( aIndex < 0 || aIndex >= std::int64_t(aArray.size()) )
+			throw lut::Error( "Unable to load OBJ file '%s': index out of bounds in mesh '%s'", source.c_str(), info.meshName.c_str() );
+
+		return aArray[std::size_t(aIndex)];
+	};
+	auto const position_ = [&] (FaceVertex_ const& aVertex) {
+		return fetch_( aObj.positions, aVertex.position, true );
+	};
+	auto const emit_ = [&] (FaceVertex_ const& aVertex) {
+		ret.positions.emplace_back( position_( aVertex ) );
+		ret.texcoords.emplace_back( fetch_( aObj.texcoords, aVertex.texcoord, false ) );
+		ret.normals.emplace_back( fetch_( aObj.normals, aVertex.normal, false ) );
+	};
+
+	for_each_line_( source.c_str(), counts.begin, counts.end, [&] (std::string_view aLine, std::uint64_t) {
+		auto const line = trim_( aLine );
+		if( line.empty() )
+			return;
+
+		if( starts_with_token_( line, "v" ) )
+			++counts.positions;
+		else if( starts_with_token_( line, "vn" ) )
+			++counts.normals;
+		else if( starts_with_token_( line, "vt" ) )
+			++counts.texcoords;
+		else if( starts_with_token_( line, "usemtl" ) )
+		{
+			auto const it = aObj.materialIndices.find( std::string( trim_( line.substr( 7 ) ) ) );
+			assert( aObj.materialIndices.end() != it ); // checked by the scan
+			counts.material = std::int64_t(it->second);
+		}
+		else if( starts_with_token_( line, "f" ) && matId == counts.material )
+		{
+			auto const corners = parse_face_( line.substr( 2 ), counts, face );
+			if( 0 == corners )
+				throw lut::Error( "Unable to load OBJ file '%s': malformed face '%.*s'", source.c_str(), int(line.size()), line.data() );
+
+			// Triangulate like rapidobj::Triangulate(): quads are split
+			// along the shorter diagonal, larger polygons are ear clipped in
+			// the axis plane where they have the largest area.
+			if( 3 == corners )
+			{
+				for( std::size_t i = 0; i < 3; ++i )
+					emit_( face[i] );
+			}
+			else if( 4 == corners )
+			{
+				auto const e02 = position_( face[0] ) - position_( face[2] );
+				auto const e13 = position_( face[1] ) - position_( face[3] );
+				bool const d02Less = e02.x*e02.x + e02.y*e02.y + e02.z*e02.z < e13.x*e13.x + e13.y*e13.y + e13.z*e13.z;
+
+				emit_( face[0] );
+				emit_( face[1] );
+				emit_( d02Less ? face[2] : face[3] );
+				emit_( d02Less ? face[0] : face[1] );
+				emit_( face[2] );
+				emit_( face[3] );
+			}
+			else
+			{
+				auto const area_ = [&] (int aX, int aY) {
+					float area = 0.f;
+					for( std::size_t i = 1; i <= corners; ++i )
+					{
+						auto const a = position_( face[i-1] );
+						auto const b = position_( face[i % corners] );
+						area += (b[aX] - a[aX]) * ((a[aY] + b[aY]) / 2);
+					}
+					return std::abs( area );
+				};
+
+				float const areaX = area_( 1, 2 ), areaY = area_( 0, 2 ), areaZ = area_( 0, 1 );
+				if( FLT_MIN > std::max( { areaX, areaY, areaZ } ) )
+					throw lut::Error( "Unable to load OBJ file '%s': unable to triangulate face '%.*s'", source.c_str(), int(line.size()), line.data() );
+
+				int axisX = 0, axisY = 1;
+				if( areaX > areaY )
+				{
+					if( areaX > areaZ )
+						axisX = 1, axisY = 2;
+				}
+				else if( areaY > areaZ )
+					axisX = 0, axisY = 2;
+
+				auto& outline = polygon.front();
+				outline.clear();
+				for( std::size_t i = 0; i < corners; ++i )
+				{
+					auto const pos = position_( face[i] );
+					outline.push_back( { pos[axisX], pos[axisY] } );
+				}
+
+				auto triangles = mapbox::earcut( polygon );
+				if( triangles.empty() || triangles.size() % 3 != 0 )
+					throw lut::Error( "Unable to load OBJ file '%s': unable to triangulate face '%.*s'", source.c_str(), int(line.size()), line.data() );
+
+				for( std::size_t i = 0; i < triangles.size(); i += 3 )
+				{
+					emit_( face[triangles[i+1]] );
+					emit_( face[triangles[i+0]] );
+					emit_( face[triangles[i+2]] );
+				}
+			}
+		}
+	} );
+
+	ret.meshes.emplace_back( InputMeshInfo{
+		info.meshName,
+		info.materialIndex,
+		0,
+		ret.positions.size()
+	} );
+
+	return ret;
+}
+
+namespace
+{
+	std::string path_prefix_( char const* aPath )
+	{
+		char const* pathBeg = aPath;
+		char const* pathEnd = std::strrchr( pathBeg, '/' );
+
+		return pathEnd
+			? std::string( pathBeg, pathEnd+1 )
+			: ""
+		;
+	}
+
+	void convert_materials_( rapidobj::Materials const& aMaterials, std::string const& aPrefix, InputModel& aModel )
+	{
+		for( auto const& mat : aMaterials )
+		{
+			InputMaterialInfo mi;
+
+			mi.materialName  = mat.name;
+
+			mi.baseColor = glm::vec3( mat.diffuse[0], mat.diffuse[1], mat.diffuse[2] );
+			mi.emissiveColor = glm::vec3( mat.emission[0], mat.emission[1], mat.emission[2] );
+
+			mi.baseRoughness  = mat.roughness;
+			mi.baseMetalness  = mat.metallic;
+
+			if( !mat.diffuse_texname.empty() )
+				mi.baseColorTexturePath  = aPrefix + mat.diffuse_texname;
+
+			if( !mat.roughness_texname.empty() )
+				mi.roughnessTexturePath  = aPrefix + mat.roughness_texname;
+			if( !mat.metallic_texname.empty() )
+				mi.metalnessTexturePath  = aPrefix + mat.metallic_texname;
+
+			if( !mat.alpha_texname.empty() )
+				mi.alphaMaskTexturePath  = aPrefix + mat.alpha_texname;
+
+			if( !mat.normal_texname.empty() )
+				mi.normalMapTexturePath  = aPrefix + mat.normal_texname;
+
+			aModel.materials.emplace_back( std::move(mi) );
+		}
+	}
+
+	rapidobj::Materials load_material_library_( std::string const& aPath )
+	{
+		// rapidobj only parses material libraries as part of an OBJ file.
+		// Hand it a stub OBJ that just references the library, whose text
+		// is passed in directly.
+		std::string text;
+		{
+			std::ifstream fin( aPath, std::ios::binary );
+			if( !fin )
+				throw lut::Error( "Unable to load material library '%s'", aPath.c_str() );
+
+			text.assign( std::istreambuf_iterator<char>( fin ), std::istreambuf_iterator<char>() );
+		}
+
+		auto const unique = std::hash<std::thread::id>{}( std::this_thread::get_id() ) ^ std::size_t(std::chrono::steady_clock::now().time_since_epoch().count());
+		auto const stub = std::filesystem::temp_directory_path() / ("meshbake-" + std::to_string( unique ) + ".obj");
+
+		{
+			std::ofstream fout( stub, std::ios::binary );
+			fout << "mtllib stub.mtl\n";
+			if( !fout )
+				throw lut::Error( "Unable to write '%s'", stub.string().c_str() );
+		}
+
+		auto result = rapidobj::ParseFile( stub, rapidobj::MaterialLibrary::String( text ) );
+
+		std::error_code ec;
+		std::filesystem::remove( stub, ec );
+
+		if( result.error )
+			throw lut::Error( "Unable to load material library '%s': %s", aPath.c_str(), result.error.code.message().c_str() );
+
+		return std::move(result.materials);
+	}
+
+	template< typename tLineFn >
+	void for_each_line_( char const* aPath, std::uint64_t aBegin, std::uint64_t aEnd, tLineFn&& aLineFn )
+	{
+		std::ifstream fin( aPath, std::ios::binary );
+		if( !fin )
+			throw lut::Error( "Unable to open '%s' for reading", aPath );
+
+		fin.seekg( std::streamoff(aBegin) );
+
+		// The buffer holds whole lines, plus the start of the line that the
+		// previous block ended in. It grows if a single line does not fit.
+		std::vector<char> buffer( std::size_t(std::min<std::uint64_t>( kReadBlockSize, aEnd - aBegin )) + 1 );
+		std::size_t used = 0;
+		std::uint64_t bufferOffset = aBegin;
+
+		while( true )
+		{
+			if( used == buffer.size() )
+				buffer.resize( buffer.size() * 2 );
+
+			auto const want = std::size_t(std::min<std::uint64_t>( buffer.size() - used, aEnd - bufferOffset - used ));
+			fin.read( buffer.data() + used, std::streamsize(want) );
+			if( std::size_t(fin.gcount()) != want )
+				throw lut::Error( "Unable to read '%s': read %zu of %zu bytes", aPath, std::size_t(fin.gcount()), want );
+
+			used += want;
+			bool const last = bufferOffset + used == aEnd;
+
+			std::size_t pos = 0;
+			while( pos < used )
+			{
+				auto const* newline = static_cast<char const*>(std::memchr( buffer.data() + pos, '\n', used - pos ));
+				if( !newline && !last )
+					break;
+
+				auto const end = newline ? std::size_t(newline - buffer.data()) : used;
+				aLineFn( std::string_view( buffer.data() + pos, end - pos ), bufferOffset + pos );
+				pos = end + 1;
+			}
+
+			if( last )
+				return;
+
+			std::memmove( buffer.data(), buffer.data() + pos, used - pos );
+			bufferOffset += pos;
+			used -= pos;
+		}
+	}
+
+	inline bool is_space_( char aChar )
+	{
+		return ' ' == aChar || '\t' == aChar || '\r' == aChar;
+	}
+
+	std::string_view trim_( std::string_view aText )
+	{
+		while( !aText.empty() && is_space_( aText.front() ) )
+			aText.remove_prefix( 1 );
+		while( !aText.empty() && is_space_( aText.back() ) )
+			aText.remove_suffix( 1 );
+		return aText;
+	}
+
+	bool starts_with_token_( std::string_view aLine, char const* aToken )
+	{
+		auto const length = std::strlen( aToken );
+		return aLine.size() > length && 0 == aLine.compare( 0, length, aToken ) && is_space_( aLine[length] );
+	}
+
+	std::size_t parse_floats_( std::string_view aText, std::size_t aMaxCount, float* aOut )
+	{
+		// Same parser as rapidobj, such that values are bit identical.
+		// Additional values (e.g., vertex colors) are ignored.
+		std::size_t count = 0;
+		for( aText = trim_( aText ); !aText.empty() && count < aMaxCount; aText = trim_( aText ) )
+		{
+			auto const [ptr, ec] = fast_float::from_chars( aText.data(), aText.data() + aText.size(), aOut[count] );
+			if( std::errc() != ec )
+				return 0;
+
+			aText.remove_prefix( std::size_t(ptr - aText.data()) );
+			++count;
+		}
+
+		return count;
+	}
+
+	std::size_t count_face_vertices_( std::string_view aText )
+	{
+		std::size_t count = 0;
+		for( std::size_t i = 0; i < aText.size(); ++i )
+		{
+			if( !is_space_( aText[i] ) && (0 == i || is_space_( aText[i-1] )) )
+				++count;
+		}
+
+		return count;
+	}
+
+	std::size_t parse_face_( std::string_view aText, ObjMeshRange const& aCounts, FaceVertex_* aOut )
+	{
+		// Corners are "p", "p/t", "p//n" or "p/t/n". Indices count from one;
+		// negative indices are relative to the current end of the attributes.
+		auto const parse_index_ = [] (std::string_view& aText, std::size_t aCount, std::int64_t& aIndex) {
+			std::int64_t value = 0;
+			auto const [ptr, ec] = std::from_chars( aText.data(), aText.data() + aText.size(), value );
+			if( std::errc() != ec || 0 == value )
+				return false;
+
+			aText.remove_prefix( std::size_t(ptr - aText.data()) );
+			aIndex = value > 0 ? value - 1 : value + std::int64_t(aCount);
+			return true;
+		};
+
+		std::size_t count = 0;
+		for( aText = trim_( aText ); !aText.empty(); aText = trim_( aText ) )
+		{
+			if( count == kMaxFaceVertices )
+				return 0;
+
+			auto& corner = aOut[count++];
+			corner = FaceVertex_{ -1, -1, -1 };
+
+			if( !parse_index_( aText, aCounts.positions, corner.position ) )
+				return 0;
+
+			if( aText.empty() || '/' != aText.front() )
+				continue;
+
+			aText.remove_prefix( 1 );
+			if( !aText.empty() && '/' != aText.front() && !parse_index_( aText, aCounts.texcoords, corner.texcoord ) )
+				return 0;
+
+			if( aText.empty() || '/' != aText.front() )
+				continue;
+
+			aText.remove_prefix( 1 );
+			if( !parse_index_( aText, aCounts.normals, corner.normal ) )
+				return 0;
+		}
+
+		return count < 3 ? 0 : count;
+	}
+}
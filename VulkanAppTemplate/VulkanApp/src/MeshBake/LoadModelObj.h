@@ -1,10 +1,61 @@
 #ifndef LOAD_MODEL_OBJ_HPP_7FB6DF28_3D89_48DD_9FD8_4E53FB04723C
 #define LOAD_MODEL_OBJ_HPP_7FB6DF28_3D89_48DD_9FD8_4E53FB04723C
 
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <cstdint>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
 #include "InputModel.h"
 
 // Load a Wavefront OBJ model
 InputModel load_wavefront_obj( char const* aPath );
 
-#endif // LOAD_MODEL_OBJ_HPP_7FB6DF28_3D89_48DD_9FD8_4E53FB04723C
 
+/* Streaming import of Wavefront OBJ models that are too large to load as a
+ * whole (see scan_wavefront_obj()).
+ */
+struct ObjMeshRange
+{
+	// Byte range of the lines of the mesh's shape
+	std::uint64_t begin, end;
+
+	// Attribute counts and current material at `begin`, for resolving
+	// relative indices and "usemtl" statements
+	std::size_t positions, normals, texcoords;
+	std::int64_t material; // -1 = none
+};
+
+struct ObjStreamModel
+{
+	// Materials and meshes. The meshes have no vertices yet; vertexCount is
+	// the number of triangle soup vertices read_wavefront_obj_mesh() returns.
+	InputModel model;
+	std::vector<ObjMeshRange> ranges; // one per mesh
+
+	// All attributes of the file, as they are indexed by the faces
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texcoords;
+
+	std::unordered_map<std::string,std::size_t> materialIndices;
+};
+
+/* Scan the OBJ file at aPath. This reads the file once, keeping only the
+ * vertex attributes, the materials and the location of each mesh's faces,
+ * but none of the faces. Meshes are the same as (and in the same order as)
+ * those of load_wavefront_obj().
+ */
+ObjStreamModel scan_wavefront_obj( char const* aPath );
+
+/* Read the faces of one mesh of a scanned OBJ file. Returns a model with just
+ * this mesh, whose triangle soup is the same as that of load_wavefront_obj().
+ * The materials are not copied. Safe to call concurrently.
+ */
+InputModel read_wavefront_obj_mesh( ObjStreamModel const&, std::size_t aMeshIndex );
+
+#endif // LOAD_MODEL_OBJ_HPP_7FB6DF28_3D89_48DD_9FD8_4E53FB04723C
@@ -0,0 +1,509 @@
+#include "OptimizeMesh.h"
+
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include <glm/glm.hpp>
+
+namespace
+{
+	// Tweakables (see Forsyth's article for the meaning of these)
+	constexpr std::size_t kForsythCacheSize_ = 32;
+	constexpr std::size_t kForsythMaxValence_ = 32;
+
+	constexpr float kCacheDecayPower_ = 1.5f;
+	constexpr float kLastTriScore_ = 0.75f;
+	constexpr float kValenceBoostScale_ = 2.f;
+	constexpr float kValenceBoostPower_ = 0.5f;
+
+	constexpr std::uint32_t kNoTriangle_ = ~std::uint32_t(0);
+
+	// Precomputed vertex scores
+	struct ForsythScores_
+	{
+		ForsythScores_();
+
+		inline float score( int aCachePosition, std::uint32_t aLiveTriangles ) const;
+
+		float cache[kForsythCacheSize_];
+		float valence[kForsythMaxValence_+1];
+	};
+
+	// Triangles adjacent to each vertex, in one array ("CSR" layout)
+	struct VertexTriangles_
+	{
+		VertexTriangles_( std::vector<std::uint32_t> const&, std::size_t aVertexCount );
+
+		void remove( std::uint32_t aVertex, std::uint32_t aTriangle );
+
+		std::vector<std::uint32_t> offsets;
+		std::vector<std::uint32_t> live;
+		std::vector<std::uint32_t> triangles;
+	};
+
+	// FIFO cache simulation via timestamps. A vertex is in the cache if it
+	// was loaded less than `cacheSize` misses ago.
+	struct FifoCache_
+	{
+		FifoCache_( std::size_t aVertexCount, std::size_t aCacheSize );
+
+		inline unsigned access( std::uint32_t );
+		inline unsigned triangle( std::uint32_t const* );
+		inline void reset();
+
+		std::vector<std::uint32_t> stamps;
+		std::uint32_t now;
+		std::uint32_t size;
+	};
+
+	// optimize_overdraw() helpers
+	std::vector<std::size_t> hard_boundaries_(
+		std::vector<std::uint32_t> const&,
+		std::size_t aVertexCount
+	);
+	std::vector<std::size_t> soft_boundaries_(
+		std::vector<std::uint32_t> const&,
+		std::size_t aVertexCount,
+		std::vector<std::size_t> const& aHardBoundaries,
+		float aThreshold
+	);
+
+	template< typename tType >
+	void permute_( std::vector<tType>&, std::vector<std::uint32_t> const& aNewToOld );
+}
+
+//--    analyze_vertex_cache()          ///{{{2///////////////////////////////
+VertexCacheStats analyze_vertex_cache( std::vector<std::uint32_t> const& aIndices, std::size_t aVertexCount, std::size_t aCacheSize )
+{
+	VertexCacheStats ret{ 0.f, 0.f };
+
+	std::size_t const tris = aIndices.size() / 3;
+	if( 0 == tris || 0 == aVertexCount )
+		return ret;
+
+	FifoCache_ cache( aVertexCount, aCacheSize );
+
+	std::size_t misses = 0;
+	for( std::size_t i = 0; i < tris; ++i )
+		misses += cache.triangle( aIndices.data() + i*3 );
+
+	ret.acmr = float(misses) / float(tris);
+	ret.atvr = float(misses) / float(aVertexCount);
+	return ret;
+}
+
+//--    optimize_vertex_cache()         ///{{{2///////////////////////////////
+void optimize_vertex_cache( IndexedMesh& aMesh )
+{
+	optimize_vertex_cache( aMesh.indices, aMesh.vert.size() );
+}
+
+void optimize_vertex_cache( std::vector<std::uint32_t>& aIndices, std::size_t aVertexCount )
+{
+	std::size_t const verts = aVertexCount;
+	std::size_t const tris = aIndices.size() / 3;
+	if( tris < 2 )
+		return;
+
+	static ForsythScores_ const scores;
+
+	VertexTriangles_ adjacency( aIndices, verts );
+
+	std::vector<float> vertexScore( verts );
+	for( std::size_t v = 0; v < verts; ++v )
+		vertexScore[v] = scores.score( -1, adjacency.live[v] );
+
+	std::vector<float> triangleScore( tris );
+	for( std::size_t t = 0; t < tris; ++t )
+	{
+		auto const* tri = aIndices.data() + t*3;
+		triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+	}
+
+	std::vector<bool> emitted( tris, false );
+
+	std::vector<std::uint32_t> cache, nextCache;
+	cache.reserve( kForsythCacheSize_+3 );
+	nextCache.reserve( kForsythCacheSize_+3 );
+
+	std::vector<std::uint32_t> result;
+	result.reserve( tris*3 );
+
+	auto const first = std::max_element( triangleScore.begin(), triangleScore.end() );
+	std::uint32_t best = std::uint32_t(first - triangleScore.begin());
+
+	std::size_t scanCursor = 0;
+	for( std::size_t n = 0; n < tris; ++n )
+	{
+		// Nothing in the cache has live triangles left: continue with the
+		// next triangle in input order. This keeps the algorithm linear.
+		if( kNoTriangle_ == best )
+		{
+			while( emitted[scanCursor] )
+				++scanCursor;
+
+			best = std::uint32_t(scanCursor);
+		}
+
+		assert( best < tris && !emitted[best] );
+		emitted[best] = true;
+
+		auto const* tri = aIndices.data() + best*3;
+		result.insert( result.end(), tri, tri+3 );
+
+		for( int i = 0; i < 3; ++i )
+			adjacency.remove( tri[i], best );
+
+		// Update LRU cache: the triangle's vertices go to the front
+		nextCache.assign( tri, tri+3 );
+		for( auto const v : cache )
+		{
+			if( v != tri[0] && v != tri[1] && v != tri[2] )
+				nextCache.push_back( v );
+		}
+
+		// Update scores of all vertices that were or are in the cache, and of
+		// their remaining triangles. Track the best candidate on the way.
+		best = kNoTriangle_;
+		float bestScore = std::numeric_limits<float>::lowest();
+
+		for( std::size_t i = 0; i < nextCache.size(); ++i )
+		{
+			auto const v = nextCache[i];
+
+			int const pos = i < kForsythCacheSize_ ? int(i) : -1;
+
+			float const score = scores.score( pos, adjacency.live[v] );
+			float const delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			auto const beg = adjacency.offsets[v];
+			auto const end = beg + adjacency.live[v];
+			for( auto j = beg; j < end; ++j )
+			{
+				auto const t = adjacency.triangles[j];
+				triangleScore[t] += delta;
+
+				if( pos >= 0 && triangleScore[t] > bestScore )
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		if( nextCache.size() > kForsythCacheSize_ )
+			nextCache.resize( kForsythCacheSize_ );
+
+		std::swap( cache, nextCache );
+	}
+
+	aIndices = std::move(result);
+}
+
+//--    optimize_overdraw()             ///{{{2///////////////////////////////
+void optimize_overdraw( IndexedMesh& aMesh, float aThreshold )
+{
+	std::size_t const verts = aMesh.vert.size();
+	std::size_t const tris = aMesh.indices.size() / 3;
+	if( tris < 2 )
+		return;
+
+	auto const hard = hard_boundaries_( aMesh.indices, verts );
+	auto const clusters = soft_boundaries_( aMesh.indices, verts, hard, aThreshold );
+
+	std::size_t const clusterCount = clusters.size();
+	if( clusterCount < 2 )
+		return;
+
+	// Mesh centroid
+	glm::vec3 meshCentroid( 0.f );
+	for( auto const& p : aMesh.vert )
+		meshCentroid += p;
+	meshCentroid /= float(verts);
+
+	// Sort clusters by how much they face "outwards"; clusters on the outside
+	// of the mesh should be drawn first, since they occlude the inside.
+	std::vector<float> sortKey( clusterCount );
+	for( std::size_t c = 0; c < clusterCount; ++c )
+	{
+		std::size_t const beg = clusters[c];
+		std::size_t const end = c+1 < clusterCount ? clusters[c+1] : tris;
+
+		glm::vec3 centroid( 0.f ), normal( 0.f );
+		float area = 0.f;
+
+		for( std::size_t t = beg; t < end; ++t )
+		{
+			auto const& p0 = aMesh.vert[aMesh.indices[t*3+0]];
+			auto const& p1 = aMesh.vert[aMesh.indices[t*3+1]];
+			auto const& p2 = aMesh.vert[aMesh.indices[t*3+2]];
+
+			glm::vec3 const n = glm::cross( p1-p0, p2-p0 );
+			float const a = glm::length( n );
+
+			centroid += (p0+p1+p2) * (a / 3.f);
+			normal += n;
+			area += a;
+		}
+
+		float const normalLength = glm::length( normal );
+		if( area > 0.f && normalLength > 0.f )
+			sortKey[c] = glm::dot( centroid / area - meshCentroid, normal / normalLength );
+		else
+			sortKey[c] = 0.f;
+	}
+
+	std::vector<std::uint32_t> order( clusterCount );
+	std::iota( order.begin(), order.end(), 0u );
+	std::stable_sort( order.begin(), order.end(), [&] (std::uint32_t aA, std::uint32_t aB) {
+		return sortKey[aA] > sortKey[aB];
+	} );
+
+	std::vector<std::uint32_t> result;
+	result.reserve( aMesh.indices.size() );
+
+	for( auto const c : order )
+	{
+		std::size_t const beg = clusters[c];
+		std::size_t const end = c+1 < clusterCount ? clusters[c+1] : tris;
+
+		result.insert( result.end(), aMesh.indices.begin() + beg*3, aMesh.indices.begin() + end*3 );
+	}
+
+	assert( result.size() == aMesh.indices.size() );
+	aMesh.indices = std::move(result);
+}
+
+//--    optimize_vertex_fetch()         ///{{{2///////////////////////////////
+void optimize_vertex_fetch( IndexedMesh& aMesh )
+{
+	std::size_t const verts = aMesh.vert.size();
+
+	constexpr std::uint32_t kUnused = ~std::uint32_t(0);
+	std::vector<std::uint32_t> oldToNew( verts, kUnused );
+	std::vector<std::uint32_t> newToOld;
+	newToOld.reserve( verts );
+
+	for( auto& index : aMesh.indices )
+	{
+		assert( index < verts );
+		if( kUnused == oldToNew[index] )
+		{
+			oldToNew[index] = std::uint32_t(newToOld.size());
+			newToOld.push_back( index );
+		}
+
+		index = oldToNew[index];
+	}
+
+	// Keep unreferenced vertices (if any) at the end
+	for( std::size_t v = 0; v < verts; ++v )
+	{
+		if( kUnused == oldToNew[v] )
+			newToOld.push_back( std::uint32_t(v) );
+	}
+
+	permute_( aMesh.vert, newToOld );
+	permute_( aMesh.norm, newToOld );
+	permute_( aMesh.text, newToOld );
+	permute_( aMesh.tangent, newToOld );
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	ForsythScores_::ForsythScores_()
+	{
+		for( std::size_t i = 0; i < kForsythCacheSize_; ++i )
+		{
+			// The most recent triangle's vertices get a fixed score, so that
+			// the next triangle does not just use the newest edge.
+			if( i < 3 )
+				cache[i] = kLastTriScore_;
+			else
+			{
+				float const s = 1.f - float(i-3) / float(kForsythCacheSize_-3);
+				cache[i] = std::pow( s, kCacheDecayPower_ );
+			}
+		}
+
+		valence[0] = 0.f;
+		for( std::size_t i = 1; i <= kForsythMaxValence_; ++i )
+			valence[i] = kValenceBoostScale_ * std::pow( float(i), -kValenceBoostPower_ );
+	}
+
+	inline
+	float ForsythScores_::score( int aCachePosition, std::uint32_t aLiveTriangles ) const
+	{
+		if( 0 == aLiveTriangles )
+			return -1.f;
+
+		float ret = valence[std::min<std::size_t>( aLiveTriangles, kForsythMaxValence_ )];
+		if( aCachePosition >= 0 )
+			ret += cache[aCachePosition];
+
+		return ret;
+	}
+}
+
+namespace
+{
+	VertexTriangles_::VertexTriangles_( std::vector<std::uint32_t> const& aIndices, std::size_t aVertexCount )
+		: offsets( aVertexCount+1, 0 )
+		, live( aVertexCount, 0 )
+		, triangles( aIndices.size() )
+	{
+		for( auto const index : aIndices )
+			++live[index];
+
+		for( std::size_t v = 0; v < aVertexCount; ++v )
+			offsets[v+1] = offsets[v] + live[v];
+
+		std::vector<std::uint32_t> fill( offsets.begin(), offsets.end()-1 );
+		for( std::size_t i = 0; i < aIndices.size(); ++i )
+			triangles[fill[aIndices[i]]++] = std::uint32_t(i / 3);
+	}
+
+	void VertexTriangles_::remove( std::uint32_t aVertex, std::uint32_t aTriangle )
+	{
+		auto const beg = triangles.begin() + offsets[aVertex];
+		auto const end = beg + live[aVertex];
+
+		// Degenerate triangles reference a vertex more than once, in which
+		// case the triangle was already removed.
+		auto const it = std::find( beg, end, aTriangle );
+		if( it == end )
+			return;
+
+		std::iter_swap( it, end-1 );
+		--live[aVertex];
+	}
+}
+
+namespace
+{
+	FifoCache_::FifoCache_( std::size_t aVertexCount, std::size_t aCacheSize )
+		: stamps( aVertexCount, 0 )
+		, now( std::uint32_t(aCacheSize+1) )
+		, size( std::uint32_t(aCacheSize) )
+	{}
+
+	inline
+	unsigned FifoCache_::access( std::uint32_t aVertex )
+	{
+		if( now - stamps[aVertex] > size )
+		{
+			stamps[aVertex] = now++;
+			return 1;
+		}
+
+		return 0;
+	}
+
+	inline
+	unsigned FifoCache_::triangle( std::uint32_t const* aTri )
+	{
+		return access( aTri[0] ) + access( aTri[1] ) + access( aTri[2] );
+	}
+
+	inline
+	void FifoCache_::reset()
+	{
+		// Everything currently in the cache is now too old
+		now += size+1;
+	}
+}
+
+namespace
+{
+	std::vector<std::size_t> hard_boundaries_( std::vector<std::uint32_t> const& aIndices, std::size_t aVertexCount )
+	{
+		FifoCache_ cache( aVertexCount, kVertexCacheAnalysisSize );
+
+		std::vector<std::size_t> ret;
+
+		std::size_t const tris = aIndices.size() / 3;
+		for( std::size_t t = 0; t < tris; ++t )
+		{
+			// Three misses in a row usually means that a new, disjoint patch
+			// of the mesh starts here
+			if( 3 == cache.triangle( aIndices.data() + t*3 ) || 0 == t )
+				ret.push_back( t );
+		}
+
+		return ret;
+	}
+
+	std::vector<std::size_t> soft_boundaries_( std::vector<std::uint32_t> const& aIndices, std::size_t aVertexCount, std::vector<std::size_t> const& aHardBoundaries, float aThreshold )
+	{
+		FifoCache_ cache( aVertexCount, kVertexCacheAnalysisSize );
+
+		std::vector<std::size_t> ret;
+
+		std::size_t const tris = aIndices.size() / 3;
+		for( std::size_t h = 0; h < aHardBoundaries.size(); ++h )
+		{
+			std::size_t const beg = aHardBoundaries[h];
+			std::size_t const end = h+1 < aHardBoundaries.size() ? aHardBoundaries[h+1] : tris;
+			assert( beg < end );
+
+			// ACMR of the whole hard cluster
+			cache.reset();
+
+			std::size_t misses = 0;
+			for( std::size_t t = beg; t < end; ++t )
+				misses += cache.triangle( aIndices.data() + t*3 );
+
+			float const target = aThreshold * float(misses) / float(end-beg);
+
+			// Split as soon as the running ACMR reaches the target; each split
+			// flushes the (simulated) cache.
+			ret.push_back( beg );
+			cache.reset();
+
+			std::size_t runningMisses = 0, runningTris = 0;
+			for( std::size_t t = beg; t < end; ++t )
+			{
+				runningMisses += cache.triangle( aIndices.data() + t*3 );
+				++runningTris;
+
+				if( float(runningMisses) <= target * float(runningTris) && t+1 < end )
+				{
+					ret.push_back( t+1 );
+					cache.reset();
+
+					runningMisses = 0;
+					runningTris = 0;
+				}
+			}
+		}
+
+		return ret;
+	}
+}
+
+namespace
+{
+	template< typename tType >
+	void permute_( std::vector<tType>& aData, std::vector<std::uint32_t> const& aNewToOld )
+	{
+		if( aData.empty() )
+			return;
+
+		assert( aData.size() == aNewToOld.size() );
+
+		std::vector<tType> result( aData.size() );
+		for( std::size_t i = 0; i < aNewToOld.size(); ++i )
+			result[i] = aData[aNewToOld[i]];
+
+		aData = std::move(result);
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,61 @@
+#ifndef OPTIMIZE_MESH_HPP_5B0E7C31_94A2_4D8F_A6E3_1F2C7B9D4E60
+#define OPTIMIZE_MESH_HPP_5B0E7C31_94A2_4D8F_A6E3_1F2C7B9D4E60
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "IndexMesh.h"
+
+//--    types                                   ///{{{1///////////////////////
+struct VertexCacheStats
+{
+	// Average cache miss ratio: transformed vertices per triangle. 0.5 is the
+	// (unreachable) ideal for a large regular grid, 3 means no reuse at all.
+	float acmr;
+	// Average transform to vertex ratio: transformed vertices per unique
+	// vertex. 1 is ideal.
+	float atvr;
+};
+
+//--    constants                               ///{{{1///////////////////////
+
+// Size of the FIFO cache simulated by analyze_vertex_cache(). Actual GPUs do
+// not have a simple FIFO post-transform cache anymore, but the numbers are
+// still a good proxy for the amount of vertex shader work.
+constexpr std::size_t kVertexCacheAnalysisSize = 16;
+
+//--    functions                               ///{{{1///////////////////////
+
+VertexCacheStats analyze_vertex_cache(
+	std::vector<std::uint32_t> const& aIndices,
+	std::size_t aVertexCount,
+	std::size_t aCacheSize = kVertexCacheAnalysisSize
+);
+
+/* Reorder triangles for post-transform vertex cache locality. This uses Tom
+ * Forsyth's "Linear-Speed Vertex Cache Optimisation" with a 32-entry LRU
+ * cache model.
+ */
+void optimize_vertex_cache( IndexedMesh& );
+void optimize_vertex_cache( std::vector<std::uint32_t>& aIndices, std::size_t aVertexCount );
+
+/* Reorder clusters of triangles such that outward facing clusters are drawn
+ * first, which reduces overdraw (Sander et al., "Fast Triangle Reordering for
+ * Vertex Locality and Reduced Overdraw"). Clusters are split where they can be
+ * without increasing the ACMR by more than `aThreshold` (relative), so this
+ * should run after optimize_vertex_cache().
+ */
+void optimize_overdraw( IndexedMesh&, float aThreshold = 1.05f );
+
+/* Reorder vertices in the order in which they are first referenced by the
+ * index buffer. All per-vertex arrays (including tangents, if present) are
+ * permuted; the indices are updated accordingly. Should run last.
+ */
+void optimize_vertex_fetch( IndexedMesh& );
+
+#endif // OPTIMIZE_MESH_HPP_5B0E7C31_94A2_4D8F_A6E3_1F2C7B9D4E60
@@ -0,0 +1,237 @@
+#include "PackModel.h"
+
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+#include <cstring>
+
+#include "WorkPool.h"
+
+#include "../BlockCodec.h"
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	using Clock_ = std::chrono::steady_clock;
+
+	constexpr char kFileVariantAligned_[16] = "aligned-cw3";
+	constexpr char kFileVariantPacked_[16] = "packed-cw3";
+
+	// See BakedModel.h
+	struct SectionEntry_
+	{
+		char tag[4];
+		std::uint32_t reserved;
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+	struct PackedHeader_
+	{
+		std::uint64_t imageSize;
+		std::uint32_t blockCount;
+		std::uint32_t reserved;
+	};
+
+	struct PackedBlock_
+	{
+		std::uint64_t imageOffset;
+		std::uint64_t dataOffset;
+		std::uint32_t rawSize;
+		std::uint32_t dataSize;
+		std::uint32_t checksum;
+		std::uint8_t filter;
+		std::uint8_t codec;
+		std::uint16_t reserved;
+	};
+
+	static_assert( sizeof(SectionEntry_) == 24 );
+	static_assert( sizeof(PackedHeader_) == 16 );
+	static_assert( sizeof(PackedBlock_) == 32 );
+
+	constexpr BlockFilter kFilters_[] = {
+		BlockFilter::none,
+		BlockFilter::bytes2,
+		BlockFilter::bytes4,
+		BlockFilter::delta16,
+		BlockFilter::delta32
+	};
+
+	// Start offsets of the parts of the image that blocks must not straddle:
+	// the header, and each section (with the padding after it).
+	std::vector<std::uint64_t> find_regions_( std::vector<std::byte> const& aImage );
+}
+
+//--    pack_aligned_model()            ///{{{2///////////////////////////////
+std::vector<std::byte> pack_aligned_model( std::vector<std::byte> const& aImage, PackStats& aStats, std::size_t aBlockSize, std::size_t aThreadCount )
+{
+	if( 0 == aBlockSize || 0 != aBlockSize % 16 || aBlockSize > kMaxBlockSize )
+		throw lut::Error( "pack_aligned_model(): invalid block size %zu", aBlockSize );
+
+	auto const start = Clock_::now();
+
+	// Split regions into blocks
+	auto const regions = find_regions_( aImage );
+
+	std::vector<PackedBlock_> blocks;
+	for( std::size_t i = 0; i < regions.size(); ++i )
+	{
+		std::uint64_t const end = i+1 < regions.size() ? regions[i+1] : aImage.size();
+		for( std::uint64_t offset = regions[i]; offset < end; offset += aBlockSize )
+		{
+			PackedBlock_ block{};
+			block.imageOffset = offset;
+			block.rawSize = std::uint32_t(std::min<std::uint64_t>( aBlockSize, end - offset ));
+			blocks.emplace_back( block );
+		}
+	}
+
+	if( blocks.size() > std::numeric_limits<std::uint32_t>::max() )
+		throw lut::Error( "pack_aligned_model(): too many blocks (%zu)", blocks.size() );
+
+	// Compress. Rather than guessing the filter from the section's contents
+	// (e.g., delta coding for indices), try each one and keep the smallest
+	// result; the first filter wins ties.
+	std::vector<EncodedBlock> encoded( blocks.size() );
+	std::vector<std::uint64_t> costs( blocks.size() );
+	for( std::size_t i = 0; i < blocks.size(); ++i )
+		costs[i] = blocks[i].rawSize;
+
+	run_tasks( blocks.size(), [&] (std::size_t aBlock) {
+		auto& block = blocks[aBlock];
+		auto const* raw = aImage.data() + block.imageOffset;
+
+		for( auto const filter : kFilters_ )
+		{
+			auto candidate = encodeBlock( filter, raw, block.rawSize );
+			if( encoded[aBlock].data.empty() || candidate.data.size() < encoded[aBlock].data.size() )
+				encoded[aBlock] = std::move(candidate);
+		}
+
+		block.dataSize = std::uint32_t(encoded[aBlock].data.size());
+		block.checksum = blockChecksum( raw, block.rawSize );
+		block.filter = std::uint8_t(encoded[aBlock].filter);
+		block.codec = std::uint8_t(encoded[aBlock].codec);
+	}, aThreadCount, &costs );
+
+	// Assemble file
+	PackedHeader_ header{};
+	header.imageSize = aImage.size();
+	header.blockCount = std::uint32_t(blocks.size());
+
+	std::uint64_t offset = 32 + sizeof(PackedHeader_) + blocks.size()*sizeof(PackedBlock_);
+	for( auto& block : blocks )
+	{
+		block.dataOffset = offset;
+		offset += block.dataSize;
+	}
+
+	std::vector<std::byte> ret;
+	ret.reserve( std::size_t(offset) );
+
+	auto const append_ = [&ret] (void const* aData, std::size_t aBytes) {
+		auto const* bytes = static_cast<std::byte const*>(aData);
+		ret.insert( ret.end(), bytes, bytes + aBytes );
+	};
+
+	append_( aImage.data(), 16 ); // magic
+	append_( kFileVariantPacked_, 16 );
+	append_( &header, sizeof(PackedHeader_) );
+	append_( blocks.data(), blocks.size()*sizeof(PackedBlock_) );
+
+	for( auto const& block : encoded )
+		append_( block.data.data(), block.data.size() );
+
+	aStats.imageBytes = aImage.size();
+	aStats.packedBytes = ret.size();
+	aStats.blockCount = blocks.size();
+
+	for( auto const& block : blocks )
+	{
+		if( BlockCodec::stored == BlockCodec(block.codec) )
+			++aStats.storedBlocks;
+		else
+			++aStats.filterBlocks[block.filter];
+	}
+
+	aStats.packMs = std::chrono::duration<double,std::milli>( Clock_::now() - start ).count();
+
+	return ret;
+}
+
+//--    verify_packed_model()           ///{{{2///////////////////////////////
+double verify_packed_model( std::vector<std::byte> const& aPacked, std::vector<std::byte> const& aImage, std::size_t aThreadCount, std::size_t aRepeats )
+{
+	PackedHeader_ header;
+	std::memcpy( &header, aPacked.data() + 32, sizeof(PackedHeader_) );
+
+	if( header.imageSize != aImage.size() )
+		throw lut::Error( "verify_packed_model(): image size is %llu, expected %zu", (unsigned long long)header.imageSize, aImage.size() );
+
+	std::vector<PackedBlock_> blocks( header.blockCount );
+	std::memcpy( blocks.data(), aPacked.data() + 32 + sizeof(PackedHeader_), blocks.size()*sizeof(PackedBlock_) );
+
+	std::vector<std::byte> image( aImage.size() );
+
+	double best = std::numeric_limits<double>::infinity();
+	for( std::size_t repeat = 0; repeat < std::max<std::size_t>( aRepeats, 1 ); ++repeat )
+	{
+		auto const start = Clock_::now();
+
+		run_tasks( blocks.size(), [&] (std::size_t aBlock) {
+			auto const& block = blocks[aBlock];
+			auto* const dest = image.data() + block.imageOffset;
+
+			thread_local std::vector<std::byte> scratch;
+			if( !decodeBlock( BlockFilter(block.filter), BlockCodec(block.codec), aPacked.data() + block.dataOffset, block.dataSize, dest, block.rawSize, scratch ) || blockChecksum( dest, block.rawSize ) != block.checksum )
+				throw lut::Error( "verify_packed_model(): block %zu does not decode", aBlock );
+		}, aThreadCount );
+
+		best = std::min( best, std::chrono::duration<double,std::milli>( Clock_::now() - start ).count() );
+	}
+
+	if( image != aImage )
+		throw lut::Error( "verify_packed_model(): decoded image differs from the original" );
+
+	return best;
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	std::vector<std::uint64_t> find_regions_( std::vector<std::byte> const& aImage )
+	{
+		if( aImage.size() < 40 || 0 != std::memcmp( aImage.data() + 16, kFileVariantAligned_, 16 ) )
+			throw lut::Error( "pack_aligned_model(): input is not an '%s' file", kFileVariantAligned_ );
+
+		std::uint32_t sectionCount;
+		std::memcpy( &sectionCount, aImage.data() + 32, sizeof(std::uint32_t) );
+
+		if( 40 + std::uint64_t(sectionCount)*sizeof(SectionEntry_) > aImage.size() )
+			throw lut::Error( "pack_aligned_model(): truncated section table" );
+
+		std::vector<SectionEntry_> sections( sectionCount );
+		std::memcpy( sections.data(), aImage.data() + 40, sections.size()*sizeof(SectionEntry_) );
+
+		std::sort( sections.begin(), sections.end(), [] (SectionEntry_ const& aA, SectionEntry_ const& aB) {
+			return aA.offset < aB.offset;
+		} );
+
+		std::vector<std::uint64_t> ret{ 0 };
+		for( auto const& section : sections )
+		{
+			if( section.offset > aImage.size() )
+				throw lut::Error( "pack_aligned_model(): section '%.4s' at offset %llu is out of bounds", section.tag, (unsigned long long)section.offset );
+
+			if( section.offset != ret.back() )
+				ret.push_back( section.offset );
+		}
+
+		return ret;
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
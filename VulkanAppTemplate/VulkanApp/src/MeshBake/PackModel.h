@@ -0,0 +1,59 @@
+#ifndef PACK_MODEL_HPP_A4C61F0B_8E27_4D93_B5F2_3E7D09A1C6B4
+#define PACK_MODEL_HPP_A4C61F0B_8E27_4D93_B5F2_3E7D09A1C6B4
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+//--    constants                               ///{{{1///////////////////////
+
+// Default (maximum) block size. Smaller blocks decode in parallel better;
+// larger ones compress slightly better.
+constexpr std::size_t kPackBlockSize = 256*1024;
+
+//--    types                                   ///{{{1///////////////////////
+struct PackStats
+{
+	std::size_t imageBytes = 0;
+	std::size_t packedBytes = 0;
+	std::size_t blockCount = 0;
+
+	// Number of compressed blocks per BlockFilter, and of stored blocks
+	std::size_t filterBlocks[5] = {};
+	std::size_t storedBlocks = 0;
+
+	double packMs = 0.0;
+};
+
+//--    functions                               ///{{{1///////////////////////
+
+/* Turn the "aligned-cw3" file `aImage` into a "packed-cw3" file (see
+ * BakedModel.h). Each block is at most `aBlockSize` bytes (a multiple of 16)
+ * and uses the filter that compresses it best. Blocks are compressed on
+ * `aThreadCount` threads (see run_tasks()); the result does not depend on
+ * the number of threads.
+ */
+std::vector<std::byte> pack_aligned_model(
+	std::vector<std::byte> const& aImage,
+	PackStats& aStats,
+	std::size_t aBlockSize = kPackBlockSize,
+	std::size_t aThreadCount = 0
+);
+
+/* Decode the packed file `aPacked` on `aThreadCount` threads, the same way
+ * the runtime does, and check that it reproduces `aImage`. Returns the
+ * decoding time in milliseconds (best of `aRepeats` runs). Throws
+ * lut::Error on mismatch.
+ */
+double verify_packed_model(
+	std::vector<std::byte> const& aPacked,
+	std::vector<std::byte> const& aImage,
+	std::size_t aThreadCount = 0,
+	std::size_t aRepeats = 3
+);
+
+#endif // PACK_MODEL_HPP_A4C61F0B_8E27_4D93_B5F2_3E7D09A1C6B4
@@ -0,0 +1,522 @@
+#include "SimplifyMesh.h"
+
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include <glm/glm.hpp>
+
+#include "OptimizeMesh.h"
+
+namespace
+{
+	// Tweakables
+	// Weight of attribute differences (normals, texture coordinates), relative
+	// to the squared extent of the mesh.
+	constexpr float kAttributeWeight_ = 0.01f;
+	// Weight of the planes that keep open borders in place.
+	constexpr double kBorderWeight_ = 10.0;
+	// Collapses may not rotate a triangle's normal by more than ~75 degrees.
+	constexpr float kMinNormalDot_ = 0.25f;
+	// A LOD level that removes less than this fraction of triangles ends the
+	// LOD chain.
+	constexpr float kMinLevelReduction_ = 0.1f;
+
+	// Quadric error metric: sum of weighted squared distances to planes
+	struct Quadric_
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double w;
+
+		void add_plane( glm::dvec3 const& aN, double aD, double aWeight );
+		Quadric_& operator+= ( Quadric_ const& );
+
+		double eval( glm::vec3 const& ) const;
+	};
+
+	enum class VertexKind_ : std::uint8_t
+	{
+		manifold,  // may collapse into any neighbour
+		border,    // on an open border; may only collapse along the border
+		locked     // on a seam or non-manifold; never moves
+	};
+
+	struct Collapse_
+	{
+		std::uint32_t from, to;
+		float cost;          // including attributes
+		float positionCost;  // squared distance
+	};
+
+	using EdgeKey_ = std::uint64_t;
+	inline EdgeKey_ edge_key_( std::uint32_t aA, std::uint32_t aB )
+	{
+		return (EdgeKey_(aA) << 32) | aB;
+	}
+
+	inline bool degenerate_( std::uint32_t aA, std::uint32_t aB, std::uint32_t aC )
+	{
+		return aA == aB || aB == aC || aA == aC;
+	}
+
+	float squared_extent_( IndexedMesh const& );
+
+	std::vector<VertexKind_> classify_vertices_(
+		IndexedMesh const&,
+		std::vector<std::uint32_t> const& aIndices,
+		std::vector<EdgeKey_>& aBorderEdges
+	);
+
+	std::vector<Quadric_> compute_quadrics_(
+		IndexedMesh const&,
+		std::vector<std::uint32_t> const& aIndices,
+		std::vector<EdgeKey_> const& aBorderEdges
+	);
+
+	bool flips_(
+		IndexedMesh const&,
+		std::vector<std::uint32_t> const& aIndices,
+		std::vector<std::uint32_t> const& aRemap,
+		std::vector<std::uint32_t> const& aAdjacencyOffsets,
+		std::vector<std::uint32_t> const& aAdjacency,
+		std::uint32_t aFrom, std::uint32_t aTo
+	);
+}
+
+//--    simplify_mesh()                 ///{{{2///////////////////////////////
+std::vector<std::uint32_t> simplify_mesh( IndexedMesh const& aMesh, std::vector<std::uint32_t> const& aIndices, std::size_t aTargetIndexCount, float aMaxError, float& aResultError )
+{
+	std::size_t const verts = aMesh.vert.size();
+
+	aResultError = 0.f;
+
+	std::vector<std::uint32_t> indices;
+	indices.reserve( aIndices.size() );
+	for( std::size_t i = 0; i+2 < aIndices.size(); i += 3 )
+	{
+		if( !degenerate_( aIndices[i+0], aIndices[i+1], aIndices[i+2] ) )
+			indices.insert( indices.end(), aIndices.begin()+i, aIndices.begin()+i+3 );
+	}
+
+	if( indices.size() <= aTargetIndexCount )
+		return indices;
+
+	std::vector<EdgeKey_> borderEdges;
+	auto const kinds = classify_vertices_( aMesh, indices, borderEdges );
+	auto quadrics = compute_quadrics_( aMesh, indices, borderEdges );
+
+	auto const is_border_edge_ = [&] (std::uint32_t aA, std::uint32_t aB) {
+		return std::binary_search( borderEdges.begin(), borderEdges.end(), edge_key_( aA, aB ) )
+			|| std::binary_search( borderEdges.begin(), borderEdges.end(), edge_key_( aB, aA ) );
+	};
+
+	float const attributeScale = kAttributeWeight_ * squared_extent_( aMesh );
+	float const maxCost = aMaxError * aMaxError;
+
+	auto const evaluate_ = [&] (std::uint32_t aFrom, std::uint32_t aTo, Collapse_& aOut) {
+		if( VertexKind_::locked == kinds[aFrom] )
+			return false;
+		if( VertexKind_::border == kinds[aFrom] && (VertexKind_::manifold == kinds[aTo] || !is_border_edge_( aFrom, aTo )) )
+			return false;
+
+		Quadric_ q = quadrics[aFrom];
+		q += quadrics[aTo];
+
+		double const position = std::max( 0.0, q.eval( aMesh.vert[aTo] ) / std::max( q.w, 1e-30 ) );
+
+		glm::vec3 const dn = aMesh.norm[aFrom] - aMesh.norm[aTo];
+		glm::vec2 const dt = aMesh.text[aFrom] - aMesh.text[aTo];
+		float const attributes = attributeScale * (glm::dot( dn, dn ) + glm::dot( dt, dt ));
+
+		aOut = Collapse_{ aFrom, aTo, float(position) + attributes, float(position) };
+		return aOut.cost <= maxCost;
+	};
+
+	std::vector<std::uint32_t> remap( verts );
+	std::iota( remap.begin(), remap.end(), 0u );
+
+	std::vector<std::uint32_t> adjacencyOffsets, adjacency;
+	std::vector<EdgeKey_> edges;
+	std::vector<Collapse_> collapses;
+	std::vector<std::uint8_t> touched( verts );
+
+	float maxPositionCost = 0.f;
+
+	// Each pass collapses a set of independent edges (no vertex is involved in
+	// more than one collapse), cheapest first.
+	while( indices.size() > aTargetIndexCount )
+	{
+		std::size_t const tris = indices.size() / 3;
+
+		// Vertex -> triangles
+		adjacencyOffsets.assign( verts+1, 0 );
+		for( auto const index : indices )
+			++adjacencyOffsets[index+1];
+		std::partial_sum( adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin() );
+
+		adjacency.resize( indices.size() );
+		{
+			std::vector<std::uint32_t> fill( adjacencyOffsets.begin(), adjacencyOffsets.end()-1 );
+			for( std::size_t i = 0; i < indices.size(); ++i )
+				adjacency[fill[indices[i]]++] = std::uint32_t(i / 3);
+		}
+
+		// Unique (undirected) edges
+		edges.clear();
+		for( std::size_t t = 0; t < tris; ++t )
+		{
+			for( int e = 0; e < 3; ++e )
+			{
+				auto const a = indices[t*3+e];
+				auto const b = indices[t*3+(e+1)%3];
+				edges.push_back( edge_key_( std::min( a, b ), std::max( a, b ) ) );
+			}
+		}
+
+		std::sort( edges.begin(), edges.end() );
+		edges.erase( std::unique( edges.begin(), edges.end() ), edges.end() );
+
+		// Rank collapses
+		collapses.clear();
+		for( auto const edge : edges )
+		{
+			auto const a = std::uint32_t(edge >> 32);
+			auto const b = std::uint32_t(edge & 0xffffffffu);
+
+			Collapse_ ab, ba;
+			bool const okAB = evaluate_( a, b, ab );
+			bool const okBA = evaluate_( b, a, ba );
+
+			if( okAB && (!okBA || ab.cost <= ba.cost) )
+				collapses.emplace_back( ab );
+			else if( okBA )
+				collapses.emplace_back( ba );
+		}
+
+		if( collapses.empty() )
+			break;
+
+		std::stable_sort( collapses.begin(), collapses.end(), [] (Collapse_ const& aA, Collapse_ const& aB) {
+			return aA.cost < aB.cost;
+		} );
+
+		// Perform collapses
+		std::size_t const toRemove = tris - aTargetIndexCount/3;
+		std::size_t removed = 0, performed = 0;
+
+		std::fill( touched.begin(), touched.end(), std::uint8_t(0) );
+
+		for( auto const& collapse : collapses )
+		{
+			if( removed >= toRemove )
+				break;
+
+			if( touched[collapse.from] || touched[collapse.to] )
+				continue;
+
+			if( flips_( aMesh, indices, remap, adjacencyOffsets, adjacency, collapse.from, collapse.to ) )
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+
+			touched[collapse.from] = 1;
+			touched[collapse.to] = 1;
+
+			maxPositionCost = std::max( maxPositionCost, collapse.positionCost );
+
+			// An interior edge is shared by two triangles, a border edge by one
+			removed += VertexKind_::border == kinds[collapse.from] ? 1 : 2;
+			++performed;
+		}
+
+		if( 0 == performed )
+			break;
+
+		// Apply remap and drop the collapsed triangles
+		std::size_t out = 0;
+		for( std::size_t t = 0; t < tris; ++t )
+		{
+			auto const a = remap[indices[t*3+0]];
+			auto const b = remap[indices[t*3+1]];
+			auto const c = remap[indices[t*3+2]];
+
+			if( degenerate_( a, b, c ) )
+				continue;
+
+			indices[out++] = a;
+			indices[out++] = b;
+			indices[out++] = c;
+		}
+
+		indices.resize( out );
+	}
+
+	aResultError = std::sqrt( maxPositionCost );
+	return indices;
+}
+
+//--    build_lod_chain()               ///{{{2///////////////////////////////
+std::vector<MeshLod> build_lod_chain( IndexedMesh const& aMesh, std::size_t aMaxLevels, float aRatio, float aMaxRelativeError )
+{
+	std::vector<MeshLod> ret;
+
+	float const maxError = aMaxRelativeError * std::sqrt( squared_extent_( aMesh ) );
+
+	std::vector<std::uint32_t> const* current = &aMesh.indices;
+	float currentError = 0.f;
+
+	for( std::size_t level = 0; level < aMaxLevels; ++level )
+	{
+		std::size_t const currentTris = current->size() / 3;
+		std::size_t const targetTris = std::size_t(float(currentTris) * aRatio);
+		if( 0 == targetTris )
+			break;
+
+		// The error of each simplification is relative to the previous
+		// level; summing them bounds the error relative to the full mesh.
+		// Each level may thus only use what the previous ones left of the
+		// budget.
+		float const remainingError = maxError - currentError;
+		if( remainingError <= 0.f )
+			break;
+
+		float error = 0.f;
+		auto indices = simplify_mesh( aMesh, *current, targetTris*3, remainingError, error );
+
+		// Stalled; there is no point in storing (nearly) the same triangles
+		// again.
+		std::size_t const tris = indices.size() / 3;
+		if( 0 == tris || float(tris) > float(currentTris) * (1.f - kMinLevelReduction_) )
+			break;
+
+		optimize_vertex_cache( indices, aMesh.vert.size() );
+
+		// simplify_mesh() keeps `error` within `remainingError`; the clamp
+		// only absorbs rounding.
+		currentError = std::min( currentError + error, maxError );
+
+		ret.emplace_back( MeshLod{ std::move(indices), currentError } );
+		current = &ret.back().indices;
+	}
+
+	assert( ret.empty() || ret.back().error <= maxError );
+	return ret;
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	void Quadric_::add_plane( glm::dvec3 const& aN, double aD, double aWeight )
+	{
+		a00 += aWeight * aN.x * aN.x;
+		a01 += aWeight * aN.x * aN.y;
+		a02 += aWeight * aN.x * aN.z;
+		a11 += aWeight * aN.y * aN.y;
+		a12 += aWeight * aN.y * aN.z;
+		a22 += aWeight * aN.z * aN.z;
+
+		b0 += aWeight * aN.x * aD;
+		b1 += aWeight * aN.y * aD;
+		b2 += aWeight * aN.z * aD;
+
+		c += aWeight * aD * aD;
+		w += aWeight;
+	}
+
+	Quadric_& Quadric_::operator+= ( Quadric_ const& aOther )
+	{
+		a00 += aOther.a00; a01 += aOther.a01; a02 += aOther.a02;
+		a11 += aOther.a11; a12 += aOther.a12; a22 += aOther.a22;
+		b0 += aOther.b0; b1 += aOther.b1; b2 += aOther.b2;
+		c += aOther.c;
+		w += aOther.w;
+		return *this;
+	}
+
+	double Quadric_::eval( glm::vec3 const& aP ) const
+	{
+		double const x = aP.x, y = aP.y, z = aP.z;
+
+		return a00*x*x + 2.0*a01*x*y + 2.0*a02*x*z
+			+ a11*y*y + 2.0*a12*y*z
+			+ a22*z*z
+			+ 2.0*(b0*x + b1*y + b2*z)
+			+ c
+		;
+	}
+}
+
+namespace
+{
+	float squared_extent_( IndexedMesh const& aMesh )
+	{
+		glm::vec3 bmin( std::numeric_limits<float>::max() );
+		glm::vec3 bmax( std::numeric_limits<float>::lowest() );
+		for( auto const& p : aMesh.vert )
+		{
+			bmin = glm::min( bmin, p );
+			bmax = glm::max( bmax, p );
+		}
+
+		if( aMesh.vert.empty() )
+			return 0.f;
+
+		glm::vec3 const d = bmax - bmin;
+		return glm::dot( d, d );
+	}
+
+	std::vector<VertexKind_> classify_vertices_( IndexedMesh const& aMesh, std::vector<std::uint32_t> const& aIndices, std::vector<EdgeKey_>& aBorderEdges )
+	{
+		std::size_t const verts = aMesh.vert.size();
+		std::vector<VertexKind_> kinds( verts, VertexKind_::manifold );
+
+		// Directed edges. An edge without its opposite is on a border; an edge
+		// that occurs twice in the same direction is non-manifold.
+		std::vector<EdgeKey_> directed;
+		directed.reserve( aIndices.size() );
+		for( std::size_t i = 0; i < aIndices.size(); i += 3 )
+		{
+			for( int e = 0; e < 3; ++e )
+				directed.push_back( edge_key_( aIndices[i+e], aIndices[i+(e+1)%3] ) );
+		}
+
+		std::sort( directed.begin(), directed.end() );
+
+		aBorderEdges.clear();
+		for( std::size_t i = 0; i < directed.size(); ++i )
+		{
+			auto const a = std::uint32_t(directed[i] >> 32);
+			auto const b = std::uint32_t(directed[i] & 0xffffffffu);
+
+			if( i+1 < directed.size() && directed[i+1] == directed[i] )
+			{
+				kinds[a] = kinds[b] = VertexKind_::locked;
+				continue;
+			}
+
+			if( !std::binary_search( directed.begin(), directed.end(), edge_key_( b, a ) ) )
+			{
+				aBorderEdges.push_back( directed[i] );
+
+				if( VertexKind_::locked != kinds[a] ) kinds[a] = VertexKind_::border;
+				if( VertexKind_::locked != kinds[b] ) kinds[b] = VertexKind_::border;
+			}
+		}
+
+		// Vertices that share their position with another vertex sit on a
+		// seam (normals or texture coordinates differ). Moving only one side
+		// would open a crack.
+		std::vector<std::uint32_t> order( verts );
+		std::iota( order.begin(), order.end(), 0u );
+		std::sort( order.begin(), order.end(), [&] (std::uint32_t aA, std::uint32_t aB) {
+			auto const& pa = aMesh.vert[aA];
+			auto const& pb = aMesh.vert[aB];
+			if( pa.x != pb.x ) return pa.x < pb.x;
+			if( pa.y != pb.y ) return pa.y < pb.y;
+			if( pa.z != pb.z ) return pa.z < pb.z;
+			return aA < aB;
+		} );
+
+		for( std::size_t i = 1; i < verts; ++i )
+		{
+			if( aMesh.vert[order[i]] == aMesh.vert[order[i-1]] )
+				kinds[order[i]] = kinds[order[i-1]] = VertexKind_::locked;
+		}
+
+		return kinds;
+	}
+
+	std::vector<Quadric_> compute_quadrics_( IndexedMesh const& aMesh, std::vector<std::uint32_t> const& aIndices, std::vector<EdgeKey_> const& aBorderEdges )
+	{
+		std::vector<Quadric_> quadrics( aMesh.vert.size(), Quadric_{} );
+
+		for( std::size_t i = 0; i < aIndices.size(); i += 3 )
+		{
+			glm::dvec3 const p0( aMesh.vert[aIndices[i+0]] );
+			glm::dvec3 const p1( aMesh.vert[aIndices[i+1]] );
+			glm::dvec3 const p2( aMesh.vert[aIndices[i+2]] );
+
+			glm::dvec3 n = glm::cross( p1-p0, p2-p0 );
+			double const area = glm::length( n );
+			if( !(area > 0.0) )
+				continue;
+
+			n /= area;
+			double const d = -glm::dot( n, p0 );
+
+			for( int j = 0; j < 3; ++j )
+				quadrics[aIndices[i+j]].add_plane( n, d, area );
+		}
+
+		// Border edges: add a plane through the edge, perpendicular to the
+		// triangle, so that the border does not shrink
+		for( auto const edge : aBorderEdges )
+		{
+			auto const a = std::uint32_t(edge >> 32);
+			auto const b = std::uint32_t(edge & 0xffffffffu);
+
+			// The surface normal along the edge is approximated by the vertex
+			// normals
+			glm::dvec3 const pa( aMesh.vert[a] );
+			glm::dvec3 const pb( aMesh.vert[b] );
+			glm::dvec3 const e = pb - pa;
+
+			glm::dvec3 const n( aMesh.norm[a] + aMesh.norm[b] );
+			glm::dvec3 pn = glm::cross( e, n );
+			double const len = glm::length( pn );
+			if( !(len > 0.0) )
+				continue;
+
+			pn /= len;
+			double const d = -glm::dot( pn, pa );
+			double const weight = kBorderWeight_ * glm::dot( e, e );
+
+			quadrics[a].add_plane( pn, d, weight );
+			quadrics[b].add_plane( pn, d, weight );
+		}
+
+		return quadrics;
+	}
+
+	bool flips_( IndexedMesh const& aMesh, std::vector<std::uint32_t> const& aIndices, std::vector<std::uint32_t> const& aRemap, std::vector<std::uint32_t> const& aAdjacencyOffsets, std::vector<std::uint32_t> const& aAdjacency, std::uint32_t aFrom, std::uint32_t aTo )
+	{
+		for( auto i = aAdjacencyOffsets[aFrom]; i < aAdjacencyOffsets[aFrom+1]; ++i )
+		{
+			auto const t = aAdjacency[i];
+
+			std::uint32_t tri[3];
+			for( int j = 0; j < 3; ++j )
+				tri[j] = aRemap[aIndices[t*3+j]];
+
+			// Triangles containing both vertices disappear
+			if( tri[0] == aTo || tri[1] == aTo || tri[2] == aTo )
+				continue;
+			if( degenerate_( tri[0], tri[1], tri[2] ) )
+				continue;
+
+			glm::vec3 p[3], q[3];
+			for( int j = 0; j < 3; ++j )
+			{
+				p[j] = aMesh.vert[tri[j]];
+				q[j] = aMesh.vert[tri[j] == aFrom ? aTo : tri[j]];
+			}
+
+			glm::vec3 const n0 = glm::cross( p[1]-p[0], p[2]-p[0] );
+			glm::vec3 const n1 = glm::cross( q[1]-q[0], q[2]-q[0] );
+
+			if( glm::dot( n0, n1 ) <= kMinNormalDot_ * glm::length( n0 ) * glm::length( n1 ) )
+				return true;
+		}
+
+		return false;
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
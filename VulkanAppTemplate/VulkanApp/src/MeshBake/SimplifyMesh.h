@@ -0,0 +1,63 @@
+#ifndef SIMPLIFY_MESH_HPP_E2D94B7A_31C8_4F05_8A6D_9B57F0C3A1E8
+#define SIMPLIFY_MESH_HPP_E2D94B7A_31C8_4F05_8A6D_9B57F0C3A1E8
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "IndexMesh.h"
+
+//--    types                                   ///{{{1///////////////////////
+struct MeshLod
+{
+	// Indices into the (unchanged) vertices of the IndexedMesh
+	std::vector<std::uint32_t> indices;
+
+	// Geometric error: upper bound (approximately) of the distance between
+	// this level and the full resolution mesh, in mesh units.
+	float error;
+};
+
+//--    functions                               ///{{{1///////////////////////
+
+/* Simplify the triangles given by `aIndices` (indices into `aMesh`) by
+ * quadric edge collapse (Garland & Heckbert), until at most
+ * `aTargetIndexCount` indices remain or no collapse with an error below
+ * `aMaxError` (in mesh units) is left.
+ *
+ * Vertices are never moved, only merged into neighbours, so the result uses
+ * a subset of the mesh's vertices. The collapse cost includes differences in
+ * normals and texture coordinates. Vertices on texture/normal seams are kept
+ * in place (to avoid cracks), and open borders are only simplified along the
+ * border.
+ *
+ * `aResultError` receives the geometric error of the result.
+ */
+std::vector<std::uint32_t> simplify_mesh(
+	IndexedMesh const&,
+	std::vector<std::uint32_t> const& aIndices,
+	std::size_t aTargetIndexCount,
+	float aMaxError,
+	float& aResultError
+);
+
+/* Build up to `aMaxLevels` levels of detail after the full resolution mesh
+ * (which is not included in the result). Each level aims for `aRatio` times
+ * the triangles of the previous level; the error of any level is at most
+ * `aMaxRelativeError` times the diagonal of the mesh's bounding box. The
+ * chain ends early if the simplification stalls.
+ *
+ * Indices of each level are optimized for the vertex cache.
+ */
+std::vector<MeshLod> build_lod_chain(
+	IndexedMesh const&,
+	std::size_t aMaxLevels,
+	float aRatio = 0.5f,
+	float aMaxRelativeError = 0.02f
+);
+
+#endif // SIMPLIFY_MESH_HPP_E2D94B7A_31C8_4F05_8A6D_9B57F0C3A1E8
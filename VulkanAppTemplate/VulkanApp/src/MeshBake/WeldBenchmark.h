@@ -0,0 +1,24 @@
+#ifndef WELD_BENCHMARK_HPP_4A9E61D2_7C38_4B15_A0F7_E83B52D6C914
+#define WELD_BENCHMARK_HPP_4A9E61D2_7C38_4B15_A0F7_E83B52D6C914
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <cstddef>
+
+//--    functions                               ///{{{1///////////////////////
+
+/* Compare make_indexed_mesh() against the previous vertex welder (an
+ * std::unordered_multimap keyed on hashed grid cells, kept in
+ * WeldBenchmark.cpp for reference) on all meshes of an OBJ file.
+ *
+ * Each welder runs `aRepeats` times per mesh; the best time is reported.
+ * Throws lut::Error if the two produce different results.
+ */
+void benchmark_welding(
+	char const* aInputOBJ,
+	float aErrorTolerance = 1e-5f,
+	std::size_t aRepeats = 3
+);
+
+#endif // WELD_BENCHMARK_HPP_4A9E61D2_7C38_4B15_A0F7_E83B52D6C914
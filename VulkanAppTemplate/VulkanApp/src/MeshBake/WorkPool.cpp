@@ -0,0 +1,138 @@
+#include "WorkPool.h"
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <numeric>
+#include <algorithm>
+#include <exception>
+
+#include <cassert>
+
+namespace
+{
+	// Per-thread task queue. Tasks are coarse (whole meshes), so a plain
+	// mutex is cheap enough.
+	struct TaskQueue_
+	{
+		std::mutex mutex;
+		std::deque<std::size_t> tasks;
+
+		bool pop_front( std::size_t& );
+		bool pop_back( std::size_t& );
+	};
+}
+
+//--    resolve_thread_count()          ///{{{2///////////////////////////////
+std::size_t resolve_thread_count( std::size_t aRequested )
+{
+	if( aRequested )
+		return aRequested;
+
+	auto const hw = std::thread::hardware_concurrency();
+	return hw ? hw : 1;
+}
+
+//--    run_tasks()                     ///{{{2///////////////////////////////
+void run_tasks( std::size_t aTaskCount, std::function<void(std::size_t)> const& aTask, std::size_t aThreadCount, std::vector<std::uint64_t> const* aCosts )
+{
+	assert( !aCosts || aCosts->size() == aTaskCount );
+
+	std::size_t const threads = std::min( resolve_thread_count( aThreadCount ), aTaskCount );
+	if( threads <= 1 )
+	{
+		for( std::size_t i = 0; i < aTaskCount; ++i )
+			aTask( i );
+		return;
+	}
+
+	// Deal tasks round-robin, largest first, so that every queue starts with
+	// a share of the expensive ones.
+	std::vector<std::size_t> order( aTaskCount );
+	std::iota( order.begin(), order.end(), std::size_t(0) );
+	if( aCosts )
+	{
+		std::stable_sort( order.begin(), order.end(), [&] (std::size_t aA, std::size_t aB) {
+			return (*aCosts)[aA] > (*aCosts)[aB];
+		} );
+	}
+
+	std::vector<TaskQueue_> queues( threads );
+	for( std::size_t i = 0; i < order.size(); ++i )
+		queues[i % threads].tasks.push_back( order[i] );
+
+	std::atomic<bool> abort{ false };
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	auto const worker_ = [&] (std::size_t aSelf) {
+		while( !abort.load( std::memory_order_relaxed ) )
+		{
+			std::size_t task;
+
+			bool found = queues[aSelf].pop_front( task );
+			for( std::size_t i = 1; !found && i < threads; ++i )
+				found = queues[(aSelf + i) % threads].pop_back( task );
+
+			// No task is ever added, so empty queues mean we are done
+			if( !found )
+				return;
+
+			try
+			{
+				aTask( task );
+			}
+			catch( ... )
+			{
+				std::lock_guard<std::mutex> lock( errorMutex );
+				if( !error )
+					error = std::current_exception();
+
+				abort = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+	pool.reserve( threads-1 );
+	for( std::size_t i = 1; i < threads; ++i )
+		pool.emplace_back( worker_, i );
+
+	worker_( 0 );
+
+	for( auto& thread : pool )
+		thread.join();
+
+	if( error )
+		std::rethrow_exception( error );
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	bool TaskQueue_::pop_front( std::size_t& aTask )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		if( tasks.empty() )
+			return false;
+
+		aTask = tasks.front();
+		tasks.pop_front();
+		return true;
+	}
+
+	bool TaskQueue_::pop_back( std::size_t& aTask )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		if( tasks.empty() )
+			return false;
+
+		aTask = tasks.back();
+		tasks.pop_back();
+		return true;
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
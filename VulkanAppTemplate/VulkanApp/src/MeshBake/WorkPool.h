@@ -0,0 +1,39 @@
+#ifndef WORK_POOL_HPP_0C7F3E58_B6A1_4D27_9E40_5A8D21F6C9B3
+#define WORK_POOL_HPP_0C7F3E58_B6A1_4D27_9E40_5A8D21F6C9B3
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <vector>
+#include <functional>
+
+#include <cstddef>
+#include <cstdint>
+
+//--    functions                               ///{{{1///////////////////////
+
+// Number of worker threads to use for a requested count; 0 means one per
+// hardware thread.
+std::size_t resolve_thread_count( std::size_t aRequested );
+
+/* Run aTask(i) for each i in [0, aTaskCount) on aThreadCount threads (see
+ * resolve_thread_count()) and wait for all of them.
+ *
+ * Tasks are dealt to per-thread queues, most expensive first if `aCosts` is
+ * given (one entry per task). Each thread works through its own queue from
+ * the front; threads that run out of work steal from the back of the other
+ * queues. Tasks must be independent. The order in which tasks run is not
+ * deterministic, so tasks should write their results to per-task slots.
+ *
+ * If a task throws, the remaining tasks are skipped and the first exception
+ * is rethrown once all threads have stopped. With one thread, tasks run on
+ * the calling thread, in order.
+ */
+void run_tasks(
+	std::size_t aTaskCount,
+	std::function<void(std::size_t)> const& aTask,
+	std::size_t aThreadCount = 0,
+	std::vector<std::uint64_t> const* aCosts = nullptr
+);
+
+#endif // WORK_POOL_HPP_0C7F3E58_B6A1_4D27_9E40_5A8D21F6C9B3
@@ -1,12 +1,24 @@
 #include <iterator>
+#include <chrono>
 #include <vector>
+#include <algorithm>
 #include <typeinfo>
 #include <exception>
 #include <filesystem>
 #include <system_error>
 #include <unordered_map>
+#include <unordered_set>
+#include <condition_variable>
+#include <mutex>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <optional>
 
 #include <cstdio>
+#include <cstdarg>
+#include <cstdlib>
+#include <cassert>
 #include <cstring>
 
 #include <tgen.h>
@@ -15,7 +27,18 @@
 #include "IndexMesh.h"
 #include "InputModel.h"
 #include "LoadModelObj.h"
-
+#include "OptimizeMesh.h"
+#include "BuildMeshlets.h"
+#include "BuildBvh.h"
+#include "BakeAo.h"
+#include "SimplifyMesh.h"
+#include "WorkPool.h"
+#include "PackModel.h"
+#include "BakeCache.h"
+#include "BakeTexture.h"
+#include "WeldBenchmark.h"
+
+#include "../QuantizedVertex.h"
 #include "../labutils/error.hpp"
 namespace lut = labutils;
 
@@ -42,6 +65,28 @@ namespace
 	 */
 	constexpr char kFileVariant[16] = "default-cw3";
 
+	/* Variant with a section table and 16-byte aligned arrays, such that the
+	 * runtime can memory map the file and use the arrays in place. See
+	 * BakedModel.h for the layout.
+	 */
+	constexpr char kFileVariantAligned[16] = "aligned-cw3";
+	constexpr std::uint64_t kAlignment = 16;
+
+	/* Meshes with at most this many vertices get 16-bit indices ("IX16")
+	 */
+	constexpr std::size_t kMaxVertices16 = 65536;
+
+	/* Estimated peak memory use of a bake, per byte of OBJ input. Measured
+	 * (peak RSS) at about 4 for large models.
+	 */
+	constexpr std::uint64_t kMemoryPerInputByte = 4;
+
+	/* Same for a streaming import (BakeOptions_::streaming), which only keeps
+	 * the OBJ's vertex attributes and one batch of meshes in memory.
+	 * Measured at about 1 (mostly the attributes).
+	 */
+	constexpr std::uint64_t kStreamingMemoryPerInputByte = 1;
+
 	/* Fallback texture for RGBA 1111 and Grayscale 1
 	 */
 	constexpr char kTextureFallbackR1[] = "../Assets/Models/NewShip/r1.png";
@@ -55,57 +100,439 @@ namespace
 		std::string newPath;
 	};
 
+	struct BakeOptions_
+	{
+		// Reorder triangles and vertices of the indexed meshes for the
+		// post-transform vertex cache and for vertex fetch. See OptimizeMesh.h.
+		bool optimizeVertexCache = true;
+
+		// Additionally reorder triangle clusters to reduce overdraw (requires
+		// `optimizeVertexCache`).
+		bool optimizeOverdraw = true;
+
+		// Write the "aligned-cw3" variant instead of "default-cw3".
+		bool aligned = true;
+
+		// Additionally write the "VERT"/"INDX" sections (aligned variant only):
+		// all meshes in the runtime's interleaved vertex layout, with indices
+		// into one global vertex buffer.
+		bool interleaved = true;
+
+		// Additionally write the "TANG" section (aligned variant only): per-vertex
+		// tangents with handedness, such that the runtime does not need to
+		// generate them.
+		bool tangents = true;
+
+		// Additionally write the "QVTX" section (requires `interleaved`):
+		// QuantizedVertex versions of the "VERT" vertices, see QuantizedVertex.h.
+		bool quantized = true;
+
+		// Additionally write the "MSHL" section (aligned variant only): meshlets
+		// with bounding spheres and normal cones, see BuildMeshlets.h.
+		bool meshlets = true;
+		std::size_t meshletMaxVertices = kMeshletMaxVertices;
+		std::size_t meshletMaxTriangles = kMeshletMaxTriangles;
+
+		// Additionally write the "LODS" section (requires `interleaved`): up to
+		// `lodLevels` simplified versions of each mesh, each with about
+		// `lodRatio` times the triangles of the previous one. See SimplifyMesh.h.
+		bool lods = true;
+		std::size_t lodLevels = 4;
+		float lodRatio = 0.5f;
+		float lodMaxRelativeError = 0.02f;
+
+		// Additionally write the "IX16" section (aligned variant only):
+		// 16-bit indices, relative to the mesh's first vertex, for all meshes
+		// with at most 65536 vertices.
+		bool indices16 = true;
+
+		// Additionally write the "MTOC" section (aligned variant only): a table
+		// of contents at the front of the file with each mesh's byte range,
+		// bounding box and material, such that meshes can be loaded on demand
+		// (see readBakedModelToc() in BakedModel.h).
+		bool toc = true;
+
+		// Additionally write the "BVH " section (aligned variant only): SAH
+		// bounding volume hierarchies over the model's meshes and over its
+		// triangles, for culling and ray queries. See BuildBvh.h.
+		bool bvh = true;
+
+		// Additionally write the "AOCC" section (requires `interleaved`):
+		// per-vertex ambient occlusion, from `aoRays` rays per vertex that
+		// count as occluded if they hit anything within `aoDistance` times
+		// the model's diagonal. See BakeAo.h.
+		bool ambientOcclusion = true;
+		std::size_t aoRays = kAoDefaultRays;
+		float aoDistance = 0.05f;
+
+		// Write the "packed-cw3" variant (requires `aligned`): the aligned file,
+		// split into blocks of at most `packBlockSize` bytes that are filtered
+		// and compressed (see PackModel.h). Smaller files, but the runtime must
+		// decode them rather than use them in place.
+		bool packed = false;
+		std::size_t packBlockSize = kPackBlockSize;
+
+		// Worker threads for the per-mesh stages; 0 = one per hardware
+		// thread, 1 = serial. The output is the same either way.
+		std::size_t threads = 0;
+
+		// Merge all meshes that use the same material into one, such that
+		// the output has a single mesh (i.e., draw) per material. Fewer draws
+		// and descriptor set binds for static scenery, at the cost of coarser
+		// culling. Mesh names are replaced by the material names.
+		bool mergeByMaterial = false;
+
+		// Write each texture as a baked texture with all mip levels (see
+		// BakedTexture.h) rather than copying the source image.
+		bool bakeTextures = true;
+
+		// Keep a cache next to the output (see BakeCache.h) and only redo
+		// what changed since the previous bake: nothing if the inputs, the
+		// options and the output are unchanged, and only the modified meshes
+		// otherwise. The output is the same as that of a full bake.
+		bool incremental = true;
+
+		// Import the OBJ mesh by mesh (see scan_wavefront_obj()) instead of
+		// loading it as a whole, and spill processed meshes to a temporary
+		// file next to the output until they are written. Only the OBJ's
+		// vertex attributes and one batch of meshes (one per thread) are in
+		// memory at a time. Requires `!mergeByMaterial`, `!bvh` and
+		// `!ambientOcclusion`, which need all meshes at once. Meshes are not
+		// reused by incremental bakes (but up-to-date outputs are skipped).
+		bool streaming = false;
+	};
+
+	// Matches the runtime Vertex (Vertex.h) and BakedVertex (BakedModel.h)
+	struct InterleavedVertex_
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec4 tangent;
+		glm::vec2 texcoord;
+		glm::vec3 color;
+	};
+
+	static_assert( sizeof(InterleavedVertex_) == 60 );
+
+	// Written to the "BVH " section
+	struct ModelBvh_
+	{
+		BvhData meshes;
+		BvhData triangles;
+		std::vector<BvhTriangle> triangleRefs; // replaces triangles.primitives
+	};
+
+	// Result of the per-mesh stages (indexing and everything after it)
+	struct ProcessedMesh_ : CachedMesh
+	{
+		// Size of `mesh`. Kept when the mesh itself is spilled, see
+		// BakeOptions_::streaming.
+		std::size_t vertexCount = 0;
+		std::size_t triangleCount = 0;
+
+		double indexMs = 0.0;
+		double postMs = 0.0;
+
+		bool cached = false; // taken from the BakeCache
+	};
+
+	// Summary of one bake, see process_model_()
+	struct ModelStats_
+	{
+		bool upToDate = false; // nothing was baked
+
+		std::size_t meshes = 0;
+		std::size_t reusedMeshes = 0;
+		std::size_t triangles = 0;
+
+		std::uint64_t outputBytes = 0;
+	};
+
+	// Models to bake and how; see print_usage_()
+	struct CommandLine_
+	{
+		struct Model
+		{
+			std::string input;
+			std::string output;
+		};
+
+		std::vector<Model> models;
+		std::string outputDir;
+
+		BakeOptions_ options;
+
+		// Applied to the vertices of all models, see process_model_()
+		glm::mat4x4 staticTransform = glm::mat4x4( 1.f );
+
+		// Models baked concurrently; 0 = as many as there are threads. The
+		// threads (BakeOptions_::threads) are split between them.
+		std::size_t jobs = 0;
+
+		// Models only start if the estimated memory use of all running
+		// models stays within this budget. A model that exceeds it on its
+		// own runs alone.
+		std::uint64_t memoryBudget = std::uint64_t(4096) << 20;
+
+		bool help = false;
+	};
+
+	/* Output of one bake. When several models are baked concurrently, each
+	 * one's output is buffered and printed as a whole when it finishes, such
+	 * that output from different models is not interleaved.
+	 */
+	class BakeLog_
+	{
+		public:
+			explicit BakeLog_( bool aBuffered = false ) noexcept
+				: mBuffered( aBuffered )
+			{}
+
+			void print( char const* aFormat, ... );
+			void flush();
+
+		private:
+			bool mBuffered;
+			std::string mText;
+	};
+
+	// Blocks until the requested amount fits into the budget, see
+	// CommandLine_::memoryBudget.
+	class MemoryBudget_
+	{
+		public:
+			explicit MemoryBudget_( std::uint64_t aLimit ) noexcept
+				: mLimit( aLimit )
+			{}
+
+			void acquire( std::uint64_t );
+			void release( std::uint64_t );
+
+		private:
+			std::uint64_t mLimit;
+			std::uint64_t mInUse = 0;
+
+			std::mutex mMutex;
+			std::condition_variable mReleased;
+	};
+
+	/* Processed meshes, in output order. These are either in memory (the
+	 * results of process_meshes_()), or in a spill file that the meshes are
+	 * appended to as they are processed (BakeOptions_::streaming). Spilled
+	 * meshes are loaded one at a time; references returned for one mesh are
+	 * valid until another one is requested.
+	 */
+	class MeshSource_
+	{
+		public:
+			MeshSource_(
+				std::vector<IndexedMesh> const&,
+				std::vector<MeshletData> const&,
+				std::vector<std::vector<MeshLod>> const&
+			) noexcept;
+			explicit MeshSource_( std::filesystem::path aSpillPath );
+
+			~MeshSource_();
+
+			MeshSource_( MeshSource_ const& ) = delete;
+			MeshSource_& operator= (MeshSource_ const&) = delete;
+
+			void append( CachedMesh const& ); // spill only
+
+			std::size_t size() const noexcept;
+
+			IndexedMesh const& mesh( std::size_t );
+			MeshletData const& meshlets( std::size_t );
+			std::vector<MeshLod> const& lods( std::size_t );
+
+		private:
+			CachedMesh const& load_( std::size_t );
+
+			std::vector<IndexedMesh> const* mIndexed = nullptr;
+			std::vector<MeshletData> const* mMeshlets = nullptr;
+			std::vector<std::vector<MeshLod>> const* mLods = nullptr;
+
+			std::filesystem::path mSpillPath;
+			FILE* mSpill = nullptr;
+			std::vector<std::uint64_t> mOffsets{ 0 }; // size()+1 entries
+
+			std::size_t mLoaded = ~std::size_t(0);
+			CachedMesh mCurrent;
+			std::vector<std::byte> mBuffer;
+	};
+
+	using Clock_ = std::chrono::steady_clock;
+
+	inline double ms_since_( Clock_::time_point aStart )
+	{
+		return std::chrono::duration<double,std::milli>( Clock_::now() - aStart ).count();
+	}
+
 	// local functions:
-	void process_model_(
+	ModelStats_ process_model_(
 		char const* aOutput,
 		char const* aInputOBJ,
-		glm::mat4x4 const& aStaticTransform = glm::mat4x4( 1.f ) //TODO
+		BakeLog_&,
+		BakeOptions_ const& aOptions = BakeOptions_{},
+		glm::mat4x4 const& aStaticTransform = glm::mat4x4( 1.f )
+	);
+
+	CommandLine_ parse_command_line_( int aArgc, char* aArgv[] );
+	void print_usage_( char const* aProgram );
+
+	void read_manifest_(
+		CommandLine_&,
+		std::filesystem::path const& aManifest
 	);
 
+	bool bake_batch_( CommandLine_ const& );
+
 
 	InputModel normalize_( InputModel );
 
+	void apply_static_transform_(
+		InputModel&,
+		glm::mat4x4 const& aTransform
+	);
+	InputModel merge_by_material_( InputModel const& );
+
 
 	void write_model_data_(
 		FILE*,
 		InputModel const&,
-		std::vector<IndexedMesh> const&,
+		MeshSource_&,
 		std::unordered_map<std::string,TextureInfo_> const&
 	);
+	void write_model_data_aligned_(
+		FILE*,
+		InputModel const&,
+		MeshSource_&,
+		std::unordered_map<std::string,TextureInfo_> const&,
+		ModelBvh_ const&,
+		std::vector<std::vector<std::uint8_t>> const& aAmbientOcclusion,
+		BakeOptions_ const&
+	);
+
+	void pack_model_file_(
+		std::filesystem::path const&,
+		BakeOptions_ const&,
+		BakeLog_&
+	);
 
 
-	std::vector<IndexedMesh> index_meshes_(
+	ProcessedMesh_ process_mesh_(
 		InputModel const&,
+		std::size_t aMeshIndex,
+		BakeOptions_ const&,
+		float aErrorTolerance
+	);
+	std::vector<ProcessedMesh_> process_meshes_(
+		InputModel const&,
+		BakeOptions_ const&,
+		BakeCache const&,
+		std::vector<std::uint64_t>& aMeshKeys,
+		float aErrorTolerance = 1e-5f
+	);
+	std::vector<ProcessedMesh_> stream_meshes_(
+		ObjStreamModel const&,
+		BakeOptions_ const&,
+		glm::mat4x4 const& aStaticTransform,
+		MeshSource_& aSpill,
 		float aErrorTolerance = 1e-5f
 	);
 
+	void print_mesh_stats_(
+		InputModel const&,
+		std::vector<ProcessedMesh_> const&,
+		BakeOptions_ const&,
+		double aWallMs,
+		BakeLog_&
+	);
+
 	std::unordered_map<std::string,TextureInfo_> find_unique_textures_(
 		InputModel const&
 	);
 
 	std::unordered_map<std::string,TextureInfo_> new_paths_(
 		std::unordered_map<std::string,TextureInfo_>,
-		std::filesystem::path const& aTexDir
+		std::filesystem::path const& aTexDir,
+		bool aBakedTextures
 	);
-}
 
 
-int main() try
-{
-#if 1
-	process_model_(
-		"../Assets/Models/NewShip/ship.comp5822mesh",
-		"../Assets/Models/NewShip/NewShip.obj"
+	std::uint64_t hash_options_(
+		BakeOptions_ const&,
+		glm::mat4x4 const& aStaticTransform
+	);
+	std::uint64_t hash_mesh_options_(
+		BakeOptions_ const&,
+		float aErrorTolerance
 	);
 
-#else
-	process_model_(
-		"../Assets/Models/sponza-pbr/sponza-pbr.comp5822mesh",
-		"../Assets/Models/sponza-pbr/sponza-pbr.obj"
+	bool is_up_to_date_(
+		BakeCache const&,
+		std::uint64_t aOptionsHash,
+		char const* aInputOBJ,
+		std::filesystem::path const& aOutput
+	);
+
+	BakeCache::Input stamp_input_(
+		std::string const& aPath,
+		BakeCache const& aPrevious
+	);
+
+	// Bakes (or copies) the textures; returns their updated stamps. Textures
+	// that could not be baked are reported and counted in `aFailed`.
+	std::vector<BakeCache::Texture> bake_textures_(
+		std::vector<BakeCache::Texture>,
+		std::filesystem::path const& aRootDir,
+		BakeCache const& aPrevious,
+		BakeOptions_ const&,
+		BakeLog_&,
+		std::size_t& aFailed
 	);
-#endif
 
+	bool same_stamps_(
+		std::vector<BakeCache::Texture> const&,
+		std::vector<BakeCache::Texture> const&
+	);
+}
+
+
+int main( int aArgc, char* aArgv[] ) try
+{
+#if 0
+	// Compare the vertex welder against the previous implementation
+	benchmark_welding( "../Assets/Models/NewShip/NewShip.obj" );
+	benchmark_welding( "../Assets/Models/sponza-pbr/sponza-pbr.obj" );
 	return 0;
+#endif
+
+	auto cmd = parse_command_line_( aArgc, aArgv );
+	if( cmd.help )
+	{
+		print_usage_( aArgv[0] );
+		return 0;
+	}
+
+	// Without any models on the command line (e.g., when started from the
+	// IDE), bake the default model.
+	if( cmd.models.empty() )
+	{
+#		if 1
+		cmd.models.push_back( {
+			"../Assets/Models/NewShip/NewShip.obj",
+			"../Assets/Models/NewShip/ship.comp5822mesh"
+		} );
+#		else
+		cmd.models.push_back( {
+			"../Assets/Models/sponza-pbr/sponza-pbr.obj",
+			"../Assets/Models/sponza-pbr/sponza-pbr.comp5822mesh"
+		} );
+#		endif
+	}
+
+	return bake_batch_( cmd ) ? 0 : 1;
 }
 catch( std::exception const& eErr )
 {
@@ -115,8 +542,10 @@ catch( std::exception const& eErr )
 
 namespace
 {
-	void process_model_( char const* aOutput, char const* aInputOBJ, glm::mat4x4 const& aStaticTransform )
+	ModelStats_ process_model_( char const* aOutput, char const* aInputOBJ, BakeLog_& aLog, BakeOptions_ const& aOptions, glm::mat4x4 const& aStaticTransform )
 	{
+		ModelStats_ ret;
+
 		static constexpr std::size_t vertexSize = sizeof(float)*(3+3+2);
 
 		// Figure out output paths
@@ -125,47 +554,324 @@ namespace
 		std::filesystem::path const basename = outname.stem();
 		std::filesystem::path const texdir = basename.string() + "-tex";
 
-		// Load input model
-		auto const model = normalize_( load_wavefront_obj( aInputOBJ ) );
+		auto mainpath = rootdir / basename;
+		mainpath.replace_extension( "comp5822mesh" );
+
+		auto cachepath = mainpath;
+		cachepath.replace_extension( "bakecache" );
+
+		// Skip the bake if nothing changed since the previous one. Only the
+		// manifest of the cache is needed to decide this, and unchanged files
+		// are recognized by their size and time stamp without reading them.
+		auto const optionsHash = hash_options_( aOptions, aStaticTransform );
+
+		BakeCache previous;
+		if( aOptions.incremental )
+		{
+			auto const checkStart = Clock_::now();
+			previous = load_bake_cache( cachepath, false );
+
+			if( is_up_to_date_( previous, optionsHash, aInputOBJ, mainpath ) )
+			{
+				aLog.print( "%s: '%s' is up to date (checked in %.1f ms)\n", aInputOBJ, mainpath.string().c_str(), ms_since_( checkStart ) );
+
+				// Rebake any textures that changed. Remember this, such that
+				// the sources are not re-hashed by the next bake.
+				std::size_t failedTextures = 0;
+				auto textures = bake_textures_( previous.textures, rootdir, previous, aOptions, aLog, failedTextures );
+				if( !same_stamps_( textures, previous.textures ) )
+				{
+					previous = load_bake_cache( cachepath, true );
+					previous.textures = std::move(textures);
+					save_bake_cache( cachepath, previous );
+				}
+
+				// The failed textures are retried by the next bake
+				if( failedTextures )
+					throw lut::Error( "%zu texture(s) failed", failedTextures );
+
+				ret.upToDate = true;
+				ret.outputBytes = previous.output.size;
+				return ret;
+			}
+
+			// Spilled meshes are not cached, see BakeOptions_::streaming
+			previous = load_bake_cache( cachepath, !aOptions.streaming );
+		}
+
+		// Load input model. The input is stamped before it is parsed, such
+		// that modifications during the bake are picked up by the next one.
+		// A streaming import only scans the OBJ here; its meshes are read
+		// when they are processed.
+		BakeCache cache;
+		cache.optionsHash = optionsHash;
+		cache.inputs.emplace_back( stamp_input_( aInputOBJ, previous ) );
+
+		ObjStreamModel obj;
+		InputModel model;
+		if( aOptions.streaming )
+		{
+			obj = scan_wavefront_obj( aInputOBJ );
+			model = normalize_( obj.model );
+		}
+		else
+		{
+			model = normalize_( load_wavefront_obj( aInputOBJ ) );
+		}
+
+		for( auto const& dependency : model.dependencyPaths )
+			cache.inputs.emplace_back( stamp_input_( dependency, previous ) );
 
 		std::size_t inputVerts = 0;
 		for( auto const& imesh : model.meshes )
 			inputVerts += imesh.vertexCount;
 
-		std::printf( "%s: %zu meshes, %zu materials\n", aInputOBJ, model.meshes.size(), model.materials.size() );
-		std::printf( " - triangle soup vertices: %zu => %zu kB\n", inputVerts, inputVerts*vertexSize/1024 );
+		aLog.print( "%s: %zu meshes, %zu materials\n", aInputOBJ, model.meshes.size(), model.materials.size() );
+
+		if( aOptions.streaming )
+		{
+			auto const attributeBytes = (obj.positions.size() + obj.normals.size())*sizeof(glm::vec3) + obj.texcoords.size()*sizeof(glm::vec2);
+			aLog.print( " - streaming: %zu positions, %zu normals, %zu texture coordinates => %zu kB\n", obj.positions.size(), obj.normals.size(), obj.texcoords.size(), attributeBytes/1024 );
+		}
+
+		// Static scenery: bake the transform into the vertices and batch
+		// meshes by material. Both happen before the per-mesh stages, such
+		// that the merged meshes are indexed, optimized etc. as a whole.
+		// (The streaming import transforms each mesh as it is read.)
+		assert( !aOptions.streaming || !aOptions.mergeByMaterial );
+		if( !aOptions.streaming && glm::mat4x4( 1.f ) != aStaticTransform )
+			apply_static_transform_( model, aStaticTransform );
+
+		if( aOptions.mergeByMaterial )
+		{
+			auto const inputMeshes = model.meshes.size();
+			model = merge_by_material_( model );
+
+			aLog.print( " - merged by material: %zu meshes => %zu meshes\n", inputMeshes, model.meshes.size() );
+		}
+		aLog.print( " - triangle soup vertices: %zu => %zu kB\n", inputVerts, inputVerts*vertexSize/1024 );
+
+		// Index and post-process meshes. Meshes are independent, so this runs
+		// in parallel; results are collected per mesh, so the output does not
+		// depend on the number of threads. Meshes that are unchanged since
+		// the previous bake are taken from the cache.
+		auto const processStart = Clock_::now();
+
+		auto spillpath = mainpath;
+		spillpath.replace_extension( "meshspill" );
+
+		std::optional<MeshSource_> meshes;
+		std::vector<std::uint64_t> meshKeys;
+		std::vector<ProcessedMesh_> processed;
+		if( aOptions.streaming )
+		{
+			std::filesystem::create_directories( rootdir );
+			meshes.emplace( spillpath );
+
+			processed = stream_meshes_( obj, aOptions, aStaticTransform, *meshes );
+		}
+		else
+		{
+			processed = process_meshes_( model, aOptions, previous, meshKeys );
+		}
+
+		auto const processMs = ms_since_( processStart );
+
+		print_mesh_stats_( model, processed, aOptions, processMs, aLog );
+
+		ret.meshes = processed.size();
+
+		if( aOptions.incremental && !aOptions.streaming )
+		{
+			for( std::size_t i = 0; i < processed.size(); ++i )
+			{
+				auto const key = meshKeys[i];
+				if( processed[i].cached )
+				{
+					++ret.reusedMeshes;
+					cache.meshes.emplace( key, std::move(previous.meshes[key]) );
+				}
+				else
+				{
+					cache.meshes.emplace( key, serialize_mesh( processed[i] ) );
+				}
+			}
+
+			previous.meshes.clear();
 
-		// Index meshes
-		auto const indexed = index_meshes_( model );
+			aLog.print( " - meshes: %zu of %zu reused from '%s'\n", ret.reusedMeshes, processed.size(), cachepath.string().c_str() );
+		}
+
+		std::vector<IndexedMesh> indexed;
+		std::vector<MeshletData> meshlets;
+		std::vector<std::vector<MeshLod>> lods;
+
+		if( !aOptions.streaming )
+		{
+			indexed.reserve( processed.size() );
+			for( auto& mesh : processed )
+			{
+				indexed.emplace_back( std::move(mesh.mesh) );
+
+				if( aOptions.aligned && aOptions.meshlets )
+					meshlets.emplace_back( std::move(mesh.meshlets) );
+				if( aOptions.aligned && aOptions.interleaved && aOptions.lods )
+					lods.emplace_back( std::move(mesh.lods) );
+			}
+
+			meshes.emplace( indexed, meshlets, lods );
+		}
+
+		processed.clear();
+
+		// Statistics, in a single pass over the meshes (which may have to be
+		// loaded from the spill file)
+		bool const withMeshlets = aOptions.aligned && aOptions.meshlets;
+		bool const withLods = aOptions.aligned && aOptions.interleaved && aOptions.lods;
+
+		struct LodStats_
+		{
+			std::size_t meshes = 0, tris = 0;
+			float error = 0.f;
+		};
 
 		std::size_t outputVerts = 0, outputIndices = 0;
-		for( auto const& mesh : indexed )
+		std::size_t meshletCount = 0, meshletVerts = 0;
+		std::size_t meshes16 = 0, indices16 = 0;
+		std::vector<LodStats_> lodStats( withLods ? aOptions.lodLevels : 0 );
+
+		for( std::size_t i = 0; i < meshes->size(); ++i )
 		{
+			auto const& mesh = meshes->mesh( i );
 			outputVerts += mesh.vert.size();
 			outputIndices += mesh.indices.size();
+
+			if( mesh.vert.size() <= kMaxVertices16 )
+			{
+				++meshes16;
+				indices16 += mesh.indices.size();
+			}
+
+			if( withMeshlets )
+			{
+				auto const& data = meshes->meshlets( i );
+				meshletCount += data.meshlets.size();
+				meshletVerts += data.vertices.size();
+			}
+
+			if( withLods )
+			{
+				auto const& chain = meshes->lods( i );
+				for( std::size_t level = 0; level < chain.size() && level < lodStats.size(); ++level )
+				{
+					auto& stats = lodStats[level];
+					++stats.meshes;
+					stats.tris += chain[level].indices.size() / 3;
+					stats.error = std::max( stats.error, chain[level].error );
+				}
+			}
+		}
+
+		ret.triangles = outputIndices / 3;
+
+		aLog.print( " - indexed vertices: %zu with %zu indices => %zu kB\n", outputVerts, outputIndices, (outputVerts*vertexSize + outputIndices*sizeof(std::uint32_t))/1024 );
+
+		if( meshletCount )
+		{
+			aLog.print( " - meshlets: %zu (max %zu/%zu), avg. %.1f vertices, %.1f triangles\n", meshletCount, aOptions.meshletMaxVertices, aOptions.meshletMaxTriangles, double(meshletVerts) / meshletCount, double(outputIndices/3) / meshletCount );
 		}
 
-		std::printf( " - indexed vertices: %zu with %zu indices => %zu kB\n", outputVerts, outputIndices, (outputVerts*vertexSize + outputIndices*sizeof(std::uint32_t))/1024 );
+		if( aOptions.aligned && aOptions.interleaved )
+		{
+			aLog.print( " - interleaved vertices: %zu kB", outputVerts*sizeof(InterleavedVertex_)/1024 );
+			if( aOptions.quantized )
+				aLog.print( ", quantized: %zu kB", outputVerts*sizeof(QuantizedVertex)/1024 );
+			aLog.print( "\n" );
+		}
+
+		if( aOptions.aligned && aOptions.indices16 )
+		{
+			auto const bytes = indices16*sizeof(std::uint16_t) + (outputIndices-indices16)*sizeof(std::uint32_t);
+			aLog.print( " - 16-bit indices: %zu of %zu meshes, %zu of %zu indices => %zu kB instead of %zu kB\n", meshes16, meshes->size(), indices16, outputIndices, bytes/1024, outputIndices*sizeof(std::uint32_t)/1024 );
+		}
+
+		if( withLods && meshes->size() )
+		{
+			aLog.print( " - LODs (triangles, max. error):\n" );
+			for( std::size_t level = 0; level < lodStats.size(); ++level )
+			{
+				if( 0 == lodStats[level].meshes )
+					break;
+
+				aLog.print( "   LOD%zu: %zu meshes, %zu triangles, error %g\n", level+1, lodStats[level].meshes, lodStats[level].tris, lodStats[level].error );
+			}
+		}
+
+		// Bounding volume hierarchies over the final meshes
+		assert( !aOptions.streaming || (!aOptions.bvh && !aOptions.ambientOcclusion) );
+
+		ModelBvh_ bvh;
+		if( aOptions.aligned && aOptions.bvh )
+		{
+			auto const bvhStart = Clock_::now();
+			bvh.meshes = build_mesh_bvh( indexed );
+			bvh.triangles = build_triangle_bvh( indexed, bvh.triangleRefs );
+			bvh.triangles.primitives.clear();
+
+			aLog.print( " - BVH: %zu nodes over %zu meshes, %zu nodes over %zu triangles => %zu kB; built in %.1f ms\n", bvh.meshes.nodes.size(), indexed.size(), bvh.triangles.nodes.size(), bvh.triangleRefs.size(), ((bvh.meshes.nodes.size() + bvh.triangles.nodes.size())*sizeof(BvhNode) + indexed.size()*sizeof(std::uint32_t) + bvh.triangleRefs.size()*sizeof(BvhTriangle))/1024, ms_since_( bvhStart ) );
+		}
+
+		// Ambient occlusion, cast against the triangle BVH (which is built
+		// just for this if the file does not include it).
+		std::vector<std::vector<std::uint8_t>> ambientOcclusion;
+		if( aOptions.aligned && aOptions.interleaved && aOptions.ambientOcclusion )
+		{
+			std::vector<BvhTriangle> localRefs;
+			BvhData localBvh;
+			if( !aOptions.bvh )
+				localBvh = build_triangle_bvh( indexed, localRefs );
+
+			auto const& triangleBvh = aOptions.bvh ? bvh.triangles : localBvh;
+			auto const& triangleRefs = aOptions.bvh ? bvh.triangleRefs : localRefs;
+
+			float diagonal = 0.f;
+			if( !triangleBvh.nodes.empty() )
+				diagonal = glm::length( triangleBvh.nodes[0].aabbMax - triangleBvh.nodes[0].aabbMin );
+
+			AoStats stats;
+			ambientOcclusion = bake_ambient_occlusion( indexed, triangleBvh, triangleRefs, aOptions.aoDistance * diagonal, aOptions.aoRays, aOptions.threads, &stats );
+
+			std::size_t vertices = 0;
+			std::uint64_t sum = 0;
+			for( auto const& values : ambientOcclusion )
+			{
+				vertices += values.size();
+				for( auto const value : values )
+					sum += value;
+			}
+
+			aLog.print( " - ambient occlusion: %zu rays/vertex up to %g units, mean %.2f; %.2f M rays (%.0f%% hit) in %.1f ms => %.2f M rays/s on %zu threads\n", aOptions.aoRays, aOptions.aoDistance * diagonal, vertices ? sum / (255.0 * vertices) : 1.0, stats.rays * 1e-6, stats.rays ? 100.0 * stats.hits / stats.rays : 0.0, stats.seconds * 1e3, stats.seconds > 0.0 ? stats.rays * 1e-6 / stats.seconds : 0.0, stats.threads );
+		}
 
 		// Find list of unique textures
-		auto const textures = new_paths_( find_unique_textures_( model ), texdir );
+		auto const textures = new_paths_( find_unique_textures_( model ), texdir, aOptions.bakeTextures );
 
-		std::printf( " - unique textures: %zu\n", textures.size() );
+		aLog.print( " - unique textures: %zu\n", textures.size() );
 
 		// Ensure output directory exists
 		std::filesystem::create_directories( rootdir );
 
 		// Output mesh data
-		auto mainpath = rootdir / basename;
-		mainpath.replace_extension( "comp5822mesh" );
-
 		FILE* fof = std::fopen( mainpath.string().c_str(), "wb" );
 		if( !fof )
 			throw lut::Error( "Unable to open '%s' for writing", mainpath.string().c_str() );
 
 		try
 		{
-			write_model_data_( fof, model, indexed, textures );
+			if( aOptions.aligned )
+				write_model_data_aligned_( fof, model, *meshes, textures, bvh, ambientOcclusion, aOptions );
+			else
+				write_model_data_( fof, model, *meshes, textures );
 		}
 		catch( ... )
 		{
@@ -175,35 +881,48 @@ namespace
 
 		std::fclose( fof );
 
-		// Copy textures
-		std::filesystem::create_directories( rootdir / texdir );
+		meshes.reset(); // removes the spill file
+
+		if( aOptions.aligned && aOptions.packed )
+			pack_model_file_( mainpath, aOptions, aLog );
 
-		std::size_t errors = 0;
+		// Bake (or copy) textures
+		std::vector<BakeCache::Texture> textureBakes;
 		for( auto const& entry : textures )
 		{
-			auto const dest = rootdir / entry.second.newPath;
+			BakeCache::Texture bake;
+			bake.source = entry.first;
+			bake.dest = entry.second.newPath;
+			bake.channels = aOptions.bakeTextures ? entry.second.channels : 0;
+			textureBakes.emplace_back( std::move(bake) );
+		}
 
-			std::error_code ec;
-			bool ret = std::filesystem::copy_file( 
-				entry.first,
-				dest,
-				std::filesystem::copy_options::none,
-				ec
-			);
+		std::sort( textureBakes.begin(), textureBakes.end(), [] (BakeCache::Texture const& aA, BakeCache::Texture const& aB) {
+			return aA.dest < aB.dest;
+		} );
 
-			if( !ret )
-			{
-				++errors;
-				std::fprintf( stderr, "copy_file(): '%s' failed: %s (%s)\n", dest.string().c_str(), ec.message().c_str(), ec.category().name() );
-			}
-		}
+		std::size_t failedTextures = 0;
+		cache.textures = bake_textures_( std::move(textureBakes), rootdir, previous, aOptions, aLog, failedTextures );
 
-		auto const total = textures.size();
-		std::printf( "Copied %zu textures out of %zu.\n", total-errors, total );
-		if( errors )
+		// Record the bake. Without a valid output stamp, the next bake starts
+		// over (but may still reuse the meshes).
+		if( aOptions.incremental )
 		{
-			std::fprintf( stderr, "Some copies reported an error. Currently, the code will never overwrite existing files. The errors likely just indicate that the file was copied previously. Remove old files manually, if necessary.\n" );
+			if( !stamp_file( mainpath, cache.output ) )
+				std::fprintf( stderr, "Unable to stamp '%s'; the next bake will not be skipped\n", mainpath.string().c_str() );
+
+			save_bake_cache( cachepath, cache );
 		}
+
+		// The output refers to the missing textures. The cache lacks their
+		// stamps, so the next bake retries them.
+		if( failedTextures )
+			throw lut::Error( "%zu texture(s) failed", failedTextures );
+
+		std::error_code ec;
+		ret.outputBytes = std::filesystem::file_size( mainpath, ec );
+
+		return ret;
 	}
 }
 
@@ -223,39 +942,114 @@ namespace
 
 		return aModel; // This should use the move constructor implicitly.
 	}
-}
 
-namespace
-{
-	void checked_write_( FILE* aOut, std::size_t aBytes, void const* aData )
+	void apply_static_transform_( InputModel& aModel, glm::mat4x4 const& aTransform )
 	{
-		auto const ret = std::fwrite( aData, 1, aBytes, aOut );
+		// Normals transform with the inverse transpose; renormalize them, as
+		// the transform may scale.
+		glm::mat3x3 const normalTransform = glm::transpose( glm::inverse( glm::mat3x3( aTransform ) ) );
 
-		if( ret != aBytes )
-			throw lut::Error( "fwrite() failed: %zu instead of %zu", ret, aBytes );
-	}
+		for( auto& pos : aModel.positions )
+			pos = glm::vec3( aTransform * glm::vec4( pos, 1.f ) );
 
-	void write_string_( FILE* aOut, char const* aString )
-	{
-		// Write a string
-		// Format:
-		//  - uint32_t : N = length of string in bytes, including terminating '\0'
-		//  - N x char : string
-		std::uint32_t const length = std::uint32_t(std::strlen(aString)+1);
-		checked_write_( aOut, sizeof(std::uint32_t), &length );
+		for( auto& nrm : aModel.normals )
+		{
+			auto const n = normalTransform * nrm;
+			auto const len = glm::length( n );
+			nrm = len > 0.f ? n / len : n;
+		}
 
-		checked_write_( aOut, length, aString );
+		// A mirroring transform flips the winding of all triangles. Restore
+		// it, such that back face culling keeps working.
+		if( glm::determinant( glm::mat3x3( aTransform ) ) < 0.f )
+		{
+			assert( aModel.positions.size() % 3 == 0 );
+			for( std::size_t i = 0; i+2 < aModel.positions.size(); i += 3 )
+			{
+				std::swap( aModel.positions[i+1], aModel.positions[i+2] );
+				std::swap( aModel.normals[i+1], aModel.normals[i+2] );
+				std::swap( aModel.texcoords[i+1], aModel.texcoords[i+2] );
+			}
+		}
 	}
 
-	void write_model_data_( FILE* aOut, InputModel const& aModel, std::vector<IndexedMesh> const& aIndexedMeshes, std::unordered_map<std::string,TextureInfo_> const& aTextures )
+	InputModel merge_by_material_( InputModel const& aModel )
 	{
-		// Write header
+		// Meshes of each material, in their original order
+		std::vector<std::vector<std::size_t>> byMaterial( aModel.materials.size() );
+		for( std::size_t i = 0; i < aModel.meshes.size(); ++i )
+		{
+			auto const& imesh = aModel.meshes[i];
+			if( imesh.materialIndex >= byMaterial.size() )
+				throw lut::Error( "Mesh '%s' uses invalid material %zu", imesh.meshName.c_str(), imesh.materialIndex );
+
+			byMaterial[imesh.materialIndex].emplace_back( i );
+		}
+
+		InputModel ret;
+		ret.modelSourcePath = aModel.modelSourcePath;
+		ret.dependencyPaths = aModel.dependencyPaths;
+		ret.materials = aModel.materials;
+
+		ret.positions.reserve( aModel.positions.size() );
+		ret.normals.reserve( aModel.normals.size() );
+		ret.texcoords.reserve( aModel.texcoords.size() );
+
+		// Copy the triangle soup of each material's meshes, such that they
+		// are contiguous. Materials without meshes are kept, but get none.
+		for( std::size_t mat = 0; mat < byMaterial.size(); ++mat )
+		{
+			if( byMaterial[mat].empty() )
+				continue;
+
+			InputMeshInfo merged;
+			merged.meshName = aModel.materials[mat].materialName;
+			merged.materialIndex = mat;
+			merged.vertexStartIndex = ret.positions.size();
+
+			for( auto const index : byMaterial[mat] )
+			{
+				auto const& imesh = aModel.meshes[index];
+				auto const first = std::ptrdiff_t(imesh.vertexStartIndex);
+				auto const last = first + std::ptrdiff_t(imesh.vertexCount);
+
+				ret.positions.insert( ret.positions.end(), aModel.positions.begin()+first, aModel.positions.begin()+last );
+				ret.normals.insert( ret.normals.end(), aModel.normals.begin()+first, aModel.normals.begin()+last );
+				ret.texcoords.insert( ret.texcoords.end(), aModel.texcoords.begin()+first, aModel.texcoords.begin()+last );
+			}
+
+			merged.vertexCount = ret.positions.size() - merged.vertexStartIndex;
+			ret.meshes.emplace_back( std::move(merged) );
+		}
+
+		return ret;
+	}
+}
+
+namespace
+{
+	void checked_write_( FILE* aOut, std::size_t aBytes, void const* aData )
+	{
+		auto const ret = std::fwrite( aData, 1, aBytes, aOut );
+
+		if( ret != aBytes )
+			throw lut::Error( "fwrite() failed: %zu instead of %zu", ret, aBytes );
+	}
+
+	void write_string_( FILE* aOut, char const* aString )
+	{
+		// Write a string
 		// Format:
-		//   - char[16] : file magic
-		//   - char[16] : file variant ID
-		checked_write_( aOut, sizeof(char)*16, kFileMagic );
-		checked_write_( aOut, sizeof(char)*16, kFileVariant );
-		
+		//  - uint32_t : N = length of string in bytes, including terminating '\0'
+		//  - N x char : string
+		std::uint32_t const length = std::uint32_t(std::strlen(aString)+1);
+		checked_write_( aOut, sizeof(std::uint32_t), &length );
+
+		checked_write_( aOut, length, aString );
+	}
+
+	void write_textures_( FILE* aOut, std::unordered_map<std::string,TextureInfo_> const& aTextures )
+	{
 		// Write list of unique textures
 		// Format:
 		//  - unit32_t : U = number of unique textures
@@ -280,7 +1074,10 @@ namespace
 			std::uint8_t channels = tex->channels;
 			checked_write_( aOut, sizeof(channels), &channels );
 		}
+	}
 
+	void write_materials_( FILE* aOut, InputModel const& aModel, std::unordered_map<std::string,TextureInfo_> const& aTextures )
+	{
 		// Write material information
 		// Format:
 		//  - uint32_t : M = number of materials
@@ -324,6 +1121,19 @@ namespace
 			checked_write_( aOut, sizeof(float), &mat.baseRoughness );
 			checked_write_( aOut, sizeof(float), &mat.baseMetalness );
 		}
+	}
+
+	void write_model_data_( FILE* aOut, InputModel const& aModel, MeshSource_& aMeshes, std::unordered_map<std::string,TextureInfo_> const& aTextures )
+	{
+		// Write header
+		// Format:
+		//   - char[16] : file magic
+		//   - char[16] : file variant ID
+		checked_write_( aOut, sizeof(char)*16, kFileMagic );
+		checked_write_( aOut, sizeof(char)*16, kFileVariant );
+		
+		write_textures_( aOut, aTextures );
+		write_materials_( aOut, aModel, aTextures );
 
 		// Write mesh data
 		// Format:
@@ -339,7 +1149,7 @@ namespace
 		std::uint32_t const meshCount = std::uint32_t(aModel.meshes.size());
 		checked_write_( aOut, sizeof(meshCount), &meshCount );
 
-		assert( aModel.meshes.size() == aIndexedMeshes.size() );
+		assert( aModel.meshes.size() == aMeshes.size() );
 		for( std::size_t i = 0; i < aModel.meshes.size(); ++i )
 		{
 			auto const& mmesh = aModel.meshes[i];
@@ -347,7 +1157,7 @@ namespace
 			std::uint32_t materialIndex = std::uint32_t(mmesh.materialIndex);
 			checked_write_( aOut, sizeof(materialIndex), &materialIndex );
 
-			auto const& imesh = aIndexedMeshes[i];
+			auto const& imesh = aMeshes.mesh( i );
 
 			std::uint32_t vertexCount = std::uint32_t(imesh.vert.size());
 			checked_write_( aOut, sizeof(vertexCount), &vertexCount );
@@ -361,91 +1171,1653 @@ namespace
 			checked_write_( aOut, sizeof(std::uint32_t)*indexCount, imesh.indices.data() );
 		}
 	}
-}
 
-namespace
-{
-	std::vector<IndexedMesh> index_meshes_( InputModel const& aModel, float aErrorTolerance )
+	std::uint64_t align_up_( std::uint64_t aOffset )
 	{
-		std::vector<IndexedMesh> indexed;
+		return (aOffset + kAlignment-1) / kAlignment * kAlignment;
+	}
+
+	std::uint64_t tell_( FILE* aOut )
+	{
+#		if defined(_WIN32)
+		auto const ret = _ftelli64( aOut );
+#		else
+		auto const ret = ftello( aOut );
+#		endif
+		if( ret < 0 )
+			throw lut::Error( "ftell() failed" );
+
+		return std::uint64_t(ret);
+	}
+
+	void seek_( FILE* aOut, std::uint64_t aOffset )
+	{
+#		if defined(_WIN32)
+		auto const ret = _fseeki64( aOut, std::int64_t(aOffset), SEEK_SET );
+#		else
+		auto const ret = fseeko( aOut, off_t(aOffset), SEEK_SET );
+#		endif
+		if( 0 != ret )
+			throw lut::Error( "fseek() to %llu failed", (unsigned long long)aOffset );
+	}
+
+	void pad_to_( FILE* aOut, std::uint64_t aOffset )
+	{
+		static constexpr char zeros[kAlignment] = {};
+
+		auto const current = tell_( aOut );
+		assert( current <= aOffset && aOffset - current < kAlignment );
+
+		checked_write_( aOut, std::size_t(aOffset - current), zeros );
+	}
+
+	void write_model_data_aligned_( FILE* aOut, InputModel const& aModel, MeshSource_& aMeshes, std::unordered_map<std::string,TextureInfo_> const& aTextures, ModelBvh_ const& aBvh, std::vector<std::vector<std::uint8_t>> const& aAmbientOcclusion, BakeOptions_ const& aOptions )
+	{
+		// See BakedModel.h for a description of the format. The section table
+		// is written twice: first as a placeholder, and then again with the
+		// final offsets once all sections have been written.
+		struct SectionEntry_
+		{
+			char tag[4];
+			std::uint32_t reserved;
+			std::uint64_t offset;
+			std::uint64_t size;
+		};
+
+		struct MeshRecord_
+		{
+			std::uint32_t materialId;
+			std::uint32_t vertexCount;
+			std::uint32_t indexCount;
+			std::uint32_t reserved;
+
+			std::uint64_t positionsOffset;
+			std::uint64_t normalsOffset;
+			std::uint64_t texcoordsOffset;
+			std::uint64_t indicesOffset;
+		};
+
+		struct MeshletHeader_
+		{
+			std::uint32_t meshCount;
+			std::uint32_t meshletCount;
+			std::uint32_t vertexCount;
+			std::uint32_t indexCount;
+
+			std::uint64_t meshletsOffset;
+			std::uint64_t verticesOffset;
+			std::uint64_t indicesOffset;
+			std::uint64_t reserved;
+		};
+
+		struct MeshletRange_
+		{
+			std::uint32_t meshletOffset, meshletCount;
+			std::uint32_t vertexOffset, vertexCount;
+			std::uint32_t indexOffset, indexCount;
+			std::uint32_t reserved[2];
+		};
+
+		struct LodHeader_
+		{
+			std::uint32_t meshCount;
+			std::uint32_t levelCount;
+			std::uint32_t indexCount;
+			std::uint32_t reserved;
+
+			std::uint64_t levelsOffset;
+			std::uint64_t indicesOffset;
+		};
+
+		struct LodRange_
+		{
+			std::uint32_t firstLevel;
+			std::uint32_t levelCount;
+		};
+
+		struct LodLevel_
+		{
+			std::uint32_t firstIndex;
+			std::uint32_t indexCount;
+			float error;
+			std::uint32_t reserved;
+		};
+
+		struct Index16Header_
+		{
+			std::uint32_t meshCount;
+			std::uint32_t indexCount;
+
+			std::uint64_t indicesOffset;
+		};
+
+		struct Index16Range_
+		{
+			std::uint32_t firstIndex;
+			std::uint32_t indexCount;
+		};
 
-		for( auto const& imesh : aModel.meshes )
+		static_assert( sizeof(SectionEntry_) == 24 );
+		static_assert( sizeof(MeshRecord_) == 48 );
+		static_assert( sizeof(MeshletHeader_) == 48 );
+		static_assert( sizeof(MeshletRange_) == 32 );
+		static_assert( sizeof(LodHeader_) == 32 );
+		static_assert( sizeof(LodRange_) == 8 );
+		static_assert( sizeof(LodLevel_) == 16 );
+		static_assert( sizeof(Index16Header_) == 16 );
+		static_assert( sizeof(Index16Range_) == 8 );
+
+		struct TocEntry_
 		{
-			auto const endIndex = imesh.vertexStartIndex + imesh.vertexCount;
+			std::uint32_t materialId;
+			std::uint32_t vertexCount;
+			std::uint32_t indexCount;
+			std::uint32_t reserved0;
+
+			glm::vec3 aabbMin;
+			float reserved1;
+			glm::vec3 aabbMax;
+			float reserved2;
+
+			std::uint64_t offset;
+			std::uint64_t size;
+		};
+
+		static_assert( sizeof(TocEntry_) == 64 );
 
-			TriangleSoup soup;
+		struct BvhHeader_
+		{
+			std::uint32_t meshNodeCount;
+			std::uint32_t meshCount;
+			std::uint32_t triangleNodeCount;
+			std::uint32_t triangleCount;
+
+			std::uint64_t meshNodesOffset;
+			std::uint64_t meshesOffset;
+			std::uint64_t triangleNodesOffset;
+			std::uint64_t trianglesOffset;
+		};
 
-			soup.vert.reserve( imesh.vertexCount );
-			for( std::size_t i = imesh.vertexStartIndex; i < endIndex; ++i )
-				soup.vert.emplace_back( aModel.positions[i] );
+		static_assert( sizeof(BvhHeader_) == 48 );
+		static_assert( sizeof(BvhTriangle) == 8 );
 
-			soup.text.reserve( imesh.vertexCount );
-			for( std::size_t i = imesh.vertexStartIndex; i < endIndex; ++i )
-				soup.text.emplace_back( aModel.texcoords[i] );
+		// Write header
+		checked_write_( aOut, sizeof(char)*16, kFileMagic );
+		checked_write_( aOut, sizeof(char)*16, kFileVariantAligned );
 
-			soup.norm.reserve( imesh.vertexCount );
-			for( std::size_t i = imesh.vertexStartIndex; i < endIndex; ++i )
-				soup.norm.emplace_back( aModel.normals[i] );
+		std::vector<SectionEntry_> sections{
+			{ { 'T', 'E', 'X', 'T' }, 0, 0, 0 },
+			{ { 'M', 'A', 'T', 'L' }, 0, 0, 0 },
+			{ { 'M', 'E', 'S', 'H' }, 0, 0, 0 }
+		};
 
+		if( aOptions.interleaved )
+		{
+			sections.push_back( { { 'V', 'E', 'R', 'T' }, 0, 0, 0 } );
+			sections.push_back( { { 'I', 'N', 'D', 'X' }, 0, 0, 0 } );
 
-			indexed.emplace_back( make_indexed_mesh( soup, aErrorTolerance ) );
+			if( aOptions.quantized )
+				sections.push_back( { { 'Q', 'V', 'T', 'X' }, 0, 0, 0 } );
 		}
 
-		return indexed;
-	}
-}
+		std::size_t const tangentSection = sections.size();
+		if( aOptions.tangents )
+			sections.push_back( { { 'T', 'A', 'N', 'G' }, 0, 0, 0 } );
 
-namespace
-{
-	std::unordered_map<std::string,TextureInfo_> find_unique_textures_( InputModel const& aModel )
-	{
-		std::unordered_map<std::string,TextureInfo_> unique;
+		std::size_t const meshletSection = sections.size();
+		if( aOptions.meshlets )
+			sections.push_back( { { 'M', 'S', 'H', 'L' }, 0, 0, 0 } );
 
-		std::uint32_t texid = 0;
-		auto const add_unique_ = [&] (std::string const& aPath, std::uint8_t aChannels)
+		std::size_t const lodSection = sections.size();
+		if( aOptions.interleaved && aOptions.lods )
+			sections.push_back( { { 'L', 'O', 'D', 'S' }, 0, 0, 0 } );
+
+		std::size_t const index16Section = sections.size();
+		if( aOptions.indices16 )
+			sections.push_back( { { 'I', 'X', '1', '6' }, 0, 0, 0 } );
+
+		std::size_t const bvhSection = sections.size();
+		if( aOptions.bvh )
+			sections.push_back( { { 'B', 'V', 'H', ' ' }, 0, 0, 0 } );
+
+		std::size_t const aoSection = sections.size();
+		if( aOptions.interleaved && aOptions.ambientOcclusion )
+			sections.push_back( { { 'A', 'O', 'C', 'C' }, 0, 0, 0 } );
+
+		std::size_t const tocSection = sections.size();
+		if( aOptions.toc )
+			sections.push_back( { { 'M', 'T', 'O', 'C' }, 0, 0, 0 } );
+
+		std::uint32_t const sectionHeader[2] = { std::uint32_t(sections.size()), 0 };
+		checked_write_( aOut, sizeof(sectionHeader), sectionHeader );
+
+		auto const tableOffset = tell_( aOut );
+		checked_write_( aOut, sections.size()*sizeof(SectionEntry_), sections.data() );
+
+		auto const begin_section_ = [&] (SectionEntry_& aSection) {
+			aSection.offset = align_up_( tell_( aOut ) );
+			pad_to_( aOut, aSection.offset );
+		};
+		auto const end_section_ = [&] (SectionEntry_& aSection) {
+			aSection.size = tell_( aOut ) - aSection.offset;
+		};
+
+		// Table of contents. It goes first, right after the section table, such
+		// that a loader finds everything it needs in the first few kB. The
+		// entries are only known once the meshes are laid out; write zeros
+		// for now and patch them below.
+		std::uint32_t const tocHeader[4] = { std::uint32_t(aModel.meshes.size()), 0, 0, 0 };
+		std::vector<TocEntry_> toc( aModel.meshes.size() );
+
+		std::uint64_t tocOffset = 0;
+		if( aOptions.toc )
 		{
-			if( aPath.empty() )
-				return;
+			begin_section_( sections[tocSection] );
+			checked_write_( aOut, sizeof(tocHeader), tocHeader );
 
-			TextureInfo_ info{};
-			info.uniqueId = texid;
-			info.channels = aChannels;
+			tocOffset = tell_( aOut );
+			checked_write_( aOut, toc.size()*sizeof(TocEntry_), toc.data() );
+			end_section_( sections[tocSection] );
+		}
 
-			auto const [it, isNew] = unique.emplace( std::make_pair(aPath,info) );
+		// Textures & materials
+		begin_section_( sections[0] );
+		write_textures_( aOut, aTextures );
+		end_section_( sections[0] );
 
-			if( isNew )
-				++texid;
+		begin_section_( sections[1] );
+		write_materials_( aOut, aModel, aTextures );
+		end_section_( sections[1] );
+
+		// Meshes: lay out all arrays first, such that the records can be
+		// written in one go. Sections are written mesh after mesh, such that
+		// only one spilled mesh needs to be loaded at a time.
+		begin_section_( sections[2] );
+
+		assert( aModel.meshes.size() == aMeshes.size() );
+		std::uint32_t const meshHeader[4] = { std::uint32_t(aModel.meshes.size()), 0, 0, 0 };
+
+		std::vector<MeshRecord_> records( aModel.meshes.size() );
+
+		std::uint64_t offset = sections[2].offset + sizeof(meshHeader) + records.size()*sizeof(MeshRecord_);
+		auto const place_ = [&] (std::uint64_t aBytes) {
+			auto const ret = align_up_( offset );
+			offset = ret + aBytes;
+			return ret;
 		};
 
-		for( auto const& mat : aModel.materials )
+		for( std::size_t i = 0; i < records.size(); ++i )
 		{
-			add_unique_( mat.baseColorTexturePath, 4 );
-			add_unique_( mat.roughnessTexturePath, 1 ); 
-			add_unique_( mat.metalnessTexturePath, 1 ); 
-			add_unique_( mat.alphaMaskTexturePath, 4 );  // assume == baseColor
-			add_unique_( mat.normalMapTexturePath, 4 );  // eh...
+			auto const& imesh = aMeshes.mesh( i );
+			auto& record = records[i];
+
+			record.materialId = std::uint32_t(aModel.meshes[i].materialIndex);
+			record.vertexCount = std::uint32_t(imesh.vert.size());
+			record.indexCount = std::uint32_t(imesh.indices.size());
+			record.reserved = 0;
+
+			record.positionsOffset = place_( sizeof(glm::vec3)*record.vertexCount );
+			record.normalsOffset = place_( sizeof(glm::vec3)*record.vertexCount );
+			record.texcoordsOffset = place_( sizeof(glm::vec2)*record.vertexCount );
+			record.indicesOffset = place_( sizeof(std::uint32_t)*record.indexCount );
+
+			// The mesh's arrays are contiguous (up to alignment)
+			auto& entry = toc[i];
+			entry.materialId = record.materialId;
+			entry.vertexCount = record.vertexCount;
+			entry.indexCount = record.indexCount;
+			entry.aabbMin = imesh.aabbMin;
+			entry.aabbMax = imesh.aabbMax;
+			entry.offset = record.positionsOffset;
+			entry.size = offset - record.positionsOffset;
 		}
 
-		return unique;
-	}
+		checked_write_( aOut, sizeof(meshHeader), meshHeader );
+		checked_write_( aOut, records.size()*sizeof(MeshRecord_), records.data() );
 
-	std::unordered_map<std::string,TextureInfo_> new_paths_( std::unordered_map<std::string,TextureInfo_> aTextures, std::filesystem::path const& aTexDir )
-	{
-		for( auto& entry : aTextures )
+		for( std::size_t i = 0; i < records.size(); ++i )
 		{
-			std::filesystem::path const originalPath( entry.first );
-			auto const filename = originalPath.filename();
-			auto const newpath = aTexDir / filename;
-		
-			auto& info = entry.second;
-			info.newPath = newpath.string();
+			auto const& imesh = aMeshes.mesh( i );
+			auto const& record = records[i];
+
+			pad_to_( aOut, record.positionsOffset );
+			checked_write_( aOut, sizeof(glm::vec3)*record.vertexCount, imesh.vert.data() );
+			pad_to_( aOut, record.normalsOffset );
+			checked_write_( aOut, sizeof(glm::vec3)*record.vertexCount, imesh.norm.data() );
+			pad_to_( aOut, record.texcoordsOffset );
+			checked_write_( aOut, sizeof(glm::vec2)*record.vertexCount, imesh.text.data() );
+			pad_to_( aOut, record.indicesOffset );
+			checked_write_( aOut, sizeof(std::uint32_t)*record.indexCount, imesh.indices.data() );
 		}
 
-		// Note: aTextures is still local to the function, so there is no need
-		// to explicitly std::move() it. However, since it is passed in as an
-		// argument, NRVO is unlikely to occur.
-		return aTextures; 
-	}
-}
+		assert( tell_( aOut ) == offset );
+		end_section_( sections[2] );
+
+		// Interleaved vertices and global indices. Meshes are written one
+		// after the other, so the indices of each mesh are rebased by the
+		// number of vertices before it.
+		if( aOptions.interleaved )
+		{
+			begin_section_( sections[3] );
+
+			std::vector<InterleavedVertex_> vertices;
+			for( std::size_t m = 0; m < aMeshes.size(); ++m )
+			{
+				auto const& imesh = aMeshes.mesh( m );
+				assert( imesh.tangent.size() == imesh.vert.size() );
+
+				vertices.resize( imesh.vert.size() );
+				for( std::size_t i = 0; i < vertices.size(); ++i )
+				{
+					auto& v = vertices[i];
+					v.position = imesh.vert[i];
+					v.normal = imesh.norm[i];
+					v.tangent = imesh.tangent[i];
+					v.texcoord = imesh.text[i];
+					v.color = glm::vec3( 1.f );
+				}
+
+				checked_write_( aOut, vertices.size()*sizeof(InterleavedVertex_), vertices.data() );
+			}
+
+			end_section_( sections[3] );
+			begin_section_( sections[4] );
+
+			std::uint32_t firstVertex = 0;
+			std::vector<std::uint32_t> indices;
+			for( std::size_t m = 0; m < aMeshes.size(); ++m )
+			{
+				auto const& imesh = aMeshes.mesh( m );
+
+				indices.resize( imesh.indices.size() );
+				for( std::size_t i = 0; i < indices.size(); ++i )
+					indices[i] = imesh.indices[i] + firstVertex;
+
+				checked_write_( aOut, indices.size()*sizeof(std::uint32_t), indices.data() );
+				firstVertex += std::uint32_t(imesh.vert.size());
+			}
+
+			end_section_( sections[4] );
+		}
+
+		// Quantized vertices: per-mesh bounds first, then the vertices of all
+		// meshes (in the same order as "VERT").
+		if( aOptions.interleaved && aOptions.quantized )
+		{
+			begin_section_( sections[5] );
+
+			std::vector<QuantizationBounds> bounds;
+			bounds.reserve( aMeshes.size() );
+			for( std::size_t m = 0; m < aMeshes.size(); ++m )
+			{
+				auto const& imesh = aMeshes.mesh( m );
+				bounds.emplace_back( makeQuantizationBounds( imesh.aabbMin, imesh.aabbMax ) );
+			}
+
+			checked_write_( aOut, bounds.size()*sizeof(QuantizationBounds), bounds.data() );
+
+			std::vector<QuantizedVertex> vertices;
+			for( std::size_t m = 0; m < aMeshes.size(); ++m )
+			{
+				auto const& imesh = aMeshes.mesh( m );
+
+				vertices.resize( imesh.vert.size() );
+				for( std::size_t i = 0; i < vertices.size(); ++i )
+					vertices[i] = quantizeVertex( bounds[m], imesh.vert[i], imesh.norm[i], imesh.tangent[i], imesh.text[i] );
 
+				checked_write_( aOut, vertices.size()*sizeof(QuantizedVertex), vertices.data() );
+			}
+
+			end_section_( sections[5] );
+		}
+
+		// Tangents, mesh after mesh
+		if( aOptions.tangents )
+		{
+			begin_section_( sections[tangentSection] );
+
+			for( std::size_t m = 0; m < aMeshes.size(); ++m )
+			{
+				auto const& imesh = aMeshes.mesh( m );
+
+				assert( imesh.tangent.size() == imesh.vert.size() );
+				checked_write_( aOut, imesh.tangent.size()*sizeof(glm::vec4), imesh.tangent.data() );
+			}
+
+			end_section_( sections[tangentSection] );
+		}
+
+		// Meshlets: per-mesh ranges, followed by the meshlets, meshlet
+		// vertices and meshlet indices of all meshes. Offsets in the meshlets
+		// are relative to the mesh's ranges.
+		if( aOptions.meshlets )
+		{
+			begin_section_( sections[meshletSection] );
+
+			std::vector<MeshletRange_> ranges( aMeshes.size() );
+
+			MeshletHeader_ header{};
+			header.meshCount = std::uint32_t(aMeshes.size());
+			for( std::size_t i = 0; i < aMeshes.size(); ++i )
+			{
+				auto const& data = aMeshes.meshlets( i );
+
+				auto& range = ranges[i];
+				range = MeshletRange_{};
+
+				range.meshletOffset = header.meshletCount;
+				range.meshletCount = std::uint32_t(data.meshlets.size());
+				range.vertexOffset = header.vertexCount;
+				range.vertexCount = std::uint32_t(data.vertices.size());
+				range.indexOffset = header.indexCount;
+				range.indexCount = std::uint32_t(data.indices.size());
+
+				header.meshletCount += range.meshletCount;
+				header.vertexCount += range.vertexCount;
+				header.indexCount += range.indexCount;
+			}
+
+			header.meshletsOffset = align_up_( sections[meshletSection].offset + sizeof(MeshletHeader_) + ranges.size()*sizeof(MeshletRange_) );
+			header.verticesOffset = align_up_( header.meshletsOffset + std::uint64_t(header.meshletCount)*sizeof(Meshlet) );
+			header.indicesOffset = align_up_( header.verticesOffset + std::uint64_t(header.vertexCount)*sizeof(std::uint32_t) );
+
+			checked_write_( aOut, sizeof(MeshletHeader_), &header );
+			checked_write_( aOut, ranges.size()*sizeof(MeshletRange_), ranges.data() );
+
+			pad_to_( aOut, header.meshletsOffset );
+			for( std::size_t i = 0; i < aMeshes.size(); ++i )
+			{
+				auto const& data = aMeshes.meshlets( i );
+				checked_write_( aOut, data.meshlets.size()*sizeof(Meshlet), data.meshlets.data() );
+			}
+
+			pad_to_( aOut, header.verticesOffset );
+			for( std::size_t i = 0; i < aMeshes.size(); ++i )
+			{
+				auto const& data = aMeshes.meshlets( i );
+				checked_write_( aOut, data.vertices.size()*sizeof(std::uint32_t), data.vertices.data() );
+			}
+
+			pad_to_( aOut, header.indicesOffset );
+			for( std::size_t i = 0; i < aMeshes.size(); ++i )
+			{
+				auto const& data = aMeshes.meshlets( i );
+				checked_write_( aOut, data.indices.size()*sizeof(std::uint8_t), data.indices.data() );
+			}
+
+			end_section_( sections[meshletSection] );
+		}
+
+		// Levels of detail. Level 0 of each mesh refers to its "INDX" range;
+		// the indices of the remaining levels follow in this section, rebased
+		// like "INDX". firstIndex counts from the start of "INDX", as if the
+		// LOD indices were appended to it.
+		if( aOptions.interleaved && aOptions.lods )
+		{
+			begin_section_( sections[lodSection] );
+
+			std::uint32_t totalIndices = 0;
+			for( std::size_t i = 0; i < aMeshes.size(); ++i )
+				totalIndices += std::uint32_t(aMeshes.mesh( i ).indices.size());
+
+			std::vector<LodRange_> ranges;
+			std::vector<LodLevel_> levels;
+
+			std::uint32_t firstIndex = 0, lodIndex = totalIndices;
+			for( std::size_t i = 0; i < aMeshes.size(); ++i )
+			{
+				auto const indexCount = std::uint32_t(aMeshes.mesh( i ).indices.size());
+				auto const& chain = aMeshes.lods( i );
+
+				ranges.push_back( { std::uint32_t(levels.size()), std::uint32_t(1 + chain.size()) } );
+				levels.push_back( { firstIndex, indexCount, 0.f, 0 } );
+
+				for( auto const& lod : chain )
+				{
+					levels.push_back( { lodIndex, std::uint32_t(lod.indices.size()), lod.error, 0 } );
+					lodIndex += std::uint32_t(lod.indices.size());
+				}
+
+				firstIndex += indexCount;
+			}
+
+			LodHeader_ header{};
+			header.meshCount = std::uint32_t(aMeshes.size());
+			header.levelCount = std::uint32_t(levels.size());
+			header.indexCount = lodIndex - totalIndices;
+			header.levelsOffset = align_up_( sections[lodSection].offset + sizeof(LodHeader_) + ranges.size()*sizeof(LodRange_) );
+			header.indicesOffset = align_up_( header.levelsOffset + levels.size()*sizeof(LodLevel_) );
+
+			checked_write_( aOut, sizeof(LodHeader_), &header );
+			checked_write_( aOut, ranges.size()*sizeof(LodRange_), ranges.data() );
+
+			pad_to_( aOut, header.levelsOffset );
+			checked_write_( aOut, levels.size()*sizeof(LodLevel_), levels.data() );
 
+			pad_to_( aOut, header.indicesOffset );
+
+			std::uint32_t firstVertex = 0;
+			std::vector<std::uint32_t> indices;
+			for( std::size_t i = 0; i < aMeshes.size(); ++i )
+			{
+				for( auto const& lod : aMeshes.lods( i ) )
+				{
+					indices.resize( lod.indices.size() );
+					for( std::size_t j = 0; j < indices.size(); ++j )
+						indices[j] = lod.indices[j] + firstVertex;
+
+					checked_write_( aOut, indices.size()*sizeof(std::uint32_t), indices.data() );
+				}
+
+				firstVertex += std::uint32_t(aMeshes.mesh( i ).vert.size());
+			}
+
+			end_section_( sections[lodSection] );
+		}
+
+		// 16-bit indices. These are the indices of the MESH records (i.e.,
+		// relative to the mesh's first vertex), narrowed. Meshes with too many
+		// vertices are marked with firstIndex = 0xffffffff.
+		if( aOptions.indices16 )
+		{
+			begin_section_( sections[index16Section] );
+
+			std::vector<Index16Range_> ranges;
+			ranges.reserve( aMeshes.size() );
+
+			Index16Header_ header{};
+			header.meshCount = std::uint32_t(aMeshes.size());
+			for( std::size_t m = 0; m < aMeshes.size(); ++m )
+			{
+				auto const& imesh = aMeshes.mesh( m );
+				if( imesh.vert.size() > kMaxVertices16 )
+				{
+					ranges.push_back( { ~std::uint32_t(0), 0 } );
+					continue;
+				}
+
+				ranges.push_back( { header.indexCount, std::uint32_t(imesh.indices.size()) } );
+				header.indexCount += std::uint32_t(imesh.indices.size());
+			}
+
+			header.indicesOffset = align_up_( sections[index16Section].offset + sizeof(Index16Header_) + ranges.size()*sizeof(Index16Range_) );
+
+			checked_write_( aOut, sizeof(Index16Header_), &header );
+			checked_write_( aOut, ranges.size()*sizeof(Index16Range_), ranges.data() );
+
+			pad_to_( aOut, header.indicesOffset );
+
+			std::vector<std::uint16_t> indices;
+			for( std::size_t m = 0; m < aMeshes.size(); ++m )
+			{
+				auto const& imesh = aMeshes.mesh( m );
+				if( imesh.vert.size() > kMaxVertices16 )
+					continue;
+
+				indices.resize( imesh.indices.size() );
+				for( std::size_t i = 0; i < indices.size(); ++i )
+					indices[i] = std::uint16_t(imesh.indices[i]);
+
+				checked_write_( aOut, indices.size()*sizeof(std::uint16_t), indices.data() );
+			}
+
+			end_section_( sections[index16Section] );
+		}
+
+		// Bounding volume hierarchies: header, then the four arrays
+		if( aOptions.bvh )
+		{
+			begin_section_( sections[bvhSection] );
+
+			BvhHeader_ header{};
+			header.meshNodeCount = std::uint32_t(aBvh.meshes.nodes.size());
+			header.meshCount = std::uint32_t(aBvh.meshes.primitives.size());
+			header.triangleNodeCount = std::uint32_t(aBvh.triangles.nodes.size());
+			header.triangleCount = std::uint32_t(aBvh.triangleRefs.size());
+
+			std::uint64_t offset = sections[bvhSection].offset + sizeof(BvhHeader_);
+			auto const place_ = [&] (std::uint64_t aBytes) {
+				auto const ret = align_up_( offset );
+				offset = ret + aBytes;
+				return ret;
+			};
+
+			header.meshNodesOffset = place_( header.meshNodeCount*sizeof(BvhNode) );
+			header.meshesOffset = place_( header.meshCount*sizeof(std::uint32_t) );
+			header.triangleNodesOffset = place_( header.triangleNodeCount*sizeof(BvhNode) );
+			header.trianglesOffset = place_( header.triangleCount*sizeof(BvhTriangle) );
+
+			checked_write_( aOut, sizeof(BvhHeader_), &header );
+
+			pad_to_( aOut, header.meshNodesOffset );
+			checked_write_( aOut, aBvh.meshes.nodes.size()*sizeof(BvhNode), aBvh.meshes.nodes.data() );
+			pad_to_( aOut, header.meshesOffset );
+			checked_write_( aOut, aBvh.meshes.primitives.size()*sizeof(std::uint32_t), aBvh.meshes.primitives.data() );
+			pad_to_( aOut, header.triangleNodesOffset );
+			checked_write_( aOut, aBvh.triangles.nodes.size()*sizeof(BvhNode), aBvh.triangles.nodes.data() );
+			pad_to_( aOut, header.trianglesOffset );
+			checked_write_( aOut, aBvh.triangleRefs.size()*sizeof(BvhTriangle), aBvh.triangleRefs.data() );
+
+			assert( tell_( aOut ) == offset );
+			end_section_( sections[bvhSection] );
+		}
+
+		// Ambient occlusion, one byte per vertex in the same order as "VERT"
+		if( aOptions.interleaved && aOptions.ambientOcclusion )
+		{
+			assert( aAmbientOcclusion.size() == aMeshes.size() );
+
+			begin_section_( sections[aoSection] );
+
+			for( std::size_t i = 0; i < aMeshes.size(); ++i )
+			{
+				assert( aAmbientOcclusion[i].size() == aMeshes.mesh( i ).vert.size() );
+				checked_write_( aOut, aAmbientOcclusion[i].size()*sizeof(std::uint8_t), aAmbientOcclusion[i].data() );
+			}
+
+			end_section_( sections[aoSection] );
+		}
+
+		auto const endOffset = tell_( aOut );
+
+		// Patch section table and table of contents
+		seek_( aOut, tableOffset );
+		checked_write_( aOut, sections.size()*sizeof(SectionEntry_), sections.data() );
+
+		if( aOptions.toc )
+		{
+			seek_( aOut, tocOffset );
+			checked_write_( aOut, toc.size()*sizeof(TocEntry_), toc.data() );
+		}
+
+		seek_( aOut, endOffset );
+	}
+}
+
+namespace
+{
+	void pack_model_file_( std::filesystem::path const& aPath, BakeOptions_ const& aOptions, BakeLog_& aLog )
+	{
+		// Read back the aligned file. The writer needs to seek, so it is
+		// easier to pack the finished file than to write to memory.
+		auto const path = aPath.string();
+
+		std::vector<std::byte> image( std::size_t(std::filesystem::file_size( aPath )) );
+
+		FILE* fin = std::fopen( path.c_str(), "rb" );
+		if( !fin )
+			throw lut::Error( "Unable to open '%s' for reading", path.c_str() );
+
+		auto const read = std::fread( image.data(), 1, image.size(), fin );
+		std::fclose( fin );
+
+		if( read != image.size() )
+			throw lut::Error( "fread() failed: %zu instead of %zu", read, image.size() );
+
+		PackStats stats;
+		auto const packed = pack_aligned_model( image, stats, aOptions.packBlockSize, aOptions.threads );
+
+		// Decode again, to make sure that the file is good and to get an idea
+		// of the decoding speed
+		auto const threads = resolve_thread_count( aOptions.threads );
+		auto const serialMs = verify_packed_model( packed, image, 1 );
+		auto const parallelMs = verify_packed_model( packed, image, threads );
+
+		auto const gbps_ = [&] (double aMs) {
+			return double(image.size()) / (aMs * 1e6);
+		};
+
+		aLog.print( " - packed: %zu kB => %zu kB (ratio %.2f), %zu blocks, %.1f ms\n", stats.imageBytes/1024, stats.packedBytes/1024, double(stats.imageBytes) / stats.packedBytes, stats.blockCount, stats.packMs );
+		aLog.print( "   blocks per filter: none %zu, bytes2 %zu, bytes4 %zu, delta16 %zu, delta32 %zu, stored %zu\n", stats.filterBlocks[0], stats.filterBlocks[1], stats.filterBlocks[2], stats.filterBlocks[3], stats.filterBlocks[4], stats.storedBlocks );
+		aLog.print( "   decode: %.2f GB/s (1 thread), %.2f GB/s (%zu threads)\n", gbps_( serialMs ), gbps_( parallelMs ), threads );
+
+		FILE* fof = std::fopen( path.c_str(), "wb" );
+		if( !fof )
+			throw lut::Error( "Unable to open '%s' for writing", path.c_str() );
+
+		try
+		{
+			checked_write_( fof, packed.size(), packed.data() );
+		}
+		catch( ... )
+		{
+			std::fclose( fof );
+			throw;
+		}
+
+		std::fclose( fof );
+	}
+
+	ProcessedMesh_ process_mesh_( InputModel const& aModel, std::size_t aMeshIndex, BakeOptions_ const& aOptions, float aErrorTolerance )
+	{
+		ProcessedMesh_ ret;
+
+		auto const& imesh = aModel.meshes[aMeshIndex];
+		auto const endIndex = imesh.vertexStartIndex + imesh.vertexCount;
+
+		// Index
+		auto start = Clock_::now();
+
+		TriangleSoup soup;
+
+		soup.vert.reserve( imesh.vertexCount );
+		for( std::size_t i = imesh.vertexStartIndex; i < endIndex; ++i )
+			soup.vert.emplace_back( aModel.positions[i] );
+
+		soup.text.reserve( imesh.vertexCount );
+		for( std::size_t i = imesh.vertexStartIndex; i < endIndex; ++i )
+			soup.text.emplace_back( aModel.texcoords[i] );
+
+		soup.norm.reserve( imesh.vertexCount );
+		for( std::size_t i = imesh.vertexStartIndex; i < endIndex; ++i )
+			soup.norm.emplace_back( aModel.normals[i] );
+
+		ret.mesh = make_indexed_mesh( soup, aErrorTolerance );
+		ret.indexMs = ms_since_( start );
+
+		auto& mesh = ret.mesh;
+
+		// Optimize index/vertex order. This must happen before anything else
+		// is derived from the vertex order.
+		start = Clock_::now();
+
+		ret.cacheBefore = analyze_vertex_cache( mesh.indices, mesh.vert.size() );
+		ret.cacheAfter = ret.cacheBefore;
+
+		if( aOptions.optimizeVertexCache )
+		{
+			optimize_vertex_cache( mesh );
+			if( aOptions.optimizeOverdraw )
+				optimize_overdraw( mesh );
+			optimize_vertex_fetch( mesh );
+
+			ret.cacheAfter = analyze_vertex_cache( mesh.indices, mesh.vert.size() );
+		}
+
+		// Tangents are needed for "TANG" and are also part of the interleaved
+		// and quantized vertices
+		if( aOptions.aligned && (aOptions.tangents || aOptions.interleaved) )
+			compute_tangents( mesh );
+
+		// Meshlets and levels of detail
+		if( aOptions.aligned && aOptions.meshlets )
+			ret.meshlets = build_meshlets( mesh, aOptions.meshletMaxVertices, aOptions.meshletMaxTriangles );
+
+		if( aOptions.aligned && aOptions.interleaved && aOptions.lods )
+			ret.lods = build_lod_chain( mesh, aOptions.lodLevels, aOptions.lodRatio, aOptions.lodMaxRelativeError );
+
+		ret.postMs = ms_since_( start );
+
+		ret.vertexCount = mesh.vert.size();
+		ret.triangleCount = mesh.indices.size() / 3;
+
+		return ret;
+	}
+
+	std::vector<ProcessedMesh_> process_meshes_( InputModel const& aModel, BakeOptions_ const& aOptions, BakeCache const& aCache, std::vector<std::uint64_t>& aMeshKeys, float aErrorTolerance )
+	{
+		std::size_t const meshCount = aModel.meshes.size();
+
+		std::vector<ProcessedMesh_> ret( meshCount );
+
+		// Key meshes by their input vertices. Everything else that affects
+		// the per-mesh stages is part of the seed.
+		auto const seed = hash_mesh_options_( aOptions, aErrorTolerance );
+
+		aMeshKeys.resize( meshCount );
+		for( std::size_t i = 0; i < meshCount; ++i )
+		{
+			auto const& imesh = aModel.meshes[i];
+
+			auto key = hash_bytes( aModel.positions.data() + imesh.vertexStartIndex, imesh.vertexCount*sizeof(glm::vec3), seed );
+			key = hash_bytes( aModel.normals.data() + imesh.vertexStartIndex, imesh.vertexCount*sizeof(glm::vec3), key );
+			key = hash_bytes( aModel.texcoords.data() + imesh.vertexStartIndex, imesh.vertexCount*sizeof(glm::vec2), key );
+			aMeshKeys[i] = key;
+		}
+
+		// Bigger meshes take longer; start with those
+		std::vector<std::uint64_t> costs( meshCount );
+		for( std::size_t i = 0; i < meshCount; ++i )
+			costs[i] = aModel.meshes[i].vertexCount;
+
+		run_tasks( meshCount, [&] (std::size_t aIndex) {
+			auto const it = aCache.meshes.find( aMeshKeys[aIndex] );
+			if( aCache.meshes.end() != it && deserialize_mesh( it->second, ret[aIndex] ) )
+			{
+				auto& mesh = ret[aIndex];
+				mesh.cached = true;
+				mesh.vertexCount = mesh.mesh.vert.size();
+				mesh.triangleCount = mesh.mesh.indices.size() / 3;
+				return;
+			}
+
+			ret[aIndex] = process_mesh_( aModel, aIndex, aOptions, aErrorTolerance );
+		}, aOptions.threads, &costs );
+
+		return ret;
+	}
+
+	std::vector<ProcessedMesh_> stream_meshes_( ObjStreamModel const& aObj, BakeOptions_ const& aOptions, glm::mat4x4 const& aStaticTransform, MeshSource_& aSpill, float aErrorTolerance )
+	{
+		std::size_t const meshCount = aObj.model.meshes.size();
+
+		// Meshes are read and processed in batches of one mesh per thread.
+		// Each batch is spilled in order before the next one starts, and only
+		// the statistics are returned.
+		std::vector<ProcessedMesh_> ret( meshCount );
+
+		auto const batchSize = resolve_thread_count( aOptions.threads );
+
+		std::vector<ProcessedMesh_> batch;
+		for( std::size_t first = 0; first < meshCount; first += batchSize )
+		{
+			auto const count = std::min( batchSize, meshCount - first );
+
+			batch.clear();
+			batch.resize( count );
+
+			run_tasks( count, [&] (std::size_t aIndex) {
+				auto model = read_wavefront_obj_mesh( aObj, first + aIndex );
+				if( glm::mat4x4( 1.f ) != aStaticTransform )
+					apply_static_transform_( model, aStaticTransform );
+
+				batch[aIndex] = process_mesh_( model, 0, aOptions, aErrorTolerance );
+			}, aOptions.threads );
+
+			for( std::size_t i = 0; i < count; ++i )
+			{
+				aSpill.append( batch[i] );
+
+				auto& mesh = ret[first + i];
+				mesh = std::move(batch[i]);
+				mesh.mesh = IndexedMesh{};
+				mesh.meshlets = MeshletData{};
+				mesh.lods = std::vector<MeshLod>{};
+			}
+		}
+
+		return ret;
+	}
+
+	void print_mesh_stats_( InputModel const& aModel, std::vector<ProcessedMesh_> const& aProcessed, BakeOptions_ const& aOptions, double aWallMs, BakeLog_& aLog )
+	{
+		assert( aModel.meshes.size() == aProcessed.size() );
+
+		std::size_t const threads = std::min( resolve_thread_count( aOptions.threads ), std::max( aProcessed.size(), std::size_t(1) ) );
+
+		double indexMs = 0.0, postMs = 0.0;
+		for( auto const& mesh : aProcessed )
+		{
+			indexMs += mesh.indexMs;
+			postMs += mesh.postMs;
+		}
+
+		aLog.print( " - mesh processing: %.1f ms wall time on %zu thread(s); index %.1f ms, post-process %.1f ms (sum over meshes)\n", aWallMs, threads, indexMs, postMs );
+		aLog.print( "   vertex cache: FIFO %zu, ACMR/ATVR before => after\n", kVertexCacheAnalysisSize );
+
+		std::size_t totalTris = 0, totalVerts = 0;
+		double missesBefore = 0.0, missesAfter = 0.0;
+
+		for( std::size_t i = 0; i < aProcessed.size(); ++i )
+		{
+			auto const& mesh = aProcessed[i];
+
+			std::size_t const verts = mesh.vertexCount;
+			std::size_t const tris = mesh.triangleCount;
+
+			if( mesh.cached )
+				aLog.print( "   %-32s %7zu tris: ACMR %.3f => %.3f, ATVR %.3f => %.3f; (cached)\n", aModel.meshes[i].meshName.c_str(), tris, mesh.cacheBefore.acmr, mesh.cacheAfter.acmr, mesh.cacheBefore.atvr, mesh.cacheAfter.atvr );
+			else
+				aLog.print( "   %-32s %7zu tris: ACMR %.3f => %.3f, ATVR %.3f => %.3f; %7.2f + %7.2f ms\n", aModel.meshes[i].meshName.c_str(), tris, mesh.cacheBefore.acmr, mesh.cacheAfter.acmr, mesh.cacheBefore.atvr, mesh.cacheAfter.atvr, mesh.indexMs, mesh.postMs );
+
+			totalTris += tris;
+			totalVerts += verts;
+			missesBefore += double(mesh.cacheBefore.acmr) * tris;
+			missesAfter += double(mesh.cacheAfter.acmr) * tris;
+		}
+
+		if( totalTris && totalVerts )
+		{
+			aLog.print( "   %-32s %7zu tris: ACMR %.3f => %.3f, ATVR %.3f => %.3f; %7.2f + %7.2f ms\n", "(total)", totalTris,
+				missesBefore / totalTris, missesAfter / totalTris,
+				missesBefore / totalVerts, missesAfter / totalVerts,
+				indexMs, postMs
+			);
+		}
+	}
+}
+
+namespace
+{
+	std::unordered_map<std::string,TextureInfo_> find_unique_textures_( InputModel const& aModel )
+	{
+		std::unordered_map<std::string,TextureInfo_> unique;
+
+		std::uint32_t texid = 0;
+		auto const add_unique_ = [&] (std::string const& aPath, std::uint8_t aChannels)
+		{
+			if( aPath.empty() )
+				return;
+
+			TextureInfo_ info{};
+			info.uniqueId = texid;
+			info.channels = aChannels;
+
+			auto const [it, isNew] = unique.emplace( std::make_pair(aPath,info) );
+
+			if( isNew )
+				++texid;
+		};
+
+		for( auto const& mat : aModel.materials )
+		{
+			add_unique_( mat.baseColorTexturePath, 4 );
+			add_unique_( mat.roughnessTexturePath, 1 ); 
+			add_unique_( mat.metalnessTexturePath, 1 ); 
+			add_unique_( mat.alphaMaskTexturePath, 4 );  // assume == baseColor
+			add_unique_( mat.normalMapTexturePath, 4 );  // eh...
+		}
+
+		return unique;
+	}
+
+	std::unordered_map<std::string,TextureInfo_> new_paths_( std::unordered_map<std::string,TextureInfo_> aTextures, std::filesystem::path const& aTexDir, bool aBakedTextures )
+	{
+		for( auto& entry : aTextures )
+		{
+			std::filesystem::path const originalPath( entry.first );
+			auto filename = originalPath.filename();
+			if( aBakedTextures )
+				filename.replace_extension( kBakedTextureExtension );
+
+			auto const newpath = aTexDir / filename;
+		
+			auto& info = entry.second;
+			info.newPath = newpath.string();
+		}
+
+		// Note: aTextures is still local to the function, so there is no need
+		// to explicitly std::move() it. However, since it is passed in as an
+		// argument, NRVO is unlikely to occur.
+		return aTextures; 
+	}
+}
+
+namespace
+{
+	template< typename tType >
+	std::uint64_t hash_value_( tType const& aValue, std::uint64_t aSeed )
+	{
+		return hash_bytes( &aValue, sizeof(tType), aSeed );
+	}
+
+	std::uint64_t hash_options_( BakeOptions_ const& aOptions, glm::mat4x4 const& aStaticTransform )
+	{
+		// Options that only affect the whole file. The per-mesh ones are
+		// included via hash_mesh_options_(). Options that do not change the
+		// output (`threads` and `incremental`) are left out.
+		auto hash = hash_mesh_options_( aOptions, 0.f );
+		hash = hash_value_( std::uint8_t(aOptions.quantized), hash );
+		hash = hash_value_( std::uint8_t(aOptions.indices16), hash );
+		hash = hash_value_( std::uint8_t(aOptions.toc), hash );
+		hash = hash_value_( std::uint8_t(aOptions.bvh), hash );
+		hash = hash_value_( std::uint8_t(aOptions.ambientOcclusion), hash );
+		hash = hash_value_( std::uint64_t(aOptions.aoRays), hash );
+		hash = hash_value_( aOptions.aoDistance, hash );
+		hash = hash_value_( std::uint8_t(aOptions.packed), hash );
+		hash = hash_value_( std::uint64_t(aOptions.packBlockSize), hash );
+		hash = hash_value_( std::uint8_t(aOptions.bakeTextures), hash );
+		hash = hash_value_( std::uint8_t(aOptions.mergeByMaterial), hash );
+		hash = hash_value_( std::uint8_t(aOptions.streaming), hash );
+		hash = hash_bytes( &aStaticTransform[0][0], sizeof(glm::mat4x4), hash );
+		return hash;
+	}
+
+	std::uint64_t hash_mesh_options_( BakeOptions_ const& aOptions, float aErrorTolerance )
+	{
+		// Options used by process_mesh_(). Fields are hashed individually,
+		// since BakeOptions_ contains padding.
+		auto hash = hash_value_( kBakeCacheVersion, 0 );
+		hash = hash_value_( aErrorTolerance, hash );
+		hash = hash_value_( std::uint8_t(aOptions.optimizeVertexCache), hash );
+		hash = hash_value_( std::uint8_t(aOptions.optimizeOverdraw), hash );
+		hash = hash_value_( std::uint8_t(aOptions.aligned), hash );
+		hash = hash_value_( std::uint8_t(aOptions.interleaved), hash );
+		hash = hash_value_( std::uint8_t(aOptions.tangents), hash );
+		hash = hash_value_( std::uint8_t(aOptions.meshlets), hash );
+		hash = hash_value_( std::uint64_t(aOptions.meshletMaxVertices), hash );
+		hash = hash_value_( std::uint64_t(aOptions.meshletMaxTriangles), hash );
+		hash = hash_value_( std::uint8_t(aOptions.lods), hash );
+		hash = hash_value_( std::uint64_t(aOptions.lodLevels), hash );
+		hash = hash_value_( aOptions.lodRatio, hash );
+		hash = hash_value_( aOptions.lodMaxRelativeError, hash );
+		return hash;
+	}
+
+	bool is_up_to_date_( BakeCache const& aCache, std::uint64_t aOptionsHash, char const* aInputOBJ, std::filesystem::path const& aOutput )
+	{
+		if( aCache.inputs.empty() || aCache.optionsHash != aOptionsHash )
+			return false;
+
+		if( aCache.inputs.front().path != aInputOBJ )
+			return false;
+
+		for( auto const& input : aCache.inputs )
+		{
+			if( !file_matches( input.path, input.stamp ) )
+				return false;
+		}
+
+		return file_matches( aOutput, aCache.output );
+	}
+
+	BakeCache::Input stamp_input_( std::string const& aPath, BakeCache const& aPrevious )
+	{
+		FileStamp const* known = nullptr;
+		for( auto const& input : aPrevious.inputs )
+		{
+			if( input.path == aPath )
+				known = &input.stamp;
+		}
+
+		BakeCache::Input ret;
+		ret.path = aPath;
+
+		// A missing input (e.g., a material library that does not exist)
+		// keeps an empty stamp; it will not match if the file shows up later.
+		stamp_file( aPath, ret.stamp, known );
+
+		return ret;
+	}
+
+	std::vector<BakeCache::Texture> bake_textures_( std::vector<BakeCache::Texture> aTextures, std::filesystem::path const& aRootDir, BakeCache const& aPrevious, BakeOptions_ const& aOptions, BakeLog_& aLog, std::size_t& aFailed )
+	{
+		auto const start = Clock_::now();
+
+		std::unordered_map<std::string,BakeCache::Texture const*> previous;
+		for( auto const& texture : aPrevious.textures )
+			previous.emplace( texture.dest, &texture );
+
+		enum class Result_ { upToDate, baked, failed };
+
+		struct Outcome_
+		{
+			Result_ result = Result_::failed;
+			std::string error;
+			BakedTextureStats stats;
+		};
+
+		// Decoding and mipmapping dominate; textures are independent.
+		std::vector<Outcome_> outcomes( aTextures.size() );
+		run_tasks( aTextures.size(), [&] (std::size_t aIndex) {
+			auto& texture = aTextures[aIndex];
+			auto& outcome = outcomes[aIndex];
+
+			auto const dest = aRootDir / texture.dest;
+
+			auto const it = previous.find( texture.dest );
+			auto const* known = previous.end() != it && it->second->source == texture.source && it->second->channels == texture.channels
+				? it->second
+				: nullptr
+			;
+
+			if( !stamp_file( texture.source, texture.sourceStamp, known ? &known->sourceStamp : nullptr ) )
+			{
+				outcome.error = "unable to read '" + texture.source + "'";
+				return;
+			}
+
+			// Skip if neither the source nor the result changed
+			if( known && known->sourceStamp.hash == texture.sourceStamp.hash && file_matches( dest, known->destStamp ) )
+			{
+				texture.destStamp = known->destStamp;
+				outcome.result = Result_::upToDate;
+				return;
+			}
+
+			std::error_code ec;
+			std::filesystem::create_directories( dest.parent_path(), ec );
+
+			if( texture.channels )
+			{
+				try
+				{
+					outcome.stats = bake_texture( texture.source, dest, std::uint8_t(texture.channels) );
+				}
+				catch( std::exception const& eErr )
+				{
+					outcome.error = eErr.what();
+					return;
+				}
+			}
+			else if( !std::filesystem::copy_file( texture.source, dest, std::filesystem::copy_options::overwrite_existing, ec ) )
+			{
+				outcome.error = "copy_file(): '" + dest.string() + "' failed: " + ec.message();
+				return;
+			}
+
+			if( !stamp_file( dest, texture.destStamp ) )
+			{
+				outcome.error = "unable to read back '" + dest.string() + "'";
+				return;
+			}
+
+			outcome.result = Result_::baked;
+		}, aOptions.threads );
+
+		std::size_t baked = 0, upToDate = 0, errors = 0;
+		std::size_t sourceBytes = 0, bakedBytes = 0;
+		for( auto const& outcome : outcomes )
+		{
+			switch( outcome.result )
+			{
+				case Result_::upToDate: ++upToDate; break;
+				case Result_::baked: ++baked; break;
+				case Result_::failed:
+					++errors;
+					std::fprintf( stderr, "Texture failed: %s\n", outcome.error.c_str() );
+					break;
+			}
+
+			sourceBytes += outcome.stats.sourceBytes;
+			bakedBytes += outcome.stats.bakedBytes;
+		}
+
+		auto const total = aTextures.size();
+		aLog.print( "%s %zu textures out of %zu (%zu up to date, %zu failed) in %.1f ms.\n", aOptions.bakeTextures ? "Baked" : "Copied", baked, total, upToDate, errors, ms_since_( start ) );
+		if( aOptions.bakeTextures && baked )
+			aLog.print( " - mip chains: %zu kB for %zu kB of level 0 texels\n", bakedBytes/1024, sourceBytes/1024 );
+
+		aFailed = errors;
+		return aTextures;
+	}
+
+	bool same_stamps_( std::vector<BakeCache::Texture> const& aA, std::vector<BakeCache::Texture> const& aB )
+	{
+		auto const same_ = [] (FileStamp const& aX, FileStamp const& aY) {
+			return aX.size == aY.size && aX.mtime == aY.mtime && aX.hash == aY.hash;
+		};
+
+		if( aA.size() != aB.size() )
+			return false;
+
+		for( std::size_t i = 0; i < aA.size(); ++i )
+		{
+			if( aA[i].dest != aB[i].dest || !same_( aA[i].sourceStamp, aB[i].sourceStamp ) || !same_( aA[i].destStamp, aB[i].destStamp ) )
+				return false;
+		}
+
+		return true;
+	}
+}
+
+namespace
+{
+	std::size_t parse_count_( char const* aOption, char const* aValue )
+	{
+		char* end = nullptr;
+		auto const value = std::strtoull( aValue, &end, 10 );
+		if( end == aValue || *end != '\0' )
+			throw lut::Error( "%s: expected a number, got '%s'", aOption, aValue );
+
+		return std::size_t(value);
+	}
+
+	float parse_number_( char const* aOption, char const* aValue )
+	{
+		char* end = nullptr;
+		auto const value = std::strtof( aValue, &end );
+		if( end == aValue || *end != '\0' )
+			throw lut::Error( "%s: expected a number, got '%s'", aOption, aValue );
+
+		return value;
+	}
+
+	std::string default_output_( std::filesystem::path const& aInput, std::string const& aOutputDir )
+	{
+		auto output = aOutputDir.empty()
+			? aInput
+			: std::filesystem::path( aOutputDir ) / aInput.filename()
+		;
+		output.replace_extension( "comp5822mesh" );
+		return output.string();
+	}
+
+	CommandLine_ parse_command_line_( int aArgc, char* aArgv[] )
+	{
+		CommandLine_ ret;
+
+		std::vector<std::string> inputs, manifests;
+		for( int i = 1; i < aArgc; ++i )
+		{
+			std::string const arg = aArgv[i];
+
+			auto const value_ = [&] () -> char const* {
+				if( i+1 >= aArgc )
+					throw lut::Error( "%s: missing argument (see --help)", arg.c_str() );
+				return aArgv[++i];
+			};
+
+			if( "-h" == arg || "--help" == arg )
+				ret.help = true;
+			else if( "-o" == arg || "--output-dir" == arg )
+				ret.outputDir = value_();
+			else if( "-m" == arg || "--manifest" == arg )
+				manifests.emplace_back( value_() );
+			else if( "-j" == arg || "--jobs" == arg )
+				ret.jobs = parse_count_( arg.c_str(), value_() );
+			else if( "-t" == arg || "--threads" == arg )
+				ret.options.threads = parse_count_( arg.c_str(), value_() );
+			else if( "--memory" == arg )
+				ret.memoryBudget = std::uint64_t(parse_count_( arg.c_str(), value_() )) << 20;
+			else if( "--packed" == arg )
+				ret.options.packed = true;
+			else if( "--default-variant" == arg )
+				ret.options.aligned = false;
+			else if( "--no-incremental" == arg )
+				ret.options.incremental = false;
+			else if( "--no-optimize" == arg )
+				ret.options.optimizeVertexCache = false;
+			else if( "--no-overdraw" == arg )
+				ret.options.optimizeOverdraw = false;
+			else if( "--no-meshlets" == arg )
+				ret.options.meshlets = false;
+			else if( "--no-lods" == arg )
+				ret.options.lods = false;
+			else if( "--no-quantized" == arg )
+				ret.options.quantized = false;
+			else if( "--no-indices16" == arg )
+				ret.options.indices16 = false;
+			else if( "--no-toc" == arg )
+				ret.options.toc = false;
+			else if( "--no-bvh" == arg )
+				ret.options.bvh = false;
+			else if( "--no-ao" == arg )
+				ret.options.ambientOcclusion = false;
+			else if( "--ao-rays" == arg )
+				ret.options.aoRays = std::max( parse_count_( arg.c_str(), value_() ), std::size_t(1) );
+			else if( "--ao-distance" == arg )
+				ret.options.aoDistance = parse_number_( arg.c_str(), value_() );
+			else if( "--copy-textures" == arg )
+				ret.options.bakeTextures = false;
+			else if( "--merge" == arg )
+				ret.options.mergeByMaterial = true;
+			else if( "--streaming" == arg )
+				ret.options.streaming = true;
+			else if( "--scale" == arg )
+			{
+				auto const factor = parse_number_( arg.c_str(), value_() );
+
+				// Transforms apply in the order they are given
+				auto scale = glm::mat4x4( 1.f );
+				scale[0][0] = scale[1][1] = scale[2][2] = factor;
+				ret.staticTransform = scale * ret.staticTransform;
+			}
+			else if( "--translate" == arg )
+			{
+				auto translation = glm::mat4x4( 1.f );
+				for( int j = 0; j < 3; ++j )
+					translation[3][j] = parse_number_( arg.c_str(), value_() );
+
+				ret.staticTransform = translation * ret.staticTransform;
+			}
+			else if( !arg.empty() && '-' == arg[0] )
+				throw lut::Error( "Unknown option '%s' (see --help)", arg.c_str() );
+			else
+				inputs.emplace_back( arg );
+		}
+
+		// Streaming keeps only a few meshes in memory at a time, which rules
+		// out everything that needs all of them (see BakeOptions_::streaming)
+		if( ret.options.streaming )
+		{
+			if( ret.options.mergeByMaterial )
+				throw lut::Error( "--streaming and --merge cannot be combined" );
+
+			ret.options.bvh = false;
+			ret.options.ambientOcclusion = false;
+		}
+
+		// Outputs depend on --output-dir, which may come after the inputs
+		for( auto const& input : inputs )
+			ret.models.push_back( { input, default_output_( input, ret.outputDir ) } );
+
+		for( auto const& manifest : manifests )
+			read_manifest_( ret, manifest );
+
+		return ret;
+	}
+
+	void print_usage_( char const* aProgram )
+	{
+		std::printf( "Usage: %s [options] [input.obj ...]\n", aProgram );
+		std::printf( "\n" );
+		std::printf( "Bakes Wavefront OBJ models into .comp5822mesh files. Without any inputs,\n" );
+		std::printf( "the default model is baked.\n" );
+		std::printf( "\n" );
+		std::printf( "Options:\n" );
+		std::printf( "  -o, --output-dir DIR   write outputs to DIR (default: next to each input)\n" );
+		std::printf( "  -m, --manifest FILE    also bake the models listed in FILE; one model per\n" );
+		std::printf( "                         line: input.obj [output.comp5822mesh]. Relative\n" );
+		std::printf( "                         paths are relative to FILE; '#' starts a comment\n" );
+		std::printf( "  -j, --jobs N           bake up to N models concurrently (default: 0 = one\n" );
+		std::printf( "                         per thread)\n" );
+		std::printf( "  -t, --threads N        total worker threads (default: 0 = one per hardware\n" );
+		std::printf( "                         thread); split between concurrent models\n" );
+		std::printf( "      --memory MB        memory budget for concurrent models (default: %llu)\n", (unsigned long long)(CommandLine_{}.memoryBudget >> 20) );
+		std::printf( "      --packed           write the compressed \"packed-cw3\" variant\n" );
+		std::printf( "      --default-variant  write the original \"default-cw3\" variant\n" );
+		std::printf( "      --no-incremental   ignore and do not write the bake cache\n" );
+		std::printf( "      --no-optimize      do not reorder for the vertex cache (or overdraw)\n" );
+		std::printf( "      --no-overdraw      do not reorder for overdraw\n" );
+		std::printf( "      --no-meshlets      do not write meshlets\n" );
+		std::printf( "      --no-lods          do not write levels of detail\n" );
+		std::printf( "      --no-quantized     do not write quantized vertices\n" );
+		std::printf( "      --no-indices16     do not write 16-bit indices\n" );
+		std::printf( "      --no-toc           do not write the mesh table of contents\n" );
+		std::printf( "      --no-bvh           do not write bounding volume hierarchies\n" );
+		std::printf( "      --no-ao            do not bake per-vertex ambient occlusion\n" );
+		std::printf( "      --ao-rays N        ambient occlusion rays per vertex (default: %zu)\n", BakeOptions_{}.aoRays );
+		std::printf( "      --ao-distance F    ambient occlusion ray length, relative to the\n" );
+		std::printf( "                         model's diagonal (default: %g)\n", double(BakeOptions_{}.aoDistance) );
+		std::printf( "      --copy-textures    copy source images instead of baking mip chains\n" );
+		std::printf( "      --merge            merge meshes with the same material (one draw per\n" );
+		std::printf( "                         material)\n" );
+		std::printf( "      --streaming        import the OBJ mesh by mesh to bound the memory\n" );
+		std::printf( "                         use; implies --no-bvh and --no-ao\n" );
+		std::printf( "      --scale S          scale all vertices by S\n" );
+		std::printf( "      --translate X Y Z  move all vertices by (X,Y,Z); --scale and\n" );
+		std::printf( "                         --translate apply in the order given\n" );
+		std::printf( "  -h, --help             show this message\n" );
+		std::printf( "\n" );
+		std::printf( "Exits with a non-zero status if any model fails to bake.\n" );
+	}
+
+	void read_manifest_( CommandLine_& aCmd, std::filesystem::path const& aManifest )
+	{
+		std::ifstream fin( aManifest );
+		if( !fin )
+			throw lut::Error( "Unable to open manifest '%s'", aManifest.string().c_str() );
+
+		auto const base = aManifest.parent_path();
+
+		std::size_t lineNumber = 0;
+		for( std::string line; std::getline( fin, line ); )
+		{
+			++lineNumber;
+
+			if( auto const comment = line.find( '#' ); std::string::npos != comment )
+				line.erase( comment );
+
+			// Paths may be quoted if they contain spaces
+			std::istringstream iss( line );
+
+			std::string input, output, extra;
+			if( !(iss >> std::quoted( input )) )
+				continue;
+
+			iss >> std::quoted( output );
+			if( iss >> extra )
+				throw lut::Error( "%s:%zu: unexpected '%s'", aManifest.string().c_str(), lineNumber, extra.c_str() );
+
+			auto const inputPath = base / input;
+
+			CommandLine_::Model model;
+			model.input = inputPath.string();
+			model.output = output.empty()
+				? default_output_( inputPath, aCmd.outputDir )
+				: (base / output).string()
+			;
+
+			aCmd.models.emplace_back( std::move(model) );
+		}
+	}
+
+	bool bake_batch_( CommandLine_ const& aCmd )
+	{
+		auto const start = Clock_::now();
+		auto const count = aCmd.models.size();
+
+		// Models that write the same output (or texture directory) would
+		// overwrite each other
+		std::unordered_set<std::string> outputs;
+		for( auto const& model : aCmd.models )
+		{
+			auto const output = std::filesystem::path( model.output ).lexically_normal().string();
+			if( !outputs.insert( output ).second )
+				throw lut::Error( "Several models are baked to '%s'", output.c_str() );
+		}
+
+		// Split the threads between concurrent models. Each model processes
+		// its meshes on its share of the threads.
+		auto const threads = resolve_thread_count( aCmd.options.threads );
+		auto const jobs = std::max<std::size_t>( 1, std::min( aCmd.jobs ? aCmd.jobs : threads, count ) );
+
+		auto options = aCmd.options;
+		options.threads = std::max<std::size_t>( 1, threads / jobs );
+
+		// Bigger models take longer (and more memory); start with those
+		std::vector<std::uint64_t> inputBytes( count );
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			std::error_code ec;
+			auto const bytes = std::filesystem::file_size( aCmd.models[i].input, ec );
+			inputBytes[i] = ec ? 0 : bytes;
+		}
+
+		if( count > 1 )
+			std::printf( "Baking %zu models, %zu at a time on %zu thread(s) each\n", count, jobs, options.threads );
+
+		struct Result_
+		{
+			ModelStats_ stats;
+			std::string error;
+			double ms = 0.0;
+		};
+
+		std::vector<Result_> results( count );
+		MemoryBudget_ budget( aCmd.memoryBudget );
+
+		run_tasks( count, [&] (std::size_t aIndex) {
+			auto const& model = aCmd.models[aIndex];
+			auto& result = results[aIndex];
+
+			auto const estimate = inputBytes[aIndex] * (options.streaming ? kStreamingMemoryPerInputByte : kMemoryPerInputByte);
+			budget.acquire( estimate );
+
+			BakeLog_ log( jobs > 1 );
+			auto const modelStart = Clock_::now();
+
+			try
+			{
+				result.stats = process_model_( model.output.c_str(), model.input.c_str(), log, options, aCmd.staticTransform );
+			}
+			catch( std::exception const& eErr )
+			{
+				result.error = eErr.what();
+			}
+			catch( ... )
+			{
+				result.error = "unknown exception";
+			}
+
+			result.ms = ms_since_( modelStart );
+			budget.release( estimate );
+
+			if( !result.error.empty() )
+				log.print( "%s: FAILED: %s\n", model.input.c_str(), result.error.c_str() );
+
+			log.flush();
+		}, jobs, &inputBytes );
+
+		// Summary
+		std::size_t baked = 0, upToDate = 0, failed = 0;
+		for( auto const& result : results )
+		{
+			if( !result.error.empty() )
+				++failed;
+			else if( result.stats.upToDate )
+				++upToDate;
+			else
+				++baked;
+		}
+
+		if( count > 1 )
+		{
+			std::printf( "\n%-40s %-10s %8s %8s %10s %10s %10s\n", "model", "status", "meshes", "reused", "triangles", "size (kB)", "time (ms)" );
+			for( std::size_t i = 0; i < count; ++i )
+			{
+				auto const& result = results[i];
+				auto const& stats = result.stats;
+
+				char const* status = !result.error.empty()
+					? "FAILED"
+					: (stats.upToDate ? "up to date" : "baked")
+				;
+
+				std::printf( "%-40s %-10s %8zu %8zu %10zu %10llu %10.1f\n", aCmd.models[i].input.c_str(), status, stats.meshes, stats.reusedMeshes, stats.triangles, (unsigned long long)(stats.outputBytes/1024), result.ms );
+			}
+		}
+
+		std::printf( "%zu model(s) in %.1f ms: %zu baked, %zu up to date, %zu failed\n", count, ms_since_( start ), baked, upToDate, failed );
+
+		return 0 == failed;
+	}
+}
+
+namespace
+{
+	void BakeLog_::print( char const* aFormat, ... )
+	{
+		std::va_list args;
+		va_start( args, aFormat );
+
+		if( !mBuffered )
+		{
+			std::vprintf( aFormat, args );
+			va_end( args );
+			return;
+		}
+
+		std::va_list copy;
+		va_copy( copy, args );
+		auto const length = std::vsnprintf( nullptr, 0, aFormat, copy );
+		va_end( copy );
+
+		if( length > 0 )
+		{
+			auto const offset = mText.size();
+			mText.resize( offset + std::size_t(length) + 1 );
+			std::vsnprintf( mText.data() + offset, std::size_t(length) + 1, aFormat, args );
+			mText.resize( offset + std::size_t(length) );
+		}
+
+		va_end( args );
+	}
+
+	void BakeLog_::flush()
+	{
+		static std::mutex mutex;
+
+		std::unique_lock lock( mutex );
+		std::fwrite( mText.data(), 1, mText.size(), stdout );
+		std::fflush( stdout );
+
+		mText.clear();
+	}
+
+	MeshSource_::MeshSource_( std::vector<IndexedMesh> const& aIndexed, std::vector<MeshletData> const& aMeshlets, std::vector<std::vector<MeshLod>> const& aLods ) noexcept
+		: mIndexed( &aIndexed )
+		, mMeshlets( &aMeshlets )
+		, mLods( &aLods )
+	{}
+
+	MeshSource_::MeshSource_( std::filesystem::path aSpillPath )
+		: mSpillPath( std::move(aSpillPath) )
+	{
+		mSpill = std::fopen( mSpillPath.string().c_str(), "w+b" );
+		if( !mSpill )
+			throw lut::Error( "Unable to open '%s' for writing", mSpillPath.string().c_str() );
+	}
+
+	MeshSource_::~MeshSource_()
+	{
+		if( mSpill )
+		{
+			std::fclose( mSpill );
+
+			std::error_code ec;
+			std::filesystem::remove( mSpillPath, ec );
+		}
+	}
+
+	void MeshSource_::append( CachedMesh const& aMesh )
+	{
+		assert( mSpill );
+
+		auto const data = serialize_mesh( aMesh );
+
+		seek_( mSpill, mOffsets.back() );
+		checked_write_( mSpill, data.size(), data.data() );
+		mOffsets.emplace_back( mOffsets.back() + data.size() );
+	}
+
+	std::size_t MeshSource_::size() const noexcept
+	{
+		return mSpill ? mOffsets.size()-1 : mIndexed->size();
+	}
+
+	IndexedMesh const& MeshSource_::mesh( std::size_t aIndex )
+	{
+		assert( aIndex < size() );
+		return mSpill ? load_( aIndex ).mesh : (*mIndexed)[aIndex];
+	}
+
+	MeshletData const& MeshSource_::meshlets( std::size_t aIndex )
+	{
+		assert( aIndex < size() );
+		return mSpill ? load_( aIndex ).meshlets : (*mMeshlets)[aIndex];
+	}
+
+	std::vector<MeshLod> const& MeshSource_::lods( std::size_t aIndex )
+	{
+		assert( aIndex < size() );
+		return mSpill ? load_( aIndex ).lods : (*mLods)[aIndex];
+	}
+
+	CachedMesh const& MeshSource_::load_( std::size_t aIndex )
+	{
+		if( mLoaded == aIndex )
+			return mCurrent;
+
+		mBuffer.resize( std::size_t(mOffsets[aIndex+1] - mOffsets[aIndex]) );
+
+		seek_( mSpill, mOffsets[aIndex] );
+		if( std::fread( mBuffer.data(), 1, mBuffer.size(), mSpill ) != mBuffer.size() || !deserialize_mesh( mBuffer, mCurrent ) )
+			throw lut::Error( "Unable to read mesh %zu from '%s'", aIndex, mSpillPath.string().c_str() );
+
+		mLoaded = aIndex;
+		return mCurrent;
+	}
+
+
+	void MemoryBudget_::acquire( std::uint64_t aBytes )
+	{
+		std::unique_lock lock( mMutex );
+		mReleased.wait( lock, [&] {
+			return 0 == mInUse || mInUse + aBytes <= mLimit;
+		} );
+
+		mInUse += aBytes;
+	}
+
+	void MemoryBudget_::release( std::uint64_t aBytes )
+	{
+		{
+			std::unique_lock lock( mMutex );
+			mInUse -= aBytes;
+		}
+
+		mReleased.notify_all();
+	}
+}
@@ -0,0 +1,447 @@
+#include "ObjModelCache.h"
+
+#include <array>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <string_view>
+#include <type_traits>
+
+#include <cstdint>
+#include <cstring>
+
+#include "labutils/error.hpp"
+#include "MappedFile.h"
+
+namespace lut = labutils;
+
+namespace
+{
+	constexpr char kObjModelCacheMagic[16] = "\0\0COMP5822Mobjc";
+
+	// Bump this whenever loadSimpleWavefrontObj() changes what it produces, or
+	// when the layout below changes.
+	constexpr std::uint32_t kObjModelCacheVersion = 2;
+
+	ObjFileStamp stamp_(const std::string& path);
+
+	// Material library referenced by the OBJ, resolved the same way rapidobj
+	// does. Empty if the OBJ does not reference one.
+	std::string material_library_(const std::string& objPath);
+
+	class CacheWriter_
+	{
+	public:
+		template<typename T>
+		void pod(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			auto const* bytes = reinterpret_cast<const std::byte*>(&value);
+			mBuffer.insert(mBuffer.end(), bytes, bytes + sizeof(T));
+		}
+
+		void string(const std::string& str)
+		{
+			pod(std::uint64_t(str.size()));
+			auto const* bytes = reinterpret_cast<const std::byte*>(str.data());
+			mBuffer.insert(mBuffer.end(), bytes, bytes + str.size());
+		}
+
+		template<typename T>
+		void array(const std::vector<T>& values)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			pod(std::uint64_t(values.size()));
+			auto const* bytes = reinterpret_cast<const std::byte*>(values.data());
+			mBuffer.insert(mBuffer.end(), bytes, bytes + values.size() * sizeof(T));
+		}
+
+		const std::vector<std::byte>& buffer() const noexcept { return mBuffer; }
+
+	private:
+		std::vector<std::byte> mBuffer;
+	};
+
+	// Bounds-checked reader over the mapped cache. Reads past the end set the
+	// failure flag and return zeroes/empty values; check ok() once at the end.
+	class CacheReader_
+	{
+	public:
+		CacheReader_(const std::byte* data, std::size_t size)
+			: mPos(data), mEnd(data + size)
+		{}
+
+		template<typename T>
+		T pod()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			T value{};
+			if (take_(sizeof(T)))
+				std::memcpy(&value, mPos - sizeof(T), sizeof(T));
+			return value;
+		}
+
+		std::string string()
+		{
+			auto const size = pod<std::uint64_t>();
+			if (!take_(size))
+				return {};
+			return std::string(reinterpret_cast<const char*>(mPos - size), std::size_t(size));
+		}
+
+		template<typename T>
+		std::vector<T> array()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			auto const count = pod<std::uint64_t>();
+			if (count > std::uint64_t(mEnd - mPos) / sizeof(T) || !take_(count * sizeof(T)))
+			{
+				mOk = false;
+				return {};
+			}
+
+			std::vector<T> values(static_cast<std::size_t>(count));
+			std::memcpy(static_cast<void*>(values.data()), mPos - count * sizeof(T), std::size_t(count) * sizeof(T));
+			return values;
+		}
+
+		bool ok() const noexcept { return mOk; }
+		bool atEnd() const noexcept { return mPos == mEnd; }
+
+	private:
+		bool take_(std::uint64_t bytes)
+		{
+			if (!mOk || bytes > std::uint64_t(mEnd - mPos))
+			{
+				mOk = false;
+				return false;
+			}
+
+			mPos += bytes;
+			return true;
+		}
+
+		const std::byte* mPos;
+		const std::byte* mEnd;
+		bool mOk = true;
+	};
+
+	enum MeshFlags_ : std::uint32_t
+	{
+		kMeshTextured = 1u << 0,
+		kMeshAlphaTextured = 1u << 1,
+		kMeshNormalTextured = 1u << 2,
+		kMeshRoughnessTextured = 1u << 3,
+		kMeshMetallicTextured = 1u << 4,
+	};
+}
+
+std::string simpleModelCachePath(const std::string& objPath)
+{
+	return objPath + ".simplemodel";
+}
+
+std::optional<SimpleModel> readSimpleModelCache(const std::string& objPath)
+{
+	auto const cachePath = simpleModelCachePath(objPath);
+
+	std::error_code ec;
+	if (!std::filesystem::is_regular_file(cachePath, ec))
+		return std::nullopt;
+
+	MappedFile file;
+	try
+	{
+		file = MappedFile(cachePath);
+	}
+	catch (const lut::Error&)
+	{
+		return std::nullopt;
+	}
+
+	CacheReader_ in(file.data(), file.size());
+
+	// Header; bail out as soon as anything does not match.
+	auto const magic = in.pod<std::array<char, sizeof(kObjModelCacheMagic)>>();
+	if (!in.ok() || 0 != std::memcmp(magic.data(), kObjModelCacheMagic, sizeof(kObjModelCacheMagic)))
+		return std::nullopt;
+
+	if (kObjModelCacheVersion != in.pod<std::uint32_t>() || sizeof(Vertex) != in.pod<std::uint32_t>())
+		return std::nullopt;
+
+	if (objPath != in.string())
+		return std::nullopt;
+
+	auto const dependencyCount = in.pod<std::uint32_t>();
+	for (std::uint32_t i = 0; i <= dependencyCount && in.ok(); ++i)
+	{
+		// The OBJ itself comes first, followed by its material library.
+		auto const path = 0 == i ? objPath : in.string();
+
+		ObjFileStamp cached;
+		cached.size = in.pod<std::uint64_t>();
+		cached.modified = in.pod<std::int64_t>();
+
+		if (!in.ok() || !(cached == stamp_(path)))
+			return std::nullopt;
+	}
+
+	// Model
+	SimpleModel model;
+	model.modelSourcePath = objPath;
+
+	auto const materialCount = in.pod<std::uint64_t>();
+	for (std::uint64_t i = 0; i < materialCount && in.ok(); ++i)
+	{
+		SimpleMaterialInfo mi;
+
+		mi.materialName = in.string();
+		mi.diffuseColor = in.pod<glm::vec3>();
+		mi.emissionColor = in.pod<glm::vec3>();
+
+		mi.diffuseTexturePath = in.string();
+		mi.normalTexturePath = in.string();
+		mi.roughnessTexturePath = in.string();
+		mi.metallicTexturePath = in.string();
+		mi.alphaTexturePath = in.string();
+
+		mi.diffuseTextureIndex = in.pod<std::uint32_t>();
+		mi.normalTextureIndex = in.pod<std::uint32_t>();
+		mi.roughnessTextureIndex = in.pod<std::uint32_t>();
+		mi.metallicTextureIndex = in.pod<std::uint32_t>();
+		mi.alphaTextureIndex = in.pod<std::uint32_t>();
+
+		mi.metallic = in.pod<float>();
+		mi.roughness = in.pod<float>();
+
+		model.materials.emplace_back(std::move(mi));
+	}
+
+	auto const meshCount = in.pod<std::uint64_t>();
+	for (std::uint64_t i = 0; i < meshCount && in.ok(); ++i)
+	{
+		SimpleMeshInfo mesh;
+
+		mesh.meshName = in.string();
+		mesh.materialIndex = std::size_t(in.pod<std::uint64_t>());
+
+		auto const flags = in.pod<std::uint32_t>();
+		mesh.textured = 0 != (flags & kMeshTextured);
+		mesh.alphaTextured = 0 != (flags & kMeshAlphaTextured);
+		mesh.normalTextured = 0 != (flags & kMeshNormalTextured);
+		mesh.roughnessTextured = 0 != (flags & kMeshRoughnessTextured);
+		mesh.metallicTextured = 0 != (flags & kMeshMetallicTextured);
+
+		mesh.vertexStartIndex = std::size_t(in.pod<std::uint64_t>());
+		mesh.vertexCount = std::size_t(in.pod<std::uint64_t>());
+		mesh.indexStartIndex = std::size_t(in.pod<std::uint64_t>());
+		mesh.indexCount = std::size_t(in.pod<std::uint64_t>());
+
+		if (mesh.materialIndex >= model.materials.size())
+			return std::nullopt;
+
+		model.meshes.emplace_back(std::move(mesh));
+	}
+
+	model.vertices = in.array<Vertex>();
+	model.indices = in.array<std::uint32_t>();
+	model.indexCount = std::size_t(in.pod<std::uint64_t>());
+
+	if (!in.ok() || !in.atEnd())
+		return std::nullopt;
+
+	for (auto const& mesh : model.meshes)
+	{
+		if (mesh.vertexStartIndex + mesh.vertexCount > model.vertices.size() || mesh.indexStartIndex + mesh.indexCount > model.indices.size())
+			return std::nullopt;
+	}
+
+	return model;
+}
+
+ObjModelSources stampObjModelSources(const std::string& objPath)
+{
+	ObjModelSources ret;
+
+	ret.obj = stamp_(objPath);
+	ret.mtlPath = material_library_(objPath);
+
+	if (!ret.mtlPath.empty())
+		ret.mtl = stamp_(ret.mtlPath);
+
+	return ret;
+}
+
+bool writeSimpleModelCache(const std::string& objPath, const ObjModelSources& sources, const SimpleModel& model)
+{
+	CacheWriter_ out;
+
+	// Header
+	std::array<char, sizeof(kObjModelCacheMagic)> magic;
+	std::memcpy(magic.data(), kObjModelCacheMagic, sizeof(kObjModelCacheMagic));
+	out.pod(magic);
+
+	out.pod(kObjModelCacheVersion);
+	out.pod(std::uint32_t(sizeof(Vertex)));
+	out.string(objPath);
+
+	out.pod(std::uint32_t(sources.mtlPath.empty() ? 0 : 1));
+
+	out.pod(sources.obj.size);
+	out.pod(sources.obj.modified);
+
+	if (!sources.mtlPath.empty())
+	{
+		out.string(sources.mtlPath);
+		out.pod(sources.mtl.size);
+		out.pod(sources.mtl.modified);
+	}
+
+	// Model
+	out.pod(std::uint64_t(model.materials.size()));
+	for (auto const& mi : model.materials)
+	{
+		out.string(mi.materialName);
+		out.pod(mi.diffuseColor);
+		out.pod(mi.emissionColor);
+
+		out.string(mi.diffuseTexturePath);
+		out.string(mi.normalTexturePath);
+		out.string(mi.roughnessTexturePath);
+		out.string(mi.metallicTexturePath);
+		out.string(mi.alphaTexturePath);
+
+		out.pod(std::uint32_t(mi.diffuseTextureIndex));
+		out.pod(std::uint32_t(mi.normalTextureIndex));
+		out.pod(std::uint32_t(mi.roughnessTextureIndex));
+		out.pod(std::uint32_t(mi.metallicTextureIndex));
+		out.pod(std::uint32_t(mi.alphaTextureIndex));
+
+		out.pod(mi.metallic);
+		out.pod(mi.roughness);
+	}
+
+	out.pod(std::uint64_t(model.meshes.size()));
+	for (auto const& mesh : model.meshes)
+	{
+		out.string(mesh.meshName);
+		out.pod(std::uint64_t(mesh.materialIndex));
+
+		std::uint32_t flags = 0;
+		if (mesh.textured) flags |= kMeshTextured;
+		if (mesh.alphaTextured) flags |= kMeshAlphaTextured;
+		if (mesh.normalTextured) flags |= kMeshNormalTextured;
+		if (mesh.roughnessTextured) flags |= kMeshRoughnessTextured;
+		if (mesh.metallicTextured) flags |= kMeshMetallicTextured;
+		out.pod(flags);
+
+		out.pod(std::uint64_t(mesh.vertexStartIndex));
+		out.pod(std::uint64_t(mesh.vertexCount));
+		out.pod(std::uint64_t(mesh.indexStartIndex));
+		out.pod(std::uint64_t(mesh.indexCount));
+	}
+
+	out.array(model.vertices);
+	out.array(model.indices);
+	out.pod(std::uint64_t(model.indexCount));
+
+	// Write to a temporary file first, so that a concurrent or interrupted
+	// write never leaves a truncated cache behind.
+	auto const cachePath = simpleModelCachePath(objPath);
+	auto const tempPath = cachePath + ".tmp";
+
+	{
+		std::ofstream ofs(tempPath, std::ios::binary | std::ios::trunc);
+		if (!ofs)
+			return false;
+
+		auto const& buffer = out.buffer();
+		ofs.write(reinterpret_cast<const char*>(buffer.data()), std::streamsize(buffer.size()));
+		if (!ofs)
+		{
+			ofs.close();
+
+			std::error_code ec;
+			std::filesystem::remove(tempPath, ec);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	return true;
+}
+
+namespace
+{
+	ObjFileStamp stamp_(const std::string& path)
+	{
+		ObjFileStamp ret;
+
+		std::error_code ec;
+		auto const size = std::filesystem::file_size(path, ec);
+		if (ec)
+			return ret;
+
+		auto const modified = std::filesystem::last_write_time(path, ec);
+		if (ec)
+			return ret;
+
+		ret.size = size;
+		ret.modified = std::int64_t(modified.time_since_epoch().count());
+		return ret;
+	}
+
+	std::string material_library_(const std::string& objPath)
+	{
+		MappedFile file;
+		try
+		{
+			file = MappedFile(objPath);
+		}
+		catch (const lut::Error&)
+		{
+			return {};
+		}
+
+		std::string_view const text(reinterpret_cast<const char*>(file.data()), file.size());
+
+		// rapidobj only uses the first `mtllib` statement. The statement is
+		// usually near the top, but nothing requires it to be.
+		for (std::size_t lineBeg = 0; lineBeg < text.size(); )
+		{
+			auto lineEnd = text.find('\n', lineBeg);
+			if (std::string_view::npos == lineEnd)
+				lineEnd = text.size();
+
+			auto line = text.substr(lineBeg, lineEnd - lineBeg);
+			lineBeg = lineEnd + 1;
+
+			auto const first = line.find_first_not_of(" \t");
+			if (std::string_view::npos == first)
+				continue;
+
+			line.remove_prefix(first);
+			if (line.size() < 7 || 0 != line.compare(0, 6, "mtllib") || (' ' != line[6] && '\t' != line[6]))
+				continue;
+
+			line.remove_prefix(7);
+
+			auto const beg = line.find_first_not_of(" \t");
+			auto const end = line.find_last_not_of(" \t\r");
+			if (std::string_view::npos == beg)
+				return {};
+
+			auto const name = line.substr(beg, end - beg + 1);
+			return (std::filesystem::path(objPath).parent_path() / std::filesystem::path(std::string(name))).string();
+		}
+
+		return {};
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef OBJ_MODEL_CACHE_HPP_7A2D94E1_3C5B_4F8A_A16E_D0B93F52C847
+#define OBJ_MODEL_CACHE_HPP_7A2D94E1_3C5B_4F8A_A16E_D0B93F52C847
+
+#include <string>
+#include <optional>
+
+#include <cstdint>
+
+#include "SimpleModel.h"
+
+// Binary cache for models loaded with loadSimpleWavefrontObj().
+//
+// The cache lives next to the OBJ file (see simpleModelCachePath()) and holds
+// the processed SimpleModel. It is keyed by the OBJ path, the size and
+// modification time of the OBJ and of its material library, the layout of
+// Vertex and a loader version (kObjModelCacheVersion in ObjModelCache.cpp).
+// Any mismatch makes readSimpleModelCache() return std::nullopt, in which case
+// the caller parses the OBJ again and rewrites the cache.
+//
+// Only the parts of SimpleModel that loadSimpleWavefrontObj() fills in are
+// stored.
+
+std::string simpleModelCachePath(const std::string& objPath);
+
+// Size and modification time of a file. Missing files get a size of ~0, so
+// that creating them later invalidates the cache as well.
+struct ObjFileStamp
+{
+	std::uint64_t size = ~std::uint64_t(0);
+	std::int64_t modified = 0;
+
+	bool operator==(const ObjFileStamp& other) const
+	{
+		return size == other.size && modified == other.modified;
+	}
+};
+
+// The files a cached model depends on: the OBJ and its material library.
+struct ObjModelSources
+{
+	ObjFileStamp obj;
+
+	std::string mtlPath; // empty if the OBJ does not reference one
+	ObjFileStamp mtl;
+};
+
+// Stamps the OBJ and its material library. Take the stamps before parsing the
+// OBJ, such that files modified during the parse invalidate the cache.
+ObjModelSources stampObjModelSources(const std::string& objPath);
+
+// Maps the cache for `objPath`. Returns std::nullopt if there is no cache or
+// if it is stale or malformed.
+std::optional<SimpleModel> readSimpleModelCache(const std::string& objPath);
+
+// Writes the cache for `objPath` (via a temporary file that is then renamed
+// into place), keyed by `sources` as stamped before `model` was parsed.
+// Returns false if the cache could not be written, e.g., because the directory
+// is read-only; this is not an error for the caller.
+bool writeSimpleModelCache(const std::string& objPath, const ObjModelSources& sources, const SimpleModel& model);
+
+#endif // OBJ_MODEL_CACHE_HPP_7A2D94E1_3C5B_4F8A_A16E_D0B93F52C847
@@ -0,0 +1,103 @@
+#ifndef QUANTIZED_VERTEX_HPP_28DAD999_020E_4568_8AC2_508170E4FA4D
+#define QUANTIZED_VERTEX_HPP_28DAD999_020E_4568_8AC2_508170E4FA4D
+
+#include <cmath>
+#include <cstdint>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/common.hpp>
+#include <glm/gtc/packing.hpp>
+
+/* Compact vertex format, shared by MeshBake and the renderer.
+ *
+ * 20 bytes instead of the 60 bytes of a float Vertex:
+ *  - position: 4*uint16_t, UNORM. xyz are normalized to the bounds of the mesh
+ *    (see QuantizationBounds); w holds the tangent handedness (0 = -1, 1 = +1).
+ *  - normal:   2*int16_t, SNORM, octahedral encoding
+ *  - tangent:  2*int16_t, SNORM, octahedral encoding
+ *  - texcoord: 2*uint16_t, half floats
+ *
+ * There is no vertex color; it is always white in our models.
+ *
+ * In Vulkan terms, the attributes are R16G16B16A16_UNORM, R16G16_SNORM,
+ * R16G16_SNORM and R16G16_SFLOAT, respectively. See offscreen_quantized.vert
+ * for the decoding.
+ */
+struct QuantizedVertex
+{
+	std::uint16_t position[4];
+	std::int16_t normal[2];
+	std::int16_t tangent[2];
+	std::uint16_t texcoord[2];
+};
+
+static_assert( sizeof(QuantizedVertex) == 20 );
+
+// Per-mesh dequantization parameters: position = offset + position.xyz * scale
+struct QuantizationBounds
+{
+	glm::vec3 offset{ 0.f };
+	float reserved0 = 0.f;
+	glm::vec3 scale{ 1.f };
+	float reserved1 = 0.f;
+};
+
+static_assert( sizeof(QuantizationBounds) == 32 );
+
+inline QuantizationBounds makeQuantizationBounds( const glm::vec3& aabbMin, const glm::vec3& aabbMax )
+{
+	QuantizationBounds ret;
+	ret.offset = aabbMin;
+
+	// Flat meshes still need a non-zero extent along every axis
+	ret.scale = glm::max( aabbMax - aabbMin, glm::vec3( 1e-6f ) );
+
+	return ret;
+}
+
+// Octahedral encoding of a unit vector into [-1,1]^2. A zero vector maps to
+// (0,0), which decodes to +Z.
+inline glm::vec2 octEncode( const glm::vec3& v )
+{
+	float const l1 = std::abs( v.x ) + std::abs( v.y ) + std::abs( v.z );
+	if( l1 <= 0.f )
+		return glm::vec2( 0.f );
+
+	glm::vec2 ret = glm::vec2( v.x, v.y ) / l1;
+
+	if( v.z < 0.f )
+	{
+		glm::vec2 const sign( ret.x >= 0.f ? 1.f : -1.f, ret.y >= 0.f ? 1.f : -1.f );
+		ret = (glm::vec2( 1.f ) - glm::abs( glm::vec2( ret.y, ret.x ) )) * sign;
+	}
+
+	return ret;
+}
+
+inline QuantizedVertex quantizeVertex( const QuantizationBounds& bounds, const glm::vec3& position, const glm::vec3& normal, const glm::vec4& tangent, const glm::vec2& texcoord )
+{
+	QuantizedVertex ret{};
+
+	glm::vec3 const p = (position - bounds.offset) / bounds.scale;
+	ret.position[0] = glm::packUnorm1x16( p.x );
+	ret.position[1] = glm::packUnorm1x16( p.y );
+	ret.position[2] = glm::packUnorm1x16( p.z );
+	ret.position[3] = tangent.w < 0.f ? 0 : 0xffff;
+
+	glm::vec2 const n = octEncode( normal );
+	ret.normal[0] = std::int16_t( glm::packSnorm1x16( n.x ) );
+	ret.normal[1] = std::int16_t( glm::packSnorm1x16( n.y ) );
+
+	glm::vec2 const t = octEncode( glm::vec3( tangent ) );
+	ret.tangent[0] = std::int16_t( glm::packSnorm1x16( t.x ) );
+	ret.tangent[1] = std::int16_t( glm::packSnorm1x16( t.y ) );
+
+	ret.texcoord[0] = glm::packHalf1x16( texcoord.x );
+	ret.texcoord[1] = glm::packHalf1x16( texcoord.y );
+
+	return ret;
+}
+
+#endif // QUANTIZED_VERTEX_HPP_28DAD999_020E_4568_8AC2_508170E4FA4D
@@ -0,0 +1,131 @@
+#include "RandomAccessFile.h"
+
+#include <utility>
+#include <algorithm>
+
+#ifdef _WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/stat.h>
+#endif
+
+#include "labutils/error.hpp"
+
+namespace lut = labutils;
+
+RandomAccessFile::RandomAccessFile(const std::string& path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (INVALID_HANDLE_VALUE == file)
+		throw lut::Error("RandomAccessFile: unable to open '%s' for reading (error %lu)", path.c_str(), GetLastError());
+
+	mFile = file;
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size))
+	{
+		release();
+		throw lut::Error("RandomAccessFile: unable to query size of '%s' (error %lu)", path.c_str(), GetLastError());
+	}
+
+	mSize = static_cast<std::uint64_t>(size.QuadPart);
+#else
+	mFile = ::open(path.c_str(), O_RDONLY);
+	if (mFile < 0)
+		throw lut::Error("RandomAccessFile: unable to open '%s' for reading", path.c_str());
+
+	struct stat st {};
+	if (0 != ::fstat(mFile, &st))
+	{
+		release();
+		throw lut::Error("RandomAccessFile: unable to query size of '%s'", path.c_str());
+	}
+
+	mSize = static_cast<std::uint64_t>(st.st_size);
+#endif
+}
+
+RandomAccessFile::~RandomAccessFile()
+{
+	release();
+}
+
+RandomAccessFile::RandomAccessFile(RandomAccessFile&& other) noexcept
+	: mSize(std::exchange(other.mSize, 0))
+#ifdef _WIN32
+	, mFile(std::exchange(other.mFile, nullptr))
+#else
+	, mFile(std::exchange(other.mFile, -1))
+#endif
+{}
+
+RandomAccessFile& RandomAccessFile::operator=(RandomAccessFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		release();
+
+		mSize = std::exchange(other.mSize, 0);
+#ifdef _WIN32
+		mFile = std::exchange(other.mFile, nullptr);
+#else
+		mFile = std::exchange(other.mFile, -1);
+#endif
+	}
+
+	return *this;
+}
+
+void RandomAccessFile::read(std::uint64_t offset, void* buffer, std::size_t bytes) const
+{
+	if (offset > mSize || bytes > mSize - offset)
+		throw lut::Error("RandomAccessFile::read(): %zu bytes at offset %llu exceed the file (%llu bytes)", bytes, (unsigned long long)offset, (unsigned long long)mSize);
+
+	auto* dest = static_cast<char*>(buffer);
+	while (bytes)
+	{
+#ifdef _WIN32
+		// ReadFile() takes at most 4 GB at a time. The offset comes with each
+		// read, so concurrent reads do not interfere.
+		auto const chunk = static_cast<DWORD>(std::min<std::size_t>(bytes, 0x40000000));
+
+		OVERLAPPED overlapped{};
+		overlapped.Offset = static_cast<DWORD>(offset);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+		DWORD got = 0;
+		if (!ReadFile(mFile, dest, chunk, &got, &overlapped) || 0 == got)
+			throw lut::Error("RandomAccessFile::read(): read of %lu bytes at offset %llu failed (error %lu)", chunk, (unsigned long long)offset, GetLastError());
+#else
+		auto const got = ::pread(mFile, dest, bytes, static_cast<off_t>(offset));
+		if (got <= 0)
+			throw lut::Error("RandomAccessFile::read(): read of %zu bytes at offset %llu failed", bytes, (unsigned long long)offset);
+#endif
+
+		dest += got;
+		offset += static_cast<std::uint64_t>(got);
+		bytes -= static_cast<std::size_t>(got);
+	}
+}
+
+void RandomAccessFile::release() noexcept
+{
+#ifdef _WIN32
+	if (mFile)
+		CloseHandle(mFile);
+
+	mFile = nullptr;
+#else
+	if (mFile >= 0)
+		::close(mFile);
+
+	mFile = -1;
+#endif
+
+	mSize = 0;
+}
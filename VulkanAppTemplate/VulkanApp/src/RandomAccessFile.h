@@ -0,0 +1,47 @@
+#ifndef RANDOM_ACCESS_FILE_HPP_3F6A9D20_58C4_4B17_9E0B_A2D47C81E635
+#define RANDOM_ACCESS_FILE_HPP_3F6A9D20_58C4_4B17_9E0B_A2D47C81E635
+
+#include <string>
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only file with positional reads.
+//
+// Unlike a FILE*, the file has no shared position: read() may be called from
+// any number of threads at the same time. The file is move-only (like
+// MappedFile) and is closed when the object goes out of scope.
+class RandomAccessFile final
+{
+public:
+	RandomAccessFile() noexcept = default;
+	~RandomAccessFile();
+
+	explicit RandomAccessFile(const std::string& path);
+
+	RandomAccessFile(const RandomAccessFile&) = delete;
+	RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+	RandomAccessFile(RandomAccessFile&&) noexcept;
+	RandomAccessFile& operator=(RandomAccessFile&&) noexcept;
+
+public:
+	// Reads exactly `bytes` bytes at `offset`; throws labutils::Error if the
+	// file is shorter or the read fails.
+	void read(std::uint64_t offset, void* buffer, std::size_t bytes) const;
+
+	std::uint64_t size() const noexcept { return mSize; }
+
+private:
+	void release() noexcept;
+
+	std::uint64_t mSize = 0;
+
+#ifdef _WIN32
+	void* mFile = nullptr;
+#else
+	int mFile = -1;
+#endif
+};
+
+#endif // RANDOM_ACCESS_FILE_HPP_3F6A9D20_58C4_4B17_9E0B_A2D47C81E635
@@ -48,14 +48,13 @@ struct SimpleMaterialInfo
 // The material of the mesh is identified by the `materialIndex` member. It is
 // an index into the `SimpleModel::materials` vector.
 //
-// The vertices belonging to the mesh are identified by the `vertexStartIndex`
-// and `vertexCount` members. The mesh contains `vertexCount` members, starting
-// at index `vertexStartIndex`. For textured meshes (`textured` set to `true`),
-// the vertices are found in the `SimpleModel::dataTextured::positions` and
-// `SimpleModel::dataTextured::texcoords` arrays. For untextured meshes
-// (`textured` set to `false`), the vertices are instead found in the
-// `SimpleModel::dataUntextured::positions` array (and do not have any texture
-// coordinates).
+// Meshes do not own any geometry. The vertices belonging to the mesh are the
+// `vertexCount` vertices starting at `SimpleModel::vertices[vertexStartIndex]`,
+// and its triangles are the `indexCount` indices starting at
+// `SimpleModel::indices[indexStartIndex]`. The indices refer to
+// `SimpleModel::vertices` directly (i.e., they are not relative to the mesh's
+// first vertex). Textured meshes (`textured` set to `true`) use the vertices'
+// texture coordinates; untextured meshes ignore them.
 struct SimpleMeshInfo
 {
 	std::string meshName;  // This is purely informational and for debugging
@@ -68,18 +67,46 @@ struct SimpleMeshInfo
 	bool roughnessTextured : 1;
 	bool metallicTextured : 1;
 
+	std::size_t vertexStartIndex = 0;
 	std::size_t vertexCount = 0;
 	std::size_t indexStartIndex = 0;
 	std::size_t indexCount = 0;
 
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
+	// Filled by the quantized vertex path (see VulkanApplication::quantizeModel()).
+	// Baked models may provide the quantized vertices up front, in
+	// SimpleModel::quantizedVertices; bakedQuantizedVertices is set for those
+	// meshes, and quantizationBounds holds their bounds.
+	QuantizationBounds quantizationBounds;
+	bool bakedQuantizedVertices = false;
+
+	// Set for meshes whose tangents came from the baked file; generateTangents()
+	// leaves those alone.
+	bool bakedTangents = false;
+
+	// 16-bit indices (see VulkanApplication::splitIndexBuffers()). For meshes
+	// with use16BitIndices set, indexStartIndex refers to SimpleModel::indices16
+	// and the indices are relative to vertexOffset.
+	//
+	// Baked models may provide the 16-bit indices up front. For meshes with
+	// bakedIndices16 set, the `indexCount` indices starting at
+	// `SimpleModel::indices16[indices16StartIndex]` are relative to the mesh's
+	// first vertex.
+	bool use16BitIndices = false;
+	uint32_t vertexOffset = 0;
+
+	bool bakedIndices16 = false;
+	std::size_t indices16StartIndex = 0;
 
 	glm::mat4 transform = glm::mat4(1.0f);
 };
 
 // Simple model.
 //
+// All geometry lives in two arenas, `vertices` and `indices`; meshes refer to
+// their part of them by offset and count (see SimpleMeshInfo). Each mesh's
+// vertices are contiguous, and the meshes' vertices follow each other in mesh
+// order.
+//
 // Note: you probably want to use this for loading only. Once you have copied
 // the mesh data into Vulkan buffers, you are unlikely to need it any longer.
 struct SimpleModel
@@ -99,17 +126,69 @@ struct SimpleModel
 		std::vector<glm::vec3> positions;
 		std::vector<glm::vec3> normals;
 		std::vector<glm::vec2> texcoords;
-	} dataTextured;
+	};
 
 	struct Data2_
 	{
 		std::vector<glm::vec3> positions;
 		std::vector<glm::vec3> normals;
-	} dataUntextured;
+	};
+
+	// Unindexed triangle soups of the textured and the untextured meshes, in
+	// mesh order. These are not stored; they are expanded from `vertices` and
+	// `indices` each time they are requested.
+	Data_ texturedSoup() const
+	{
+		Data_ soup;
+		for (const auto& mesh : meshes)
+		{
+			if (!mesh.textured)
+				continue;
+
+			for (std::size_t i = mesh.indexStartIndex; i < mesh.indexStartIndex + mesh.indexCount; ++i)
+			{
+				const auto& vertex = vertices[indices[i]];
+				soup.positions.emplace_back(vertex.position);
+				soup.normals.emplace_back(vertex.normal);
+				soup.texcoords.emplace_back(vertex.texcoord);
+			}
+		}
+		return soup;
+	}
+
+	Data2_ untexturedSoup() const
+	{
+		Data2_ soup;
+		for (const auto& mesh : meshes)
+		{
+			if (mesh.textured)
+				continue;
+
+			for (std::size_t i = mesh.indexStartIndex; i < mesh.indexStartIndex + mesh.indexCount; ++i)
+			{
+				const auto& vertex = vertices[indices[i]];
+				soup.positions.emplace_back(vertex.position);
+				soup.normals.emplace_back(vertex.normal);
+			}
+		}
+		return soup;
+	}
 
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
 
+	// See SimpleMeshInfo::use16BitIndices and SimpleMeshInfo::bakedIndices16
+	std::vector<uint16_t> indices16;
+
+	// Parallel to `vertices`, for the second vertex stream (see
+	// AmbientOcclusionLayout in Vertex.h). Baked models provide it; for other
+	// models it stays empty, which mergeModels() treats as unoccluded.
+	std::vector<uint8_t> ambientOcclusion;
+
+	// Parallel to `vertices` once quantizeModel() ran. Baked models may provide
+	// it up front (see SimpleMeshInfo::bakedQuantizedVertices); otherwise it
+	// stays empty until then.
+	std::vector<QuantizedVertex> quantizedVertices;
+
 	std::size_t indexCount = 0;
 };
-
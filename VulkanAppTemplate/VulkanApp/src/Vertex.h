@@ -3,6 +3,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include "glm.h"
+#include "QuantizedVertex.h"
 
 #include <array>
 
@@ -65,7 +66,7 @@ struct Vertex
 
 		attributeDescriptions[2].binding = 0;
 		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDescriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
 		attributeDescriptions[2].offset = offsetof(Vertex, tangent);
 
 		attributeDescriptions[3].binding = 0;
@@ -83,11 +84,82 @@ struct Vertex
 
 	glm::vec3 position{ 0.0f, 0.0f, 0.0f };
 	glm::vec3 normal{ 0.0f, 0.0f, 0.0f };
-	glm::vec3 tangent{ 0.0f, 0.0f, 0.0f };
+	glm::vec4 tangent{ 0.0f, 0.0f, 0.0f, 1.0f }; // w = handedness of the bitangent (+-1)
 	glm::vec2 texcoord{ 0.0f, 0.0f };
 	glm::vec3 color{ 1.0f, 1.0f, 1.0f };
 };
 
+// Vertex input for the quantized vertex buffer (QuantizedVertex.h). Used by the
+// offscreen pipeline together with offscreen_quantized.vert.
+struct QuantizedVertexLayout
+{
+	static VkVertexInputBindingDescription getBindingDescription()
+	{
+		VkVertexInputBindingDescription vertexInputBindingDescription{};
+		vertexInputBindingDescription.binding = 0;
+		vertexInputBindingDescription.stride = sizeof(QuantizedVertex);
+		vertexInputBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return vertexInputBindingDescription;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions()
+	{
+		// Same locations as Vertex, minus the color at location 4. The
+		// normalized formats are converted to floats by the vertex fetch.
+		std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+
+		attributeDescriptions[0].binding = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+		attributeDescriptions[0].offset = offsetof(QuantizedVertex, position);
+
+		attributeDescriptions[1].binding = 0;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+		attributeDescriptions[1].offset = offsetof(QuantizedVertex, normal);
+
+		attributeDescriptions[2].binding = 0;
+		attributeDescriptions[2].location = 2;
+		attributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+		attributeDescriptions[2].offset = offsetof(QuantizedVertex, tangent);
+
+		attributeDescriptions[3].binding = 0;
+		attributeDescriptions[3].location = 3;
+		attributeDescriptions[3].format = VK_FORMAT_R16G16_SFLOAT;
+		attributeDescriptions[3].offset = offsetof(QuantizedVertex, texcoord);
+
+		return attributeDescriptions;
+	}
+};
+
+// Second vertex stream with the baked per-vertex ambient occlusion, one byte
+// per vertex (see SimpleModel::ambientOcclusion). Bound at binding 1 next to
+// either vertex layout; the offscreen vertex shaders read it at location 5.
+struct AmbientOcclusionLayout
+{
+	static VkVertexInputBindingDescription getBindingDescription()
+	{
+		VkVertexInputBindingDescription vertexInputBindingDescription{};
+		vertexInputBindingDescription.binding = 1;
+		vertexInputBindingDescription.stride = sizeof(uint8_t);
+		vertexInputBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return vertexInputBindingDescription;
+	}
+
+	static VkVertexInputAttributeDescription getAttributeDescription()
+	{
+		VkVertexInputAttributeDescription attributeDescription{};
+		attributeDescription.binding = 1;
+		attributeDescription.location = 5;
+		attributeDescription.format = VK_FORMAT_R8_UNORM;
+		attributeDescription.offset = 0;
+
+		return attributeDescription;
+	}
+};
+
 namespace std {
 	template<> struct hash<Vertex> {
 		size_t operator()(Vertex const& vertex) const {
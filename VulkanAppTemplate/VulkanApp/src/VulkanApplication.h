@@ -137,6 +137,10 @@ struct GlobalUniformBufferObject
 struct ObjectUniformBufferObject
 {
 	glm::mat4 model;
+
+	// Position dequantization (offscreen_quantized.vert only)
+	glm::vec4 positionOffset = glm::vec4(0.0f);
+	glm::vec4 positionScale = glm::vec4(1.0f);
 };
 
 struct MaterialUniformBufferObject
@@ -210,6 +214,16 @@ const int32_t TextureUnits = 64;
 
 static bool useVma = true;
 
+// Render the offscreen pass from 20-byte QuantizedVertex data instead of 60-byte
+// Vertex data. The vertex buffer size is printed at startup and the frame time
+// is shown in the window title, so both paths can be compared.
+static bool quantizeVertices = false;
+
+// Draw meshes that span at most 65536 vertices from a 16-bit index buffer,
+// with indices relative to the mesh's first vertex (passed as vertexOffset).
+// The index buffer sizes are printed at startup.
+static bool use16BitIndices = true;
+
 #ifdef NDEBUG
 const bool EnableValidationLayers = false;
 #else
@@ -284,6 +298,9 @@ struct MeshGeometry
 	bool dirty = true;
 	std::shared_ptr<Material> material;
 	glm::mat4 transform = glm::mat4(1.0f);
+	QuantizationBounds quantizationBounds;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	int32_t vertexOffset = 0;
 };
 
 class VulkanApplication
@@ -320,12 +337,17 @@ private:
 	void prepareOffscreen();
 	Image createTextureImage(const std::string& path, Channel requireChannels = Channel::RGBAlpha);
 	Image createTextureImageVma(const std::string& path, Channel requireChannels = Channel::RGBAlpha);
+	Image createBakedTextureImage(const std::string& path);
 	VkImageView createTextureImageView(VkImage image);
 	void createTextureSampler();
 	Buffer createVertexBuffer(const std::vector<Vertex>& vertices);
 	Buffer createVertexBufferVma(const std::vector<Vertex>& vertices);
+	Buffer createVertexBuffer(const void* vertices, VkDeviceSize bufferSize);
+	Buffer createVertexBufferVma(const void* vertices, VkDeviceSize bufferSize);
 	Buffer createIndexBuffer(const std::vector<uint32_t>& indices);
 	Buffer createIndexBufferVma(const std::vector<uint32_t>& indices);
+	Buffer createIndexBuffer(const void* indices, VkDeviceSize bufferSize);
+	Buffer createIndexBufferVma(const void* indices, VkDeviceSize bufferSize);
 	std::unique_ptr<MeshGeometry> createMeshGeometry(const Mesh& mesh);
 	std::unique_ptr<MeshGeometry> createMeshGeometry(const SimpleMeshInfo& mesh, const SimpleMaterialInfo& material);
 	void createMeshGeometries(const Model& model);
@@ -383,7 +405,7 @@ private:
 	void createComputeDescriptorSets();
 	void createSyncObjects();
 
-	SimpleModel mergeModels(const std::vector<SimpleModel>& models);
+	SimpleModel mergeModels(std::vector<SimpleModel> models);
 
 	void recordGraphicsCommandBuffer(VkCommandBuffer graphicsCommandBuffer, uint32_t imageIndex);
 
@@ -417,11 +439,13 @@ private:
 	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
 	VkImageView createImageView(Image image, VkImageAspectFlags aspectFlags);
 
-	void generateTangents(SimpleModel& model);
+	void quantizeModel(SimpleModel& model);
+	void splitIndexBuffers(SimpleModel& model);
 
 	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
 
 	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+	void copyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions);
 
 	void createVmaAllocator();
 
@@ -435,10 +459,6 @@ private:
 
 	void etc2Compress(const std::string& inputPath, const std::string& overrideOutputPath = "");
 
-	SimpleMaterialInfo bakedMaterial2SimpleMaterial(const BakedMaterialInfo& bakedMaterial, const std::vector<BakedTextureInfo>& bakedTextures);
-
-	SimpleModel bakedModel2SimpleModel(const BakedModel& bakedModel);
-
 	void loadResources();
 
 	void createTextureImageViews();
@@ -542,7 +562,9 @@ private:
 	Image depthImage;
 	Image colorImage;	// For MSAA
 	Buffer vertexBuffer;
+	Buffer ambientOcclusionBuffer;
 	Buffer indexBuffer;
+	Buffer indexBuffer16;
 	Buffer quadVertexBuffer;
 	Buffer quadIndexBuffer;
 	std::vector<VkDescriptorSet> graphicsDescriptorSets;
@@ -74,6 +74,8 @@ project "VulkanApp"
     { 
         "%{prj.name}/src/MeshBake/**.h", 
         "%{prj.name}/src/MeshBake/**.cpp", 
+        "%{prj.name}/src/LoadBench/**.h", 
+        "%{prj.name}/src/LoadBench/**.cpp", 
     }
 
     --Debug配置项属性
@@ -95,6 +97,7 @@ project "VulkanApp"
             './ThirdParty/fmt-9.1.0/include',
             './ThirdParty/Optick_1.4.0/include',
             './ThirdParty/rapidobj-1.0.1/include',
+            './ThirdParty/cgltf-1.13',
             './ThirdParty/glfw-3.3.8.bin.WIN64/include',
             './ThirdParty/VulkanMemoryAllocator/include',
             './ThirdParty/easy_profiler-v2.1.0-msvc15-win64/include',
@@ -139,6 +142,7 @@ project "VulkanApp"
             './ThirdParty/fmt-9.1.0/include',
             './ThirdParty/Optick_1.4.0/include',
             './ThirdParty/rapidobj-1.0.1/include',
+            './ThirdParty/cgltf-1.13',
             './ThirdParty/glfw-3.3.8.bin.WIN64/include',
             './ThirdParty/VulkanMemoryAllocator/include',
             './ThirdParty/easy_profiler-v2.1.0-msvc15-win64/include'
@@ -179,6 +183,9 @@ project "MeshBake"
     { 
         "VulkanApp/src/MeshBake/**.h", 
         "VulkanApp/src/MeshBake/**.cpp", 
+        "VulkanApp/src/QuantizedVertex.h",
+        "VulkanApp/src/BlockCodec.h",
+        "VulkanApp/src/BlockCodec.cpp",
         "VulkanApp/src/labutils/error.hpp",
         "VulkanApp/src/labutils/error.cpp",
         "ThirdParty/tgen/src/tgen.cpp"
@@ -272,5 +279,73 @@ project "MeshBake"
             "easy_profiler.lib"
         }
 
+-- Baked model load-throughput benchmark; needs no window or Vulkan device
+project "LoadBench"
+    kind "ConsoleApp"                       --项目类型，控制台程序
+    language "C++"                          --工程采用的语言，Premake5.0当前支持C、C++、C#
+    location "Project"
+
+    files 
+    { 
+        "VulkanApp/src/LoadBench/**.h", 
+        "VulkanApp/src/LoadBench/**.cpp", 
+        "VulkanApp/src/BakedBvh.h",
+        "VulkanApp/src/BakedBvh.cpp",
+        "VulkanApp/src/BakedModel.h",
+        "VulkanApp/src/BakedModel.cpp",
+        "VulkanApp/src/BakedModelConvert.h",
+        "VulkanApp/src/BakedModelConvert.cpp",
+        "VulkanApp/src/BlockCodec.h",
+        "VulkanApp/src/BlockCodec.cpp",
+        "VulkanApp/src/LoadModelGltf.h",
+        "VulkanApp/src/LoadModelGltf.cpp",
+        "VulkanApp/src/LoadModelObj.h",
+        "VulkanApp/src/LoadModelObj.cpp",
+        "VulkanApp/src/MappedFile.h",
+        "VulkanApp/src/MappedFile.cpp",
+        "VulkanApp/src/ObjModelCache.h",
+        "VulkanApp/src/ObjModelCache.cpp",
+        "VulkanApp/src/RandomAccessFile.h",
+        "VulkanApp/src/RandomAccessFile.cpp",
+        "VulkanApp/src/QuantizedVertex.h",
+        "VulkanApp/src/SimpleModel.h",
+        "VulkanApp/src/Vertex.h",
+        "VulkanApp/src/labutils/error.hpp",
+        "VulkanApp/src/labutils/error.cpp",
+        "ThirdParty/tgen/src/tgen.cpp"
+    }                                       --指定加载哪些文件或哪些类型的文件
+
+    --Debug配置项属性
+    filter "configurations:Debug"
+        defines { "DEBUG", "ARIA_CORE_DEBUG", "ARIA_PLATFORM_WINDOWS" }                 --定义Debug宏(这可以算是默认配置)
+        symbols "On"                                           --开启调试符号
+        debugdir "%{prj.location}"
+
+        includedirs 
+        { 
+            './ThirdParty/tgen/include',
+            '%{IncludeDir.VulkanSDK}',
+            './ThirdParty/glm-0.9.9.8/glm',
+            './ThirdParty/rapidobj-1.0.1/include',
+            './ThirdParty/cgltf-1.13',
+            './ThirdParty/glfw-3.3.8.bin.WIN64/include',
+        }
+
+    --Release配置项属性
+    filter "configurations:Release"
+        defines { "NDEBUG", "ARIA_RELEASE", "ARIA_PLATFORM_WINDOWS" }                 --定义NDebug宏(这可以算是默认配置)
+        optimize "On"                                           --开启优化参数
+        debugdir "%{prj.location}"
+
+        includedirs 
+        { 
+            './ThirdParty/tgen/include',
+            '%{IncludeDir.VulkanSDK}',
+            './ThirdParty/glm-0.9.9.8/glm',
+            './ThirdParty/rapidobj-1.0.1/include',
+            './ThirdParty/cgltf-1.13',
+            './ThirdParty/glfw-3.3.8.bin.WIN64/include',
+        }
+
 include "Etc2Compress"
 include "External.lua"
\ No newline at end of file